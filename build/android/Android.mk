@@ -32,6 +32,10 @@ LOCAL_SRC_FILES := \
 	presence.c \
 	proxy.c \
 	friend.c \
+	hashtable.c \
+	timerwheel.c \
+	tunnelchannel.c \
+	profiling.c \
 	authentication.c \
 	lpconfig.c \
 	chat.c \
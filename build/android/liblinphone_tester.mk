@@ -16,7 +16,8 @@ common_SRC_FILES := \
 	quality_reporting_tester.c \
 	log_collection_tester.c \
 	transport_tester.c \
-	player_tester.c
+	player_tester.c \
+	offeranswer_tester.c
 
 common_C_INCLUDES += \
         $(LOCAL_PATH) \
@@ -106,6 +106,7 @@ static int lpc_cmd_ringback(LinphoneCore *lc, char *args);
 static int lpc_cmd_conference(LinphoneCore *lc, char *args);
 static int lpc_cmd_zrtp_verified(LinphoneCore *lc, char *args);
 static int lpc_cmd_zrtp_unverified(LinphoneCore *lc, char *args);
+static int lpc_cmd_profiling(LinphoneCore *lc, char *args);
 
 /* Command handler helpers */
 static void linphonec_proxy_add(LinphoneCore *lc);
@@ -362,6 +363,12 @@ static LPC_COMMAND advanced_commands[] = {
 	{ "zrtp-set-unverified", lpc_cmd_zrtp_unverified,"Set ZRTP SAS not verified.",
 		"'Set ZRTP SAS not verified'\n"
 	},
+	{ "profiling", lpc_cmd_profiling, "Measure the time spent in the main loop",
+		"'profiling enable'\t: start measuring the sections of the main loop\n"
+		"'profiling disable'\t: stop measuring\n"
+		"'profiling reset'\t: clear the measures and the counters\n"
+		"'profiling show'\t: print count, average, maximum, median and 99th percentile of each section, in microseconds\n"
+	},
 	{	NULL,NULL,NULL,NULL}
 };
 
@@ -2619,6 +2626,47 @@ static int lpc_cmd_zrtp_unverified(LinphoneCore *lc, char *args){
 	return zrtp_set_verified(lc,args,FALSE);
 }
 
+/*upper bound of the histogram bucket holding the requested percentile*/
+static unsigned int profiling_percentile(const LinphoneProfilingHistogram *h, int percent){
+	unsigned int threshold=(unsigned int)(((uint64_t)h->count*percent+99)/100);
+	unsigned int cumulated=0;
+	int i;
+	for(i=0;i<LINPHONE_PROFILING_HISTOGRAM_SIZE-1;i++){
+		cumulated+=h->buckets[i];
+		if (cumulated>=threshold) return ((1U<<i)<h->max) ? (1U<<i) : h->max;
+	}
+	return h->max;
+}
+
+static int lpc_cmd_profiling(LinphoneCore *lc, char *args){
+	int i;
+	if (!args) return 0;
+	if (strcmp(args,"enable")==0){
+		linphone_core_enable_profiling(lc,TRUE);
+	}else if (strcmp(args,"disable")==0){
+		linphone_core_enable_profiling(lc,FALSE);
+	}else if (strcmp(args,"reset")==0){
+		linphone_core_reset_profiling(lc);
+	}else if (strcmp(args,"show")==0){
+		if (!linphone_core_profiling_enabled(lc)){
+			linphonec_out("Profiling is disabled.\n");
+		}else{
+			linphonec_out("%-12s %10s %10s %10s %10s %10s\n","section","count","avg","max","p50","p99");
+			for(i=0;i<LinphoneProfilingSectionCount;i++){
+				LinphoneProfilingHistogram h;
+				linphone_core_get_profiling_histogram(lc,(LinphoneProfilingSection)i,&h);
+				linphonec_out("%-12s %10u %10u %10u %10u %10u\n",linphone_profiling_section_to_string((LinphoneProfilingSection)i),
+					h.count,h.count ? (unsigned int)(h.total/h.count) : 0,h.max,profiling_percentile(&h,50),profiling_percentile(&h,99));
+			}
+		}
+		for(i=0;i<LinphoneProfilingCounterCount;i++){
+			linphonec_out("%-20s %10lu\n",linphone_profiling_counter_to_string((LinphoneProfilingCounter)i),
+				(unsigned long)linphone_core_get_profiling_counter(lc,(LinphoneProfilingCounter)i));
+		}
+	}else return 0;
+	return 1;
+}
+
 /***************************************************************************
  *
  *  Command table management funx
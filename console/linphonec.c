@@ -435,6 +435,7 @@ static void *prompt_reader_thread(void *arg){
 		strcpy(received_prompt,ret);
 		have_prompt=TRUE;
 		ms_mutex_unlock(&prompt_mutex);
+		linphone_core_wakeup(linphonec);
 	}
 	return NULL;
 }
@@ -484,6 +485,7 @@ static void *pipe_thread(void*p){
 				printf("Receiving command '%s'\n",received_prompt);fflush(stdout);
 				have_prompt=TRUE;
 				ortp_mutex_unlock(&prompt_mutex);
+				linphone_core_wakeup(linphonec);
 			}else{
 				printf("read nothing\n");fflush(stdout);
 				ortp_server_pipe_close_client(client_sock);
@@ -559,7 +561,8 @@ char *linphonec_readline(char *prompt){
 				}
 			}
 #else
-			usleep(20000);
+			/*sleep until the core has work to do or a command is received*/
+			linphone_core_wait(linphonec,1000);
 #endif
 		}
 	}else{
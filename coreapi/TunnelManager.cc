@@ -65,13 +65,48 @@ void TunnelManager::reconnect(){
 		mTunnelClient->reconnect();
 }
 
-static void sCloseRtpTransport(RtpTransport *t, void *userData){
-	TunnelSocket *s=(TunnelSocket*)userData;
+static int sTunnelChannelSendto(void *socket, const uint8_t *data, size_t len, const struct sockaddr *to, socklen_t tolen){
+	return ((TunnelSocket*)socket)->sendto(data,len,to,tolen);
+}
+
+static int sTunnelChannelRecvfrom(void *socket, uint8_t *buf, size_t size, struct sockaddr *from, socklen_t fromlen){
+	return ((TunnelSocket*)socket)->recvfrom(buf,size,from,fromlen);
+}
+
+void TunnelManager::closeChannelSocket(void *socket){
+	TunnelSocket *s=(TunnelSocket*)socket;
 	TunnelManager *manager=(TunnelManager*)s->getUserPointer();
-	manager->closeRtpTransport(t, s);
+	manager->mTunnelClient->closeSocket(s);
+}
+
+/*
+ * RtpTransport given to oRTP, extended with the buffer used to gather fragmented packets
+ * before they are written to the tunnel socket.
+ */
+struct TunnelRtpTransport{
+	RtpTransport base; /*must be first*/
+	LinphoneSendBuffer sendBuffer;
+	TunnelManager *manager;
+	LinphoneTunnelChannel *channel; /*NULL unless the flow is multiplexed*/
+	uint16_t streamId;
+};
+
+static void sCloseRtpTransport(RtpTransport *t, void *userData){
+	/*the socket of a multiplexed flow may have been destroyed with its tunnel client already: do not touch userData*/
+	((TunnelRtpTransport*)t)->manager->closeRtpTransport(t, (TunnelSocket*)userData);
 }
 void TunnelManager::closeRtpTransport(RtpTransport *t, TunnelSocket *s){
-	mTunnelClient->closeSocket(s);
+	TunnelRtpTransport *tt=(TunnelRtpTransport*)t;
+	LinphoneTunnelChannel *channel=tt->channel;
+	if (channel==NULL){
+		mTunnelClient->closeSocket(s);
+		return;
+	}
+	tt->channel=NULL;
+	if (linphone_tunnel_channel_remove_stream(channel,tt->streamId)){
+		if (channel==mRtpChannel) mRtpChannel=NULL;
+		linphone_tunnel_channel_destroy(channel);
+	}
 }
 
 static RtpTransport *sCreateRtpTransport(void* userData, int port){
@@ -79,13 +114,29 @@ static RtpTransport *sCreateRtpTransport(void* userData, int port){
 }
 
 void sDestroyRtpTransport(RtpTransport *t){
+	linphone_send_buffer_uninit(&((TunnelRtpTransport*)t)->sendBuffer);
 	ms_free(t);
 }
 
 RtpTransport *TunnelManager::createRtpTransport(int port){
-	TunnelSocket *socket=mTunnelClient->createSocket(port);
-	socket->setUserPointer(this);
-	RtpTransport *t=ms_new0(RtpTransport,1);
+	TunnelRtpTransport *tt=ms_new0(TunnelRtpTransport,1);
+	TunnelSocket *socket;
+	tt->manager=this;
+	if (mRtpMultiplexing){
+		if (mRtpChannel==NULL){
+			socket=mTunnelClient->createSocket(port);
+			socket->setUserPointer(this);
+			mRtpChannel=linphone_tunnel_channel_new(socket,sTunnelChannelSendto,sTunnelChannelRecvfrom,closeChannelSocket);
+		}
+		tt->channel=mRtpChannel;
+		tt->streamId=linphone_tunnel_channel_add_stream(mRtpChannel);
+		socket=(TunnelSocket*)linphone_tunnel_channel_get_socket(mRtpChannel);
+		ms_message("TunnelManager: flow on port %i multiplexed as stream %i",port,tt->streamId);
+	}else{
+		socket=mTunnelClient->createSocket(port);
+		socket->setUserPointer(this);
+	}
+	RtpTransport *t=&tt->base;
 	t->t_getsocket=NULL;
 	t->t_recvfrom=customRecvfrom;
 	t->t_sendto=customSendto;
@@ -95,6 +146,13 @@ RtpTransport *TunnelManager::createRtpTransport(int port){
 	return t;
 }
 
+/*the socket of the channel is destroyed together with the tunnel client, streams still open keep the channel alive*/
+void TunnelManager::detachRtpChannel(){
+	if (mRtpChannel==NULL) return;
+	linphone_tunnel_channel_detach_socket(mRtpChannel);
+	mRtpChannel=NULL;
+}
+
 void TunnelManager::startClient() {
 	ms_message("TunnelManager: Starting tunnel client");
 	mTunnelClient = new TunnelClient();
@@ -113,15 +171,23 @@ bool TunnelManager::isConnected() const {
 }
 
 int TunnelManager::customSendto(struct _RtpTransport *t, mblk_t *msg , int flags, const struct sockaddr *to, socklen_t tolen){
-	int size;
-	msgpullup(msg,-1);
-	size=msgdsize(msg);
-	((TunnelSocket*)t->data)->sendto(msg->b_rptr,size,to,tolen);
-	return size;
+	TunnelRtpTransport *tt=(TunnelRtpTransport*)t;
+	size_t size;
+	if (tt->channel) return linphone_tunnel_channel_sendto(tt->channel,tt->streamId,&tt->sendBuffer,msg,to,tolen);
+	/*the RTP header and payload usually come in separate fragments: gather them into the transport's buffer
+	instead of pulling the message up, which would allocate and copy a new block for every packet*/
+	const uint8_t *data=linphone_send_buffer_gather(&tt->sendBuffer,msg,&size);
+	((TunnelSocket*)t->data)->sendto(data,size,to,tolen);
+	return (int)size;
 }
 
 int TunnelManager::customRecvfrom(struct _RtpTransport *t, mblk_t *msg, int flags, struct sockaddr *from, socklen_t *fromlen){
-	int err=((TunnelSocket*)t->data)->recvfrom(msg->b_wptr,msg->b_datap->db_lim-msg->b_datap->db_base,from,*fromlen);
+	TunnelRtpTransport *tt=(TunnelRtpTransport*)t;
+	int err;
+	if (tt->channel)
+		err=linphone_tunnel_channel_recvfrom(tt->channel,tt->streamId,msg->b_wptr,msg->b_datap->db_lim-msg->b_datap->db_base,from,*fromlen);
+	else
+		err=((TunnelSocket*)t->data)->recvfrom(msg->b_wptr,msg->b_datap->db_lim-msg->b_datap->db_base,from,*fromlen);
 	if (err>0) return err;
 	return 0;
 }
@@ -136,7 +202,9 @@ TunnelManager::TunnelManager(LinphoneCore* lc) :
 	mMode(LinphoneTunnelModeDisable),
 	mState(disabled),
 	mTunnelizeSipPackets(true),
+	mRtpMultiplexing(false),
 	mTunnelClient(NULL),
+	mRtpChannel(NULL),
 	mHttpProxyPort(0),
 	mVTable(NULL)
 {
@@ -158,6 +226,7 @@ TunnelManager::~TunnelManager(){
 	for(UdpMirrorClientList::iterator udpMirror = mUdpMirrorClients.begin(); udpMirror != mUdpMirrorClients.end(); udpMirror++) {
 		udpMirror->stop();
 	}
+	detachRtpChannel();
 	if(mTunnelClient) delete mTunnelClient;
 	linphone_core_remove_listener(mCore, mVTable);
 	linphone_core_v_table_destroy(mVTable);
@@ -223,6 +292,7 @@ void TunnelManager::setMode(LinphoneTunnelMode mode) {
 				doUnregistration();
 				sal_disable_tunnel(mCore->sal);
 			}
+			detachRtpChannel();
 			delete mTunnelClient;
 			mTunnelClient=NULL;
 			if(mTunnelizeSipPackets) {
@@ -327,6 +397,7 @@ void TunnelManager::processUdpMirrorEvent(const Event &ev){
 		ms_message("TunnelManager: UDP mirror test succeed");
 		if(mTunnelClient) {
 			if(mTunnelizeSipPackets) doUnregistration();
+			detachRtpChannel();
 			delete mTunnelClient;
 			mTunnelClient = NULL;
 			if(mTunnelizeSipPackets) doRegistration();
@@ -399,6 +470,14 @@ bool TunnelManager::tunnelizeSipPacketsEnabled() const {
 	return mTunnelizeSipPackets;
 }
 
+void TunnelManager::enableRtpMultiplexing(bool enable){
+	mRtpMultiplexing = enable;
+}
+
+bool TunnelManager::rtpMultiplexingEnabled() const {
+	return mRtpMultiplexing;
+}
+
 void TunnelManager::setHttpProxy(const char *host,int port, const char *username, const char *passwd){
 	mHttpUserName=username?username:"";
 	mHttpPasswd=passwd?passwd:"";
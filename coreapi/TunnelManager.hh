@@ -23,6 +23,8 @@ extern "C" {
 }
 #endif
 
+struct _LinphoneTunnelChannel;
+
 namespace belledonnecomm {
 /**
  * @addtogroup tunnel_client
@@ -110,6 +112,19 @@ namespace belledonnecomm {
 		 * @return True, SIP packets pass through the tunnel
 		 */
 		bool tunnelizeSipPacketsEnabled() const;
+		/**
+		 * Indicate to the tunnel manager whether the RTP and RTCP flows of the calls must be multiplexed
+		 * over a single tunnel socket instead of using one socket per flow.
+		 * Each packet is then prefixed with a 2 bytes stream identifier, which requires a tunnel server
+		 * supporting this mode. The setting applies to the streams created afterwards.
+		 * @param enable If set to TRUE, RTP and RTCP flows share one tunnel socket.
+		 */
+		void enableRtpMultiplexing(bool enable);
+		/**
+		 * @brief Check whether the tunnel manager multiplexes RTP and RTCP flows over a single tunnel socket
+		 * @return True, RTP and RTCP flows share one tunnel socket
+		 */
+		bool rtpMultiplexingEnabled() const;
 		/**
 		 * @brief Constructor
 		 * @param lc The LinphoneCore instance of which the TunnelManager will be associated to.
@@ -171,6 +186,7 @@ namespace belledonnecomm {
 		static void sOnIterate(TunnelManager *zis);
 		static void sUdpMirrorClientCallback(bool result, void* data);
 		static void networkReachableCb(LinphoneCore *lc, bool_t reachable);
+		static void closeChannelSocket(void *socket);
 
 	private:
 		void onIterate();
@@ -181,13 +197,16 @@ namespace belledonnecomm {
 		void processTunnelEvent(const Event &ev);
 		void processUdpMirrorEvent(const Event &ev);
 		void postEvent(const Event &ev);
+		void detachRtpChannel();
 
 	private:
 		LinphoneCore* mCore;
 		LinphoneTunnelMode mMode;
 		State mState;
 		bool mTunnelizeSipPackets;
+		bool mRtpMultiplexing;
 		TunnelClient* mTunnelClient;
+		struct _LinphoneTunnelChannel* mRtpChannel;
 		std::string mHttpUserName;
 		std::string mHttpPasswd;
 		std::string mHttpProxyHost;
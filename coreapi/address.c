@@ -182,6 +182,17 @@ bool_t linphone_address_weak_equal(const LinphoneAddress *a1, const LinphoneAddr
 	return strings_equals(u1,u2) && strings_equals(h1,h2) && p1==p2;
 }
 
+/*
+ * Returns a string built from the parts compared by linphone_address_weak_equal(), to be used as a hash table key.
+ * A missing username or domain gives the same key as an empty one, so lookups must be confirmed with
+ * linphone_address_weak_equal().
+**/
+char *linphone_address_as_weak_key(const LinphoneAddress *addr){
+	const char *username=linphone_address_get_username(addr);
+	const char *domain=linphone_address_get_domain(addr);
+	return ms_strdup_printf("%s@%s:%i",username ? username : "",domain ? domain : "",linphone_address_get_port(addr));
+}
+
 /**
  * Destroys a LinphoneAddress object (actually calls linphone_address_unref()).
  * @deprecated Use linphone_address_unref() instead
@@ -31,6 +31,21 @@
  * @{
 **/
 
+static void linphone_core_index_auth_info(LinphoneCore *lc, LinphoneAuthInfo *ai);
+static void linphone_core_unindex_auth_info(LinphoneCore *lc, LinphoneAuthInfo *ai);
+
+/*the ha1 computed from the password no longer matches the credentials once one of them changes*/
+static void linphone_auth_info_clear_cached_ha1(LinphoneAuthInfo *info){
+	if (info->cached_ha1!=NULL){
+		ms_free(info->cached_ha1);
+		info->cached_ha1=NULL;
+	}
+	if (info->cached_ha1_realm!=NULL){
+		ms_free(info->cached_ha1_realm);
+		info->cached_ha1_realm=NULL;
+	}
+}
+
 LinphoneAuthInfo *linphone_auth_info_new(const char *username, const char *userid, const char *passwd, const char *ha1, const char *realm, const char *domain){
 	LinphoneAuthInfo *obj=ms_new0(LinphoneAuthInfo,1);
 	if (username!=NULL && (strlen(username)>0) ) obj->username=ms_strdup(username);
@@ -83,14 +98,19 @@ void linphone_auth_info_set_passwd(LinphoneAuthInfo *info, const char *passwd){
 		info->passwd=NULL;
 	}
 	if (passwd!=NULL && (strlen(passwd)>0)) info->passwd=ms_strdup(passwd);
+	linphone_auth_info_clear_cached_ha1(info);
 }
 
 void linphone_auth_info_set_username(LinphoneAuthInfo *info, const char *username){
+	/*the auth infos of a core are indexed by username, realm and domain*/
+	if (info->lc) linphone_core_unindex_auth_info(info->lc,info);
 	if (info->username){
 		ms_free(info->username);
 		info->username=NULL;
 	}
 	if (username && strlen(username)>0) info->username=ms_strdup(username);
+	linphone_auth_info_clear_cached_ha1(info);
+	if (info->lc) linphone_core_index_auth_info(info->lc,info);
 }
 
 void linphone_auth_info_set_userid(LinphoneAuthInfo *info, const char *userid){
@@ -99,22 +119,27 @@ void linphone_auth_info_set_userid(LinphoneAuthInfo *info, const char *userid){
 		info->userid=NULL;
 	}
 	if (userid && strlen(userid)>0) info->userid=ms_strdup(userid);
+	linphone_auth_info_clear_cached_ha1(info);
 }
 
 void linphone_auth_info_set_realm(LinphoneAuthInfo *info, const char *realm){
+	if (info->lc) linphone_core_unindex_auth_info(info->lc,info);
 	if (info->realm){
 		ms_free(info->realm);
 		info->realm=NULL;
 	}
 	if (realm && strlen(realm)>0) info->realm=ms_strdup(realm);
+	if (info->lc) linphone_core_index_auth_info(info->lc,info);
 }
 
 void linphone_auth_info_set_domain(LinphoneAuthInfo *info, const char *domain){
+	if (info->lc) linphone_core_unindex_auth_info(info->lc,info);
 	if (info->domain){
 		ms_free(info->domain);
 		info->domain=NULL;
 	}
 	if (domain && strlen(domain)>0) info->domain=ms_strdup(domain);
+	if (info->lc) linphone_core_index_auth_info(info->lc,info);
 }
 
 void linphone_auth_info_set_ha1(LinphoneAuthInfo *info, const char *ha1){
@@ -135,9 +160,26 @@ void linphone_auth_info_destroy(LinphoneAuthInfo *obj){
 	if (obj->ha1!=NULL) ms_free(obj->ha1);
 	if (obj->realm!=NULL) ms_free(obj->realm);
 	if (obj->domain!=NULL) ms_free(obj->domain);
+	linphone_auth_info_clear_cached_ha1(obj);
 	ms_free(obj);
 }
 
+/*
+ * Returns the ha1 to answer a challenge for the given realm.
+ * When only the password is known, the ha1 is computed once and kept until a challenge comes with another realm.
+ */
+const char *linphone_auth_info_get_challenge_ha1(LinphoneAuthInfo *info, const char *realm){
+	if (info->ha1!=NULL) return info->ha1;
+	if (info->passwd==NULL || realm==NULL || (info->userid==NULL && info->username==NULL)) return NULL;
+	if (info->cached_ha1==NULL || strcmp(info->cached_ha1_realm,realm)!=0){
+		if (info->cached_ha1==NULL) info->cached_ha1=ms_malloc(33);
+		if (info->cached_ha1_realm!=NULL) ms_free(info->cached_ha1_realm);
+		sal_auth_compute_ha1(info->userid?info->userid:info->username,realm,info->passwd,info->cached_ha1);
+		info->cached_ha1_realm=ms_strdup(realm);
+	}
+	return info->cached_ha1;
+}
+
 void linphone_auth_info_write_config(LpConfig *config, LinphoneAuthInfo *obj, int pos)
 {
 	char key[50];
@@ -192,60 +234,109 @@ LinphoneAuthInfo *linphone_auth_info_new_from_config_file(LpConfig * config, int
 	return ret;
 }
 
-static char * remove_quotes(char * input){
-	char *tmp;
-	if (*input=='"') input++;
-	tmp=strchr(input,'"');
-	if (tmp) *tmp='\0';
-	return input;
-}
-
-static int realm_match(const char *realm1, const char *realm2){
-	if (realm1==NULL && realm2==NULL) return TRUE;
-	if (realm1!=NULL && realm2!=NULL){
-		if (strcmp(realm1,realm2)==0) return TRUE;
-		else{
-			char tmp1[128];
-			char tmp2[128];
-			char *p1,*p2;
-			strncpy(tmp1,realm1,sizeof(tmp1)-1);
-			strncpy(tmp2,realm2,sizeof(tmp2)-1);
-			p1=remove_quotes(tmp1);
-			p2=remove_quotes(tmp2);
-			return strcmp(p1,p2)==0;
-		}
+/*the index keys are made of the username and the realm without quotes, or the domain*/
+static char *auth_info_key(const char *username, const char *value, bool_t is_realm){
+	const char *end=NULL;
+	if (is_realm){
+		if (*value=='"') value++;
+		end=strchr(value,'"');
 	}
-	return FALSE;
+	if (end==NULL) end=value+strlen(value);
+	return ms_strdup_printf("%s\n%.*s",username,(int)(end-value),value);
 }
 
+static int auth_info_compare_pos(const void *a, const void *b){
+	return ((const LinphoneAuthInfo*)a)->pos-((const LinphoneAuthInfo*)b)->pos;
+}
+
+static void auth_info_index_add(LinphoneHashTable **table, char *key, LinphoneAuthInfo *ai){
+	MSList *l;
+	if (*table==NULL) *table=linphone_hash_table_new_for_strings();
+	l=(MSList*)linphone_hash_table_lookup(*table,key);
+	l=ms_list_insert_sorted(l,ai,auth_info_compare_pos);
+	linphone_hash_table_insert(*table,key,l);
+	ms_free(key);
+}
+
+static void auth_info_index_remove(LinphoneHashTable *table, char *key, LinphoneAuthInfo *ai){
+	MSList *l=(MSList*)linphone_hash_table_lookup(table,key);
+	l=ms_list_remove(l,ai);
+	if (l!=NULL) linphone_hash_table_insert(table,key,l);
+	else linphone_hash_table_remove(table,key);
+	ms_free(key);
+}
+
+static MSList *auth_info_index_lookup(const LinphoneHashTable *table, const char *username, const char *value, bool_t is_realm){
+	MSList *l;
+	char *key;
+	if (table==NULL) return NULL;
+	key=value ? auth_info_key(username,value,is_realm) : ms_strdup(username);
+	l=(MSList*)linphone_hash_table_lookup(table,key);
+	ms_free(key);
+	return l;
+}
+
+static void linphone_core_index_auth_info(LinphoneCore *lc, LinphoneAuthInfo *ai){
+	/*auth infos without username can never be found*/
+	if (ai->username==NULL) return;
+	auth_info_index_add(&lc->auth_info_by_username,ms_strdup(ai->username),ai);
+	if (ai->realm) auth_info_index_add(&lc->auth_info_by_realm,auth_info_key(ai->username,ai->realm,TRUE),ai);
+	if (ai->domain) auth_info_index_add(&lc->auth_info_by_domain,auth_info_key(ai->username,ai->domain,FALSE),ai);
+}
+
+static void linphone_core_unindex_auth_info(LinphoneCore *lc, LinphoneAuthInfo *ai){
+	if (ai->username==NULL) return;
+	auth_info_index_remove(lc->auth_info_by_username,ms_strdup(ai->username),ai);
+	if (ai->realm) auth_info_index_remove(lc->auth_info_by_realm,auth_info_key(ai->username,ai->realm,TRUE),ai);
+	if (ai->domain) auth_info_index_remove(lc->auth_info_by_domain,auth_info_key(ai->username,ai->domain,FALSE),ai);
+}
+
+static void free_auth_info_index_entry(const void *key, void *value, void *user_data){
+	ms_list_free((MSList*)value);
+}
+
+static void auth_info_index_destroy(LinphoneHashTable **table){
+	if (*table==NULL) return;
+	linphone_hash_table_for_each(*table,free_auth_info_index_entry,NULL);
+	linphone_hash_table_destroy(*table);
+	*table=NULL;
+}
+
+void linphone_core_free_auth_infos(LinphoneCore *lc){
+	auth_info_index_destroy(&lc->auth_info_by_username);
+	auth_info_index_destroy(&lc->auth_info_by_realm);
+	auth_info_index_destroy(&lc->auth_info_by_domain);
+	lc->auth_info=ms_list_free_with_data(lc->auth_info,(void (*)(void*))linphone_auth_info_destroy);
+}
+
+/*
+ * The candidates are those with the same username and realm (or domain), in the order of lc->auth_info.
+ * As in this list, the first matching one is returned, except for the realm alone that must match a single auth info.
+ */
 static const LinphoneAuthInfo *find_auth_info(LinphoneCore *lc, const char *username, const char *realm, const char *domain){
 	MSList *elem;
-	const LinphoneAuthInfo *ret=NULL;
-
-	for (elem=lc->auth_info;elem!=NULL;elem=elem->next) {
-		LinphoneAuthInfo *pinfo = (LinphoneAuthInfo*)elem->data;
-		if (username && pinfo->username && strcmp(username,pinfo->username)==0) {
-			if (realm && domain){
-				if (pinfo->realm && strcmp(realm,pinfo->realm)==0
-					&& pinfo->domain && strcmp(domain,pinfo->domain)==0) {
-					return pinfo;
-				}
-			} else if (realm) {
-				if (pinfo->realm && realm_match(realm,pinfo->realm)) {
-					if (ret!=NULL) {
-						ms_warning("Non unique realm found for %s",username);
-						return NULL;
-					}
-					ret=pinfo;
-				}
-			} else if (domain && pinfo->domain && strcmp(domain,pinfo->domain)==0) {
-				return pinfo;
-			} else if (!domain) {
+
+	if (username==NULL) return NULL;
+	if (realm && domain){
+		for (elem=auth_info_index_lookup(lc->auth_info_by_realm,username,realm,TRUE);elem!=NULL;elem=elem->next){
+			LinphoneAuthInfo *pinfo = (LinphoneAuthInfo*)elem->data;
+			if (strcmp(realm,pinfo->realm)==0 && pinfo->domain && strcmp(domain,pinfo->domain)==0) {
 				return pinfo;
 			}
 		}
+		return NULL;
+	} else if (realm) {
+		elem=auth_info_index_lookup(lc->auth_info_by_realm,username,realm,TRUE);
+		if (elem!=NULL && elem->next!=NULL) {
+			ms_warning("Non unique realm found for %s",username);
+			return NULL;
+		}
+	} else if (domain) {
+		elem=auth_info_index_lookup(lc->auth_info_by_domain,username,domain,FALSE);
+	} else {
+		elem=auth_info_index_lookup(lc->auth_info_by_username,username,NULL,FALSE);
 	}
-	return ret;
+	return elem ? (const LinphoneAuthInfo*)elem->data : NULL;
 }
 
 /**
@@ -274,12 +365,14 @@ const LinphoneAuthInfo *linphone_core_find_auth_info(LinphoneCore *lc, const cha
 	return ai;
 }
 
-static void write_auth_infos(LinphoneCore *lc){
-	MSList *elem;
+/*writes the auth infos from the given position to the end of the list*/
+static void write_auth_infos(LinphoneCore *lc, int from){
+	MSList *elem=lc->auth_info;
 	int i;
 
 	if (!linphone_core_ready(lc)) return;
-	for(elem=lc->auth_info,i=0;elem!=NULL;elem=ms_list_next(elem),i++){
+	for(i=0;i<from && elem!=NULL;i++) elem=ms_list_next(elem);
+	for(;elem!=NULL;elem=ms_list_next(elem),i++){
 		LinphoneAuthInfo *ai=(LinphoneAuthInfo*)(elem->data);
 		linphone_auth_info_write_config(lc->config,ai,i);
 	}
@@ -297,6 +390,7 @@ LinphoneAuthInfo * linphone_core_create_auth_info(LinphoneCore *lc, const char *
 **/
 void linphone_core_add_auth_info(LinphoneCore *lc, const LinphoneAuthInfo *info){
 	LinphoneAuthInfo *ai;
+	LinphoneAuthInfo *new_ai=linphone_auth_info_clone(info);
 	MSList *elem;
 	MSList *l;
 	int restarted_op_count=0;
@@ -304,16 +398,24 @@ void linphone_core_add_auth_info(LinphoneCore *lc, const LinphoneAuthInfo *info)
 
 	if (info->ha1==NULL && info->passwd==NULL){
 		ms_error("linphone_core_add_auth_info(): info supplied with empty password or ha1.");
+		linphone_auth_info_destroy(new_ai);
 		return;
 	}
 	/* find if we are attempting to modify an existing auth info */
 	ai=(LinphoneAuthInfo*)linphone_core_find_auth_info(lc,info->realm,info->username,info->domain);
 	if (ai!=NULL && ai->domain && info->domain && strcmp(ai->domain, info->domain)==0){
-		lc->auth_info=ms_list_remove(lc->auth_info,ai);
+		/*the updated auth info keeps its position, so that only its own config section is written again*/
+		new_ai->pos=ai->pos;
+		linphone_core_unindex_auth_info(lc,ai);
+		ms_list_find(lc->auth_info,ai)->data=new_ai;
 		linphone_auth_info_destroy(ai);
 		updating=TRUE;
+	}else{
+		new_ai->pos=ms_list_size(lc->auth_info);
+		lc->auth_info=ms_list_append(lc->auth_info,new_ai);
 	}
-	lc->auth_info=ms_list_append(lc->auth_info,linphone_auth_info_clone(info));
+	new_ai->lc=lc;
+	linphone_core_index_auth_info(lc,new_ai);
 
 	/* retry pending authentication operations */
 	for(l=elem=sal_get_pending_auths(lc->sal);elem!=NULL;elem=elem->next){
@@ -352,7 +454,8 @@ void linphone_core_add_auth_info(LinphoneCore *lc, const LinphoneAuthInfo *info)
 			info->domain ? info->domain : "");
 	}
 	ms_list_free(l);
-	write_auth_infos(lc);
+	if (!updating) write_auth_infos(lc,new_ai->pos);
+	else if (linphone_core_ready(lc)) linphone_auth_info_write_config(lc->config,new_ai,new_ai->pos);
 }
 
 
@@ -370,9 +473,17 @@ void linphone_core_remove_auth_info(LinphoneCore *lc, const LinphoneAuthInfo *in
 	LinphoneAuthInfo *r;
 	r=(LinphoneAuthInfo*)linphone_core_find_auth_info(lc,info->realm,info->username,info->domain);
 	if (r){
+		int pos=r->pos;
+		MSList *elem;
+		linphone_core_unindex_auth_info(lc,r);
 		lc->auth_info=ms_list_remove(lc->auth_info,r);
 		linphone_auth_info_destroy(r);
-		write_auth_infos(lc);
+		/*the following auth infos move up by one config section*/
+		for(elem=lc->auth_info;elem!=NULL;elem=elem->next){
+			LinphoneAuthInfo *ai=(LinphoneAuthInfo*)elem->data;
+			if (ai->pos>pos) ai->pos--;
+		}
+		write_auth_infos(lc,pos);
 	}
 }
 
@@ -392,12 +503,9 @@ void linphone_core_clear_all_auth_info(LinphoneCore *lc){
 	MSList *elem;
 	int i;
 	for(i=0,elem=lc->auth_info;elem!=NULL;elem=ms_list_next(elem),i++){
-		LinphoneAuthInfo *info=(LinphoneAuthInfo*)elem->data;
-		linphone_auth_info_destroy(info);
 		linphone_auth_info_write_config(lc->config,NULL,i);
 	}
-	ms_list_free(lc->auth_info);
-	lc->auth_info=NULL;
+	linphone_core_free_auth_infos(lc);
 }
 
 /**
@@ -174,6 +174,7 @@ void sal_process_authentication(SalOp *op) {
 static void process_dialog_terminated(void *sal, const belle_sip_dialog_terminated_event_t *event){
 	belle_sip_dialog_t* dialog =  belle_sip_dialog_terminated_event_get_dialog(event);
 	SalOp* op = belle_sip_dialog_get_application_data(dialog);
+	sal_interrupt_wait((Sal*)sal);
 	if (op && op->callbacks && op->callbacks->process_dialog_terminated) {
 		op->callbacks->process_dialog_terminated(op,event);
 	} else {
@@ -184,6 +185,7 @@ static void process_dialog_terminated(void *sal, const belle_sip_dialog_terminat
 static void process_io_error(void *user_ctx, const belle_sip_io_error_event_t *event){
 	belle_sip_client_transaction_t*client_transaction;
 	SalOp* op;
+	sal_interrupt_wait((Sal*)user_ctx);
 	if (BELLE_SIP_OBJECT_IS_INSTANCE_OF(belle_sip_io_error_event_get_source(event),belle_sip_client_transaction_t)) {
 		client_transaction=BELLE_SIP_CLIENT_TRANSACTION(belle_sip_io_error_event_get_source(event));
 		op = (SalOp*)belle_sip_transaction_get_application_data(BELLE_SIP_TRANSACTION(client_transaction));
@@ -212,6 +214,8 @@ static void process_request_event(void *ud, const belle_sip_request_event_t *eve
 	const char *method=belle_sip_request_get_method(req);
 	belle_sip_header_contact_t* remote_contact = belle_sip_message_get_header_by_type(req, belle_sip_header_contact_t);
 
+	sal_interrupt_wait(sal);
+	sal->nb_requests_received++;
 	from_header=belle_sip_message_get_header_by_type(BELLE_SIP_MESSAGE(req),belle_sip_header_from_t);
 
 	if (dialog) {
@@ -315,6 +319,8 @@ static void process_response_event(void *user_ctx, const belle_sip_response_even
 	belle_sip_response_t* response = belle_sip_response_event_get_response(event);
 	int response_code = belle_sip_response_get_status_code(response);
 
+	sal_interrupt_wait((Sal*)user_ctx);
+	((Sal*)user_ctx)->nb_responses_received++;
 	if (!client_transaction) {
 		ms_warning("Discarding stateless response [%i]",response_code);
 		return;
@@ -385,6 +391,7 @@ static void process_response_event(void *user_ctx, const belle_sip_response_even
 static void process_timeout(void *user_ctx, const belle_sip_timeout_event_t *event) {
 	belle_sip_client_transaction_t* client_transaction = belle_sip_timeout_event_get_client_transaction(event);
 	SalOp* op = (SalOp*)belle_sip_transaction_get_application_data(BELLE_SIP_TRANSACTION(client_transaction));
+	sal_interrupt_wait((Sal*)user_ctx);
 	if (op && op->callbacks && op->callbacks->process_timeout) {
 		op->callbacks->process_timeout(op,event);
 	} else {
@@ -398,6 +405,7 @@ static void process_transaction_terminated(void *user_ctx, const belle_sip_trans
 	belle_sip_transaction_t* trans;
 	SalOp* op;
 
+	sal_interrupt_wait((Sal*)user_ctx);
 	if(client_transaction)
 		trans=BELLE_SIP_TRANSACTION(client_transaction);
 	 else
@@ -424,6 +432,57 @@ static void process_auth_requested(void *sal, belle_sip_auth_event_t *event) {
 	sal_auth_info_delete(auth_info);
 }
 
+static int process_wakeup(void *data, unsigned int events){
+	Sal *sal=(Sal*)data;
+	char buf[32];
+	while(recv(sal->wakeup_socket,buf,sizeof(buf),0)>0){}
+	sal_interrupt_wait(sal);
+	return BELLE_SIP_CONTINUE;
+}
+
+/*
+ * sal_wakeup() sends a datagram to a loopback UDP socket polled by the belle-sip main loop, so that other threads can
+ * end a sal_wait(). A socket rather than a pipe, as the main loop can only poll sockets on Windows.
+ */
+static void sal_init_wakeup(Sal *sal){
+	struct sockaddr_in addr;
+	socklen_t addrlen=sizeof(addr);
+	ortp_socket_t sock=socket(AF_INET,SOCK_DGRAM,0);
+
+	sal->wakeup_socket=(ortp_socket_t)-1;
+	if (sock==(ortp_socket_t)-1){
+		ms_error("Could not create the wakeup socket: %s",getSocketError());
+		return;
+	}
+	memset(&addr,0,sizeof(addr));
+	addr.sin_family=AF_INET;
+	addr.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+	/*connected to itself: what sal_wakeup() sends is received on the same socket*/
+	if (bind(sock,(struct sockaddr*)&addr,sizeof(addr))!=0
+		|| getsockname(sock,(struct sockaddr*)&addr,&addrlen)!=0
+		|| connect(sock,(struct sockaddr*)&addr,addrlen)!=0){
+		ms_error("Could not set up the wakeup socket: %s",getSocketError());
+		close_socket(sock);
+		return;
+	}
+	set_non_blocking_socket(sock);
+	sal->wakeup_socket=sock;
+	sal->wakeup_source=belle_sip_socket_source_new(process_wakeup,sal,sock,BELLE_SIP_EVENT_READ,-1);
+	belle_sip_main_loop_add_source(belle_sip_stack_get_main_loop(sal->stack),sal->wakeup_source);
+}
+
+static void sal_uninit_wakeup(Sal *sal){
+	if (sal->wakeup_source){
+		belle_sip_main_loop_remove_source(belle_sip_stack_get_main_loop(sal->stack),sal->wakeup_source);
+		belle_sip_object_unref(sal->wakeup_source);
+		sal->wakeup_source=NULL;
+	}
+	if (sal->wakeup_socket!=(ortp_socket_t)-1){
+		close_socket(sal->wakeup_socket);
+		sal->wakeup_socket=(ortp_socket_t)-1;
+	}
+}
+
 Sal * sal_init(){
 	belle_sip_listener_callbacks_t listener_callbacks;
 	Sal * sal=ms_new0(Sal,1);
@@ -458,6 +517,7 @@ Sal * sal_init(){
 	sal->tls_verify_cn=TRUE;
 	sal->refresher_retry_after=60000; /*default value in ms*/
 	sal->enable_sip_update=TRUE;
+	sal_init_wakeup(sal);
 	return sal;
 }
 
@@ -530,6 +590,7 @@ void sal_set_callbacks(Sal *ctx, const SalCallbacks *cbs){
 
 
 void sal_uninit(Sal* sal){
+	sal_uninit_wakeup(sal);
 	belle_sip_object_unref(sal->user_agent);
 	belle_sip_object_unref(sal->prov);
 	belle_sip_object_unref(sal->stack);
@@ -750,6 +811,36 @@ int sal_iterate(Sal *sal){
 	belle_sip_stack_sleep(sal->stack,0);
 	return 0;
 }
+
+int sal_wait(Sal *sal, int timeout_ms){
+	sal->waiting=TRUE;
+	belle_sip_stack_sleep(sal->stack,timeout_ms);
+	sal->waiting=FALSE;
+	return 0;
+}
+
+void sal_interrupt_wait(Sal *sal){
+	if (sal->waiting) belle_sip_main_loop_quit(belle_sip_stack_get_main_loop(sal->stack));
+}
+
+void sal_wakeup(Sal *sal){
+	char c=0;
+	if (sal->wakeup_socket!=(ortp_socket_t)-1 && send(sal->wakeup_socket,&c,1,0)<0){
+		ms_warning("Could not send to the wakeup socket: %s",getSocketError());
+	}
+}
+void sal_get_message_counters(const Sal *sal, uint64_t *requests_received, uint64_t *responses_received, uint64_t *requests_sent){
+	*requests_received=sal->nb_requests_received;
+	*responses_received=sal->nb_responses_received;
+	*requests_sent=sal->nb_requests_sent;
+}
+
+void sal_reset_message_counters(Sal *sal){
+	sal->nb_requests_received=0;
+	sal->nb_responses_received=0;
+	sal->nb_requests_sent=0;
+}
+
 MSList * sal_get_pending_auths(Sal *sal){
 	return ms_list_copy(sal->pending_auths);
 }
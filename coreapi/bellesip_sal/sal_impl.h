@@ -53,6 +53,12 @@ struct Sal{
 	bool_t enable_test_features;
 	bool_t no_initial_route;
 	bool_t enable_sip_update; /*true by default*/
+	bool_t waiting; /*a sal_wait() is in progress*/
+	ortp_socket_t wakeup_socket; /*written by sal_wakeup(), polled by the main loop*/
+	belle_sip_source_t *wakeup_source;
+	uint64_t nb_requests_received;
+	uint64_t nb_responses_received;
+	uint64_t nb_requests_sent;
 };
 
 typedef enum SalOpState {
@@ -80,6 +86,21 @@ typedef enum SalOpType {
 
 const char* sal_op_type_to_string(SalOpType type);
 
+typedef struct SalSdpCachePart{
+	uint64_t key;
+	char *text;
+	size_t length;
+}SalSdpCachePart;
+
+#define SAL_SDP_CACHE_MAX_PARTS (SAL_MEDIA_DESCRIPTION_MAX_STREAMS+1)
+
+/*encoded SDP of the last local description sent by an op: session level first, then one part per m-line*/
+typedef struct SalSdpCache{
+	SalSdpCachePart parts[SAL_SDP_CACHE_MAX_PARTS];
+	unsigned int nb_encoded;
+	unsigned int nb_reused;
+}SalSdpCache;
+
 struct SalOp{
 	SalOpBase base;
 	const belle_sip_listener_callbacks_t *callbacks;
@@ -94,6 +115,7 @@ struct SalOp{
 	belle_sip_header_referred_by_t *referred_by;
 	SalMediaDescription *result;
 	belle_sdp_session_description_t *sdp_answer;
+	SalSdpCache *sdp_cache;
 	bool_t supports_session_timers;
 	SalOpState state;
 	SalOpDir dir;
@@ -107,12 +129,17 @@ struct SalOp{
 	bool_t call_released;
 	bool_t manual_refresher;
 	bool_t has_auth_pending;
+	bool_t presence_list; /*subscription to a resource list (RFC 4662)*/
 	int auth_requests; /*number of auth requested for this op*/
 };
 
 
-belle_sdp_session_description_t * media_description_to_sdp(const SalMediaDescription *sal);
-int sdp_to_media_description(belle_sdp_session_description_t  *sdp, SalMediaDescription *desc);
+LINPHONE_PUBLIC belle_sdp_session_description_t * media_description_to_sdp(const SalMediaDescription *sal);
+LINPHONE_PUBLIC int sdp_to_media_description(belle_sdp_session_description_t  *sdp, SalMediaDescription *desc);
+LINPHONE_PUBLIC SalSdpCache * sal_sdp_cache_new(void);
+LINPHONE_PUBLIC void sal_sdp_cache_destroy(SalSdpCache *cache);
+/*encodes desc into a belle_sip_malloc()ed text, re-encoding only the parts that changed since the last call with the same cache*/
+LINPHONE_PUBLIC int media_description_to_sdp_text(const SalMediaDescription *desc, SalSdpCache *cache, char **text, size_t *length);
 belle_sip_request_t* sal_op_build_request(SalOp *op,const char* method);
 
 
@@ -146,6 +173,8 @@ SalReason _sal_reason_from_sip_code(int code);
 void sal_op_set_error_info_from_response(SalOp *op, belle_sip_response_t *response);
 /*presence*/
 void sal_op_presence_fill_cbs(SalOp*op);
+/*notifies the presence of each resource of a multipart resource list notification body, returns the number of resources*/
+LINPHONE_PUBLIC int sal_process_presence_list_notification(SalOp *op, const char *body, size_t body_len, const char *boundary);
 /*messaging*/
 void sal_op_message_fill_cbs(SalOp*op);
 void sal_process_incoming_message(SalOp *op,const belle_sip_request_event_t *event);
@@ -72,9 +72,13 @@ static void sdp_process(SalOp *h){
 	}
 }
 
+static void set_sdp_body(belle_sip_message_t *msg, char *buff, size_t length) {
+	belle_sip_message_add_header(msg,BELLE_SIP_HEADER(belle_sip_header_content_type_create("application","sdp")));
+	belle_sip_message_add_header(msg,BELLE_SIP_HEADER(belle_sip_header_content_length_create(length)));
+	belle_sip_message_assign_body(msg,buff,length);
+}
+
 static int set_sdp(belle_sip_message_t *msg,belle_sdp_session_description_t* session_desc) {
-	belle_sip_header_content_type_t* content_type ;
-	belle_sip_header_content_length_t* content_length;
 	belle_sip_error_code error = BELLE_SIP_BUFFER_OVERFLOW;
 	size_t length = 0;
 
@@ -82,7 +86,6 @@ static int set_sdp(belle_sip_message_t *msg,belle_sdp_session_description_t* ses
 		size_t bufLen = 2048;
 		size_t hardlimit = 16*1024; /* 16k SDP limit seems reasonable */
 		char* buff = belle_sip_malloc(bufLen);
-		content_type = belle_sip_header_content_type_create("application","sdp");
 
 		/* try to marshal the description. This could go higher than 2k so we iterate */
 		while( error != BELLE_SIP_OK && bufLen <= hardlimit && buff != NULL){
@@ -98,22 +101,22 @@ static int set_sdp(belle_sip_message_t *msg,belle_sdp_session_description_t* ses
 			return -1;
 		}
 
-		content_length = belle_sip_header_content_length_create(length);
-		belle_sip_message_add_header(msg,BELLE_SIP_HEADER(content_type));
-		belle_sip_message_add_header(msg,BELLE_SIP_HEADER(content_length));
-		belle_sip_message_assign_body(msg,buff,length);
+		set_sdp_body(msg,buff,length);
 		return 0;
 	} else {
 		return -1;
 	}
 }
-static int set_sdp_from_desc(belle_sip_message_t *msg, const SalMediaDescription *desc){
-	int err;
-	belle_sdp_session_description_t *sdp=media_description_to_sdp(desc);
-	err=set_sdp(msg,sdp);
-	belle_sip_object_unref(sdp);
-	return err;
 
+/*local descriptions are encoded through the op's cache: re-INVITEs for hold, refreshes or ICE completion re-encode only what changed*/
+static int set_sdp_from_desc(SalOp *op, belle_sip_message_t *msg, const SalMediaDescription *desc){
+	char *buff;
+	size_t length;
+
+	if (op->sdp_cache==NULL) op->sdp_cache=sal_sdp_cache_new();
+	if (media_description_to_sdp_text(desc,op->sdp_cache,&buff,&length)!=0) return -1;
+	set_sdp_body(msg,buff,length);
+	return 0;
 }
 static void call_process_io_error(void *user_ctx, const belle_sip_io_error_event_t *event){
 	SalOp* op=(SalOp*)user_ctx;
@@ -655,7 +658,7 @@ static void sal_op_fill_invite(SalOp *op, belle_sip_request_t* invite) {
 	}
 	if (op->base.local_media){
 		op->sdp_offering=TRUE;
-		set_sdp_from_desc(BELLE_SIP_MESSAGE(invite),op->base.local_media);
+		set_sdp_from_desc(op,BELLE_SIP_MESSAGE(invite),op->base.local_media);
 	}else op->sdp_offering=FALSE;
 	return;
 }
@@ -701,7 +704,7 @@ static void handle_offer_answer_response(SalOp* op, belle_sip_response_t* respon
 	if (op->base.local_media){
 		/*this is the case where we received an invite without SDP*/
 		if (op->sdp_offering) {
-			set_sdp_from_desc(BELLE_SIP_MESSAGE(response),op->base.local_media);
+			set_sdp_from_desc(op,BELLE_SIP_MESSAGE(response),op->base.local_media);
 		}else{
 
 			if (op->sdp_answer==NULL)
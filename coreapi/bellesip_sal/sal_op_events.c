@@ -42,6 +42,7 @@ static void subscribe_refresher_listener (belle_sip_refresher_t* refresher
 	SalSubscribeStatus sss=SalSubscribeTerminated;
 	
 	ms_message("Subscribe refresher  [%i] reason [%s] ",status_code,reason_phrase?reason_phrase:"none");
+	sal_interrupt_wait(op->base.root);
 	if (status_code>=200 && status_code<300){
 		if (status_code==200) sss=SalSubscribeActive;
 		else if (status_code==202) sss=SalSubscribePending;
@@ -49,6 +49,7 @@ void sal_op_release_impl(SalOp *op){
 		sal_auth_info_delete(op->auth_info);
 	}
 	if (op->sdp_answer) belle_sip_object_unref(op->sdp_answer);
+	if (op->sdp_cache) sal_sdp_cache_destroy(op->sdp_cache);
 	if (op->refresher) {
 		belle_sip_object_unref(op->refresher);
 		op->refresher=NULL;
@@ -333,6 +334,7 @@ static int _sal_op_send_request_with_contact(SalOp* op, belle_sip_request_t* req
 		belle_sip_provider_add_authorization(op->base.root->prov,request,NULL,NULL,NULL,op->base.realm);
 	}
 	result = belle_sip_client_transaction_send_request_to(client_transaction,next_hop_uri/*might be null*/);
+	if (result == 0) op->base.root->nb_requests_sent++;
 
 	/*update call id if not set yet for this OP*/
 	if (result == 0 && !op->base.call_id) {
@@ -523,6 +525,7 @@ void sal_error_info_reset(SalErrorInfo *ei){
 		ei->full_string=NULL;
 	}
 	ei->protocol_code=0;
+	ei->retry_after=0;
 	ei->reason=SalReasonNone;
 }
 
@@ -546,12 +549,18 @@ void sal_op_set_error_info_from_response(SalOp *op, belle_sip_response_t *respon
 	/*Remark: the reason header is to be used mainly in SIP requests, thus the use and prototype of this function should be changed.*/
 	belle_sip_header_t* reason_header = belle_sip_message_get_header(BELLE_SIP_MESSAGE(response),"Reason");
 	belle_sip_header_t *warning=belle_sip_message_get_header(BELLE_SIP_MESSAGE(response),"Warning");
+	belle_sip_header_t *retry_after=belle_sip_message_get_header(BELLE_SIP_MESSAGE(response),"Retry-After");
 	SalErrorInfo *ei=&op->error_info;
 	const char *warnings;
 
 	warnings=warning ? belle_sip_header_get_unparsed_value(warning) : NULL;
 	if (warnings==NULL) warnings=reason_header ? belle_sip_header_get_unparsed_value(reason_header) : NULL;
 	sal_error_info_set(ei,SalReasonUnknown,code,reason_phrase,warnings);
+	if (retry_after){
+		/*only the delta-seconds are used, the comment and parameters are ignored*/
+		int delay=atoi(belle_sip_header_get_unparsed_value(retry_after));
+		if (delay>0) ei->retry_after=delay;
+	}
 }
 
 const SalErrorInfo *sal_op_get_error_info(const SalOp *op){
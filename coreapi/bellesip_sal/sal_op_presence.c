@@ -60,6 +60,7 @@ static void presence_process_dialog_terminated(void *ctx, const belle_sip_dialog
 
 static void presence_refresher_listener(belle_sip_refresher_t* refresher, void* user_pointer, unsigned int status_code, const char* reason_phrase){
 	SalOp* op = (SalOp*)user_pointer;
+	sal_interrupt_wait(op->base.root);
 	switch(status_code){
 		case 481: {
 
@@ -177,6 +178,112 @@ static SalPresenceModel * process_presence_notification(SalOp *op, belle_sip_req
 	return result;
 }
 
+/*
+ * Resource list NOTIFYs (RFC 4662) carry a multipart/related body made of a RLMI document and of one PIDF document per
+ * resource. Only the PIDF parts are parsed: each of them is a regular presence document whose entity is the resource.
+ */
+/*the body of a message is not NUL terminated: it is only searched between begin and end*/
+static const char *find_in_body(const char *begin, const char *end, const char *str, size_t len){
+	const char *p;
+	for(p=begin;p+len<=end;p++){
+		if (memcmp(p,str,len)==0) return p;
+	}
+	return NULL;
+}
+
+static const char *find_part_content_type(const char *headers, const char *headers_end, char *type, size_t type_size){
+	const char *line=headers;
+	while(line<headers_end){
+		const char *eol=find_in_body(line,headers_end,"\n",1);
+		if (eol==NULL) eol=headers_end;
+		if (eol-line>=13 && strncasecmp(line,"Content-Type:",13)==0){
+			const char *value=line+13;
+			size_t len=0;
+			while(value<eol && (*value==' ' || *value=='\t')) value++;
+			while(value+len<eol && value[len]!=';' && value[len]!='\r' && value[len]!=' ') len++;
+			if (len>=type_size) len=type_size-1;
+			strncpy(type,value,len);
+			type[len]='\0';
+			return type;
+		}
+		line=eol+1;
+	}
+	return NULL;
+}
+
+static MSList *process_presence_list_notification(SalOp *op, const char *body, size_t body_len, const char *boundary){
+	MSList *models=NULL;
+	char *delimiter=ms_strdup_printf("--%s",boundary);
+	size_t delimiter_len=strlen(delimiter);
+	const char *body_end=body+body_len;
+	const char *part=find_in_body(body,body_end,delimiter,delimiter_len);
+
+	while(part!=NULL){
+		const char *headers=part+delimiter_len;
+		const char *headers_end;
+		const char *content;
+		const char *next;
+		char type[64];
+
+		if (body_end-headers>=2 && memcmp(headers,"--",2)==0) break; /*closing delimiter*/
+		headers_end=find_in_body(headers,body_end,"\r\n\r\n",4);
+		if (headers_end==NULL) break;
+		content=headers_end+4;
+		next=find_in_body(content,body_end,delimiter,delimiter_len);
+		if (next==NULL) break;
+		if (find_part_content_type(headers,headers_end,type,sizeof(type))!=NULL && strcasecmp(type,"application/pidf+xml")==0){
+			size_t content_len=next-content;
+			char *pidf;
+			SalPresenceModel *model=NULL;
+			/*the CRLF preceding the delimiter belongs to the delimiter*/
+			if (content_len>=2 && memcmp(next-2,"\r\n",2)==0) content_len-=2;
+			pidf=ms_strndup(content,content_len);
+			op->base.root->callbacks.parse_presence_requested(op,"application","pidf+xml",pidf,&model);
+			if (model!=NULL) models=ms_list_append(models,model);
+			else ms_warning("Wrongly formatted presence document in resource list notification.");
+			ms_free(pidf);
+		}
+		part=next;
+	}
+	ms_free(delimiter);
+	return models;
+}
+
+static char *get_multipart_boundary(belle_sip_header_content_type_t *content_type){
+	const char *boundary;
+	size_t len;
+	if (strcasecmp(belle_sip_header_content_type_get_type(content_type),"multipart")!=0) return NULL;
+	boundary=belle_sip_parameters_get_parameter(BELLE_SIP_PARAMETERS(content_type),"boundary");
+	if (boundary==NULL) return NULL;
+	len=strlen(boundary);
+	if (len>=2 && boundary[0]=='"' && boundary[len-1]=='"') return ms_strndup(boundary+1,len-2);
+	return ms_strdup(boundary);
+}
+
+int sal_process_presence_list_notification(SalOp *op, const char *body, size_t body_len, const char *boundary){
+	MSList *models=process_presence_list_notification(op,body,body_len,boundary);
+	MSList *elem;
+	int count=0;
+
+	for(elem=models;elem!=NULL;elem=elem->next,count++){
+		op->base.root->callbacks.notify_presence(op,SalSubscribeActive,(SalPresenceModel*)elem->data,NULL);
+	}
+	ms_list_free(models);
+	return count;
+}
+
+static void handle_presence_list_notify(SalOp *op, belle_sip_request_t *req, SalSubscribeStatus sub_state, const char *boundary){
+	belle_sip_server_transaction_t* server_transaction=op->pending_server_trans;
+	belle_sip_response_t* resp;
+	SalBody body;
+
+	resp=sal_op_create_response_from_request(op,req,200); /*create first because the op may be destroyed by notify_presence */
+	/*the state of the subscription is given once all the resources have been notified*/
+	if (sal_op_get_body(op,BELLE_SIP_MESSAGE(req),&body)) sal_process_presence_list_notification(op,body.data,body.size,boundary);
+	if (sub_state==SalSubscribeTerminated) op->base.root->callbacks.notify_presence(op,sub_state,NULL,NULL);
+	belle_sip_server_transaction_send_response(server_transaction,resp);
+}
+
 static void handle_notify(SalOp *op, belle_sip_request_t *req){
 	belle_sip_response_t* resp=NULL;
 	belle_sip_server_transaction_t* server_transaction=op->pending_server_trans;
@@ -192,6 +299,15 @@ static void handle_notify(SalOp *op, belle_sip_request_t *req){
 		} else {
 			sub_state=SalSubscribeActive;
 		}
+		if (op->presence_list){
+			belle_sip_header_content_type_t *content_type=belle_sip_message_get_header_by_type(BELLE_SIP_MESSAGE(req),belle_sip_header_content_type_t);
+			char *boundary=content_type ? get_multipart_boundary(content_type) : NULL;
+			if (boundary){
+				handle_presence_list_notify(op,req,sub_state,boundary);
+				ms_free(boundary);
+				return;
+			}
+		}
 		presence_model = process_presence_notification(op, req);
 		if (presence_model != NULL || body==NULL) {
 			/* Presence notification body parsed successfully. */
@@ -308,10 +424,20 @@ int sal_subscribe_presence(SalOp *op, const char *from, const char *to, int expi
 	req=sal_op_build_request(op,"SUBSCRIBE");
 	belle_sip_message_add_header(BELLE_SIP_MESSAGE(req),op->event);
 	belle_sip_message_add_header(BELLE_SIP_MESSAGE(req),BELLE_SIP_HEADER(belle_sip_header_expires_create(expires)));
+	if (op->presence_list){
+		belle_sip_message_add_header(BELLE_SIP_MESSAGE(req),belle_sip_header_create("Supported","eventlist"));
+		belle_sip_message_add_header(BELLE_SIP_MESSAGE(req),belle_sip_header_create("Accept","application/pidf+xml, application/rlmi+xml, multipart/related"));
+	}
 
 	return sal_op_send_request(op,req);
 }
 
+/*subscribes to the presence of all the resources of a list served by a RLS*/
+int sal_subscribe_presence_list(SalOp *op, const char *from, const char *to, int expires){
+	op->presence_list=TRUE;
+	return sal_subscribe_presence(op,from,to,expires);
+}
+
 
 static belle_sip_request_t *create_presence_notify(SalOp *op){
 	belle_sip_request_t* notify=belle_sip_dialog_create_queued_request(op->dialog,"NOTIFY");
@@ -29,6 +29,7 @@ static void publish_refresher_listener (belle_sip_refresher_t* refresher
 	belle_sip_response_t *response=belle_sip_transaction_get_response(BELLE_SIP_TRANSACTION(last_publish_trans));
 	/*belle_sip_response_t* response=belle_sip_transaction_get_response(BELLE_SIP_TRANSACTION(belle_sip_refresher_get_transaction(refresher)));*/
 	ms_message("Publish refresher  [%i] reason [%s] for proxy [%s]",status_code,reason_phrase?reason_phrase:"none",sal_op_get_proxy(op));
+	sal_interrupt_wait(op->base.root);
 	if (status_code==412){
 		/*resubmit the request after removing the SIP-If-Match*/
 		belle_sip_message_remove_header((belle_sip_message_t*)last_publish,"SIP-If-Match");
@@ -26,6 +26,7 @@ static void register_refresher_listener (belle_sip_refresher_t* refresher
 	SalOp* op = (SalOp*)user_pointer;
 	belle_sip_response_t* response=belle_sip_transaction_get_response(BELLE_SIP_TRANSACTION(belle_sip_refresher_get_transaction(refresher)));
 	ms_message("Register refresher  [%i] reason [%s] for proxy [%s]",status_code,reason_phrase,sal_op_get_proxy(op));
+	sal_interrupt_wait(op->base.root);
 	
 	if (belle_sip_refresher_get_auth_events(refresher)) {
 		if (op->auth_info) sal_auth_info_delete(op->auth_info);
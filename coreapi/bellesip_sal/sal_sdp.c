@@ -26,7 +26,7 @@ static void add_ice_candidates(belle_sdp_media_description_t *md, const SalStrea
 	int nb;
 	int i;
 
-	for (i = 0; i < SAL_MEDIA_DESCRIPTION_MAX_ICE_CANDIDATES; i++) {
+	for (i = 0; i < desc->nb_ice_candidates; i++) {
 		candidate = &desc->ice_candidates[i];
 		if ((candidate->addr[0] == '\0') || (candidate->port == 0)) break;
 		nb = snprintf(buffer, sizeof(buffer), "%s %u UDP %u %s %d typ %s",
@@ -163,7 +163,7 @@ static belle_sdp_attribute_t * create_rtcp_xr_attribute(const OrtpRtcpXrConfigur
 	return BELLE_SDP_ATTRIBUTE(attribute);
 }
 
-static void stream_description_to_sdp ( belle_sdp_session_description_t *session_desc, const SalMediaDescription *md, const SalStreamDescription *stream ) {
+static belle_sdp_media_description_t * stream_description_to_sdp ( const SalMediaDescription *md, const SalStreamDescription *stream ) {
 	belle_sdp_mime_parameter_t* mime_param;
 	belle_sdp_media_description_t* media_desc;
 	int j;
@@ -268,9 +268,9 @@ static void stream_description_to_sdp ( belle_sdp_session_description_t *session
 		belle_sdp_media_description_add_attribute(media_desc,belle_sdp_attribute_create ("ice-mismatch",NULL));
 	} else {
 		if (rtp_port != 0) {
-			if (stream->ice_pwd[0] != '\0') 
+			if (stream->ice_pwd != NULL)
 				belle_sdp_media_description_add_attribute(media_desc,belle_sdp_attribute_create ("ice-pwd",stream->ice_pwd));
-			if (stream->ice_ufrag[0] != '\0')
+			if (stream->ice_ufrag != NULL)
 				belle_sdp_media_description_add_attribute(media_desc,belle_sdp_attribute_create ("ice-ufrag",stream->ice_ufrag));
 			add_ice_candidates(media_desc,stream);
 			add_ice_remote_candidates(media_desc,stream);
@@ -286,10 +286,11 @@ static void stream_description_to_sdp ( belle_sdp_session_description_t *session
 		char mastr[1024] = {0};
 		size_t saoff = 0;
 		size_t maoff = 0;
-		const belle_sdp_attribute_t *session_attribute = belle_sdp_session_description_get_attribute(session_desc, "rtcp-xr");
 		belle_sdp_attribute_t *media_attribute;
-		if (session_attribute != NULL) {
+		if (md->rtcp_xr.enabled == TRUE) {
+			belle_sdp_attribute_t *session_attribute = create_rtcp_xr_attribute(&md->rtcp_xr);
 			belle_sip_object_marshal((belle_sip_object_t*)session_attribute, sastr, sizeof(sastr), &saoff);
+			belle_sip_object_unref(session_attribute);
 		}
 		media_attribute = create_rtcp_xr_attribute(&stream->rtcp_xr);
 		if (media_attribute != NULL) {
@@ -302,14 +303,13 @@ static void stream_description_to_sdp ( belle_sdp_session_description_t *session
 		}
 	}
 
-	belle_sdp_session_description_add_media_description(session_desc, media_desc);
+	return media_desc;
 }
 
-belle_sdp_session_description_t * media_description_to_sdp ( const SalMediaDescription *desc ) {
+static belle_sdp_session_description_t * session_description_to_sdp ( const SalMediaDescription *desc ) {
 	belle_sdp_session_description_t* session_desc=belle_sdp_session_description_new();
 	bool_t inet6;
 	belle_sdp_origin_t* origin;
-	int i;
 
 	if ( strchr ( desc->addr,':' ) !=NULL ) {
 		inet6=1;
@@ -329,7 +329,7 @@ belle_sdp_session_description_t * media_description_to_sdp ( const SalMediaDescr
 		belle_sdp_session_name_create ( desc->name[0]!='\0' ? desc->name : "Talk" ) );
 
 	if ( (!sal_media_description_has_dir ( desc,SalStreamSendOnly ) && !sal_media_description_has_dir ( desc,SalStreamInactive )) 
-		|| desc->ice_ufrag[0] != '\0' ) {
+		|| desc->ice_ufrag != NULL ) {
 		belle_sdp_session_description_set_connection ( session_desc
 				,belle_sdp_connection_create ( "IN",inet6 ? "IP6" :"IP4",desc->addr ) );
 
@@ -348,19 +348,216 @@ belle_sdp_session_description_t * media_description_to_sdp ( const SalMediaDescr
 	}
 	
 	if (desc->ice_completed == TRUE) belle_sdp_session_description_add_attribute(session_desc, belle_sdp_attribute_create("nortpproxy","yes"));
-	if (desc->ice_pwd[0] != '\0') belle_sdp_session_description_add_attribute(session_desc, belle_sdp_attribute_create("ice-pwd",desc->ice_pwd));
-	if (desc->ice_ufrag[0] != '\0') belle_sdp_session_description_add_attribute(session_desc, belle_sdp_attribute_create("ice-ufrag",desc->ice_ufrag));
+	if (desc->ice_pwd != NULL) belle_sdp_session_description_add_attribute(session_desc, belle_sdp_attribute_create("ice-pwd",desc->ice_pwd));
+	if (desc->ice_ufrag != NULL) belle_sdp_session_description_add_attribute(session_desc, belle_sdp_attribute_create("ice-ufrag",desc->ice_ufrag));
 
 	if (desc->rtcp_xr.enabled == TRUE) {
 		belle_sdp_session_description_add_attribute(session_desc, create_rtcp_xr_attribute(&desc->rtcp_xr));
 	}
+	return session_desc;
+}
+
+belle_sdp_session_description_t * media_description_to_sdp ( const SalMediaDescription *desc ) {
+	belle_sdp_session_description_t* session_desc=session_description_to_sdp(desc);
+	int i;
 
 	for ( i=0; i<desc->nb_streams; i++ ) {
-		stream_description_to_sdp(session_desc, desc, &desc->streams[i]);
+		belle_sdp_session_description_add_media_description(session_desc, stream_description_to_sdp(desc, &desc->streams[i]));
 	}
 	return session_desc;
 }
 
+/*
+ * Keys of the SDP encoding cache: a FNV-1a hash of every field the encoders above read.
+ * Each part is re-encoded only when its key changes.
+ */
+#define SDP_CACHE_KEY_INIT 0xcbf29ce484222325ULL
+
+static uint64_t key_bytes(uint64_t key, const void *data, size_t len) {
+	const unsigned char *p = (const unsigned char *)data;
+	size_t i;
+	for (i = 0; i < len; i++) {
+		key ^= p[i];
+		key *= 0x100000001b3ULL;
+	}
+	return key;
+}
+
+static uint64_t key_int(uint64_t key, int value) {
+	return key_bytes(key, &value, sizeof(value));
+}
+
+static uint64_t key_string(uint64_t key, const char *str) {
+	if (str == NULL) return key_int(key, -1);
+	return key_bytes(key, str, strlen(str) + 1);
+}
+
+static uint64_t key_rtcp_xr(uint64_t key, const OrtpRtcpXrConfiguration *config) {
+	key = key_int(key, config->enabled);
+	key = key_int(key, config->rcvr_rtt_mode);
+	key = key_int(key, config->rcvr_rtt_max_size);
+	key = key_int(key, config->stat_summary_enabled);
+	key = key_int(key, config->stat_summary_flags);
+	return key_int(key, config->voip_metrics_enabled);
+}
+
+static uint64_t session_description_key(const SalMediaDescription *desc) {
+	uint64_t key = SDP_CACHE_KEY_INIT;
+	bool_t null_connection = (sal_media_description_has_dir(desc, SalStreamSendOnly) || sal_media_description_has_dir(desc, SalStreamInactive))
+		&& desc->ice_ufrag == NULL;
+
+	key = key_string(key, desc->username);
+	key = key_string(key, desc->addr);
+	key = key_string(key, desc->name);
+	key = key_int(key, (int)desc->session_id);
+	key = key_int(key, (int)desc->session_ver);
+	key = key_int(key, null_connection);
+	key = key_int(key, desc->bandwidth);
+	key = key_int(key, desc->ice_completed);
+	key = key_string(key, desc->ice_pwd);
+	key = key_string(key, desc->ice_ufrag);
+	return key_rtcp_xr(key, &desc->rtcp_xr);
+}
+
+static uint64_t stream_description_key(const SalMediaDescription *md, const SalStreamDescription *stream) {
+	uint64_t key = SDP_CACHE_KEY_INIT;
+	const MSList *pt_it;
+	int i;
+
+	/*the stream encoding compares against these session level fields*/
+	key = key_string(key, md->addr);
+	key = key_rtcp_xr(key, &md->rtcp_xr);
+
+	key = key_int(key, stream->type);
+	key = key_string(key, stream->typeother);
+	key = key_int(key, stream->proto);
+	key = key_string(key, stream->proto_other);
+	key = key_string(key, stream->rtp_addr);
+	key = key_int(key, stream->rtp_port);
+	key = key_string(key, stream->rtcp_addr);
+	key = key_int(key, stream->rtcp_port);
+	key = key_int(key, stream->bandwidth);
+	key = key_int(key, stream->ptime);
+	key = key_int(key, stream->dir);
+	for (pt_it = stream->payloads; pt_it != NULL; pt_it = pt_it->next) {
+		PayloadType *pt = (PayloadType *)pt_it->data;
+		PayloadTypeAvpfParams avpf_params = payload_type_get_avpf_params(pt);
+		key = key_string(key, pt->mime_type);
+		key = key_int(key, payload_type_get_number(pt));
+		key = key_int(key, pt->clock_rate);
+		key = key_int(key, pt->channels);
+		key = key_string(key, pt->recv_fmtp);
+		key = key_int(key, pt->flags);
+		key = key_int(key, avpf_params.features);
+		key = key_int(key, avpf_params.trr_interval);
+	}
+	for (i = 0; i < SAL_CRYPTO_ALGO_MAX; i++) {
+		key = key_int(key, (int)stream->crypto[i].tag);
+		key = key_int(key, stream->crypto[i].algo);
+		key = key_string(key, stream->crypto[i].master_key);
+	}
+	key = key_int(key, stream->ice_completed);
+	key = key_int(key, stream->ice_mismatch);
+	key = key_string(key, stream->ice_pwd);
+	key = key_string(key, stream->ice_ufrag);
+	for (i = 0; i < stream->nb_ice_candidates; i++) {
+		const SalIceCandidate *candidate = &stream->ice_candidates[i];
+		key = key_string(key, candidate->foundation);
+		key = key_int(key, (int)candidate->componentID);
+		key = key_int(key, (int)candidate->priority);
+		key = key_string(key, candidate->addr);
+		key = key_int(key, candidate->port);
+		key = key_string(key, candidate->type);
+		key = key_string(key, candidate->raddr);
+		key = key_int(key, candidate->rport);
+	}
+	for (i = 0; i < SAL_MEDIA_DESCRIPTION_MAX_ICE_REMOTE_CANDIDATES; i++) {
+		key = key_string(key, stream->ice_remote_candidates[i].addr);
+		key = key_int(key, stream->ice_remote_candidates[i].port);
+	}
+	return key_rtcp_xr(key, &stream->rtcp_xr);
+}
+
+static int encode_sdp_part(SalSdpCachePart *part, uint64_t key, belle_sip_object_t *obj) {
+	belle_sip_error_code error = BELLE_SIP_BUFFER_OVERFLOW;
+	size_t buff_len = 1024;
+	size_t hardlimit = 16*1024;
+	size_t length = 0;
+
+	while (error != BELLE_SIP_OK && buff_len <= hardlimit) {
+		part->text = ms_realloc(part->text, buff_len);
+		length = 0;
+		error = belle_sip_object_marshal(obj, part->text, buff_len, &length);
+		if (error != BELLE_SIP_OK) buff_len *= 2;
+	}
+	belle_sip_object_unref(obj);
+	if (error != BELLE_SIP_OK) {
+		ms_error("Cannot encode SDP part in less than %d bytes", (int)hardlimit);
+		ms_free(part->text);
+		part->text = NULL;
+		return -1;
+	}
+	part->key = key;
+	part->length = length;
+	return 0;
+}
+
+SalSdpCache * sal_sdp_cache_new(void) {
+	return ms_new0(SalSdpCache, 1);
+}
+
+void sal_sdp_cache_destroy(SalSdpCache *cache) {
+	int i;
+	for (i = 0; i < SAL_SDP_CACHE_MAX_PARTS; i++) {
+		if (cache->parts[i].text) ms_free(cache->parts[i].text);
+	}
+	ms_free(cache);
+}
+
+int media_description_to_sdp_text(const SalMediaDescription *desc, SalSdpCache *cache, char **text, size_t *length) {
+	SalSdpCachePart *part;
+	uint64_t key;
+	size_t total;
+	char *buff;
+	int i;
+
+	key = session_description_key(desc);
+	part = &cache->parts[0];
+	if (part->text == NULL || part->key != key) {
+		if (encode_sdp_part(part, key, BELLE_SIP_OBJECT(session_description_to_sdp(desc))) != 0) return -1;
+		cache->nb_encoded++;
+	} else cache->nb_reused++;
+	total = part->length;
+
+	for (i = 0; i < desc->nb_streams; i++) {
+		const SalStreamDescription *stream = &desc->streams[i];
+		if ((stream->rtp_port != 0) && sal_stream_description_has_avpf(stream)) {
+			/*the encoder enables feedback on the payloads it advertises, do it before computing the key*/
+			MSList *pt_it;
+			for (pt_it = stream->payloads; pt_it != NULL; pt_it = pt_it->next)
+				payload_type_set_flag((PayloadType *)pt_it->data, PAYLOAD_TYPE_RTCP_FEEDBACK_ENABLED);
+		}
+		key = stream_description_key(desc, stream);
+		part = &cache->parts[i + 1];
+		if (part->text == NULL || part->key != key) {
+			if (encode_sdp_part(part, key, BELLE_SIP_OBJECT(stream_description_to_sdp(desc, stream))) != 0) return -1;
+			cache->nb_encoded++;
+		} else cache->nb_reused++;
+		total += part->length;
+	}
+
+	buff = belle_sip_malloc(total + 1);
+	total = 0;
+	for (i = 0; i <= desc->nb_streams; i++) {
+		memcpy(buff + total, cache->parts[i].text, cache->parts[i].length);
+		total += cache->parts[i].length;
+	}
+	buff[total] = '\0';
+	*text = buff;
+	*length = total;
+	return 0;
+}
+
 
 static void sdp_parse_payload_types(belle_sdp_media_description_t *media_desc, SalStreamDescription *stream) {
 	PayloadType *pt;
@@ -443,7 +640,6 @@ static void sdp_parse_media_ice_parameters(belle_sdp_media_description_t *media_
 	belle_sdp_attribute_t *attribute;
 	const char *att_name;
 	const char *value;
-	int nb_ice_candidates = 0;
 
 	for (attribute_it = belle_sdp_media_description_get_attributes(media_desc); attribute_it != NULL; attribute_it=attribute_it->next) {
 		attribute=BELLE_SDP_ATTRIBUTE(attribute_it->data);
@@ -451,12 +647,17 @@ static void sdp_parse_media_ice_parameters(belle_sdp_media_description_t *media_
 		value = belle_sdp_attribute_get_value(attribute);
 
 		if ((keywordcmp("candidate", att_name) == 0) && (value != NULL)) {
-			SalIceCandidate *candidate = &stream->ice_candidates[nb_ice_candidates];
-			int nb = sscanf(value, "%s %u UDP %u %s %d typ %s raddr %s rport %d",
-				candidate->foundation, &candidate->componentID, &candidate->priority, candidate->addr, &candidate->port,
-				candidate->type, candidate->raddr, &candidate->rport);
-			if ((nb == 6) || (nb == 8)) nb_ice_candidates++;
-			else memset(candidate, 0, sizeof(*candidate));
+			SalIceCandidate candidate;
+			int nb;
+			memset(&candidate, 0, sizeof(candidate));
+			nb = sscanf(value, "%31s %u UDP %u %63s %d typ %5s raddr %63s rport %d",
+				candidate.foundation, &candidate.componentID, &candidate.priority, candidate.addr, &candidate.port,
+				candidate.type, candidate.raddr, &candidate.rport);
+			if ((nb == 6) || (nb == 8)) {
+				SalIceCandidate *added = sal_stream_description_add_ice_candidate(stream);
+				if (added != NULL) *added = candidate;
+				else ms_warning("Too many ICE candidates in stream, ignoring [%s]", value);
+			}
 		} else if ((keywordcmp("remote-candidates", att_name) == 0) && (value != NULL)) {
 			SalIceRemoteCandidate candidate;
 			unsigned int componentID;
@@ -475,9 +676,9 @@ static void sdp_parse_media_ice_parameters(belle_sdp_media_description_t *media_
 				} else break;
 			}
 		} else if ((keywordcmp("ice-ufrag", att_name) == 0) && (value != NULL)) {
-			strncpy(stream->ice_ufrag, value, sizeof(stream->ice_ufrag)-1);
+			sal_shared_string_set(&stream->ice_ufrag, value);
 		} else if ((keywordcmp("ice-pwd", att_name) == 0) && (value != NULL)) {
-			strncpy(stream->ice_pwd, value, sizeof(stream->ice_pwd) -1);
+			sal_shared_string_set(&stream->ice_pwd, value);
 		} else if (keywordcmp("ice-mismatch", att_name) == 0) {
 			stream->ice_mismatch = TRUE;
 		}
@@ -758,10 +959,10 @@ int sdp_to_media_description ( belle_sdp_session_description_t  *session_desc, S
 
 	/* Get ICE remote ufrag and remote pwd, and ice_lite flag */
 	value=belle_sdp_session_description_get_attribute_value(session_desc,"ice-ufrag");
-	if (value) strncpy(desc->ice_ufrag, value, sizeof(desc->ice_ufrag) - 1);
+	if (value) sal_shared_string_set(&desc->ice_ufrag, value);
 	
 	value=belle_sdp_session_description_get_attribute_value(session_desc,"ice-pwd");
-	if (value) strncpy(desc->ice_pwd, value, sizeof(desc->ice_pwd)-1);
+	if (value) sal_shared_string_set(&desc->ice_pwd, value);
 	
 	value=belle_sdp_session_description_get_attribute_value(session_desc,"ice-lite");
 	if (value) desc->ice_lite = TRUE;
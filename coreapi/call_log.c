@@ -71,7 +71,7 @@ void call_logs_write_to_config_file(LinphoneCore *lc){
 	for(i=0,elem=lc->call_logs;elem!=NULL;elem=elem->next,++i){
 		LinphoneCallLog *cl=(LinphoneCallLog*)elem->data;
 		snprintf(logsection,sizeof(logsection),"call_log_%i",i);
-		lp_config_clean_section(cfg,logsection);
+		/*the section is updated in place rather than cleaned, so that unchanged logs do not need to be written again*/
 		lp_config_set_int(cfg,logsection,"dir",cl->dir);
 		lp_config_set_int(cfg,logsection,"status",cl->status);
 		tmp=linphone_address_as_string(cl->from);
@@ -80,11 +80,15 @@ void call_logs_write_to_config_file(LinphoneCore *lc){
 		tmp=linphone_address_as_string(cl->to);
 		lp_config_set_string(cfg,logsection,"to",tmp);
 		ms_free(tmp);
-		if (cl->start_date_time)
+		if (cl->start_date_time){
 			lp_config_set_int64(cfg,logsection,"start_date_time",(int64_t)cl->start_date_time);
-		else lp_config_set_string(cfg,logsection,"start_date",cl->start_date);
+			lp_config_set_string(cfg,logsection,"start_date",NULL);
+		}else{
+			lp_config_set_string(cfg,logsection,"start_date_time",NULL);
+			lp_config_set_string(cfg,logsection,"start_date",cl->start_date);
+		}
 		lp_config_set_int(cfg,logsection,"duration",cl->duration);
-		if (cl->refkey) lp_config_set_string(cfg,logsection,"refkey",cl->refkey);
+		lp_config_set_string(cfg,logsection,"refkey",cl->refkey);
 		lp_config_set_float(cfg,logsection,"quality",cl->quality);
 		lp_config_set_int(cfg,logsection,"video_enabled", cl->video_enabled);
 		lp_config_set_string(cfg,logsection,"call_id",cl->call_id);
@@ -139,6 +143,294 @@ void call_logs_read_from_config_file(LinphoneCore *lc){
 }
 
 
+static bool_t linphone_call_log_matches_filter(LinphoneCallLog *cl, const LinphoneCallLogFilter *filter){
+	if (filter==NULL) return TRUE;
+	if (filter->peer && !linphone_address_weak_equal(linphone_call_log_get_remote_address(cl),filter->peer)) return FALSE;
+	if (filter->start_date && cl->start_date_time<filter->start_date) return FALSE;
+	if (filter->end_date && cl->start_date_time>=filter->end_date) return FALSE;
+	if (filter->missed_only && cl->status!=LinphoneCallMissed) return FALSE;
+	return TRUE;
+}
+
+#ifdef MSG_STORAGE_ENABLED
+
+/*version of the call logs database schema, stored as PRAGMA user_version.*/
+#define LINPHONE_CALL_LOG_STORAGE_VERSION 1
+
+/*columns of the call_history table, in the order they are inserted and read*/
+#define LINPHONE_CALL_LOG_COLUMNS "id,direction,status,caller,callee,remote,start_time,connected_time,duration,quality,video_enabled,call_id,refkey"
+
+static void linphone_call_log_storage_create_table(sqlite3 *db){
+	int version=0;
+	sqlite3_stmt *stmt;
+	char *buf;
+
+	linphone_sql_request(db,"CREATE TABLE IF NOT EXISTS call_history ("
+					"id             INTEGER PRIMARY KEY AUTOINCREMENT,"
+					"direction      INTEGER,"
+					"status         INTEGER,"
+					"caller         TEXT NOT NULL,"
+					"callee         TEXT NOT NULL,"
+					"remote         TEXT NOT NULL," /*address of the other party, as returned by linphone_address_as_weak_key()*/
+					"start_time     INTEGER NOT NULL,"
+					"connected_time INTEGER,"
+					"duration       INTEGER,"
+					"quality        REAL,"
+					"video_enabled  INTEGER,"
+					"call_id        TEXT,"
+					"refkey         TEXT"
+				");");
+	if (sqlite3_prepare_v2(db,"PRAGMA user_version;",-1,&stmt,NULL)==SQLITE_OK && sqlite3_step(stmt)==SQLITE_ROW){
+		version=sqlite3_column_int(stmt,0);
+	}
+	sqlite3_finalize(stmt);
+	if (version>=LINPHONE_CALL_LOG_STORAGE_VERSION) return;
+	/*the history is listed by start date, optionally for a given peer or status*/
+	linphone_sql_request(db,"CREATE INDEX IF NOT EXISTS call_history_start_time ON call_history(start_time);");
+	linphone_sql_request(db,"CREATE INDEX IF NOT EXISTS call_history_remote ON call_history(remote,start_time);");
+	linphone_sql_request(db,"CREATE INDEX IF NOT EXISTS call_history_status ON call_history(status,start_time);");
+	buf=sqlite3_mprintf("PRAGMA user_version=%i;",LINPHONE_CALL_LOG_STORAGE_VERSION);
+	linphone_sql_request(db,buf);
+	sqlite3_free(buf);
+}
+
+static void linphone_call_log_storage_insert(LinphoneCore *lc, LinphoneCallLog *cl){
+	sqlite3_stmt *stmt;
+	char *caller,*callee,*remote;
+
+	if (sqlite3_prepare_v2(lc->logs_db,"INSERT INTO call_history ("LINPHONE_CALL_LOG_COLUMNS") VALUES(NULL,?,?,?,?,?,?,?,?,?,?,?,?);",-1,&stmt,NULL)!=SQLITE_OK){
+		ms_error("Cannot prepare call log insertion: %s.",sqlite3_errmsg(lc->logs_db));
+		sqlite3_finalize(stmt);
+		return;
+	}
+	caller=linphone_address_as_string(cl->from);
+	callee=linphone_address_as_string(cl->to);
+	remote=linphone_address_as_weak_key(linphone_call_log_get_remote_address(cl));
+	sqlite3_bind_int(stmt,1,cl->dir);
+	sqlite3_bind_int(stmt,2,cl->status);
+	sqlite3_bind_text(stmt,3,caller,-1,SQLITE_TRANSIENT);
+	sqlite3_bind_text(stmt,4,callee,-1,SQLITE_TRANSIENT);
+	sqlite3_bind_text(stmt,5,remote,-1,SQLITE_TRANSIENT);
+	sqlite3_bind_int64(stmt,6,(sqlite3_int64)cl->start_date_time);
+	sqlite3_bind_int64(stmt,7,(sqlite3_int64)cl->connected_date_time);
+	sqlite3_bind_int(stmt,8,cl->duration);
+	sqlite3_bind_double(stmt,9,cl->quality);
+	sqlite3_bind_int(stmt,10,cl->video_enabled);
+	if (cl->call_id) sqlite3_bind_text(stmt,11,cl->call_id,-1,SQLITE_TRANSIENT);
+	if (cl->refkey) sqlite3_bind_text(stmt,12,cl->refkey,-1,SQLITE_TRANSIENT);
+	if (sqlite3_step(stmt)==SQLITE_DONE){
+		cl->storage_id=(unsigned int)sqlite3_last_insert_rowid(lc->logs_db);
+	}else{
+		ms_error("Cannot store call log: %s.",sqlite3_errmsg(lc->logs_db));
+	}
+	sqlite3_finalize(stmt);
+	ms_free(caller);
+	ms_free(callee);
+	ms_free(remote);
+}
+
+/*call logs already in lc->call_logs are returned as is, so that they can be compared or removed*/
+static LinphoneCallLog *linphone_call_log_new_from_row(LinphoneCore *lc, sqlite3_stmt *stmt){
+	unsigned int storage_id=(unsigned int)sqlite3_column_int(stmt,0);
+	const char *tmp;
+	LinphoneAddress *from=NULL,*to=NULL;
+	LinphoneCallLog *cl;
+	MSList *elem;
+
+	for(elem=lc->call_logs;elem!=NULL;elem=elem->next){
+		cl=(LinphoneCallLog*)elem->data;
+		if (cl->storage_id==storage_id) return linphone_call_log_ref(cl);
+	}
+	tmp=(const char*)sqlite3_column_text(stmt,3);
+	if (tmp) from=linphone_address_new(tmp);
+	tmp=(const char*)sqlite3_column_text(stmt,4);
+	if (tmp) to=linphone_address_new(tmp);
+	if (!from || !to){
+		if (from) linphone_address_destroy(from);
+		if (to) linphone_address_destroy(to);
+		return NULL;
+	}
+	cl=linphone_call_log_new(sqlite3_column_int(stmt,1),from,to);
+	cl->storage_id=storage_id;
+	cl->status=sqlite3_column_int(stmt,2);
+	cl->start_date_time=(time_t)sqlite3_column_int64(stmt,6);
+	set_call_log_date(cl,cl->start_date_time);
+	cl->connected_date_time=(time_t)sqlite3_column_int64(stmt,7);
+	cl->duration=sqlite3_column_int(stmt,8);
+	cl->quality=(float)sqlite3_column_double(stmt,9);
+	cl->video_enabled=sqlite3_column_int(stmt,10);
+	tmp=(const char*)sqlite3_column_text(stmt,11);
+	if (tmp) cl->call_id=ms_strdup(tmp);
+	tmp=(const char*)sqlite3_column_text(stmt,12);
+	if (tmp) cl->refkey=ms_strdup(tmp);
+	return cl;
+}
+
+/*prepares the query of the call logs matching the filter, whose parameters are ?1 to ?4, followed by the limit and offset when paged*/
+static sqlite3_stmt *linphone_call_log_storage_prepare_query(LinphoneCore *lc, const char *what, const LinphoneCallLogFilter *filter, char **remote, bool_t paged){
+	char *query;
+	sqlite3_stmt *stmt=NULL;
+
+	*remote=NULL;
+	query=sqlite3_mprintf("SELECT %s FROM call_history WHERE 1%s%s%s%s%s;",what,
+		(filter && filter->peer) ? " AND remote=?1" : "",
+		(filter && filter->start_date) ? " AND start_time>=?2" : "",
+		(filter && filter->end_date) ? " AND start_time<?3" : "",
+		(filter && filter->missed_only) ? " AND status=?4" : "",
+		paged ? " ORDER BY start_time DESC, id DESC LIMIT ?5 OFFSET ?6" : "");
+	if (sqlite3_prepare_v2(lc->logs_db,query,-1,&stmt,NULL)!=SQLITE_OK){
+		ms_error("Cannot prepare statement [%s]: %s.",query,sqlite3_errmsg(lc->logs_db));
+		sqlite3_finalize(stmt);
+		sqlite3_free(query);
+		return NULL;
+	}
+	sqlite3_free(query);
+	if (filter && filter->peer){
+		*remote=linphone_address_as_weak_key(filter->peer);
+		sqlite3_bind_text(stmt,1,*remote,-1,SQLITE_STATIC);
+	}
+	if (filter && filter->start_date) sqlite3_bind_int64(stmt,2,(sqlite3_int64)filter->start_date);
+	if (filter && filter->end_date) sqlite3_bind_int64(stmt,3,(sqlite3_int64)filter->end_date);
+	if (filter && filter->missed_only) sqlite3_bind_int(stmt,4,LinphoneCallMissed);
+	return stmt;
+}
+
+static MSList *linphone_call_log_storage_get_history(LinphoneCore *lc, const LinphoneCallLogFilter *filter, int offset, int count){
+	char *remote;
+	sqlite3_stmt *stmt=linphone_call_log_storage_prepare_query(lc,LINPHONE_CALL_LOG_COLUMNS,filter,&remote,TRUE);
+	MSList *rows=NULL;
+	MSList *result=NULL;
+	MSList *elem;
+
+	if (stmt==NULL) return NULL;
+	sqlite3_bind_int(stmt,5,count>0 ? count : -1);
+	sqlite3_bind_int(stmt,6,offset>0 ? offset : 0);
+	while(sqlite3_step(stmt)==SQLITE_ROW){
+		LinphoneCallLog *cl=linphone_call_log_new_from_row(lc,stmt);
+		if (cl) rows=ms_list_prepend(rows,cl);
+	}
+	sqlite3_finalize(stmt);
+	if (remote) ms_free(remote);
+	/*rows were prepended to avoid walking the list at each one*/
+	for(elem=rows;elem!=NULL;elem=elem->next){
+		result=ms_list_prepend(result,elem->data);
+	}
+	ms_list_free(rows);
+	return result;
+}
+
+static int linphone_call_log_storage_get_history_size(LinphoneCore *lc, const LinphoneCallLogFilter *filter){
+	char *remote;
+	sqlite3_stmt *stmt=linphone_call_log_storage_prepare_query(lc,"count(*)",filter,&remote,FALSE);
+	int size=0;
+
+	if (stmt==NULL) return 0;
+	if (sqlite3_step(stmt)==SQLITE_ROW) size=sqlite3_column_int(stmt,0);
+	sqlite3_finalize(stmt);
+	if (remote) ms_free(remote);
+	return size;
+}
+
+/*moves the call logs of the config file to the database*/
+static void linphone_call_log_storage_migrate(LinphoneCore *lc){
+	char logsection[32];
+	MSList *elem;
+	MSList *last=NULL;
+	int i;
+
+	if (!lp_config_has_section(lc->config,"call_log_0")) return;
+	linphone_sql_request(lc->logs_db,"BEGIN TRANSACTION;");
+	/*lc->call_logs is most recent first*/
+	for(elem=lc->call_logs;elem!=NULL;elem=elem->next){
+		last=elem;
+	}
+	for(elem=last;elem!=NULL;elem=elem->prev){
+		linphone_call_log_storage_insert(lc,(LinphoneCallLog*)elem->data);
+	}
+	if (linphone_sql_request(lc->logs_db,"COMMIT;")!=SQLITE_OK){
+		ms_error("Call logs could not be moved to %s, keeping them in the config file.",lc->logs_db_file);
+		return;
+	}
+	for(i=0;;i++){
+		snprintf(logsection,sizeof(logsection),"call_log_%i",i);
+		if (!lp_config_has_section(lc->config,logsection)) break;
+		lp_config_clean_section(lc->config,logsection);
+	}
+	ms_message("%i call logs moved from the config file to %s.",ms_list_size(lc->call_logs),lc->logs_db_file);
+}
+
+void linphone_core_call_log_storage_init(LinphoneCore *lc){
+	sqlite3 *db;
+	MSList *logs;
+
+	linphone_core_call_log_storage_close(lc);
+	if (sqlite3_open(lc->logs_db_file,&db)!=SQLITE_OK){
+		ms_error("Cannot open call logs database %s: %s.",lc->logs_db_file,sqlite3_errmsg(db));
+		sqlite3_close(db);
+		return;
+	}
+	linphone_call_log_storage_create_table(db);
+	lc->logs_db=db;
+	linphone_call_log_storage_migrate(lc);
+
+	/*only the most recent call logs are kept in memory*/
+	logs=linphone_call_log_storage_get_history(lc,NULL,0,lc->max_call_logs);
+	ms_list_for_each(lc->call_logs,(void (*)(void*))linphone_call_log_unref);
+	ms_list_free(lc->call_logs);
+	lc->call_logs=logs;
+}
+
+void linphone_core_call_log_storage_close(LinphoneCore *lc){
+	if (lc->logs_db){
+		sqlite3_close(lc->logs_db);
+		lc->logs_db=NULL;
+	}
+}
+
+#else
+
+void linphone_core_call_log_storage_init(LinphoneCore *lc){
+}
+
+void linphone_core_call_log_storage_close(LinphoneCore *lc){
+}
+
+#endif
+
+void linphone_core_call_log_storage_add(LinphoneCore *lc, LinphoneCallLog *cl){
+#ifdef MSG_STORAGE_ENABLED
+	if (lc->logs_db){
+		linphone_call_log_storage_insert(lc,cl);
+		return;
+	}
+#endif
+	call_logs_write_to_config_file(lc);
+}
+
+void linphone_core_call_log_storage_remove(LinphoneCore *lc, LinphoneCallLog *cl){
+#ifdef MSG_STORAGE_ENABLED
+	if (lc->logs_db){
+		char *buf;
+		if (cl->storage_id==0) return;
+		buf=sqlite3_mprintf("DELETE FROM call_history WHERE id = %u;",cl->storage_id);
+		linphone_sql_request(lc->logs_db,buf);
+		sqlite3_free(buf);
+		return;
+	}
+#endif
+	call_logs_write_to_config_file(lc);
+}
+
+void linphone_core_call_log_storage_clear(LinphoneCore *lc){
+#ifdef MSG_STORAGE_ENABLED
+	if (lc->logs_db){
+		linphone_sql_request(lc->logs_db,"DELETE FROM call_history;");
+		return;
+	}
+#endif
+	call_logs_write_to_config_file(lc);
+}
+
 /*******************************************************************************
  * Public functions                                                            *
  ******************************************************************************/
@@ -234,6 +526,35 @@ bool_t linphone_call_log_video_enabled(LinphoneCallLog *cl) {
 	return cl->video_enabled;
 }
 
+MSList *linphone_core_get_call_history(LinphoneCore *lc, const LinphoneCallLogFilter *filter, int offset, int count){
+	MSList *elem;
+	MSList *result=NULL;
+	int index=0;
+
+#ifdef MSG_STORAGE_ENABLED
+	if (lc->logs_db) return linphone_call_log_storage_get_history(lc,filter,offset,count);
+#endif
+	for(elem=lc->call_logs;elem!=NULL && (count<=0 || index<offset+count);elem=elem->next){
+		LinphoneCallLog *cl=(LinphoneCallLog*)elem->data;
+		if (!linphone_call_log_matches_filter(cl,filter)) continue;
+		if (index++>=offset) result=ms_list_append(result,linphone_call_log_ref(cl));
+	}
+	return result;
+}
+
+int linphone_core_get_call_history_size(LinphoneCore *lc, const LinphoneCallLogFilter *filter){
+	MSList *elem;
+	int size=0;
+
+#ifdef MSG_STORAGE_ENABLED
+	if (lc->logs_db) return linphone_call_log_storage_get_history_size(lc,filter);
+#endif
+	for(elem=lc->call_logs;elem!=NULL;elem=elem->next){
+		if (linphone_call_log_matches_filter((LinphoneCallLog*)elem->data,filter)) size++;
+	}
+	return size;
+}
+
 
 /*******************************************************************************
  * Reference and user data handling functions                                  *
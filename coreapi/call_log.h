@@ -59,6 +59,17 @@ typedef enum _LinphoneCallStatus {
 **/
 typedef struct _LinphoneCallLog LinphoneCallLog;
 
+/**
+ * Criteria of the call logs returned by linphone_core_get_call_history().
+ * Zeroed fields do not filter anything.
+**/
+typedef struct _LinphoneCallLogFilter {
+	const LinphoneAddress *peer; /**< Only the calls with this remote address (compared with linphone_address_weak_equal()) */
+	time_t start_date; /**< Only the calls started at or after this date */
+	time_t end_date; /**< Only the calls started before this date */
+	bool_t missed_only; /**< Only the missed calls */
+} LinphoneCallLogFilter;
+
 
 /*******************************************************************************
  * Public functions                                                            *
@@ -1063,9 +1063,11 @@ static bool_t fill_auth_info_with_client_certificate(LinphoneCore *lc, SalAuthIn
 static bool_t fill_auth_info(LinphoneCore *lc, SalAuthInfo* sai) {
 	LinphoneAuthInfo *ai=(LinphoneAuthInfo*)linphone_core_find_auth_info(lc,sai->realm,sai->username,sai->domain);
 	if (ai) {
+		/*the ha1 computed from the password for the first challenge is used for the following ones*/
+		const char *ha1=linphone_auth_info_get_challenge_ha1(ai,sai->realm);
 		sai->userid=ms_strdup(ai->userid?ai->userid:ai->username);
 		sai->password=ai->passwd?ms_strdup(ai->passwd):NULL;
-		sai->ha1=ai->ha1?ms_strdup(ai->ha1):NULL;
+		sai->ha1=ha1?ms_strdup(ha1):NULL;
 		return TRUE;
 	} else {
 		return FALSE;
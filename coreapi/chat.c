@@ -224,13 +224,49 @@ bool_t linphone_core_chat_enabled(const LinphoneCore *lc){
 
 /**
  * Returns an list of chat rooms
+ * When lazy chat rooms are enabled, this creates all the chat rooms known from the history: prefer linphone_core_get_chat_rooms_page().
  * @param[in] lc #LinphoneCore object
  * @return \mslist{LinphoneChatRoom}
 **/
 MSList* linphone_core_get_chat_rooms(LinphoneCore *lc) {
+	/*chat rooms only known from the history are all created*/
+	while (linphone_message_storage_create_next_lazy_chat_room(lc)!=NULL);
 	return lc->chatrooms;
 }
 
+/**
+ * Returns the number of chat rooms, including the ones known from the history that have not been created yet.
+ * @param[in] lc #LinphoneCore object
+ * @return The number of chat rooms.
+**/
+int linphone_core_get_chat_rooms_count(LinphoneCore *lc) {
+	return ms_list_size(lc->chatrooms) + linphone_message_storage_get_lazy_chat_rooms_count(lc);
+}
+
+/**
+ * Returns a range of the chat rooms, in the order of linphone_core_get_chat_rooms().
+ * The chat rooms that were already created come first, followed by the ones known from the history, most recent conversation first.
+ * When lazy chat rooms are enabled, only the chat rooms up to the end of the requested range are created.
+ * @param[in] lc #LinphoneCore object
+ * @param[in] offset Rank of the first chat room to return.
+ * @param[in] count Maximum number of chat rooms to return.
+ * @return \mslist{LinphoneChatRoom} The list must be freed with ms_list_free(), the chat rooms belong to the core.
+**/
+MSList *linphone_core_get_chat_rooms_page(LinphoneCore *lc, int offset, int count) {
+	MSList *ret = NULL;
+	const MSList *elem;
+	int nb_rooms = ms_list_size(lc->chatrooms);
+	int i;
+
+	/*chat rooms only known from the history are created in order, so that the rank of a chat room does not change
+	from one page to the next*/
+	while (nb_rooms < offset + count && linphone_message_storage_create_next_lazy_chat_room(lc) != NULL) nb_rooms++;
+	for (elem = lc->chatrooms, i = 0; elem != NULL && i < offset + count; elem = elem->next, i++) {
+		if (i >= offset) ret = ms_list_append(ret, elem->data);
+	}
+	return ret;
+}
+
 static bool_t linphone_chat_room_matches(LinphoneChatRoom *cr, const LinphoneAddress *from){
 	return linphone_address_weak_equal(cr->peer_url,from);
 }
@@ -246,16 +282,53 @@ BELLE_SIP_INSTANCIATE_VPTR(LinphoneChatRoom, belle_sip_object_t,
 	FALSE
 );
 
+/*
+ * Chat rooms are indexed by peer address (see linphone_address_as_weak_key()) so that incoming messages and
+ * is-composing notifications are dispatched without walking the whole list of chat rooms.
+ */
+static void linphone_chat_room_index(LinphoneChatRoom *cr) {
+	LinphoneCore *lc = cr->lc;
+	cr->peer_key = linphone_address_as_weak_key(cr->peer_url);
+	if (lc->chatrooms_by_peer == NULL) lc->chatrooms_by_peer = linphone_hash_table_new_for_strings();
+	if (linphone_hash_table_lookup(lc->chatrooms_by_peer, cr->peer_key) == NULL)
+		linphone_hash_table_insert(lc->chatrooms_by_peer, cr->peer_key, cr);
+}
+
+static void linphone_chat_room_unindex(LinphoneChatRoom *cr) {
+	LinphoneCore *lc = cr->lc;
+	if (linphone_hash_table_lookup(lc->chatrooms_by_peer, cr->peer_key) == cr) {
+		LinphoneChatRoom *other = NULL;
+		MSList *elem;
+		/*another chat room may have been created for the same peer*/
+		for (elem = lc->chatrooms; elem != NULL; elem = elem->next) {
+			other = (LinphoneChatRoom *)elem->data;
+			if (other != cr && strcmp(other->peer_key, cr->peer_key) == 0) break;
+			other = NULL;
+		}
+		if (other) linphone_hash_table_insert(lc->chatrooms_by_peer, cr->peer_key, other);
+		else linphone_hash_table_remove(lc->chatrooms_by_peer, cr->peer_key);
+	}
+}
+
+void linphone_core_clear_chat_room_index(LinphoneCore *lc) {
+	if (lc->chatrooms_by_peer) {
+		linphone_hash_table_destroy(lc->chatrooms_by_peer);
+		lc->chatrooms_by_peer = NULL;
+	}
+}
+
 static LinphoneChatRoom * _linphone_core_create_chat_room(LinphoneCore *lc, LinphoneAddress *addr) {
 	LinphoneChatRoom *cr = belle_sip_object_new(LinphoneChatRoom);
 	cr->lc = lc;
 	cr->peer = linphone_address_as_string(addr);
 	cr->peer_url = addr;
+	cr->unread_count = -1;
 	lc->chatrooms = ms_list_append(lc->chatrooms, (void *)cr);
+	linphone_chat_room_index(cr);
 	return cr;
 }
 
-static LinphoneChatRoom * _linphone_core_create_chat_room_from_url(LinphoneCore *lc, const char *to) {
+LinphoneChatRoom * _linphone_core_create_chat_room_from_url(LinphoneCore *lc, const char *to) {
 	LinphoneAddress *parsed_url = NULL;
 	if ((parsed_url = linphone_core_interpret_url(lc, to)) != NULL) {
 		return _linphone_core_create_chat_room(lc, parsed_url);
@@ -266,12 +339,24 @@ static LinphoneChatRoom * _linphone_core_create_chat_room_from_url(LinphoneCore
 LinphoneChatRoom * _linphone_core_get_chat_room(LinphoneCore *lc, const LinphoneAddress *addr){
 	LinphoneChatRoom *cr=NULL;
 	MSList *elem;
-	for(elem=lc->chatrooms;elem!=NULL;elem=ms_list_next(elem)){
-		cr=(LinphoneChatRoom*)elem->data;
-		if (linphone_chat_room_matches(cr,addr)){
-			break;
+	char *key;
+
+	key=linphone_address_as_weak_key(addr);
+	cr=(LinphoneChatRoom*)linphone_hash_table_lookup(lc->chatrooms_by_peer,key);
+	ms_free(key);
+	if (cr!=NULL && !linphone_chat_room_matches(cr,addr)){
+		/*the key does not distinguish a missing username or domain from an empty one*/
+		for(elem=lc->chatrooms;elem!=NULL;elem=ms_list_next(elem)){
+			cr=(LinphoneChatRoom*)elem->data;
+			if (linphone_chat_room_matches(cr,addr)){
+				break;
+			}
+			cr=NULL;
 		}
-		cr=NULL;
+	}
+	if (cr==NULL){
+		/*the chat room may be known from the history without having been created yet*/
+		cr=linphone_message_storage_get_lazy_chat_room(lc,addr);
 	}
 	return cr;
 }
@@ -372,9 +457,11 @@ static void _linphone_chat_room_destroy(LinphoneChatRoom *cr){
 	linphone_chat_room_delete_remote_composing_refresh_timer(cr);
 	if (cr->lc != NULL) {
 		cr->lc->chatrooms=ms_list_remove(cr->lc->chatrooms,(void *) cr);
+		linphone_chat_room_unindex(cr);
 	}
 	linphone_address_destroy(cr->peer_url);
 	ms_free(cr->peer);
+	ms_free(cr->peer_key);
 }
 
 /**
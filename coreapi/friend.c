@@ -88,22 +88,145 @@ MSList *linphone_find_friend_by_address(MSList *fl, const LinphoneAddress *addr,
 	return res;
 }
 
-LinphoneFriend *linphone_find_friend_by_inc_subscribe(MSList *l, SalOp *op){
-	MSList *elem;
-	for (elem=l;elem!=NULL;elem=elem->next){
+/*
+ * The friend list of the core is indexed by normalized address, by refkey and by subscription op, so that incoming
+ * SUBSCRIBE/NOTIFY and application lookups do not have to walk the whole list.
+ * When several friends share the same address or refkey, the index points to the first one added, like the linear
+ * searches did.
+ */
+static LinphoneFriend *linphone_core_find_friend_by_address_key(const LinphoneCore *lc, const char *key, const LinphoneFriend *excluded){
+	const MSList *elem;
+	for(elem=lc->friends;elem!=NULL;elem=elem->next){
 		LinphoneFriend *lf=(LinphoneFriend*)elem->data;
-		if (lf->insub==op) return lf;
+		if (lf!=excluded && lf->address_key!=NULL && strcmp(lf->address_key,key)==0) return lf;
 	}
 	return NULL;
 }
 
-LinphoneFriend *linphone_find_friend_by_out_subscribe(MSList *l, SalOp *op){
-	MSList *elem;
-	LinphoneFriend *lf;
-	for (elem=l;elem!=NULL;elem=elem->next){
-		lf=(LinphoneFriend*)elem->data;
-		if (lf->outsub==op) return lf;
+static LinphoneFriend *linphone_core_find_friend_by_refkey_slow(const LinphoneCore *lc, const char *key, const LinphoneFriend *excluded){
+	const MSList *elem;
+	for(elem=lc->friends;elem!=NULL;elem=elem->next){
+		LinphoneFriend *lf=(LinphoneFriend*)elem->data;
+		if (lf!=excluded && lf->refkey!=NULL && strcmp(lf->refkey,key)==0) return lf;
+	}
+	return NULL;
+}
+
+static void linphone_friend_index_address(LinphoneFriend *lf){
+	LinphoneCore *lc=lf->lc;
+	if (lf->uri==NULL) return;
+	lf->address_key=linphone_address_as_weak_key(lf->uri);
+	if (lc->friends_by_address==NULL) lc->friends_by_address=linphone_hash_table_new_for_strings();
+	if (linphone_hash_table_lookup(lc->friends_by_address,lf->address_key)==NULL)
+		linphone_hash_table_insert(lc->friends_by_address,lf->address_key,lf);
+}
+
+static void linphone_friend_unindex_address(LinphoneFriend *lf){
+	LinphoneCore *lc=lf->lc;
+	if (lf->address_key==NULL) return;
+	if (linphone_hash_table_lookup(lc->friends_by_address,lf->address_key)==lf){
+		LinphoneFriend *other=linphone_core_find_friend_by_address_key(lc,lf->address_key,lf);
+		if (other!=NULL) linphone_hash_table_insert(lc->friends_by_address,lf->address_key,other);
+		else linphone_hash_table_remove(lc->friends_by_address,lf->address_key);
+	}
+	ms_free(lf->address_key);
+	lf->address_key=NULL;
+}
+
+static void linphone_friend_index_refkey(LinphoneFriend *lf){
+	LinphoneCore *lc=lf->lc;
+	if (lf->refkey==NULL) return;
+	if (lc->friends_by_refkey==NULL) lc->friends_by_refkey=linphone_hash_table_new_for_strings();
+	if (linphone_hash_table_lookup(lc->friends_by_refkey,lf->refkey)==NULL)
+		linphone_hash_table_insert(lc->friends_by_refkey,lf->refkey,lf);
+}
+
+static void linphone_friend_unindex_refkey(LinphoneFriend *lf){
+	LinphoneCore *lc=lf->lc;
+	if (lf->refkey==NULL) return;
+	if (linphone_hash_table_lookup(lc->friends_by_refkey,lf->refkey)==lf){
+		LinphoneFriend *other=linphone_core_find_friend_by_refkey_slow(lc,lf->refkey,lf);
+		if (other!=NULL) linphone_hash_table_insert(lc->friends_by_refkey,lf->refkey,other);
+		else linphone_hash_table_remove(lc->friends_by_refkey,lf->refkey);
+	}
+}
+
+static void linphone_friend_index_op(LinphoneFriend *lf, SalOp *op){
+	LinphoneCore *lc=lf->lc;
+	if (op==NULL) return;
+	if (lc->friends_by_op==NULL) lc->friends_by_op=linphone_hash_table_new_for_pointers();
+	linphone_hash_table_insert(lc->friends_by_op,op,lf);
+}
+
+static void linphone_friend_unindex_op(LinphoneFriend *lf, SalOp *op){
+	LinphoneCore *lc=lf->lc;
+	if (op==NULL) return;
+	if (linphone_hash_table_lookup(lc->friends_by_op,op)==lf)
+		linphone_hash_table_remove(lc->friends_by_op,op);
+}
+
+static void linphone_friend_add_to_indexes(LinphoneFriend *lf){
+	linphone_friend_index_address(lf);
+	linphone_friend_index_refkey(lf);
+	linphone_friend_index_op(lf,lf->insub);
+	linphone_friend_index_op(lf,lf->outsub);
+}
+
+static void linphone_friend_remove_from_indexes(LinphoneFriend *lf){
+	linphone_friend_unindex_address(lf);
+	linphone_friend_unindex_refkey(lf);
+	linphone_friend_unindex_op(lf,lf->insub);
+	linphone_friend_unindex_op(lf,lf->outsub);
+}
+
+/*to be called when the address of a friend that belongs to a core may have changed*/
+static void linphone_friend_update_address_index(LinphoneFriend *lf){
+	char *key;
+	if (lf->lc==NULL || lf->uri==NULL) return;
+	key=linphone_address_as_weak_key(lf->uri);
+	if (lf->address_key==NULL || strcmp(key,lf->address_key)!=0){
+		linphone_friend_unindex_address(lf);
+		linphone_friend_index_address(lf);
+	}
+	ms_free(key);
+}
+
+void linphone_core_clear_friend_indexes(LinphoneCore *lc){
+	if (lc->friends_by_address){
+		linphone_hash_table_destroy(lc->friends_by_address);
+		lc->friends_by_address=NULL;
+	}
+	if (lc->friends_by_refkey){
+		linphone_hash_table_destroy(lc->friends_by_refkey);
+		lc->friends_by_refkey=NULL;
+	}
+	if (lc->friends_by_op){
+		linphone_hash_table_destroy(lc->friends_by_op);
+		lc->friends_by_op=NULL;
 	}
+}
+
+void linphone_friend_set_inc_subscribe_op(LinphoneFriend *lf, SalOp *op){
+	if (lf->lc) linphone_friend_unindex_op(lf,lf->insub);
+	lf->insub=op;
+	if (lf->lc) linphone_friend_index_op(lf,op);
+}
+
+void linphone_friend_set_out_subscribe_op(LinphoneFriend *lf, SalOp *op){
+	if (lf->lc) linphone_friend_unindex_op(lf,lf->outsub);
+	lf->outsub=op;
+	if (lf->lc) linphone_friend_index_op(lf,op);
+}
+
+LinphoneFriend *linphone_core_find_friend_by_inc_subscribe(const LinphoneCore *lc, SalOp *op){
+	LinphoneFriend *lf=(LinphoneFriend*)linphone_hash_table_lookup(lc->friends_by_op,op);
+	if (lf!=NULL && lf->insub==op) return lf;
+	return NULL;
+}
+
+LinphoneFriend *linphone_core_find_friend_by_out_subscribe(const LinphoneCore *lc, SalOp *op){
+	LinphoneFriend *lf=(LinphoneFriend*)linphone_hash_table_lookup(lc->friends_by_op,op);
+	if (lf!=NULL && lf->outsub==op) return lf;
 	return NULL;
 }
 
@@ -119,9 +242,9 @@ void __linphone_friend_do_subscribe(LinphoneFriend *fr){
 		 */
 	}else{
 		sal_op_release(fr->outsub);
-		fr->outsub=NULL;
+		linphone_friend_set_out_subscribe_op(fr,NULL);
 	}
-	fr->outsub=sal_op_new(lc->sal);
+	linphone_friend_set_out_subscribe_op(fr,sal_op_new(lc->sal));
 	linphone_configure_op(lc,fr->outsub,fr->uri,NULL,TRUE);
 	sal_subscribe_presence(fr->outsub,NULL,NULL,lp_config_get_int(lc->config,"sip","subscribe_expires",600));
 	fr->subscribe_active=TRUE;
@@ -202,6 +325,7 @@ int linphone_friend_set_address(LinphoneFriend *lf, const LinphoneAddress *addr)
 	linphone_address_clean(fr);
 	if (lf->uri!=NULL) linphone_address_destroy(lf->uri);
 	lf->uri=fr;
+	linphone_friend_update_address_index(lf);
 	return 0;
 }
 
@@ -246,7 +370,7 @@ static void linphone_friend_invalidate_subscription(LinphoneFriend *lf){
 	if (lf->outsub!=NULL) {
 		LinphoneCore *lc=lf->lc;
 		sal_op_release(lf->outsub);
-		lf->outsub=NULL;
+		linphone_friend_set_out_subscribe_op(lf,NULL);
 		lf->subscribe_active=FALSE;
 		/*notify application that we no longer know the presence activity */
 		if (lf->presence != NULL) {
@@ -267,6 +391,11 @@ void linphone_friend_close_subscriptions(LinphoneFriend *lf){
 }
 
 void linphone_friend_destroy(LinphoneFriend *lf){
+	if (lf->lc){
+		MSList *elem=ms_list_find(lf->lc->presence_notify_queue,lf);
+		if (elem) lf->lc->presence_notify_queue=ms_list_remove_link(lf->lc->presence_notify_queue,elem);
+		if (lf->subscribe_scheduled) lf->lc->subscribe_queue=ms_list_remove(lf->lc->subscribe_queue,lf);
+	}
 	if (lf->insub) {
 		sal_op_release(lf->insub);
 		lf->insub=NULL;
@@ -278,6 +407,8 @@ void linphone_friend_destroy(LinphoneFriend *lf){
 	if (lf->presence != NULL) linphone_presence_model_unref(lf->presence);
 	if (lf->uri!=NULL) linphone_address_destroy(lf->uri);
 	if (lf->info!=NULL) buddy_info_free(lf->info);
+	if (lf->refkey!=NULL) ms_free(lf->refkey);
+	if (lf->address_key!=NULL) ms_free(lf->address_key);
 	ms_free(lf);
 }
 
@@ -408,8 +539,7 @@ void linphone_friend_update_subscribes(LinphoneFriend *fr, LinphoneProxyConfig *
 		}
 	}
 	if (can_subscribe && fr->subscribe && fr->subscribe_active==FALSE){
-		ms_message("Sending a new SUBSCRIBE");
-		__linphone_friend_do_subscribe(fr);
+		linphone_core_schedule_friend_subscribe(fr->lc,fr);
 	}else if (can_subscribe && fr->subscribe_active && !fr->subscribe){
 		linphone_friend_unsubscribe(fr);
 	}else if (!can_subscribe && fr->outsub){
@@ -427,6 +557,7 @@ void linphone_friend_apply(LinphoneFriend *fr, LinphoneCore *lc){
 	}
 
 	linphone_core_write_friends_config(lc);
+	linphone_friend_update_address_index(fr);
 
 	if (fr->inc_subscribe_pending){
 		switch(fr->pol){
@@ -483,6 +614,7 @@ void linphone_core_add_friend(LinphoneCore *lc, LinphoneFriend *lf)
 	}
 	lc->friends=ms_list_append(lc->friends,lf);
 	lf->lc=lc;
+	linphone_friend_add_to_indexes(lf);
 	if ( linphone_core_ready(lc)) linphone_friend_apply(lf,lc);
 	else lf->commit=TRUE;
 	return ;
@@ -491,8 +623,9 @@ void linphone_core_add_friend(LinphoneCore *lc, LinphoneFriend *lf)
 void linphone_core_remove_friend(LinphoneCore *lc, LinphoneFriend* fl){
 	MSList *el=ms_list_find(lc->friends,fl);
 	if (el!=NULL){
-		linphone_friend_destroy((LinphoneFriend*)el->data);
 		lc->friends=ms_list_remove_link(lc->friends,el);
+		linphone_friend_remove_from_indexes(fl);
+		linphone_friend_destroy(fl);
 		linphone_core_write_friends_config(lc);
 	}else{
 		ms_error("linphone_core_remove_friend(): friend [%p] is not part of core's list.",fl);
@@ -517,24 +650,176 @@ void linphone_core_send_initial_subscribes(LinphoneCore *lc){
 	linphone_core_update_friends_subscriptions(lc,NULL,linphone_core_should_subscribe_friends_only_when_registered(lc));
 }
 
+/*
+ * SUBSCRIBEs to friends are not sent right away but queued, and the queue is emptied at sip/subscribe_rate requests
+ * per second (0 for no limit), plus a random delay of up to sip/subscribe_jitter_ms between two of them.
+ * When the server answers 503, the queue is suspended for the time given by its Retry-After header, or for an
+ * exponential back-off delay starting at sip/subscribe_backoff_ms and limited to sip/subscribe_max_backoff_ms.
+ * When a presence list URI is configured, a single subscription to this resource list (RFC 4662) replaces the ones of
+ * the friends, unless the server does not support it.
+ */
+static bool_t linphone_core_presence_list_enabled(const LinphoneCore *lc){
+	return linphone_core_get_presence_list_uri(lc)!=NULL && !lc->presence_list_unavailable;
+}
+
+static void linphone_core_subscribe_presence_list(LinphoneCore *lc){
+	const char *uri=linphone_core_get_presence_list_uri(lc);
+	LinphoneAddress *addr;
+
+	if (lc->presence_list_op!=NULL || uri==NULL) return;
+	addr=linphone_address_new(uri);
+	if (addr==NULL){
+		ms_error("Invalid presence list uri [%s], subscribing to friends individually.",uri);
+		lc->presence_list_unavailable=TRUE;
+		return;
+	}
+	ms_message("Subscribing to presence list [%s]",uri);
+	lc->presence_list_op=sal_op_new(lc->sal);
+	linphone_configure_op(lc,lc->presence_list_op,addr,NULL,TRUE);
+	sal_subscribe_presence_list(lc->presence_list_op,NULL,NULL,lp_config_get_int(lc->config,"sip","subscribe_expires",600));
+	linphone_address_destroy(addr);
+}
+
+void linphone_core_close_presence_list(LinphoneCore *lc){
+	if (lc->presence_list_op!=NULL){
+		sal_unsubscribe(lc->presence_list_op);
+		sal_op_release(lc->presence_list_op);
+		lc->presence_list_op=NULL;
+	}
+	lc->presence_list_pending=FALSE;
+}
+
+static int linphone_core_get_subscribe_jitter(const LinphoneCore *lc){
+	int jitter=lp_config_get_int(lc->config,"sip","subscribe_jitter_ms",0);
+	return jitter>0 ? (int)(ortp_random()%(jitter+1)) : 0;
+}
+
+void linphone_core_schedule_friend_subscribe(LinphoneCore *lc, LinphoneFriend *lf){
+	if (linphone_core_presence_list_enabled(lc)){
+		/*the presence of this friend will be given by the resource list*/
+		if (lc->presence_list_op==NULL) lc->presence_list_pending=TRUE;
+	}else if (!lf->subscribe_scheduled){
+		lf->subscribe_scheduled=TRUE;
+		lc->subscribe_queue=ms_list_append(lc->subscribe_queue,lf);
+	}
+	linphone_core_process_subscribe_queue(lc);
+}
+
+void linphone_core_process_subscribe_queue(LinphoneCore *lc){
+	uint64_t now;
+	int rate;
+
+	if (lc->subscribe_queue==NULL && !lc->presence_list_pending) return;
+	now=ortp_get_cur_time_ms();
+	if (now<lc->subscribe_resume_time) return;
+	if (lc->presence_list_pending){
+		lc->presence_list_pending=FALSE;
+		linphone_core_subscribe_presence_list(lc);
+	}
+	rate=lp_config_get_int(lc->config,"sip","subscribe_rate",20);
+	while(lc->subscribe_queue!=NULL && now>=lc->next_subscribe_time){
+		LinphoneFriend *lf=(LinphoneFriend*)lc->subscribe_queue->data;
+		lc->subscribe_queue=ms_list_remove_link(lc->subscribe_queue,lc->subscribe_queue);
+		lf->subscribe_scheduled=FALSE;
+		if (!lf->subscribe || lf->subscribe_active) continue;
+		ms_message("Sending a new SUBSCRIBE");
+		__linphone_friend_do_subscribe(lf);
+		if (rate>0) lc->next_subscribe_time=now+1000/rate+linphone_core_get_subscribe_jitter(lc);
+	}
+}
+
+void linphone_core_delay_subscribes(LinphoneCore *lc, int retry_after){
+	int delay;
+
+	if (retry_after>0){
+		delay=retry_after*1000;
+	}else{
+		int max_delay=lp_config_get_int(lc->config,"sip","subscribe_max_backoff_ms",120000);
+		if (lc->subscribe_backoff>0) lc->subscribe_backoff=MIN(lc->subscribe_backoff*2,max_delay);
+		else lc->subscribe_backoff=lp_config_get_int(lc->config,"sip","subscribe_backoff_ms",2000);
+		delay=lc->subscribe_backoff;
+	}
+	delay+=linphone_core_get_subscribe_jitter(lc);
+	ms_message("Presence server is overloaded, SUBSCRIBEs are suspended for %i ms.",delay);
+	lc->subscribe_resume_time=MAX(lc->subscribe_resume_time,ortp_get_cur_time_ms()+delay);
+}
+
+void linphone_core_presence_list_terminated(LinphoneCore *lc, int code, int retry_after){
+	lc->presence_list_op=NULL;
+	if (code==503){
+		linphone_core_delay_subscribes(lc,retry_after);
+		lc->presence_list_pending=TRUE;
+	}else if (code>=300){
+		ms_warning("Subscription to presence list rejected with code [%i], subscribing to friends individually.",code);
+		lc->presence_list_unavailable=TRUE;
+		linphone_core_update_friends_subscriptions(lc,NULL,linphone_core_should_subscribe_friends_only_when_registered(lc));
+	}else if (lc->initial_subscribes_sent){
+		/*terminated by the server*/
+		lc->presence_list_pending=TRUE;
+	}
+}
+
+void linphone_core_clear_subscribe_queue(LinphoneCore *lc){
+	MSList *elem;
+	for(elem=lc->subscribe_queue;elem!=NULL;elem=elem->next){
+		((LinphoneFriend*)elem->data)->subscribe_scheduled=FALSE;
+	}
+	lc->subscribe_queue=ms_list_free(lc->subscribe_queue);
+	lc->next_subscribe_time=0;
+	lc->subscribe_resume_time=0;
+	lc->subscribe_backoff=0;
+}
+
+void linphone_core_set_presence_list_uri(LinphoneCore *lc, const char *uri){
+	if (uri!=NULL && uri[0]!='\0'){
+		LinphoneAddress *addr=linphone_address_new(uri);
+		if (addr==NULL){
+			ms_error("linphone_core_set_presence_list_uri(): invalid uri [%s]",uri);
+			return;
+		}
+		linphone_address_destroy(addr);
+	}else uri=NULL;
+	lp_config_set_string(lc->config,"sip","rls_uri",uri);
+	linphone_core_close_presence_list(lc);
+	lc->presence_list_unavailable=FALSE;
+	if (lc->initial_subscribes_sent){
+		if (uri!=NULL) lc->presence_list_pending=TRUE;
+		linphone_core_update_friends_subscriptions(lc,NULL,linphone_core_should_subscribe_friends_only_when_registered(lc));
+	}
+}
+
+const char *linphone_core_get_presence_list_uri(const LinphoneCore *lc){
+	return lp_config_get_string(lc->config,"sip","rls_uri",NULL);
+}
+
 void linphone_core_invalidate_friend_subscriptions(LinphoneCore *lc){
 	const MSList *elem;
 	for(elem=lc->friends;elem!=NULL;elem=elem->next){
 		LinphoneFriend *f=(LinphoneFriend*)elem->data;
 		linphone_friend_invalidate_subscription(f);
 	}
+	linphone_core_clear_subscribe_queue(lc);
+	if (lc->presence_list_op!=NULL){
+		sal_op_release(lc->presence_list_op);
+		lc->presence_list_op=NULL;
+	}
+	lc->presence_list_pending=FALSE;
+	lc->presence_list_unavailable=FALSE;
 	lc->initial_subscribes_sent=FALSE;
 }
 
 void linphone_friend_set_ref_key(LinphoneFriend *lf, const char *key){
 	if (lf->refkey!=NULL){
+		if (lf->lc) linphone_friend_unindex_refkey(lf);
 		ms_free(lf->refkey);
 		lf->refkey=NULL;
 	}
 	if (key)
 		lf->refkey=ms_strdup(key);
-	if (lf->lc)
+	if (lf->lc){
+		linphone_friend_index_refkey(lf);
 		linphone_core_write_friends_config(lf->lc);
+	}
 }
 
 const char *linphone_friend_get_ref_key(const LinphoneFriend *lf){
@@ -544,6 +829,14 @@ const char *linphone_friend_get_ref_key(const LinphoneFriend *lf){
 LinphoneFriend *linphone_core_find_friend(const LinphoneCore *lc, const LinphoneAddress *addr){
 	LinphoneFriend *lf=NULL;
 	MSList *elem;
+	char *key;
+
+	if (lc->friends_by_address==NULL) return NULL;
+	key=linphone_address_as_weak_key(addr);
+	lf=(LinphoneFriend*)linphone_hash_table_lookup(lc->friends_by_address,key);
+	ms_free(key);
+	if (lf==NULL || linphone_address_weak_equal(lf->uri,addr)) return lf;
+	/*the key does not distinguish a missing username or domain from an empty one*/
 	for(elem=lc->friends;elem!=NULL;elem=ms_list_next(elem)){
 		lf=(LinphoneFriend*)elem->data;
 		if (linphone_address_weak_equal(lf->uri,addr))
@@ -561,15 +854,7 @@ LinphoneFriend *linphone_core_get_friend_by_address(const LinphoneCore *lc, cons
 }
 
 LinphoneFriend *linphone_core_get_friend_by_ref_key(const LinphoneCore *lc, const char *key){
-	const MSList *elem;
-	if (key==NULL) return NULL;
-	for(elem=linphone_core_get_friend_list(lc);elem!=NULL;elem=elem->next){
-		LinphoneFriend *lf=(LinphoneFriend*)elem->data;
-		if (lf->refkey!=NULL && strcmp(lf->refkey,key)==0){
-			return lf;
-		}
-	}
-	return NULL;
+	return (LinphoneFriend*)linphone_hash_table_lookup(lc->friends_by_refkey,key);
 }
 
 #define key_compare(s1,s2)	strcmp(s1,s2)
@@ -0,0 +1,214 @@
+/*
+hashtable.c
+Copyright (C) 2015  Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#include "private.h"
+#include <ctype.h>
+
+#define HASH_TABLE_INITIAL_SIZE 16
+
+typedef struct _LinphoneHashTableEntry{
+	struct _LinphoneHashTableEntry *next;
+	void *key;
+	void *value;
+	unsigned int hash;
+}LinphoneHashTableEntry;
+
+struct _LinphoneHashTable{
+	LinphoneHashTableEntry **buckets;
+	size_t nbuckets; /*always a power of 2*/
+	size_t count;
+	LinphoneHashFunc hash_func;
+	LinphoneHashCompareFunc compare_func;
+	bool_t copy_keys; /*keys are strings duplicated on insertion*/
+};
+
+/*FNV-1a*/
+unsigned int linphone_hash_string(const void *key){
+	const unsigned char *p=(const unsigned char*)key;
+	unsigned int h=2166136261U;
+	while(*p!='\0'){
+		h^=*p++;
+		h*=16777619U;
+	}
+	return h;
+}
+
+unsigned int linphone_hash_string_nocase(const void *key){
+	const unsigned char *p=(const unsigned char*)key;
+	unsigned int h=2166136261U;
+	while(*p!='\0'){
+		h^=(unsigned char)tolower(*p++);
+		h*=16777619U;
+	}
+	return h;
+}
+
+unsigned int linphone_hash_pointer(const void *key){
+	size_t v=(size_t)key;
+	/*pointers are aligned, so spread the high bits on the low ones*/
+	v^=(v>>4)^(v>>16);
+	return (unsigned int)(v*2654435761U);
+}
+
+static int compare_strings(const void *k1, const void *k2){
+	return strcmp((const char*)k1,(const char*)k2);
+}
+
+static int compare_strings_nocase(const void *k1, const void *k2){
+	return strcasecmp((const char*)k1,(const char*)k2);
+}
+
+static int compare_pointers(const void *k1, const void *k2){
+	return k1!=k2;
+}
+
+LinphoneHashTable *linphone_hash_table_new(LinphoneHashFunc hash_func, LinphoneHashCompareFunc compare_func, bool_t copy_keys){
+	LinphoneHashTable *table=ms_new0(LinphoneHashTable,1);
+	table->nbuckets=HASH_TABLE_INITIAL_SIZE;
+	table->buckets=ms_new0(LinphoneHashTableEntry*,table->nbuckets);
+	table->hash_func=hash_func;
+	table->compare_func=compare_func;
+	table->copy_keys=copy_keys;
+	return table;
+}
+
+LinphoneHashTable *linphone_hash_table_new_for_strings(void){
+	return linphone_hash_table_new(linphone_hash_string,compare_strings,TRUE);
+}
+
+LinphoneHashTable *linphone_hash_table_new_for_strings_nocase(void){
+	return linphone_hash_table_new(linphone_hash_string_nocase,compare_strings_nocase,TRUE);
+}
+
+LinphoneHashTable *linphone_hash_table_new_for_strings_nocopy(void){
+	return linphone_hash_table_new(linphone_hash_string,compare_strings,FALSE);
+}
+
+LinphoneHashTable *linphone_hash_table_new_for_pointers(void){
+	return linphone_hash_table_new(linphone_hash_pointer,compare_pointers,FALSE);
+}
+
+void linphone_hash_table_clear(LinphoneHashTable *table){
+	size_t i;
+	for(i=0;i<table->nbuckets;i++){
+		LinphoneHashTableEntry *entry=table->buckets[i];
+		while(entry!=NULL){
+			LinphoneHashTableEntry *next=entry->next;
+			if (table->copy_keys) ms_free(entry->key);
+			ms_free(entry);
+			entry=next;
+		}
+		table->buckets[i]=NULL;
+	}
+	table->count=0;
+}
+
+void linphone_hash_table_destroy(LinphoneHashTable *table){
+	linphone_hash_table_clear(table);
+	ms_free(table->buckets);
+	ms_free(table);
+}
+
+static LinphoneHashTableEntry **linphone_hash_table_find(const LinphoneHashTable *table, const void *key, unsigned int hash){
+	LinphoneHashTableEntry **entry=&table->buckets[hash&(table->nbuckets-1)];
+	while(*entry!=NULL){
+		if ((*entry)->hash==hash && table->compare_func((*entry)->key,key)==0) break;
+		entry=&(*entry)->next;
+	}
+	return entry;
+}
+
+static void linphone_hash_table_grow(LinphoneHashTable *table){
+	size_t nbuckets=table->nbuckets*2;
+	LinphoneHashTableEntry **buckets=ms_new0(LinphoneHashTableEntry*,nbuckets);
+	size_t i;
+	for(i=0;i<table->nbuckets;i++){
+		LinphoneHashTableEntry *entry=table->buckets[i];
+		while(entry!=NULL){
+			LinphoneHashTableEntry *next=entry->next;
+			size_t index=entry->hash&(nbuckets-1);
+			entry->next=buckets[index];
+			buckets[index]=entry;
+			entry=next;
+		}
+	}
+	ms_free(table->buckets);
+	table->buckets=buckets;
+	table->nbuckets=nbuckets;
+}
+
+void linphone_hash_table_insert(LinphoneHashTable *table, const void *key, void *value){
+	unsigned int hash=table->hash_func(key);
+	LinphoneHashTableEntry **entry=linphone_hash_table_find(table,key,hash);
+	LinphoneHashTableEntry *new_entry;
+
+	if (*entry!=NULL){
+		(*entry)->value=value;
+		return;
+	}
+	new_entry=ms_new0(LinphoneHashTableEntry,1);
+	new_entry->key=table->copy_keys ? ms_strdup((const char*)key) : (void*)key;
+	new_entry->value=value;
+	new_entry->hash=hash;
+	*entry=new_entry;
+	table->count++;
+	if (table->count>table->nbuckets-table->nbuckets/4){
+		linphone_hash_table_grow(table);
+	}
+}
+
+void *linphone_hash_table_lookup(const LinphoneHashTable *table, const void *key){
+	LinphoneHashTableEntry **entry;
+	if (table==NULL || key==NULL) return NULL;
+	entry=linphone_hash_table_find(table,key,table->hash_func(key));
+	return *entry ? (*entry)->value : NULL;
+}
+
+void *linphone_hash_table_remove(LinphoneHashTable *table, const void *key){
+	LinphoneHashTableEntry **entry;
+	LinphoneHashTableEntry *found;
+	void *value;
+
+	if (table==NULL || key==NULL) return NULL;
+	entry=linphone_hash_table_find(table,key,table->hash_func(key));
+	found=*entry;
+	if (found==NULL) return NULL;
+	*entry=found->next;
+	value=found->value;
+	if (table->copy_keys) ms_free(found->key);
+	ms_free(found);
+	table->count--;
+	return value;
+}
+
+size_t linphone_hash_table_size(const LinphoneHashTable *table){
+	return table ? table->count : 0;
+}
+
+void linphone_hash_table_for_each(const LinphoneHashTable *table, LinphoneHashTableForEachFunc func, void *user_data){
+	size_t i;
+	for(i=0;i<table->nbuckets;i++){
+		LinphoneHashTableEntry *entry=table->buckets[i];
+		while(entry!=NULL){
+			LinphoneHashTableEntry *next=entry->next;
+			func(entry->key,entry->value,user_data);
+			entry=next;
+		}
+	}
+}
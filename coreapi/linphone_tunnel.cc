@@ -328,6 +328,15 @@ bool_t linphone_tunnel_sip_enabled(const LinphoneTunnel *tunnel) {
 	return bcTunnel(tunnel)->tunnelizeSipPacketsEnabled() ? TRUE : FALSE;
 }
 
+void linphone_tunnel_enable_rtp_multiplexing(LinphoneTunnel *tunnel, bool_t enable) {
+	bcTunnel(tunnel)->enableRtpMultiplexing(enable);
+	lp_config_set_int(config(tunnel), "tunnel", "rtp_multiplexing", (enable ? TRUE : FALSE));
+}
+
+bool_t linphone_tunnel_rtp_multiplexing_enabled(const LinphoneTunnel *tunnel) {
+	return bcTunnel(tunnel)->rtpMultiplexingEnabled() ? TRUE : FALSE;
+}
+
 static void my_ortp_logv(OrtpLogLevel level, const char *fmt, va_list args){
 	ortp_logv(level,fmt,args);
 }
@@ -358,9 +367,11 @@ const char *tunnel_mode_to_string(LinphoneTunnelMode mode) {
 void linphone_tunnel_configure(LinphoneTunnel *tunnel){
 	LinphoneTunnelMode mode = string_to_tunnel_mode(lp_config_get_string(config(tunnel), "tunnel", "mode", NULL));
 	bool_t tunnelizeSIPPackets = (bool_t)lp_config_get_int(config(tunnel), "tunnel", "sip", TRUE);
+	bool_t rtpMultiplexing = (bool_t)lp_config_get_int(config(tunnel), "tunnel", "rtp_multiplexing", FALSE);
 	linphone_tunnel_enable_logs_with_handler(tunnel,TRUE,my_ortp_logv);
 	linphone_tunnel_load_config(tunnel);
 	linphone_tunnel_enable_sip(tunnel, tunnelizeSIPPackets);
+	linphone_tunnel_enable_rtp_multiplexing(tunnel, rtpMultiplexing);
 	linphone_tunnel_set_mode(tunnel, mode);
 }
 
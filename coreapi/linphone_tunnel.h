@@ -222,6 +222,23 @@ LINPHONE_PUBLIC void linphone_tunnel_enable_sip(LinphoneTunnel *tunnel, bool_t e
  */
 LINPHONE_PUBLIC bool_t linphone_tunnel_sip_enabled(const LinphoneTunnel *tunnel);
 
+/**
+ * @brief Set whether the RTP and RTCP flows of the calls share a single tunnel channel
+ * When enabled, the audio and video RTP and RTCP flows of all the calls are multiplexed over one tunnel socket
+ * instead of one socket per flow, each packet being prefixed with a 2 bytes stream identifier.
+ * The tunnel server must support this mode. The setting is taken into account for the streams created afterwards.
+ * @param tunnel Tunnel to configure
+ * @param enable If true, RTP and RTCP flows are multiplexed over a single tunnel channel
+ */
+LINPHONE_PUBLIC void linphone_tunnel_enable_rtp_multiplexing(LinphoneTunnel *tunnel, bool_t enable);
+
+/**
+ * @brief Check whether the RTP and RTCP flows of the calls share a single tunnel channel
+ * @param tunnel Tunnel to check
+ * @return True, RTP and RTCP flows are multiplexed over a single tunnel channel
+ */
+LINPHONE_PUBLIC bool_t linphone_tunnel_rtp_multiplexing_enabled(const LinphoneTunnel *tunnel);
+
 /**
  * Set an optional http proxy to go through when connecting to tunnel server.
  * @param tunnel LinphoneTunnel object
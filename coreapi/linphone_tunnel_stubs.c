@@ -84,6 +84,8 @@ void linphone_tunnel_configure(LinphoneTunnel *tunnel){
 
 void linphone_tunnel_enable_sip(LinphoneTunnel *tunnel, bool_t enable) {}
 bool_t linphone_tunnel_sip_enabled(const LinphoneTunnel *tunnel) { return FALSE; }
+void linphone_tunnel_enable_rtp_multiplexing(LinphoneTunnel *tunnel, bool_t enable) {}
+bool_t linphone_tunnel_rtp_multiplexing_enabled(const LinphoneTunnel *tunnel) { return FALSE; }
 
 /* Deprecated functions */
 void linphone_tunnel_enable(LinphoneTunnel *tunnel, bool_t enabled) {}
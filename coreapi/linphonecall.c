@@ -481,88 +481,240 @@ void linphone_call_make_local_media_description(LinphoneCore *lc, LinphoneCall *
 	}
 }
 
-static int find_port_offset(LinphoneCore *lc, int stream_index, int base_port){
-	int offset;
-	MSList *elem;
-	int tried_port;
-	int existing_port;
-	bool_t already_used=FALSE;
-
-	for(offset=0;offset<100;offset+=2){
-		tried_port=base_port+offset;
-		already_used=FALSE;
+#define FIXED_PORT_NB_PAIRS 50
+
+static void port_allocator_init(PortAllocator *pa, int min_port, int max_port){
+	int nb_words;
+	if (pa->bitmap) ms_free(pa->bitmap);
+	pa->bitmap=NULL;
+	pa->min_port=min_port;
+	pa->max_port=max_port;
+	pa->nb_used=0;
+	if (min_port==max_port){
+		/* Use fixed RTP port, or the next ones when already used. */
+		pa->sequential=TRUE;
+		pa->base_port=min_port;
+		pa->nb_pairs=FIXED_PORT_NB_PAIRS;
+	}else{
+		/* Use random RTP ports in the specified range, RTP on even ports. */
+		pa->sequential=FALSE;
+		pa->base_port=(min_port+1)&~0x1;
+		pa->nb_pairs=(max_port-pa->base_port+1)/2;
+	}
+	if (pa->nb_pairs<=0){
+		pa->nb_pairs=0;
+		return;
+	}
+	nb_words=(pa->nb_pairs+31)/32;
+	pa->bitmap=ms_new0(unsigned int,nb_words);
+	/*the bits after the last pair are never free*/
+	if (pa->nb_pairs%32!=0) pa->bitmap[nb_words-1]=~0U<<(pa->nb_pairs%32);
+}
+
+static int port_allocator_index(const PortAllocator *pa, int rtp_port){
+	int index;
+	if (pa->bitmap==NULL || rtp_port<pa->base_port || (rtp_port-pa->base_port)%2!=0) return -1;
+	index=(rtp_port-pa->base_port)/2;
+	return index<pa->nb_pairs ? index : -1;
+}
+
+static void port_allocator_mark(PortAllocator *pa, int rtp_port){
+	int index=port_allocator_index(pa,rtp_port);
+	if (index==-1 || (pa->bitmap[index/32]&(1U<<(index%32)))) return;
+	pa->bitmap[index/32]|=1U<<(index%32);
+	pa->nb_used++;
+	if (pa->nb_used>pa->max_used) pa->max_used=pa->nb_used;
+}
+
+static void port_allocator_release(PortAllocator *pa, int rtp_port){
+	int index=port_allocator_index(pa,rtp_port);
+	if (index==-1 || !(pa->bitmap[index/32]&(1U<<(index%32)))) return;
+	pa->bitmap[index/32]&=~(1U<<(index%32));
+	pa->nb_used--;
+}
+
+/*
+ * Returns a free RTP port, whose RTCP port is the next one, or -1 if all are in use.
+ * Starting from a random pair (or the first one for a fixed port), the free pairs are found a word of the bitmap at a time.
+ */
+static int port_allocator_take(PortAllocator *pa){
+	int nb_words=(pa->nb_pairs+31)/32;
+	int start=pa->sequential ? 0 : rand()%pa->nb_pairs;
+	int word=start/32;
+	int bit=0;
+	int i;
+	unsigned int free_pairs;
+
+	if (pa->nb_used>=pa->nb_pairs){
+		pa->nb_exhausted++;
+		return -1;
+	}
+	free_pairs=~pa->bitmap[word]&(~0U<<(start%32));
+	/*after a full turn, the pairs of the first word before the start are considered too*/
+	for(i=0;free_pairs==0 && i<nb_words;i++){
+		word=(word+1)%nb_words;
+		free_pairs=~pa->bitmap[word];
+	}
+	while(!(free_pairs&(1U<<bit))) bit++;
+	pa->bitmap[word]|=1U<<bit;
+	pa->nb_used++;
+	if (pa->nb_used>pa->max_used) pa->max_used=pa->nb_used;
+	return pa->base_port+2*(word*32+bit);
+}
+
+static PortAllocator *linphone_core_get_port_allocator(LinphoneCore *lc, int stream_index, int min_port, int max_port){
+	PortAllocator *pa=&lc->port_allocators[stream_index];
+	if (pa->bitmap==NULL || pa->min_port!=min_port || pa->max_port!=max_port){
+		MSList *elem;
+		/*the port range has changed: only the ports of the current calls within the new range are in use*/
+		port_allocator_init(pa,min_port,max_port);
 		for(elem=lc->calls;elem!=NULL;elem=elem->next){
 			LinphoneCall *call=(LinphoneCall*)elem->data;
-			existing_port=call->media_ports[stream_index].rtp_port;
-			if (existing_port==tried_port) {
-				already_used=TRUE;
-				break;
-			}
+			if (call->media_ports[stream_index].allocated) port_allocator_mark(pa,call->media_ports[stream_index].rtp_port);
 		}
-		if (!already_used) break;
-	}
-	if (offset==100){
-		ms_error("Could not find any free port !");
-		return -1;
 	}
-	return offset;
+	return pa->nb_pairs>0 ? pa : NULL;
 }
 
-static int select_random_port(LinphoneCore *lc, int stream_index, int min_port, int max_port) {
-	MSList *elem;
-	int nb_tries;
-	int tried_port = 0;
-	int existing_port = 0;
-	bool_t already_used = FALSE;
-
-	tried_port = (rand() % (max_port - min_port) + min_port) & ~0x1;
-	if (tried_port < min_port) tried_port = min_port + 2;
-	for (nb_tries = 0; nb_tries < 100; nb_tries++) {
-		for (elem = lc->calls; elem != NULL; elem = elem->next) {
-			LinphoneCall *call = (LinphoneCall *)elem->data;
-			existing_port=call->media_ports[stream_index].rtp_port;
-			if (existing_port == tried_port) {
-				already_used = TRUE;
-				break;
-			}
+void linphone_call_release_media_ports(LinphoneCall *call){
+	int i;
+	for(i=0;i<2;i++){
+		if (call->media_ports[i].allocated){
+			port_allocator_release(&call->core->port_allocators[i],call->media_ports[i].rtp_port);
+			call->media_ports[i].allocated=FALSE;
 		}
-		if (!already_used) break;
 	}
-	if (nb_tries == 100) {
-		ms_error("Could not find any free port!");
-		return -1;
+}
+
+void linphone_core_uninit_port_allocators(LinphoneCore *lc){
+	int i;
+	for(i=0;i<2;i++){
+		if (lc->port_allocators[i].bitmap) ms_free(lc->port_allocators[i].bitmap);
+		memset(&lc->port_allocators[i],0,sizeof(PortAllocator));
 	}
-	return tried_port;
+}
+
+void linphone_core_get_media_port_stats(const LinphoneCore *lc, int stream_type, LinphoneMediaPortStats *stats){
+	const PortAllocator *pa=&lc->port_allocators[stream_type==LINPHONE_CALL_STATS_VIDEO ? 1 : 0];
+	stats->nb_ports=pa->nb_pairs;
+	stats->nb_used=pa->nb_used;
+	stats->max_used=pa->max_used;
+	stats->nb_exhausted=pa->nb_exhausted;
 }
 
 static void port_config_set_random(LinphoneCall *call, int stream_index){
 	call->media_ports[stream_index].rtp_port=-1;
 	call->media_ports[stream_index].rtcp_port=-1;
+	call->media_ports[stream_index].allocated=FALSE;
 }
 
 static void port_config_set(LinphoneCall *call, int stream_index, int min_port, int max_port){
-	int port_offset;
 	if (min_port>0 && max_port>0){
-		if (min_port == max_port) {
-			/* Used fixed RTP audio port. */
-			port_offset=find_port_offset(call->core, stream_index, min_port);
-			if (port_offset==-1) {
-				port_config_set_random(call, stream_index);
-				return;
-			}
-			call->media_ports[stream_index].rtp_port=min_port+port_offset;
-		} else {
-			/* Select random RTP audio port in the specified range. */
-			call->media_ports[stream_index].rtp_port = select_random_port(call->core, stream_index, min_port, max_port);
+		PortAllocator *pa=linphone_core_get_port_allocator(call->core,stream_index,min_port,max_port);
+		int port=pa ? port_allocator_take(pa) : -1;
+		if (port==-1){
+			ms_error("Could not find any free port !");
+			port_config_set_random(call,stream_index);
+			return;
 		}
-		call->media_ports[stream_index].rtcp_port=call->media_ports[stream_index].rtp_port+1;
+		call->media_ports[stream_index].rtp_port=port;
+		call->media_ports[stream_index].rtcp_port=port+1;
+		call->media_ports[stream_index].allocated=TRUE;
 	}else port_config_set_random(call,stream_index);
 }
 
+static void linphone_call_timeout_expired(void *data){
+	LinphoneCall *call=(LinphoneCall*)data;
+	LinphoneCore *lc=call->core;
+
+	linphone_call_ref(call);
+	switch(call->state){
+		case LinphoneCallOutgoingInit:
+			/*start the call even if the OPTIONS reply did not arrive*/
+			if (call->ice_session != NULL) {
+				ms_warning("ICE candidates gathering from [%s] has not finished yet, proceed with the call without ICE anyway."
+						,linphone_core_get_stun_server(lc));
+				linphone_call_delete_ice_session(call);
+				linphone_call_stop_media_streams_for_ice_gathering(call);
+			}
+#ifdef BUILD_UPNP
+			if (call->upnp_session != NULL) {
+				ms_warning("uPnP mapping has not finished yet, proceeded with the call without uPnP anyway.");
+				linphone_call_delete_upnp_session(call);
+			}
+#endif //BUILD_UPNP
+			linphone_core_start_invite(lc,call, NULL);
+		break;
+		case LinphoneCallIncomingReceived:
+		case LinphoneCallIncomingEarlyMedia:{
+			LinphoneReason decline_reason;
+			ms_message("incoming call timeout (%i)",lc->sip_conf.inc_timeout);
+			decline_reason=lc->current_call ? LinphoneReasonBusy : LinphoneReasonDeclined;
+			call->log->status=LinphoneCallMissed;
+			sal_error_info_set(&call->non_op_error,SalReasonRequestTimeout,408,"Not answered",NULL);
+			linphone_core_decline_call(lc,call,decline_reason);
+		}
+		break;
+		default:
+			ms_message("in call timeout (%i)",lc->sip_conf.in_call_timeout);
+			linphone_core_terminate_call(lc,call);
+		break;
+	}
+	linphone_call_unref(call);
+}
+
+/*
+ * (Re)schedules the timeout that applies to the current state of the call on the timer wheel of the core:
+ * sip/delayed_timeout while in OutgoingInit, sip/inc_timeout while an incoming call is ringing and
+ * sip/in_call_timeout once connected. The timeouts keep being counted from the start or connection of the call.
+ */
+void linphone_call_update_timeout(LinphoneCall *call){
+	LinphoneCore *lc=call->core;
+	time_t deadline;
+
+	switch(call->state){
+		case LinphoneCallOutgoingInit:
+			deadline=call->log->start_date_time+lc->sip_conf.delayed_timeout;
+		break;
+		case LinphoneCallIncomingReceived:
+		case LinphoneCallIncomingEarlyMedia:
+			deadline=call->log->start_date_time+lc->sip_conf.inc_timeout+1;
+		break;
+		case LinphoneCallIdle:
+		case LinphoneCallEnd:
+		case LinphoneCallError:
+		case LinphoneCallReleased:
+			deadline=0;
+		break;
+		default:
+			if (lc->sip_conf.in_call_timeout>0 && call->log->connected_date_time!=0)
+				deadline=call->log->connected_date_time+lc->sip_conf.in_call_timeout+1;
+			else deadline=0;
+		break;
+	}
+	if (deadline==0 || lc->timer_wheel==NULL){
+		linphone_timer_cancel(&call->timeout_timer);
+	}else{
+		uint64_t now=ortp_get_cur_time_ms();
+		time_t remaining=deadline-time(NULL);
+		uint64_t expire=now+(remaining>0 ? (uint64_t)remaining*1000 : 0);
+
+		linphone_timer_wheel_schedule(lc->timer_wheel,&call->timeout_timer,expire);
+		if (lc->wait_deadline!=0 && expire<lc->wait_deadline){
+			/*linphone_core_wait() must return in time for this timeout*/
+			sal_interrupt_wait(lc->sal);
+		}
+	}
+}
+
+static void linphone_call_stats_timer_expired(void *data);
+
 static void linphone_call_init_common(LinphoneCall *call, LinphoneAddress *from, LinphoneAddress *to){
 	int min_port, max_port;
 	ms_message("New LinphoneCall [%p] initialized (LinphoneCore version: %s)",call,linphone_core_get_version());
 	call->state=LinphoneCallIdle;
+	linphone_timer_init(&call->timeout_timer,linphone_call_timeout_expired,call);
+	linphone_timer_init(&call->stats_timer,linphone_call_stats_timer_expired,call);
 	call->transfer_state = LinphoneCallIdle;
 	call->log=linphone_call_log_new(call->dir, from, to);
 	call->camera_enabled=TRUE;
@@ -973,6 +1125,7 @@ void linphone_call_set_state_base(LinphoneCall *call, LinphoneCallState cstate,
 			call->log->status=LinphoneCallSuccess;
 			call->log->connected_date_time=time(NULL);
 		}
+		linphone_call_update_timeout(call);
 
 		if (!silently)
 			linphone_core_notify_call_state_changed(lc,call,cstate,message);
@@ -1008,6 +1161,8 @@ void linphone_call_set_state_base(LinphoneCall *call, LinphoneCallState cstate,
 static void linphone_call_destroy(LinphoneCall *obj)
 {
 	ms_message("Call [%p] freed.",obj);
+	linphone_timer_cancel(&obj->timeout_timer);
+	linphone_timer_cancel(&obj->stats_timer);
 	if (obj->op!=NULL) {
 		sal_op_release(obj->op);
 		obj->op=NULL;
@@ -2365,6 +2520,8 @@ void linphone_call_stop_media_streams(LinphoneCall *call){
 			ms_event_queue_skip(call->core->msevq);
 		}
 	}
+	/*the final statistics are not held back*/
+	linphone_call_flush_stats_notifications(call);
 
 	if (call->audio_profile){
 		rtp_profile_destroy(call->audio_profile);
@@ -2859,14 +3016,124 @@ void linphone_call_stats_uninit(LinphoneCallStats *stats){
 	}
 }
 
+static void linphone_call_deliver_stats(LinphoneCall *call, int stream_index, uint64_t now){
+	LinphoneCallStats *stats=&call->stats[stream_index];
+
+	stats->updated=call->stats_pending_updates[stream_index];
+	call->stats_pending_updates[stream_index]=0;
+	call->stats_notified_time[stream_index]=now;
+	linphone_core_notify_call_stats_updated(call->core, call, stats);
+	stats->updated=0;
+}
+
+/*schedules the stats timer at the earliest time a held back update may be notified*/
+static void linphone_call_schedule_stats_notification(LinphoneCall *call){
+	int interval=call->core->rtp_conf.stats_notification_interval;
+	uint64_t expire=0;
+	int i;
+
+	for(i=0;i<2;i++){
+		if (call->stats_pending_updates[i]){
+			uint64_t t=call->stats_notified_time[i]+interval;
+			if (expire==0 || t<expire) expire=t;
+		}
+	}
+	if (expire==0 || call->core->timer_wheel==NULL){
+		linphone_timer_cancel(&call->stats_timer);
+	}else if (!linphone_timer_is_scheduled(&call->stats_timer) || call->stats_timer.expire_time!=expire){
+		linphone_timer_wheel_schedule(call->core->timer_wheel,&call->stats_timer,expire);
+	}
+}
+
+static void linphone_call_stats_timer_expired(void *data){
+	LinphoneCall *call=(LinphoneCall*)data;
+	int interval=call->core->rtp_conf.stats_notification_interval;
+	uint64_t now=ortp_get_cur_time_ms();
+	int i;
+
+	linphone_call_ref(call);
+	for(i=0;i<2;i++){
+		if (call->stats_pending_updates[i] && now>=call->stats_notified_time[i]+interval)
+			linphone_call_deliver_stats(call,i,now);
+	}
+	linphone_call_schedule_stats_notification(call);
+	linphone_call_unref(call);
+}
+
+/*notifies the updates held back by the stats notification interval right away*/
+void linphone_call_flush_stats_notifications(LinphoneCall *call){
+	uint64_t now=ortp_get_cur_time_ms();
+	int i;
+
+	for(i=0;i<2;i++){
+		if (call->stats_pending_updates[i]) linphone_call_deliver_stats(call,i,now);
+	}
+	linphone_timer_cancel(&call->stats_timer);
+}
+
 void linphone_call_notify_stats_updated(LinphoneCall *call, int stream_index){
 	LinphoneCallStats *stats=&call->stats[stream_index];
-	LinphoneCore *lc=call->core;
-	if (stats->updated){
-		linphone_reporting_on_rtcp_update(call, stream_index);
-		linphone_core_notify_call_stats_updated(lc, call, stats);
-		stats->updated = 0;
+	int interval=call->core->rtp_conf.stats_notification_interval;
+	uint64_t now;
+
+	if (!stats->updated) return;
+	linphone_reporting_on_rtcp_update(call, stream_index);
+	call->stats_pending_updates[stream_index]|=stats->updated;
+	stats->updated=0;
+	now=(interval>0) ? ortp_get_cur_time_ms() : 0;
+	if (interval==0 || now>=call->stats_notified_time[stream_index]+interval){
+		linphone_call_deliver_stats(call,stream_index,now);
+	}
+	/*otherwise the update is coalesced with the next ones and delivered by the stats timer*/
+	linphone_call_schedule_stats_notification(call);
+}
+
+/**
+ * Copies the statistics of every stream of every call into a flat array, for applications that
+ * poll the statistics periodically instead of handling each call_stats_updated notification.
+ *
+ * @ingroup call_misc
+ * @param lc the LinphoneCore
+ * @param snapshots array receiving one entry per running audio or video stream, may be NULL
+ * @param max_count number of entries of the array
+ * @return the number of entries written, or the number of running streams if snapshots is NULL.
+**/
+int linphone_core_get_call_stats_snapshot(LinphoneCore *lc, LinphoneCallStatsSnapshot *snapshots, int max_count){
+	const MSList *elem;
+	int count=0;
+
+	for(elem=lc->calls;elem!=NULL;elem=elem->next){
+		LinphoneCall *call=(LinphoneCall*)elem->data;
+		int i;
+		for(i=0;i<2;i++){
+			MediaStream *ms=(i==LINPHONE_CALL_STATS_AUDIO) ? (MediaStream*)call->audiostream : (MediaStream*)call->videostream;
+			LinphoneCallStats *stats=&call->stats[i];
+			LinphoneCallStatsSnapshot *snap;
+
+			if (ms==NULL) continue;
+			if (snapshots==NULL){
+				count++;
+				continue;
+			}
+			if (count>=max_count) return count;
+			update_local_stats(stats,ms);
+			snap=&snapshots[count++];
+			snap->call=call;
+			snap->type=stats->type;
+			snap->ice_state=stats->ice_state;
+			snap->download_bandwidth=stats->download_bandwidth;
+			snap->upload_bandwidth=stats->upload_bandwidth;
+			snap->sender_loss_rate=linphone_call_stats_get_sender_loss_rate(stats);
+			snap->receiver_loss_rate=linphone_call_stats_get_receiver_loss_rate(stats);
+			snap->sender_interarrival_jitter=linphone_call_stats_get_sender_interarrival_jitter(stats,call);
+			snap->receiver_interarrival_jitter=linphone_call_stats_get_receiver_interarrival_jitter(stats,call);
+			snap->round_trip_delay=stats->round_trip_delay;
+			snap->jitter_buffer_size_ms=stats->jitter_stats.jitter_buffer_size_ms;
+			snap->local_loss_rate=stats->local_loss_rate;
+			snap->local_late_rate=stats->local_late_rate;
+		}
 	}
+	return count;
 }
 
 void linphone_call_handle_stream_events(LinphoneCall *call, int stream_index){
@@ -2974,7 +3241,7 @@ void linphone_call_log_completed(LinphoneCall *call){
 		lc->call_logs=ms_list_remove_link(lc->call_logs,elem);
 	}
 	linphone_core_notify_call_log_updated(lc,call->log);
-	call_logs_write_to_config_file(lc);
+	linphone_core_call_log_storage_add(lc,call->log);
 }
 
 /**
@@ -24,6 +24,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quality_reporting.h"
 
 #include <math.h>
+#include <limits.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <ortp/telephonyevents.h>
@@ -71,6 +72,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define LOG_COLLECTION_DEFAULT_PATH "."
 #define LOG_COLLECTION_DEFAULT_PREFIX "linphone"
 #define LOG_COLLECTION_DEFAULT_MAX_FILE_SIZE (10 * 1024 * 1024)
+#define LOG_COLLECTION_BUFFER_SIZE (1024 * 1024)
+#define LOG_COLLECTION_MAX_WRITE_SIZE (64 * 1024)
 
 
 /*#define UNSTANDART_GSM_11K 1*/
@@ -89,7 +92,7 @@ static LinphoneLogCollectionState liblinphone_log_collection_state = LinphoneLog
 static char * liblinphone_log_collection_path = NULL;
 static char * liblinphone_log_collection_prefix = NULL;
 static int liblinphone_log_collection_max_file_size = LOG_COLLECTION_DEFAULT_MAX_FILE_SIZE;
-static ortp_mutex_t liblinphone_log_collection_mutex;
+static ortp_mutex_t liblinphone_log_collection_mutex; /*protects the log files*/
 static bool_t liblinphone_serialize_logs = FALSE;
 static void set_network_reachable(LinphoneCore* lc,bool_t isReachable, time_t curtime);
 static void linphone_core_run_hooks(LinphoneCore *lc);
@@ -170,16 +173,245 @@ void linphone_core_set_log_level(OrtpLogLevel loglevel) {
 	}
 }
 
+/*
+ * Log collection records are formatted by the logging threads into a ring buffer, then written to the log files
+ * by a background thread that keeps the current file open. The ring buffer lock is only held to copy a record.
+ * Each record is queued after its length, so that the writer only writes whole records and a record is never
+ * split across two log files.
+ */
+typedef struct _LogCollectionWriter{
+	ortp_thread_t thread;
+	ortp_mutex_t mutex;
+	ortp_cond_t cond; /*signaled when records are queued or a flush is requested*/
+	ortp_cond_t flushed_cond;
+	char *buffer;
+	char *write_buffer; /*whole records gathered by the writer thread*/
+	size_t write_buffer_size;
+	size_t read_pos;
+	size_t used;
+	unsigned int dropped; /*records that did not fit in the buffer*/
+	unsigned int flush_serial;
+	unsigned int flushed_serial;
+	FILE *file; /*protected by liblinphone_log_collection_mutex*/
+	long file_size;
+	bool_t initialized;
+	bool_t running;
+	bool_t reopen;
+} LogCollectionWriter;
+
+static LogCollectionWriter liblinphone_log_collection_writer;
+
+static char *log_collection_filename(int index) {
+	return ortp_strdup_printf("%s/%s%i.log",
+		liblinphone_log_collection_path ? liblinphone_log_collection_path : LOG_COLLECTION_DEFAULT_PATH,
+		liblinphone_log_collection_prefix ? liblinphone_log_collection_prefix : LOG_COLLECTION_DEFAULT_PREFIX,
+		index);
+}
+
+/*
+ * Opens the file where to append logs: the first one until it reaches the max size, then the second one.
+ * When both are full, the second one replaces the first one and a new second one is started.
+ * Must be called with liblinphone_log_collection_mutex held.
+ */
+static FILE *log_collection_open_file(long *size) {
+	char *log_filename1 = log_collection_filename(1);
+	char *log_filename2 = log_collection_filename(2);
+	struct stat statbuf;
+	FILE *log_file;
+
+	*size = 0;
+	log_file = fopen(log_filename1, "a");
+	if (log_file != NULL) {
+		fstat(fileno(log_file), &statbuf);
+		*size = statbuf.st_size;
+		if (statbuf.st_size > liblinphone_log_collection_max_file_size) {
+			fclose(log_file);
+			log_file = fopen(log_filename2, "a");
+			if (log_file != NULL) {
+				fstat(fileno(log_file), &statbuf);
+				*size = statbuf.st_size;
+				if (statbuf.st_size > liblinphone_log_collection_max_file_size) {
+					fclose(log_file);
+					unlink(log_filename1);
+					rename(log_filename2, log_filename1);
+					log_file = fopen(log_filename2, "a");
+					*size = 0;
+				}
+			}
+		}
+	}
+	ortp_free(log_filename1);
+	ortp_free(log_filename2);
+	return log_file;
+}
+
+static void log_collection_write(LogCollectionWriter *w, const char *data, size_t len) {
+	ortp_mutex_lock(&liblinphone_log_collection_mutex);
+	if (w->reopen || (w->file != NULL && w->file_size > liblinphone_log_collection_max_file_size)) {
+		w->reopen = FALSE;
+		if (w->file != NULL) {
+			fclose(w->file);
+			w->file = NULL;
+		}
+	}
+	if (w->file == NULL) {
+		w->file = log_collection_open_file(&w->file_size);
+	}
+	if (w->file != NULL) {
+		w->file_size += (long)fwrite(data, 1, len, w->file);
+	}
+	ortp_mutex_unlock(&liblinphone_log_collection_mutex);
+}
+
+/*the queued bytes are not overwritten by producers until used is decreased, so they can be read without the lock*/
+static void log_collection_writer_read(const LogCollectionWriter *w, size_t pos, void *data, size_t len) {
+	size_t first = MIN(len, LOG_COLLECTION_BUFFER_SIZE - pos);
+	memcpy(data, w->buffer + pos, first);
+	memcpy((char *)data + first, w->buffer, len - first);
+}
+
+/*
+ * Gathers whole queued records, at least one and no more than LOG_COLLECTION_MAX_WRITE_SIZE bytes unless a single
+ * record is bigger, into the write buffer. Returns the number of queued bytes they used.
+ */
+static size_t log_collection_writer_gather(LogCollectionWriter *w, size_t used, size_t *len) {
+	size_t consumed = 0;
+	*len = 0;
+	while (consumed < used) {
+		size_t pos = (w->read_pos + consumed) % LOG_COLLECTION_BUFFER_SIZE;
+		uint32_t record_len;
+		log_collection_writer_read(w, pos, &record_len, sizeof(record_len));
+		if (*len > 0 && *len + record_len > LOG_COLLECTION_MAX_WRITE_SIZE) break;
+		if (*len + record_len > w->write_buffer_size) {
+			w->write_buffer_size = *len + record_len;
+			w->write_buffer = ms_realloc(w->write_buffer, w->write_buffer_size);
+		}
+		log_collection_writer_read(w, (pos + sizeof(record_len)) % LOG_COLLECTION_BUFFER_SIZE, w->write_buffer + *len, record_len);
+		*len += record_len;
+		consumed += sizeof(record_len) + record_len;
+	}
+	return consumed;
+}
+
+static void *log_collection_writer_thread(void *data) {
+	LogCollectionWriter *w = (LogCollectionWriter *)data;
+	bool_t needs_fflush = FALSE;
+
+	ortp_mutex_lock(&w->mutex);
+	while (TRUE) {
+		if (w->used == 0 && w->dropped == 0) {
+			if (needs_fflush) {
+				needs_fflush = FALSE;
+				ortp_mutex_unlock(&w->mutex);
+				ortp_mutex_lock(&liblinphone_log_collection_mutex);
+				if (w->file != NULL) fflush(w->file);
+				ortp_mutex_unlock(&liblinphone_log_collection_mutex);
+				ortp_mutex_lock(&w->mutex);
+				continue;
+			}
+			/*everything queued so far is on disk*/
+			if (w->flushed_serial != w->flush_serial) {
+				w->flushed_serial = w->flush_serial;
+				ortp_cond_broadcast(&w->flushed_cond);
+			}
+			if (!w->running) break;
+			ortp_cond_wait(&w->cond, &w->mutex);
+		} else if (w->dropped != 0) {
+			char note[64];
+			snprintf(note, sizeof(note), "%u log records dropped\n", w->dropped);
+			w->dropped = 0;
+			ortp_mutex_unlock(&w->mutex);
+			log_collection_write(w, note, strlen(note));
+			ortp_mutex_lock(&w->mutex);
+			needs_fflush = TRUE;
+		} else {
+			size_t used = w->used;
+			size_t consumed, len;
+			ortp_mutex_unlock(&w->mutex);
+			consumed = log_collection_writer_gather(w, used, &len);
+			log_collection_write(w, w->write_buffer, len);
+			ortp_mutex_lock(&w->mutex);
+			w->read_pos = (w->read_pos + consumed) % LOG_COLLECTION_BUFFER_SIZE;
+			w->used -= consumed;
+			needs_fflush = TRUE;
+		}
+	}
+	ortp_mutex_unlock(&w->mutex);
+
+	ortp_mutex_lock(&liblinphone_log_collection_mutex);
+	if (w->file != NULL) {
+		fclose(w->file);
+		w->file = NULL;
+	}
+	ortp_mutex_unlock(&liblinphone_log_collection_mutex);
+	return NULL;
+}
+
+static void log_collection_writer_start(void) {
+	LogCollectionWriter *w = &liblinphone_log_collection_writer;
+	if (!w->initialized) {
+		ortp_mutex_init(&liblinphone_log_collection_mutex, NULL);
+		ortp_mutex_init(&w->mutex, NULL);
+		ortp_cond_init(&w->cond, NULL);
+		ortp_cond_init(&w->flushed_cond, NULL);
+		w->initialized = TRUE;
+	}
+	if (w->running) return;
+	if (w->buffer == NULL) w->buffer = ms_malloc(LOG_COLLECTION_BUFFER_SIZE);
+	w->read_pos = 0;
+	w->used = 0;
+	w->running = TRUE;
+	ortp_thread_create(&w->thread, NULL, log_collection_writer_thread, w);
+}
+
+static void log_collection_writer_stop(void) {
+	LogCollectionWriter *w = &liblinphone_log_collection_writer;
+	if (!w->running) return;
+	ortp_mutex_lock(&w->mutex);
+	w->running = FALSE;
+	ortp_cond_signal(&w->cond);
+	ortp_mutex_unlock(&w->mutex);
+	ortp_thread_join(w->thread, NULL);
+	/*producers no longer queue records once running is cleared*/
+	ms_free(w->buffer);
+	w->buffer = NULL;
+	if (w->write_buffer != NULL) {
+		ms_free(w->write_buffer);
+		w->write_buffer = NULL;
+		w->write_buffer_size = 0;
+	}
+}
+
+/*to be called with the ring buffer lock held and enough room*/
+static void log_collection_writer_push(LogCollectionWriter *w, const char *data, size_t len) {
+	size_t pos = (w->read_pos + w->used) % LOG_COLLECTION_BUFFER_SIZE;
+	size_t first = MIN(len, LOG_COLLECTION_BUFFER_SIZE - pos);
+	memcpy(w->buffer + pos, data, first);
+	memcpy(w->buffer, data + first, len - first);
+	w->used += len;
+}
+
+/*make the writer close its file so that it is reopened with the current path, prefix and size*/
+static void log_collection_writer_reopen(void) {
+	LogCollectionWriter *w = &liblinphone_log_collection_writer;
+	if (w->initialized) {
+		ortp_mutex_lock(&liblinphone_log_collection_mutex);
+		w->reopen = TRUE;
+		ortp_mutex_unlock(&liblinphone_log_collection_mutex);
+	}
+}
+
 static void linphone_core_log_collection_handler(OrtpLogLevel level, const char *fmt, va_list args) {
+	LogCollectionWriter *w = &liblinphone_log_collection_writer;
 	const char *lname="undef";
 	char *msg;
-	char *log_filename1;
-	char *log_filename2;
-	FILE *log_file;
+	char header[64];
+	size_t header_len;
+	size_t msg_len;
+	uint32_t record_len;
 	struct timeval tp;
 	struct tm *lt;
 	time_t tt;
-	struct stat statbuf;
 
 	if (liblinphone_log_func != NULL) {
 		liblinphone_log_func(level, fmt, args);
@@ -208,38 +440,41 @@ static void linphone_core_log_collection_handler(OrtpLogLevel level, const char
 			ortp_fatal("Bad level !");
 	}
 	msg = ortp_strdup_vprintf(fmt, args);
-
-	log_filename1 = ortp_strdup_printf("%s/%s1.log",
-		liblinphone_log_collection_path ? liblinphone_log_collection_path : LOG_COLLECTION_DEFAULT_PATH,
-		liblinphone_log_collection_prefix ? liblinphone_log_collection_prefix : LOG_COLLECTION_DEFAULT_PREFIX);
-	log_filename2 = ortp_strdup_printf("%s/%s2.log",
-		liblinphone_log_collection_path ? liblinphone_log_collection_path : LOG_COLLECTION_DEFAULT_PATH,
-		liblinphone_log_collection_prefix ? liblinphone_log_collection_prefix : LOG_COLLECTION_DEFAULT_PREFIX);
-	ortp_mutex_lock(&liblinphone_log_collection_mutex);
-	log_file = fopen(log_filename1, "a");
-	fstat(fileno(log_file), &statbuf);
-	if (statbuf.st_size > liblinphone_log_collection_max_file_size) {
-		fclose(log_file);
-		log_file = fopen(log_filename2, "a");
-		fstat(fileno(log_file), &statbuf);
-		if (statbuf.st_size > liblinphone_log_collection_max_file_size) {
-			fclose(log_file);
-			unlink(log_filename1);
-			rename(log_filename2, log_filename1);
-			log_file = fopen(log_filename2, "a");
-		}
+	msg_len = strlen(msg);
+	header_len = (size_t)snprintf(header, sizeof(header), "%i-%.2i-%.2i %.2i:%.2i:%.2i:%.3i %s ",
+		1900 + lt->tm_year, lt->tm_mon + 1, lt->tm_mday, lt->tm_hour, lt->tm_min, lt->tm_sec, (int)(tp.tv_usec / 1000), lname);
+
+	record_len = (uint32_t)(header_len + msg_len + 1);
+	ortp_mutex_lock(&w->mutex);
+	if (w->running && w->used + sizeof(record_len) + record_len <= LOG_COLLECTION_BUFFER_SIZE) {
+		log_collection_writer_push(w, (const char *)&record_len, sizeof(record_len));
+		log_collection_writer_push(w, header, header_len);
+		log_collection_writer_push(w, msg, msg_len);
+		log_collection_writer_push(w, "\n", 1);
+		ortp_cond_signal(&w->cond);
+	} else {
+		w->dropped++;
 	}
-	fprintf(log_file,"%i-%.2i-%.2i %.2i:%.2i:%.2i:%.3i %s %s\n",
-		1900 + lt->tm_year, lt->tm_mon + 1, lt->tm_mday, lt->tm_hour, lt->tm_min, lt->tm_sec, (int)(tp.tv_usec / 1000), lname, msg);
-	fflush(log_file);
-	fclose(log_file);
-	ortp_mutex_unlock(&liblinphone_log_collection_mutex);
+	ortp_mutex_unlock(&w->mutex);
 
-	ortp_free(log_filename1);
-	ortp_free(log_filename2);
 	ortp_free(msg);
 }
 
+void linphone_core_flush_log_collection(void) {
+	LogCollectionWriter *w = &liblinphone_log_collection_writer;
+	unsigned int serial;
+	if (!w->initialized) return;
+	ortp_mutex_lock(&w->mutex);
+	if (w->running) {
+		serial = ++w->flush_serial;
+		ortp_cond_signal(&w->cond);
+		while ((int)(w->flushed_serial - serial) < 0 && w->running) {
+			ortp_cond_wait(&w->flushed_cond, &w->mutex);
+		}
+	}
+	ortp_mutex_unlock(&w->mutex);
+}
+
 const char * linphone_core_get_log_collection_path(void) {
 	if (liblinphone_log_collection_path != NULL) {
 		return liblinphone_log_collection_path;
@@ -255,6 +490,7 @@ void linphone_core_set_log_collection_path(const char *path) {
 	if (path != NULL) {
 		liblinphone_log_collection_path = ms_strdup(path);
 	}
+	log_collection_writer_reopen();
 }
 
 const char * linphone_core_get_log_collection_prefix(void) {
@@ -272,6 +508,7 @@ void linphone_core_set_log_collection_prefix(const char *prefix) {
 	if (prefix != NULL) {
 		liblinphone_log_collection_prefix = ms_strdup(prefix);
 	}
+	log_collection_writer_reopen();
 }
 
 int linphone_core_get_log_collection_max_file_size(void) {
@@ -302,7 +539,7 @@ void linphone_core_enable_log_collection(LinphoneLogCollectionState state) {
 	}
 	liblinphone_log_collection_state = state;
 	if (state != LinphoneLogCollectionDisabled) {
-		ortp_mutex_init(&liblinphone_log_collection_mutex, NULL);
+		log_collection_writer_start();
 		if (state == LinphoneLogCollectionEnabledWithoutPreviousLogHandler) {
 			liblinphone_log_func = NULL;
 		} else {
@@ -311,6 +548,7 @@ void linphone_core_enable_log_collection(LinphoneLogCollectionState state) {
 		ortp_set_log_handler(linphone_core_log_collection_handler);
 	} else {
 		ortp_set_log_handler(liblinphone_log_func);
+		log_collection_writer_stop();
 	}
 }
 
@@ -501,6 +739,7 @@ static int prepare_log_collection_file_to_upload(const char *filename) {
 	COMPRESS_FILE_PTR output_file = NULL;
 	int ret = 0;
 
+	linphone_core_flush_log_collection();
 	ortp_mutex_lock(&liblinphone_log_collection_mutex);
 	output_filename = ms_strdup_printf("%s/%s",
 		liblinphone_log_collection_path ? liblinphone_log_collection_path : LOG_COLLECTION_DEFAULT_PATH, filename);
@@ -596,6 +835,10 @@ char * linphone_core_compress_log_collection(LinphoneCore *core) {
 void linphone_core_reset_log_collection(LinphoneCore *core) {
 	char *filename;
 	ortp_mutex_lock(&liblinphone_log_collection_mutex);
+	if (liblinphone_log_collection_writer.file != NULL) {
+		fclose(liblinphone_log_collection_writer.file);
+		liblinphone_log_collection_writer.file = NULL;
+	}
 	delete_log_collection_upload_file();
 	filename = ms_strdup_printf("%s/%s1.log",
 			liblinphone_log_collection_path ? liblinphone_log_collection_path : LOG_COLLECTION_DEFAULT_PATH,
@@ -966,6 +1209,7 @@ static void rtp_config_read(LinphoneCore *lc)
 	linphone_core_set_video_jittcomp(lc,jitt_comp);
 	nortp_timeout=lp_config_get_int(lc->config,"rtp","nortp_timeout",30);
 	linphone_core_set_nortp_timeout(lc,nortp_timeout);
+	lc->rtp_conf.stats_notification_interval=lp_config_get_int(lc->config,"rtp","stats_notification_interval",0);
 	rtp_no_xmit_on_audio_mute=lp_config_get_int(lc->config,"rtp","rtp_no_xmit_on_audio_mute",FALSE);
 	linphone_core_set_rtp_no_xmit_on_audio_mute(lc,rtp_no_xmit_on_audio_mute);
 	adaptive_jitt_comp_enabled = lp_config_get_int(lc->config, "rtp", "audio_adaptive_jitt_comp_enabled", TRUE);
@@ -1526,12 +1770,17 @@ static void linphone_core_init(LinphoneCore * lc, const LinphoneCoreVTable *vtab
 	lc->config=lp_config_ref(config);
 	lc->data=userdata;
 	lc->ringstream_autorelease=TRUE;
+	/*config writes are done from a background thread when a delay (in ms) is configured*/
+	if (lp_config_get_int(lc->config,"misc","config_sync_delay",-1)>=0){
+		lp_config_enable_background_sync(lc->config,TRUE,lp_config_get_int(lc->config,"misc","config_sync_delay",-1));
+	}
 
 	memcpy(local_vtable,vtable,sizeof(LinphoneCoreVTable));
 	lc->vtables=ms_list_append(lc->vtables,local_vtable);
 
 	linphone_core_set_state(lc,LinphoneGlobalStartup,"Starting up");
 	ortp_init();
+	linphone_dial_plans_compile();
 	if (liblinphone_serialize_logs == TRUE) {
 		ortp_set_log_thread_id(ortp_thread_self());
 	}
@@ -1616,6 +1865,9 @@ static void linphone_core_init(LinphoneCore * lc, const LinphoneCoreVTable *vtab
 	/* This allows to run event's callback in linphone_core_iterate() */
 	lc->msevq=ms_event_queue_new();
 	ms_set_global_event_queue(lc->msevq);
+	/* per-call timeouts are scheduled on this timer wheel and fired from linphone_core_iterate() */
+	lc->timer_wheel=linphone_timer_wheel_new(ortp_get_cur_time_ms());
+	linphone_core_enable_profiling(lc,lp_config_get_int(lc->config,"misc","profiling",0));
 
 	lc->sal=sal_init();
 
@@ -2050,6 +2302,35 @@ void linphone_core_set_nortp_timeout(LinphoneCore *lc, int nortp_timeout){
 	lc->rtp_conf.nortp_timeout=nortp_timeout;
 }
 
+/**
+ * Sets the minimum interval between two call_stats_updated notifications for the same stream of a call.
+ *
+ * @ingroup media_parameters
+ * The updates received in between are coalesced: the notification that follows carries the latest statistics,
+ * and the LinphoneCallStats.updated field tells every kind of RTCP packet received or sent since the previous one.
+ * Quality reporting still processes every update.
+ * @param lc the LinphoneCore
+ * @param interval_ms the interval in milliseconds, 0 (the default) to notify every update as soon as it happens.
+**/
+void linphone_core_set_call_stats_notification_interval(LinphoneCore *lc, int interval_ms){
+	const MSList *elem;
+	lc->rtp_conf.stats_notification_interval=interval_ms>0 ? interval_ms : 0;
+	/*the updates held back under the previous interval must not wait for longer than the new one*/
+	for(elem=lc->calls;elem!=NULL;elem=elem->next){
+		linphone_call_flush_stats_notifications((LinphoneCall*)elem->data);
+	}
+}
+
+/**
+ * Returns the minimum interval between two call_stats_updated notifications for the same stream of a call.
+ *
+ * @ingroup media_parameters
+ * See linphone_core_set_call_stats_notification_interval() for details.
+**/
+int linphone_core_get_call_stats_notification_interval(const LinphoneCore *lc){
+	return lc->rtp_conf.stats_notification_interval;
+}
+
 /**
  * Indicates whether SIP INFO is used for sending digits.
  *
@@ -2424,7 +2705,7 @@ static void linphone_core_do_plugin_tasks(LinphoneCore *lc){
  * - handles timers and timeout
  * - performs registration to proxies
  * - authentication retries
- * The application MUST call this function periodically, in its main loop.
+ * The application MUST call this function periodically, in its main loop, or after each linphone_core_wait().
  * Be careful that this function must be called from the same thread as
  * other liblinphone methods. If it is not the case make sure all liblinphone calls are
  * serialized with a mutex.
@@ -2433,9 +2714,10 @@ void linphone_core_iterate(LinphoneCore *lc){
 	MSList *calls;
 	LinphoneCall *call;
 	time_t curtime=time(NULL);
-	int elapsed;
 	bool_t one_second_elapsed=FALSE;
 	const char *remote_provisioning_uri = NULL;
+	uint64_t iterate_begin=linphone_core_profiling_start(lc);
+	uint64_t begin;
 	if (lc->network_reachable_to_be_notified) {
 		lc->network_reachable_to_be_notified=FALSE;
 		linphone_core_notify_network_reachable(lc,lc->network_reachable);
@@ -2504,57 +2786,33 @@ void linphone_core_iterate(LinphoneCore *lc){
 		}
 	}
 
+	begin=linphone_core_profiling_start(lc);
 	sal_iterate(lc->sal);
-	if (lc->msevq) ms_event_queue_pump(lc->msevq);
+	linphone_core_profiling_stop(lc,LinphoneProfilingSalIterate,begin);
+	if (lc->msevq){
+		begin=linphone_core_profiling_start(lc);
+		ms_event_queue_pump(lc->msevq);
+		linphone_core_profiling_stop(lc,LinphoneProfilingEventQueue,begin);
+	}
 	if (lc->auto_net_state_mon) monitor_network_state(lc,curtime);
 
+	begin=linphone_core_profiling_start(lc);
 	proxy_update(lc);
+	linphone_core_profiling_stop(lc,LinphoneProfilingProxyUpdate,begin);
 
-	//we have to iterate for each call
+	/*fire the per-call timeouts that expired*/
+	begin=linphone_core_profiling_start(lc);
+	linphone_timer_wheel_run(lc->timer_wheel,ortp_get_cur_time_ms());
+	linphone_core_profiling_stop(lc,LinphoneProfilingTimers,begin);
+
+	begin=linphone_core_profiling_start(lc);
 	calls= lc->calls;
 	while(calls!= NULL){
 		call = (LinphoneCall *)calls->data;
-		elapsed = curtime-call->log->start_date_time;
-		 /* get immediately a reference to next one in case the one
-		 we are going to examine is destroy and removed during
-		 linphone_core_start_invite() */
 		calls=calls->next;
 		linphone_call_background_tasks(call,one_second_elapsed);
-		if (call->state==LinphoneCallOutgoingInit && (elapsed>=lc->sip_conf.delayed_timeout)){
-			/*start the call even if the OPTIONS reply did not arrive*/
-			if (call->ice_session != NULL) {
-				ms_warning("ICE candidates gathering from [%s] has not finished yet, proceed with the call without ICE anyway."
-						,linphone_core_get_stun_server(lc));
-				linphone_call_delete_ice_session(call);
-				linphone_call_stop_media_streams_for_ice_gathering(call);
-			}
-#ifdef BUILD_UPNP
-			if (call->upnp_session != NULL) {
-				ms_warning("uPnP mapping has not finished yet, proceeded with the call without uPnP anyway.");
-				linphone_call_delete_upnp_session(call);
-			}
-#endif //BUILD_UPNP
-			linphone_core_start_invite(lc,call, NULL);
-		}
-		if (call->state==LinphoneCallIncomingReceived || call->state==LinphoneCallIncomingEarlyMedia){
-			if (one_second_elapsed) ms_message("incoming call ringing for %i seconds",elapsed);
-			if (elapsed>lc->sip_conf.inc_timeout){
-				LinphoneReason decline_reason;
-				ms_message("incoming call timeout (%i)",lc->sip_conf.inc_timeout);
-				decline_reason=lc->current_call ? LinphoneReasonBusy : LinphoneReasonDeclined;
-				call->log->status=LinphoneCallMissed;
-				sal_error_info_set(&call->non_op_error,SalReasonRequestTimeout,408,"Not answered",NULL);
-				linphone_core_decline_call(lc,call,decline_reason);
-			}
-		}
-		if ( (lc->sip_conf.in_call_timeout > 0)
-			 && (call->log->connected_date_time != 0)
-			 && ((curtime - call->log->connected_date_time) > lc->sip_conf.in_call_timeout))
-		{
-			ms_message("in call timeout (%i)",lc->sip_conf.in_call_timeout);
-			linphone_core_terminate_call(lc,call);
-		}
 	}
+	linphone_core_profiling_stop(lc,LinphoneProfilingCallTasks,begin);
 
 	if (linphone_core_video_preview_enabled(lc)){
 		if (lc->previewstream==NULL && lc->calls==NULL)
@@ -2567,23 +2825,140 @@ void linphone_core_iterate(LinphoneCore *lc){
 			toggle_video_preview(lc,FALSE);
 	}
 
+	begin=linphone_core_profiling_start(lc);
 	linphone_core_run_hooks(lc);
+	linphone_core_profiling_stop(lc,LinphoneProfilingHooks,begin);
 	linphone_core_do_plugin_tasks(lc);
+	begin=linphone_core_profiling_start(lc);
+	linphone_core_message_storage_iterate(lc);
+	linphone_core_profiling_stop(lc,LinphoneProfilingStorage,begin);
+	linphone_core_send_queued_presence_notifies(lc);
 
 	if (lc->network_reachable && lc->netup_time!=0 && (curtime-lc->netup_time)>3){
 		/*not do that immediately, take your time.*/
 		linphone_core_send_initial_subscribes(lc);
 	}
+	linphone_core_process_subscribe_queue(lc);
 
 	if (one_second_elapsed) {
 		if (lp_config_needs_commit(lc->config)) {
+			begin=linphone_core_profiling_start(lc);
 			lp_config_sync(lc->config);
+			linphone_core_profiling_stop(lc,LinphoneProfilingConfigSync,begin);
 		}
 	}
 
 	if (liblinphone_serialize_logs == TRUE) {
 		ortp_logv_flush();
 	}
+	linphone_core_profiling_stop(lc,LinphoneProfilingIterate,iterate_begin);
+}
+
+#define LINPHONE_CORE_BUSY_ITERATE_INTERVAL 20 /*ms, period at which media streams, previews and hooks need linphone_core_iterate()*/
+#define LINPHONE_CORE_IDLE_ITERATE_INTERVAL 1000 /*ms, for the tasks that linphone_core_iterate() checks every second*/
+
+/*the events of the media streams are processed by linphone_call_background_tasks()*/
+static bool_t linphone_core_has_media_streams(const LinphoneCore *lc){
+	const MSList *elem;
+	for(elem=lc->calls;elem!=NULL;elem=elem->next){
+		LinphoneCall *call=(LinphoneCall*)elem->data;
+		if (call->audiostream!=NULL || call->videostream!=NULL) return TRUE;
+#ifdef BUILD_UPNP
+		if (call->upnp_session!=NULL) return TRUE;
+#endif //BUILD_UPNP
+	}
+	return FALSE;
+}
+
+static void iterate_timeout_limit(int *timeout, int value){
+	if (value<0) value=0;
+	if (*timeout<0 || value<*timeout) *timeout=value;
+}
+
+static void iterate_timeout_limit_to_time(int *timeout, uint64_t time, uint64_t now){
+	iterate_timeout_limit(timeout, time>now ? (int)MIN(time-now,(uint64_t)INT_MAX) : 0);
+}
+
+/**
+ * Returns the time after which linphone_core_iterate() has work to do, without taking the SIP stack into account.
+ *
+ * @ingroup initializing
+ * An idle core only needs to be iterated when one of its internal timers expires, for example the
+ * incoming call timeout. While media streams, video previews or iterate hooks are active, the core has to be iterated
+ * about every 20 milliseconds.
+ * @param lc the LinphoneCore
+ * @return the timeout in milliseconds, 0 if linphone_core_iterate() must be called immediately, -1 if no timer is pending.
+**/
+int linphone_core_get_iterate_timeout(LinphoneCore *lc){
+	uint64_t now=ortp_get_cur_time_ms();
+	uint64_t expire;
+	int timeout=-1;
+	const MSList *elem;
+
+	if (linphone_core_get_global_state(lc)==LinphoneGlobalStartup || lc->network_reachable_to_be_notified || lc->preview_finished)
+		return 0;
+	if (linphone_core_has_media_streams(lc) || lc->ecc!=NULL || lc->ringstream!=NULL || lc->previewstream!=NULL || linphone_core_video_preview_enabled(lc)
+		|| lc->hooks!=NULL || lc->bl_refresh || lc->bl_reqs!=NULL || lc->presence_notify_queue!=NULL)
+		return LINPHONE_CORE_BUSY_ITERATE_INTERVAL;
+	for(elem=lc->sip_conf.proxies;elem!=NULL;elem=elem->next){
+		LinphoneProxyConfig *cfg=(LinphoneProxyConfig*)elem->data;
+		/*otherwise the registration or the network going up will be notified by an event*/
+		if ((cfg->commit && lc->network_reachable)
+			|| (cfg->send_publish && (cfg->state==LinphoneRegistrationOk || cfg->state==LinphoneRegistrationCleared)))
+			return LINPHONE_CORE_BUSY_ITERATE_INTERVAL;
+	}
+
+	if (linphone_timer_wheel_get_next_expiry(lc->timer_wheel,&expire))
+		iterate_timeout_limit_to_time(&timeout,expire,now);
+	if (lc->subscribe_queue!=NULL || lc->presence_list_pending){
+		expire=lc->subscribe_resume_time;
+		if (lc->subscribe_queue!=NULL && lc->next_subscribe_time>expire) expire=lc->next_subscribe_time;
+		iterate_timeout_limit_to_time(&timeout,expire,now);
+	}
+	if (lc->network_reachable && lc->netup_time!=0 && !lc->initial_subscribes_sent)
+		iterate_timeout_limit(&timeout,(int)(lc->netup_time+4-time(NULL))*1000);
+#ifdef MSG_STORAGE_ENABLED
+	if (lc->db_transaction_start!=0)
+		iterate_timeout_limit_to_time(&timeout,lc->db_transaction_start+lc->db_flush_interval,now);
+#endif
+	if (lc->sip_conf.deleted_proxies!=NULL || lc->auto_net_state_mon || lp_config_needs_commit(lc->config))
+		iterate_timeout_limit(&timeout,LINPHONE_CORE_IDLE_ITERATE_INTERVAL);
+	return timeout;
+}
+
+/**
+ * Blocks until linphone_core_iterate() has work to do, or until the given timeout.
+ *
+ * @ingroup initializing
+ * This is the event driven alternative to calling linphone_core_iterate() every 20 milliseconds:
+ * the application loop calls linphone_core_wait() then linphone_core_iterate().
+ * While waiting, the SIP sockets and timers are serviced, and the wait ends as soon as a SIP event was processed,
+ * the delay returned by linphone_core_get_iterate_timeout() elapsed, or linphone_core_wakeup() was called.
+ * @param lc the LinphoneCore
+ * @param max_timeout_ms the maximum time to wait in milliseconds, -1 for no limit.
+**/
+void linphone_core_wait(LinphoneCore *lc, int max_timeout_ms){
+	int timeout=linphone_core_get_iterate_timeout(lc);
+
+	if (timeout<0 || (max_timeout_ms>=0 && timeout>max_timeout_ms)) timeout=max_timeout_ms;
+	if (timeout<0) timeout=INT_MAX;
+	if (timeout==0) return;
+	lc->wait_deadline=ortp_get_cur_time_ms()+timeout;
+	sal_wait(lc->sal,timeout);
+	lc->wait_deadline=0;
+}
+
+/**
+ * Ends the linphone_core_wait() in progress. If none is in progress, the wakeup is processed by the next
+ * call to linphone_core_wait() or linphone_core_iterate().
+ *
+ * @ingroup initializing
+ * This is the only function of liblinphone that can be called from any thread, for example after posting
+ * work to the thread running the core.
+ * @param lc the LinphoneCore
+**/
+void linphone_core_wakeup(LinphoneCore *lc){
+	sal_wakeup(lc->sal);
 }
 
 /**
@@ -4030,6 +4405,10 @@ int linphone_core_send_publish(LinphoneCore *lc,
 	return 0;
 }
 
+static void linphone_core_update_call_timeouts(LinphoneCore *lc){
+	ms_list_for_each(lc->calls,(void (*)(void*))linphone_call_update_timeout);
+}
+
 /**
  * Set the incoming call timeout in seconds.
  *
@@ -4042,6 +4421,7 @@ void linphone_core_set_inc_timeout(LinphoneCore *lc, int seconds){
 	if (linphone_core_ready(lc)){
 		lp_config_set_int(lc->config,"sip","inc_timeout",seconds);
 	}
+	linphone_core_update_call_timeouts(lc);
 }
 
 /**
@@ -4062,6 +4442,7 @@ int linphone_core_get_inc_timeout(LinphoneCore *lc){
 **/
 void linphone_core_set_in_call_timeout(LinphoneCore *lc, int seconds){
 	lc->sip_conf.in_call_timeout=seconds;
+	linphone_core_update_call_timeouts(lc);
 }
 
 /**
@@ -4092,6 +4473,7 @@ int linphone_core_get_delayed_timeout(LinphoneCore *lc){
 **/
 void linphone_core_set_delayed_timeout(LinphoneCore *lc, int seconds){
 	lc->sip_conf.delayed_timeout=seconds;
+	linphone_core_update_call_timeouts(lc);
 }
 
 void linphone_core_set_presence_info(LinphoneCore *lc, int minutes_away, const char *contact, LinphoneOnlineStatus os) {
@@ -5003,7 +5385,7 @@ void linphone_core_clear_call_logs(LinphoneCore *lc){
 	lc->missed_calls=0;
 	ms_list_for_each(lc->call_logs,(void (*)(void*))linphone_call_log_unref);
 	lc->call_logs=ms_list_free(lc->call_logs);
-	call_logs_write_to_config_file(lc);
+	linphone_core_call_log_storage_clear(lc);
 }
 
 int linphone_core_get_missed_calls_count(LinphoneCore *lc) {
@@ -5015,9 +5397,11 @@ void linphone_core_reset_missed_calls_count(LinphoneCore *lc) {
 }
 
 void linphone_core_remove_call_log(LinphoneCore *lc, LinphoneCallLog *cl){
-	lc->call_logs = ms_list_remove(lc->call_logs, cl);
-	call_logs_write_to_config_file(lc);
-	linphone_call_log_unref(cl);
+	/*call logs of the history that are not in memory can be removed as well*/
+	bool_t in_memory = (ms_list_find(lc->call_logs, cl) != NULL);
+	if (in_memory) lc->call_logs = ms_list_remove(lc->call_logs, cl);
+	linphone_core_call_log_storage_remove(lc, cl);
+	if (in_memory) linphone_call_log_unref(cl);
 }
 
 
@@ -6065,7 +6449,7 @@ void sip_config_uninit(LinphoneCore *lc)
 
 	/*no longuer need to write proxy config if not changedlinphone_proxy_config_write_to_config_file(lc->config,NULL,i);*/	/*mark the end */
 
-	lc->auth_info=ms_list_free_with_data(lc->auth_info,(void (*)(void*))linphone_auth_info_destroy);
+	linphone_core_free_auth_infos(lc);
 
 	/*now that we are unregisted, we no longer need the tunnel.*/
 #ifdef TUNNEL_ENABLED
@@ -6113,6 +6497,7 @@ void rtp_config_uninit(LinphoneCore *lc)
 	lp_config_set_int(lc->config,"rtp","audio_jitt_comp",config->audio_jitt_comp);
 	lp_config_set_int(lc->config,"rtp","video_jitt_comp",config->video_jitt_comp);
 	lp_config_set_int(lc->config,"rtp","nortp_timeout",config->nortp_timeout);
+	lp_config_set_int(lc->config,"rtp","stats_notification_interval",config->stats_notification_interval);
 	lp_config_set_int(lc->config,"rtp","audio_adaptive_jitt_comp_enabled",config->audio_adaptive_jitt_comp_enabled);
 	lp_config_set_int(lc->config,"rtp","video_adaptive_jitt_comp_enabled",config->video_adaptive_jitt_comp_enabled);
 	ms_free(config->srtp_suites);
@@ -6186,11 +6571,15 @@ static void codecs_config_uninit(LinphoneCore *lc)
 void ui_config_uninit(LinphoneCore* lc)
 {
 	ms_message("Destroying friends.");
+	linphone_core_clear_subscribe_queue(lc);
+	lc->presence_notify_queue=ms_list_free(lc->presence_notify_queue);
+	linphone_core_set_presence_notify_model(lc,NULL);
 	if (lc->friends){
 		ms_list_for_each(lc->friends,(void (*)(void *))linphone_friend_destroy);
 		ms_list_free(lc->friends);
 		lc->friends=NULL;
 	}
+	linphone_core_clear_friend_indexes(lc);
 	if (lc->presence_model) {
 		linphone_presence_model_unref(lc->presence_model);
 		lc->presence_model = NULL;
@@ -6229,6 +6618,7 @@ static void linphone_core_uninit(LinphoneCore *lc)
 
 	if (lc->friends) /* FIXME we should wait until subscription to complete*/
 		ms_list_for_each(lc->friends,(void (*)(void *))linphone_friend_close_subscriptions);
+	linphone_core_close_presence_list(lc);
 	linphone_core_set_state(lc,LinphoneGlobalShutdown,"Shutting down");
 #ifdef VIDEO_ENABLED
 	if (lc->previewstream!=NULL){
@@ -6244,6 +6634,10 @@ static void linphone_core_uninit(LinphoneCore *lc)
 	sip_config_uninit(lc);
 	net_config_uninit(lc);
 	rtp_config_uninit(lc);
+	linphone_core_uninit_port_allocators(lc);
+	linphone_timer_wheel_destroy(lc->timer_wheel);
+	lc->timer_wheel=NULL;
+	linphone_core_enable_profiling(lc,FALSE);
 	linphone_core_stop_ringing(lc);
 	sound_config_uninit(lc);
 	video_config_uninit(lc);
@@ -6260,8 +6654,11 @@ static void linphone_core_uninit(LinphoneCore *lc)
 
 	ms_list_for_each(lc->chatrooms, (MSIterateFunc)linphone_chat_room_release);
 	lc->chatrooms = ms_list_free(lc->chatrooms);
+	linphone_core_clear_chat_room_index(lc);
 
 	if (lp_config_needs_commit(lc->config)) lp_config_sync(lc->config);
+	/*the config file is expected to be up to date once the core is destroyed*/
+	lp_config_enable_background_sync(lc->config,FALSE,0);
 	lp_config_destroy(lc->config);
 	lc->config = NULL; /* Mark the config as NULL to block further calls */
 
@@ -6286,6 +6683,8 @@ static void linphone_core_uninit(LinphoneCore *lc)
 	linphone_core_free_payload_types(lc);
 	if (lc->supported_formats) ms_free(lc->supported_formats);
 	linphone_core_message_storage_close(lc);
+	linphone_core_call_log_storage_close(lc);
+	if (lc->logs_db_file) ms_free(lc->logs_db_file);
 	ms_exit();
 	linphone_core_set_state(lc,LinphoneGlobalOff,"Off");
 	if (liblinphone_serialize_logs == TRUE) {
@@ -6415,6 +6814,7 @@ int linphone_core_add_call( LinphoneCore *lc, LinphoneCall *call)
 		lc->calls = ms_list_append(lc->calls,call);
 		return 0;
 	}
+	linphone_call_release_media_ports(call);
 	return -1;
 }
 
@@ -6434,6 +6834,7 @@ int linphone_core_del_call( LinphoneCore *lc, LinphoneCall *call)
 		return -1;
 	}
 	lc->calls = the_calls;
+	linphone_call_release_media_ports(call);
 	return 0;
 }
 
@@ -6928,6 +7329,19 @@ void linphone_core_set_chat_database_path(LinphoneCore *lc, const char *path){
 		linphone_core_message_storage_init(lc);
 	}
 }
+
+void linphone_core_set_call_logs_database_path(LinphoneCore *lc, const char *path){
+	if (lc->logs_db_file){
+		ms_free(lc->logs_db_file);
+		lc->logs_db_file=NULL;
+	}
+	linphone_core_call_log_storage_close(lc);
+	if (path) {
+		lc->logs_db_file=ms_strdup(path);
+		linphone_core_call_log_storage_init(lc);
+	}
+}
+
 void linphone_core_enable_sdp_200_ack(LinphoneCore *lc, bool_t enable) {
 	lp_config_set_int(lc->config,"sip","sdp_200_ack",lc->sip_conf.sdp_200_ack=enable);
 }
@@ -570,6 +570,28 @@ LINPHONE_PUBLIC float linphone_call_stats_get_upload_bandwidth(const LinphoneCal
 LINPHONE_PUBLIC LinphoneIceState linphone_call_stats_get_ice_state(const LinphoneCallStats *stats);
 LINPHONE_PUBLIC LinphoneUpnpState linphone_call_stats_get_upnp_state(const LinphoneCallStats *stats);
 
+/**
+ * Flat copy of the statistics of one stream of a call, as returned by linphone_core_get_call_stats_snapshot().
+ * @ingroup call_misc
+**/
+typedef struct _LinphoneCallStatsSnapshot{
+	LinphoneCall *call; /**< the call, not referenced */
+	int type; /**< LINPHONE_CALL_STATS_AUDIO or LINPHONE_CALL_STATS_VIDEO */
+	LinphoneIceState ice_state;
+	float download_bandwidth; /**< kbit/s */
+	float upload_bandwidth; /**< kbit/s */
+	float sender_loss_rate; /**< percentage */
+	float receiver_loss_rate; /**< percentage */
+	float sender_interarrival_jitter; /**< ms */
+	float receiver_interarrival_jitter; /**< ms */
+	float round_trip_delay; /**< seconds, -1 if unknown */
+	float jitter_buffer_size_ms;
+	float local_loss_rate; /**< percentage over the last second */
+	float local_late_rate; /**< percentage over the last second */
+}LinphoneCallStatsSnapshot;
+
+LINPHONE_PUBLIC int linphone_core_get_call_stats_snapshot(LinphoneCore *lc, LinphoneCallStatsSnapshot *snapshots, int max_count);
+
 /** Callback prototype */
 typedef void (*LinphoneCallCbFunc)(LinphoneCall *call,void * user_data);
 
@@ -1021,6 +1043,18 @@ LINPHONE_PUBLIC SipSetup *linphone_proxy_config_get_sip_setup(LinphoneProxyConfi
  */
 LINPHONE_PUBLIC	int linphone_proxy_config_normalize_number(LinphoneProxyConfig *proxy, const char *username, char *result, size_t result_len);
 
+/**
+ * Normalizes an array of human readable phone numbers, as linphone_proxy_config_normalize_number() does for each of them.
+ * The dial plan of the proxy config is looked up once and no memory is allocated, which makes it suitable to import large address books.
+ * @param proxy #LinphoneProxyConfig object whose dial prefix and escape plus setting are used
+ * @param numbers array of count numbers to normalize
+ * @param count number of entries in numbers
+ * @param results buffer of count*result_len bytes: the i-th normalized number is written at results+i*result_len
+ * @param result_len size of each result, including the terminating null character
+ * @return the number of normalized numbers
+ */
+LINPHONE_PUBLIC	int linphone_proxy_config_normalize_numbers(LinphoneProxyConfig *proxy, const char * const *numbers, int count, char *results, size_t result_len);
+
 /**
  * Set default privacy policy for all calls routed through this proxy.
  * @param cfg #LinphoneProxyConfig object to be modified
@@ -1314,6 +1348,54 @@ typedef enum _LinphoneChatMessageState {
 typedef void (*LinphoneChatMessageStateChangedCb)(LinphoneChatMessage* msg,LinphoneChatMessageState state,void* ud);
 
 LINPHONE_PUBLIC void linphone_core_set_chat_database_path(LinphoneCore *lc, const char *path);
+
+/**
+ * Enables or disables the write-behind mode of the chat message storage.
+ * When enabled, the messages and their state changes are not written to disk as soon as they are stored,
+ * but committed in a single transaction from linphone_core_iterate(), at most every [misc] chat_database_flush_interval milliseconds
+ * (0, the default, meaning at each iteration). The history getters always see the pending changes.
+ * Write-behind mode also switches the database to write-ahead logging.
+ * @ingroup initializing
+ * @param[in] lc #LinphoneCore object
+ * @param[in] enable TRUE to enable write-behind mode, FALSE to write messages immediately.
+ */
+LINPHONE_PUBLIC void linphone_core_enable_chat_database_write_behind(LinphoneCore *lc, bool_t enable);
+
+/**
+ * Tells whether the write-behind mode of the chat message storage is enabled.
+ * @ingroup initializing
+ * @param[in] lc #LinphoneCore object
+ * @return TRUE if write-behind mode is enabled, FALSE otherwise.
+ */
+LINPHONE_PUBLIC bool_t linphone_core_chat_database_write_behind_enabled(const LinphoneCore *lc);
+
+/**
+ * Writes to disk the chat messages and state changes pending in write-behind mode.
+ * This is done automatically from linphone_core_iterate() and when the core is destroyed,
+ * but an application may want to call it before being suspended.
+ * @ingroup initializing
+ * @param[in] lc #LinphoneCore object
+ */
+LINPHONE_PUBLIC void linphone_core_flush_chat_database(LinphoneCore *lc);
+
+/**
+ * Enables or disables lazy creation of the chat rooms known from the history.
+ * When enabled, opening the chat database only loads the peer, the last message id and the unread message count
+ * of each conversation. The #LinphoneChatRoom objects are created when looked up, or listed with linphone_core_get_chat_rooms_page().
+ * Enabling takes effect the next time the chat database is opened, disabling creates the pending chat rooms immediately.
+ * @ingroup initializing
+ * @param[in] lc #LinphoneCore object
+ * @param[in] enable TRUE to create chat rooms on demand, FALSE to create them all when the chat database is opened.
+ */
+LINPHONE_PUBLIC void linphone_core_enable_lazy_chat_rooms(LinphoneCore *lc, bool_t enable);
+
+/**
+ * Tells whether chat rooms known from the history are created on demand.
+ * @ingroup initializing
+ * @param[in] lc #LinphoneCore object
+ * @return TRUE if lazy chat rooms are enabled, FALSE otherwise.
+ */
+LINPHONE_PUBLIC bool_t linphone_core_lazy_chat_rooms_enabled(const LinphoneCore *lc);
 LINPHONE_PUBLIC	LinphoneChatRoom * linphone_core_create_chat_room(LinphoneCore *lc, const char *to);
 LINPHONE_PUBLIC	LinphoneChatRoom * linphone_core_get_or_create_chat_room(LinphoneCore *lc, const char *to);
 LINPHONE_PUBLIC LinphoneChatRoom *linphone_core_get_chat_room(LinphoneCore *lc, const LinphoneAddress *addr);
@@ -1384,6 +1466,17 @@ LINPHONE_PUBLIC int linphone_chat_room_get_history_size(LinphoneChatRoom *cr);
  */
 LINPHONE_PUBLIC MSList *linphone_chat_room_get_history_range(LinphoneChatRoom *cr, int begin, int end);
 
+/**
+ * Gets the messages stored before a given message, sorted from oldest to most recent.
+ * Unlike #linphone_chat_room_get_history_range, the cost of this function only depends on the number of messages returned,
+ * so that it should be used to browse long histories page by page.
+ * @param[in] cr The #LinphoneChatRoom object corresponding to the conversation for which messages should be retrieved
+ * @param[in] storage_id The storage id of the message following the requested page (see #linphone_chat_message_get_storage_id), or 0 to start from the most recent message.
+ * @param[in] nb_messages The maximum number of messages to retrieve, or 0 to retrieve all of them.
+ * @return \mslist{LinphoneChatMessage}
+ */
+LINPHONE_PUBLIC MSList *linphone_chat_room_get_history_before(LinphoneChatRoom *cr, unsigned int storage_id, int nb_messages);
+
 /**
  * Notifies the destination of the chat message being composed that the user is typing a new message.
  * @param[in] cr The #LinphoneChatRoom object corresponding to the conversation for which a new message is being typed.
@@ -1401,6 +1494,8 @@ LINPHONE_PUBLIC int linphone_chat_room_get_unread_messages_count(LinphoneChatRoo
 LINPHONE_PUBLIC LinphoneCore* linphone_chat_room_get_lc(LinphoneChatRoom *cr);
 LINPHONE_PUBLIC LinphoneCore* linphone_chat_room_get_core(LinphoneChatRoom *cr);
 LINPHONE_PUBLIC MSList* linphone_core_get_chat_rooms(LinphoneCore *lc);
+LINPHONE_PUBLIC int linphone_core_get_chat_rooms_count(LinphoneCore *lc);
+LINPHONE_PUBLIC MSList *linphone_core_get_chat_rooms_page(LinphoneCore *lc, int offset, int count);
 LINPHONE_PUBLIC unsigned int linphone_chat_message_store(LinphoneChatMessage *msg);
 
 LINPHONE_PUBLIC	const char* linphone_chat_message_state_to_string(const LinphoneChatMessageState state);
@@ -1872,6 +1967,14 @@ LINPHONE_PUBLIC char * linphone_core_compress_log_collection(LinphoneCore *core)
  */
 LINPHONE_PUBLIC void linphone_core_reset_log_collection(LinphoneCore *core);
 
+/**
+ * Write to the log files all the logs collected so far.
+ * Logs are collected in memory and written to the log files by a background thread, this function waits for this thread
+ * to have written them.
+ * @ingroup misc
+ */
+LINPHONE_PUBLIC void linphone_core_flush_log_collection(void);
+
 /**
  * Define a log handler.
  *
@@ -1944,6 +2047,64 @@ LINPHONE_PUBLIC LinphoneCore *linphone_core_new_with_config(const LinphoneCoreVT
 /* For ICE to work properly it should be called every 20ms */
 LINPHONE_PUBLIC	void linphone_core_iterate(LinphoneCore *lc);
 
+/* event driven alternative: call linphone_core_wait() then linphone_core_iterate() in a loop */
+LINPHONE_PUBLIC int linphone_core_get_iterate_timeout(LinphoneCore *lc);
+LINPHONE_PUBLIC void linphone_core_wait(LinphoneCore *lc, int max_timeout_ms);
+LINPHONE_PUBLIC void linphone_core_wakeup(LinphoneCore *lc);
+
+/**
+ * Parts of linphone_core_iterate() whose execution time is measured when profiling is enabled.
+ * @ingroup misc
+**/
+typedef enum _LinphoneProfilingSection{
+	LinphoneProfilingIterate, /**< the whole linphone_core_iterate() */
+	LinphoneProfilingSalIterate, /**< reception and processing of the SIP messages */
+	LinphoneProfilingEventQueue, /**< mediastreamer2 event queue */
+	LinphoneProfilingTimers, /**< call timeouts */
+	LinphoneProfilingCallTasks, /**< background tasks of the calls */
+	LinphoneProfilingProxyUpdate, /**< registrations and publications */
+	LinphoneProfilingHooks, /**< iterate hooks */
+	LinphoneProfilingStorage, /**< chat database write-behind */
+	LinphoneProfilingConfigSync, /**< writing of the configuration file */
+	LinphoneProfilingSectionCount
+}LinphoneProfilingSection;
+
+/**
+ * Event counters of the core. They are maintained even when profiling is disabled.
+ * @ingroup misc
+**/
+typedef enum _LinphoneProfilingCounter{
+	LinphoneProfilingSipRequestsReceived,
+	LinphoneProfilingSipResponsesReceived,
+	LinphoneProfilingSipRequestsSent, /**< retransmissions, refreshes, ACKs and CANCELs excluded */
+	LinphoneProfilingNotifiesParsed, /**< presence documents parsed */
+	LinphoneProfilingMessagesStored, /**< chat messages inserted in the database */
+	LinphoneProfilingCounterCount
+}LinphoneProfilingCounter;
+
+#define LINPHONE_PROFILING_HISTOGRAM_SIZE 16
+
+/**
+ * Distribution of the execution times of a #LinphoneProfilingSection.
+ * @ingroup misc
+**/
+typedef struct _LinphoneProfilingHistogram{
+	unsigned int count; /**< number of executions */
+	unsigned int max; /**< longest execution, in microseconds */
+	uint64_t total; /**< cumulated execution time, in microseconds */
+	/** buckets[0] counts the executions shorter than 1 microsecond, buckets[i] the ones from 2^(i-1) to 2^i-1 microseconds,
+	 and the last bucket all the longer ones */
+	unsigned int buckets[LINPHONE_PROFILING_HISTOGRAM_SIZE];
+}LinphoneProfilingHistogram;
+
+LINPHONE_PUBLIC void linphone_core_enable_profiling(LinphoneCore *lc, bool_t enable);
+LINPHONE_PUBLIC bool_t linphone_core_profiling_enabled(const LinphoneCore *lc);
+LINPHONE_PUBLIC void linphone_core_reset_profiling(LinphoneCore *lc);
+LINPHONE_PUBLIC void linphone_core_get_profiling_histogram(const LinphoneCore *lc, LinphoneProfilingSection section, LinphoneProfilingHistogram *histogram);
+LINPHONE_PUBLIC uint64_t linphone_core_get_profiling_counter(const LinphoneCore *lc, LinphoneProfilingCounter counter);
+LINPHONE_PUBLIC const char *linphone_profiling_section_to_string(LinphoneProfilingSection section);
+LINPHONE_PUBLIC const char *linphone_profiling_counter_to_string(LinphoneProfilingCounter counter);
+
 /**
  * @ingroup initializing
  * add a listener to be notified of linphone core events. Once events are received, registered vtable are invoked in order.
@@ -2308,8 +2469,33 @@ LINPHONE_PUBLIC	void linphone_core_set_video_port(LinphoneCore *lc, int port);
 
 LINPHONE_PUBLIC	void linphone_core_set_video_port_range(LinphoneCore *lc, int min_port, int max_port);
 
+/**
+ * Statistics about the RTP/RTCP port pairs reserved by the calls for a type of stream.
+ * @ingroup media_parameters
+**/
+typedef struct _LinphoneMediaPortStats{
+	int nb_ports; /**< number of RTP/RTCP port pairs of the configured range, 0 if the ports are chosen by the system */
+	int nb_used; /**< number of port pairs currently reserved by calls */
+	int max_used; /**< highest number of port pairs reserved at the same time */
+	unsigned int nb_exhausted; /**< number of calls that could not get a port pair because all were in use */
+} LinphoneMediaPortStats;
+
+/**
+ * Retrieves the statistics about the RTP/RTCP ports reserved by the calls.
+ * When no pair is free in the configured range, the port of the stream is chosen by the system.
+ * @ingroup media_parameters
+ * @param lc #LinphoneCore object
+ * @param stream_type either LINPHONE_CALL_STATS_AUDIO or LINPHONE_CALL_STATS_VIDEO
+ * @param stats structure filled with the statistics
+**/
+LINPHONE_PUBLIC	void linphone_core_get_media_port_stats(const LinphoneCore *lc, int stream_type, LinphoneMediaPortStats *stats);
+
 LINPHONE_PUBLIC	void linphone_core_set_nortp_timeout(LinphoneCore *lc, int port);
 
+LINPHONE_PUBLIC void linphone_core_set_call_stats_notification_interval(LinphoneCore *lc, int interval_ms);
+
+LINPHONE_PUBLIC int linphone_core_get_call_stats_notification_interval(const LinphoneCore *lc);
+
 LINPHONE_PUBLIC	void linphone_core_set_use_info_for_dtmf(LinphoneCore *lc, bool_t use_info);
 
 LINPHONE_PUBLIC	bool_t linphone_core_get_use_info_for_dtmf(LinphoneCore *lc);
@@ -2548,6 +2734,35 @@ void linphone_core_set_rtp_no_xmit_on_audio_mute(LinphoneCore *lc, bool_t val);
 **/
 LINPHONE_PUBLIC const MSList * linphone_core_get_call_logs(LinphoneCore *lc);
 
+/**
+ * Sets the database filename where call logs will be stored.
+ * If the file does not exist, it will be created, and the call logs of the configuration file are moved to it.
+ * The whole history is then kept in the database, while linphone_core_get_call_logs() only returns the most recent calls,
+ * up to the history_max_size setting of the [misc] section.
+ * @param[in] lc LinphoneCore object
+ * @param[in] path filesystem path
+**/
+LINPHONE_PUBLIC void linphone_core_set_call_logs_database_path(LinphoneCore *lc, const char *path);
+
+/**
+ * Get a page of the call history, most recent calls first.
+ * Without call logs database, the history is the list returned by linphone_core_get_call_logs().
+ * @param[in] lc LinphoneCore object
+ * @param[in] filter Criteria of the returned call logs, or NULL for all of them
+ * @param[in] offset Number of matching call logs to skip
+ * @param[in] count Maximum number of call logs to return, 0 for all of them
+ * @return \mslist{LinphoneCallLog}, to be freed with ms_list_free_with_data(list, (void (*)(void*))linphone_call_log_unref)
+**/
+LINPHONE_PUBLIC MSList * linphone_core_get_call_history(LinphoneCore *lc, const LinphoneCallLogFilter *filter, int offset, int count);
+
+/**
+ * Get the number of call logs of the call history matching a filter.
+ * @param[in] lc LinphoneCore object
+ * @param[in] filter Criteria of the counted call logs, or NULL for all of them
+ * @return The number of matching call logs
+**/
+LINPHONE_PUBLIC int linphone_core_get_call_history_size(LinphoneCore *lc, const LinphoneCallLogFilter *filter);
+
 /**
  * Erase the call log.
  * @param[in] lc LinphoneCore object
@@ -2570,7 +2785,8 @@ LINPHONE_PUBLIC void linphone_core_reset_missed_calls_count(LinphoneCore *lc);
 
 /**
  * Remove a specific call log from call history list.
- * This function destroys the call log object. It must not be accessed anymore by the application after calling this function.
+ * This function destroys the call log object, unless it was returned by linphone_core_get_call_history(): in that case the reference obtained from it must still be released.
+ * It must not be accessed anymore by the application after calling this function.
  * @param[in] lc #LinphoneCore object
  * @param[in] call_log #LinphoneCallLog object to remove.
 **/
@@ -63,24 +63,50 @@ extern "C" void libmswebrtc_init();
 /*force linking of ms_audio_diff symbol because the tester requires it.*/
 static void *audiodiff=(void*)&ms_audio_diff;
 
+/*javaclass is the prefix of the class and constructor resolved in JNI_OnLoad()*/
 #define RETURN_USER_DATA_OBJECT(javaclass, funcprefix, cobj) \
 	{ \
-		jclass jUserDataObjectClass; \
-		jmethodID jUserDataObjectCtor; \
 		jobject jUserDataObj; \
 		jUserDataObj = (jobject)funcprefix ## _get_user_data(cobj); \
 		if (jUserDataObj == NULL) { \
-			jUserDataObjectClass = (jclass)env->NewGlobalRef(env->FindClass("org/linphone/core/" javaclass)); \
-			jUserDataObjectCtor = env->GetMethodID(jUserDataObjectClass,"<init>", "(J)V"); \
-			jUserDataObj = env->NewObject(jUserDataObjectClass, jUserDataObjectCtor, (jlong)funcprefix ## _ref(cobj)); \
+			jUserDataObj = env->NewObject(javaclass ## _class, javaclass ## _ctor_id, (jlong)funcprefix ## _ref(cobj)); \
 			jUserDataObj = env->NewGlobalRef(jUserDataObj); \
 			funcprefix ## _set_user_data(cobj, jUserDataObj); \
-			env->DeleteGlobalRef(jUserDataObjectClass); \
 		} \
 		return jUserDataObj; \
 	}
 
 static JavaVM *jvm=0;
+
+/*
+ * Classes and methods used outside of the LinphoneCoreData callbacks, resolved once in JNI_OnLoad():
+ * FindClass() is slow, and from a native thread it cannot find the application classes on Android.
+ */
+static jclass string_class;
+static jclass proxy_config_class;
+static jclass content_class;
+static jmethodID content_ctor_id;
+static jclass chat_message_state_listener_class;
+static jmethodID chat_message_state_changed_id;
+static jclass tunnel_config_class;
+static jmethodID tunnel_config_get_host_id;
+static jmethodID tunnel_config_get_port_id;
+static jmethodID tunnel_config_get_remote_udp_mirror_port_id;
+static jmethodID tunnel_config_get_delay_id;
+static jmethodID tunnel_config_set_host_id;
+static jmethodID tunnel_config_set_port_id;
+static jmethodID tunnel_config_set_remote_udp_mirror_port_id;
+static jmethodID tunnel_config_set_delay_id;
+static jclass presence_model_class;
+static jmethodID presence_model_ctor_id;
+static jclass presence_activity_class;
+static jmethodID presence_activity_ctor_id;
+static jclass presence_note_class;
+static jmethodID presence_note_ctor_id;
+static jclass presence_service_class;
+static jmethodID presence_service_ctor_id;
+static jclass presence_person_class;
+static jmethodID presence_person_ctor_id;
 static const char* LogDomain = "Linphone";
 static jclass handler_class;
 static jmethodID loghandler_id;
@@ -139,12 +165,68 @@ int dumbMethodForAllowingUsageOfCpuFeaturesFromStaticLibMediastream() {
 }
 #endif /*ANDROID*/
 
+static jclass find_class(JNIEnv *env, const char *name) {
+	jclass cls = env->FindClass(name);
+	jclass global;
+
+	if (cls == NULL) {
+		ms_error("Could not find java class %s", name);
+		env->ExceptionClear();
+		return NULL;
+	}
+	global = (jclass)env->NewGlobalRef(cls);
+	env->DeleteLocalRef(cls);
+	return global;
+}
+
+static jmethodID get_method_id(JNIEnv *env, jclass cls, const char *name, const char *sig) {
+	jmethodID id;
+
+	if (cls == NULL) return NULL;
+	id = env->GetMethodID(cls, name, sig);
+	if (id == NULL) {
+		ms_error("Could not find java method %s%s", name, sig);
+		env->ExceptionClear();
+	}
+	return id;
+}
+
 JNIEXPORT jint JNICALL  JNI_OnLoad(JavaVM *ajvm, void *reserved)
 {
+	JNIEnv *env = NULL;
 #ifdef ANDROID
 	ms_set_jvm(ajvm);
 #endif /*ANDROID*/
 	jvm=ajvm;
+	if (jvm->GetEnv((void **)&env, JNI_VERSION_1_2) != JNI_OK) return JNI_VERSION_1_2;
+
+	string_class = find_class(env, "java/lang/String");
+	proxy_config_class = find_class(env, "org/linphone/core/LinphoneProxyConfigImpl");
+	content_class = find_class(env, "org/linphone/core/LinphoneContentImpl");
+	content_ctor_id = get_method_id(env, content_class, "<init>", "(Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;[BLjava/lang/String;I)V");
+	chat_message_state_listener_class = find_class(env, "org/linphone/core/LinphoneChatMessage$StateListener");
+	chat_message_state_changed_id = get_method_id(env, chat_message_state_listener_class, "onLinphoneChatMessageStateChanged", "(Lorg/linphone/core/LinphoneChatMessage;Lorg/linphone/core/LinphoneChatMessage$State;)V");
+
+	tunnel_config_class = find_class(env, "org/linphone/core/TunnelConfig");
+	tunnel_config_get_host_id = get_method_id(env, tunnel_config_class, "getHost", "()Ljava/lang/String;");
+	tunnel_config_get_port_id = get_method_id(env, tunnel_config_class, "getPort", "()I");
+	tunnel_config_get_remote_udp_mirror_port_id = get_method_id(env, tunnel_config_class, "getRemoteUdpMirrorPort", "()I");
+	tunnel_config_get_delay_id = get_method_id(env, tunnel_config_class, "getDelay", "()I");
+	tunnel_config_set_host_id = get_method_id(env, tunnel_config_class, "setHost", "(Ljava/lang/String;)V");
+	tunnel_config_set_port_id = get_method_id(env, tunnel_config_class, "setPort", "(I)V");
+	tunnel_config_set_remote_udp_mirror_port_id = get_method_id(env, tunnel_config_class, "setRemoteUdpMirrorPort", "(I)V");
+	tunnel_config_set_delay_id = get_method_id(env, tunnel_config_class, "setDelay", "(I)V");
+
+	presence_model_class = find_class(env, "org/linphone/core/PresenceModelImpl");
+	presence_model_ctor_id = get_method_id(env, presence_model_class, "<init>", "(J)V");
+	presence_activity_class = find_class(env, "org/linphone/core/PresenceActivityImpl");
+	presence_activity_ctor_id = get_method_id(env, presence_activity_class, "<init>", "(J)V");
+	presence_note_class = find_class(env, "org/linphone/core/PresenceNoteImpl");
+	presence_note_ctor_id = get_method_id(env, presence_note_class, "<init>", "(J)V");
+	presence_service_class = find_class(env, "org/linphone/core/PresenceServiceImpl");
+	presence_service_ctor_id = get_method_id(env, presence_service_class, "<init>", "(J)V");
+	presence_person_class = find_class(env, "org/linphone/core/PresencePersonImpl");
+	presence_person_ctor_id = get_method_id(env, presence_person_class, "<init>", "(J)V");
 	return JNI_VERSION_1_2;
 }
 
@@ -275,10 +357,23 @@ public:
 		addressClass = (jclass)env->NewGlobalRef(env->FindClass("org/linphone/core/LinphoneAddressImpl"));
 		addressCtrId =env->GetMethodID(addressClass,"<init>", "(J)V");
 
+		/*the stats objects of a call are created once, then their fields are updated in place on each report*/
 		callStatsClass = (jclass)env->NewGlobalRef(env->FindClass("org/linphone/core/LinphoneCallStatsImpl"));
-		callStatsId = env->GetMethodID(callStatsClass, "<init>", "(JJ)V");
-		callSetAudioStatsId = env->GetMethodID(callClass, "setAudioStats", "(Lorg/linphone/core/LinphoneCallStats;)V");
-		callSetVideoStatsId = env->GetMethodID(callClass, "setVideoStats", "(Lorg/linphone/core/LinphoneCallStats;)V");
+		callStatsId = env->GetMethodID(callStatsClass, "<init>", "()V");
+		callAudioStatsFieldId = env->GetFieldID(callClass, "audioStats", "Lorg/linphone/core/LinphoneCallStats;");
+		callVideoStatsFieldId = env->GetFieldID(callClass, "videoStats", "Lorg/linphone/core/LinphoneCallStats;");
+		statsMediaTypeFieldId = env->GetFieldID(callStatsClass, "mediaType", "I");
+		statsIceStateFieldId = env->GetFieldID(callStatsClass, "iceState", "I");
+		statsDownloadBandwidthFieldId = env->GetFieldID(callStatsClass, "downloadBandwidth", "F");
+		statsUploadBandwidthFieldId = env->GetFieldID(callStatsClass, "uploadBandwidth", "F");
+		statsSenderLossRateFieldId = env->GetFieldID(callStatsClass, "senderLossRate", "F");
+		statsReceiverLossRateFieldId = env->GetFieldID(callStatsClass, "receiverLossRate", "F");
+		statsSenderInterarrivalJitterFieldId = env->GetFieldID(callStatsClass, "senderInterarrivalJitter", "F");
+		statsReceiverInterarrivalJitterFieldId = env->GetFieldID(callStatsClass, "receiverInterarrivalJitter", "F");
+		statsRoundTripDelayFieldId = env->GetFieldID(callStatsClass, "roundTripDelay", "F");
+		statsLatePacketsCumulativeNumberFieldId = env->GetFieldID(callStatsClass, "latePacketsCumulativeNumber", "J");
+		statsJitterBufferSizeFieldId = env->GetFieldID(callStatsClass, "jitterBufferSize", "F");
+		statsNativePtrFieldId = env->GetFieldID(callStatsClass, "nativePtr", "J");
 
 		infoMessageClass = (jclass)env->NewGlobalRef(env->FindClass("org/linphone/core/LinphoneInfoMessageImpl"));
 		infoMessageCtor = env->GetMethodID(infoMessageClass,"<init>", "(J)V");
@@ -305,8 +400,7 @@ public:
 	}
 
 	~LinphoneCoreData() {
-		JNIEnv *env = 0;
-		jvm->AttachCurrentThread(&env,NULL);
+		JNIEnv *env = ms_get_jni_env();
 		env->DeleteGlobalRef(core);
 		env->DeleteGlobalRef(listener);
 		if (userdata) env->DeleteGlobalRef(userdata);
@@ -325,6 +419,10 @@ public:
 		env->DeleteGlobalRef(linphoneEventClass);
 		env->DeleteGlobalRef(subscriptionStateClass);
 		env->DeleteGlobalRef(subscriptionDirClass);
+		env->DeleteGlobalRef(publishStateClass);
+		env->DeleteGlobalRef(ecCalibratorStatusClass);
+		env->DeleteGlobalRef(addressClass);
+		env->DeleteGlobalRef(callStatsClass);
 	}
 	jobject core;
 	jobject listener;
@@ -364,8 +462,20 @@ public:
 
 	jclass callStatsClass;
 	jmethodID callStatsId;
-	jmethodID callSetAudioStatsId;
-	jmethodID callSetVideoStatsId;
+	jfieldID callAudioStatsFieldId;
+	jfieldID callVideoStatsFieldId;
+	jfieldID statsMediaTypeFieldId;
+	jfieldID statsIceStateFieldId;
+	jfieldID statsDownloadBandwidthFieldId;
+	jfieldID statsUploadBandwidthFieldId;
+	jfieldID statsSenderLossRateFieldId;
+	jfieldID statsReceiverLossRateFieldId;
+	jfieldID statsSenderInterarrivalJitterFieldId;
+	jfieldID statsReceiverInterarrivalJitterFieldId;
+	jfieldID statsRoundTripDelayFieldId;
+	jfieldID statsLatePacketsCumulativeNumberFieldId;
+	jfieldID statsJitterBufferSizeFieldId;
+	jfieldID statsNativePtrFieldId;
 
 	jclass chatMessageStateClass;
 	jmethodID chatMessageStateFromIntId;
@@ -422,9 +532,8 @@ public:
 
 	}
 	static void displayStatusCb(LinphoneCore *lc, const char *message) {
-		JNIEnv *env = 0;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
-		if (result != 0) {
+		JNIEnv *env = ms_get_jni_env();
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -435,9 +544,8 @@ public:
 
 	}
 	static void authInfoRequested(LinphoneCore *lc, const char *realm, const char *username, const char *domain) {
-		JNIEnv *env = 0;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
-		if (result != 0) {
+		JNIEnv *env = ms_get_jni_env();
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -450,9 +558,8 @@ public:
 							domain ? env->NewStringUTF(domain) : NULL);
 	}
 	static void globalStateChange(LinphoneCore *lc, LinphoneGlobalState gstate,const char* message) {
-		JNIEnv *env = 0;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
-		if (result != 0) {
+		JNIEnv *env = ms_get_jni_env();
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -489,10 +596,9 @@ public:
 		return jobj;
 	}
 	static void registrationStateChange(LinphoneCore *lc, LinphoneProxyConfig* proxy,LinphoneRegistrationState state,const char* message) {
-		JNIEnv *env = 0;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
+		JNIEnv *env = ms_get_jni_env();
 		jobject jproxy;
-		if (result != 0) {
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -523,10 +629,9 @@ public:
 	}
 
 	static void callStateChange(LinphoneCore *lc, LinphoneCall* call,LinphoneCallState state,const char* message) {
-		JNIEnv *env = 0;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
+		JNIEnv *env = ms_get_jni_env();
 		jobject jcall;
-		if (result != 0) {
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -543,9 +648,8 @@ public:
 		}
 	}
 	static void callEncryptionChange(LinphoneCore *lc, LinphoneCall* call, bool_t encrypted,const char* authentication_token) {
-		JNIEnv *env = 0;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
-		if (result != 0) {
+		JNIEnv *env = ms_get_jni_env();
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -558,9 +662,8 @@ public:
 							,authentication_token ? env->NewStringUTF(authentication_token) : NULL);
 	}
 	static void notify_presence_received(LinphoneCore *lc,  LinphoneFriend *my_friend) {
-		JNIEnv *env = 0;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
-		if (result != 0) {
+		JNIEnv *env = ms_get_jni_env();
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -571,9 +674,8 @@ public:
 							,env->NewObject(lcData->friendClass,lcData->friendCtrId,(jlong)my_friend));
 	}
 	static void new_subscription_requested(LinphoneCore *lc,  LinphoneFriend *my_friend, const char* url) {
-		JNIEnv *env = 0;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
-		if (result != 0) {
+		JNIEnv *env = ms_get_jni_env();
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -585,9 +687,8 @@ public:
 							,url ? env->NewStringUTF(url) : NULL);
 	}
 	static void dtmf_received(LinphoneCore *lc, LinphoneCall *call, int dtmf) {
-		JNIEnv *env = 0;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
-		if (result != 0) {
+		JNIEnv *env = ms_get_jni_env();
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -599,9 +700,8 @@ public:
 							,dtmf);
 	}
 	static void text_received(LinphoneCore *lc, LinphoneChatRoom *room, const LinphoneAddress *from, const char *message) {
-		JNIEnv *env = 0;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
-		if (result != 0) {
+		JNIEnv *env = ms_get_jni_env();
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -630,10 +730,9 @@ public:
 		return jobj;
 	}
 	static void message_received(LinphoneCore *lc, LinphoneChatRoom *room, LinphoneChatMessage *msg) {
-			JNIEnv *env = 0;
+			JNIEnv *env = ms_get_jni_env();
 			jobject jmsg;
-			jint result = jvm->AttachCurrentThread(&env,NULL);
-			if (result != 0) {
+			if (env == NULL) {
 				ms_error("cannot attach VM");
 				return;
 			}
@@ -646,9 +745,8 @@ public:
 								,(jmsg = lcData->getChatMessage(env, msg)));
 		}
 	static void is_composing_received(LinphoneCore *lc, LinphoneChatRoom *room) {
-		JNIEnv *env = 0;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
-		if (result != 0) {
+		JNIEnv *env = ms_get_jni_env();
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -659,9 +757,8 @@ public:
 							,env->NewObject(lcData->chatRoomClass,lcData->chatRoomCtrId,(jlong)room));
 	}
 	static void ecCalibrationStatus(LinphoneCore *lc, LinphoneEcCalibratorStatus status, int delay_ms, void *data) {
-		JNIEnv *env = 0;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
-		if (result != 0) {
+		JNIEnv *env = ms_get_jni_env();
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -678,29 +775,50 @@ public:
 		}
 
 	}
+	/*
+	 * copies the C stats into the java object directly, instead of letting its constructor fetch each value
+	 * through its own native method.
+	 */
+	void fillCallStats(JNIEnv *env, jobject statsobj, LinphoneCall *call, const LinphoneCallStats *stats) {
+		env->SetIntField(statsobj, statsMediaTypeFieldId, (jint)stats->type);
+		env->SetIntField(statsobj, statsIceStateFieldId, (jint)stats->ice_state);
+		env->SetFloatField(statsobj, statsDownloadBandwidthFieldId, (jfloat)stats->download_bandwidth);
+		env->SetFloatField(statsobj, statsUploadBandwidthFieldId, (jfloat)stats->upload_bandwidth);
+		env->SetFloatField(statsobj, statsSenderLossRateFieldId, (jfloat)linphone_call_stats_get_sender_loss_rate(stats));
+		env->SetFloatField(statsobj, statsReceiverLossRateFieldId, (jfloat)linphone_call_stats_get_receiver_loss_rate(stats));
+		env->SetFloatField(statsobj, statsSenderInterarrivalJitterFieldId, (jfloat)linphone_call_stats_get_sender_interarrival_jitter(stats, call));
+		env->SetFloatField(statsobj, statsReceiverInterarrivalJitterFieldId, (jfloat)linphone_call_stats_get_receiver_interarrival_jitter(stats, call));
+		env->SetFloatField(statsobj, statsRoundTripDelayFieldId, (jfloat)stats->round_trip_delay);
+		env->SetLongField(statsobj, statsLatePacketsCumulativeNumberFieldId, (jlong)linphone_call_stats_get_late_packets_cumulative_number(stats, call));
+		env->SetFloatField(statsobj, statsJitterBufferSizeFieldId, (jfloat)stats->jitter_stats.jitter_buffer_size_ms);
+		env->SetLongField(statsobj, statsNativePtrFieldId, (jlong)stats);
+	}
 	static void callStatsUpdated(LinphoneCore *lc, LinphoneCall* call, const LinphoneCallStats *stats) {
-		JNIEnv *env = 0;
+		JNIEnv *env = ms_get_jni_env();
 		jobject statsobj;
 		jobject callobj;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
-		if (result != 0) {
+		jfieldID statsFieldId;
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
 		LinphoneCoreData* lcData = (LinphoneCoreData*)linphone_core_get_user_data(lc);
-		statsobj = env->NewObject(lcData->callStatsClass, lcData->callStatsId, (jlong)call, (jlong)stats);
 		callobj = lcData->getCall(env, call);
-		if (stats->type == LINPHONE_CALL_STATS_AUDIO)
-			env->CallVoidMethod(callobj, lcData->callSetAudioStatsId, statsobj);
-		else
-			env->CallVoidMethod(callobj, lcData->callSetVideoStatsId, statsobj);
+		statsFieldId = (stats->type == LINPHONE_CALL_STATS_AUDIO) ? lcData->callAudioStatsFieldId : lcData->callVideoStatsFieldId;
+		/*the java call keeps its stats object across reports, so that no object is allocated per RTCP packet*/
+		statsobj = env->GetObjectField(callobj, statsFieldId);
+		if (statsobj == NULL) {
+			statsobj = env->NewObject(lcData->callStatsClass, lcData->callStatsId);
+			env->SetObjectField(callobj, statsFieldId, statsobj);
+		}
+		lcData->fillCallStats(env, statsobj, call, stats);
 		env->CallVoidMethod(lcData->listener, lcData->callStatsUpdatedId, lcData->core, callobj, statsobj);
+		env->DeleteLocalRef(statsobj);
 	}
 	static void transferStateChanged(LinphoneCore *lc, LinphoneCall *call, LinphoneCallState remote_call_state){
-		JNIEnv *env = 0;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
+		JNIEnv *env = ms_get_jni_env();
 		jobject jcall;
-		if (result != 0) {
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -713,9 +831,8 @@ public:
 							);
 	}
 	static void infoReceived(LinphoneCore *lc, LinphoneCall*call, const LinphoneInfoMessage *info){
-		JNIEnv *env = 0;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
-		if (result != 0) {
+		JNIEnv *env = ms_get_jni_env();
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -739,11 +856,10 @@ public:
 		return jev;
 	}
 	static void subscriptionStateChanged(LinphoneCore *lc, LinphoneEvent *ev, LinphoneSubscriptionState state){
-		JNIEnv *env = 0;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
+		JNIEnv *env = ms_get_jni_env();
 		jobject jevent;
 		jobject jstate;
-		if (result != 0) {
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -763,11 +879,10 @@ public:
 		}
 	}
 	static void publishStateChanged(LinphoneCore *lc, LinphoneEvent *ev, LinphonePublishState state){
-		JNIEnv *env = 0;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
+		JNIEnv *env = ms_get_jni_env();
 		jobject jevent;
 		jobject jstate;
-		if (result != 0) {
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -782,10 +897,9 @@ public:
 							);
 	}
 	static void notifyReceived(LinphoneCore *lc, LinphoneEvent *ev, const char *evname, const LinphoneContent *content){
-		JNIEnv *env = 0;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
+		JNIEnv *env = ms_get_jni_env();
 		jobject jevent;
-		if (result != 0) {
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -801,9 +915,8 @@ public:
 	}
 
 	static void configuringStatus(LinphoneCore *lc, LinphoneConfiguringState status, const char *message) {
-		JNIEnv *env = 0;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
-		if (result != 0) {
+		JNIEnv *env = ms_get_jni_env();
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -812,11 +925,10 @@ public:
 	}
 
 	static void fileTransferProgressIndication(LinphoneCore *lc, LinphoneChatMessage *message, const LinphoneContent* content, size_t offset, size_t total) {
-		JNIEnv *env = 0;
+		JNIEnv *env = ms_get_jni_env();
 		jobject jmsg;
 		size_t progress = (offset * 100) / total;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
-		if (result != 0) {
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -830,11 +942,10 @@ public:
 	}
 
 	static void fileTransferSend(LinphoneCore *lc, LinphoneChatMessage *message, const LinphoneContent* content, char* buff, size_t* size) {
-		JNIEnv *env = 0;
+		JNIEnv *env = ms_get_jni_env();
 		jobject jmsg;
 		size_t asking = *size;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
-		if (result != 0) {
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -849,10 +960,9 @@ public:
 	}
 
 	static void fileTransferRecv(LinphoneCore *lc, LinphoneChatMessage *message, const LinphoneContent* content, const char* buff, size_t size) {
-		JNIEnv *env = 0;
+		JNIEnv *env = ms_get_jni_env();
 		jobject jmsg;
-		jint result = jvm->AttachCurrentThread(&env,NULL);
-		if (result != 0) {
+		if (env == NULL) {
 			ms_error("cannot attach VM");
 			return;
 		}
@@ -1010,8 +1120,7 @@ extern "C" jobject Java_org_linphone_core_LinphoneCoreImpl_getDefaultProxyConfig
 extern "C" jobjectArray Java_org_linphone_core_LinphoneCoreImpl_getProxyConfigList(JNIEnv* env, jobject thiz, jlong lc) {
 	const MSList* proxies = linphone_core_get_proxy_config_list((LinphoneCore*)lc);
 	int proxyCount = ms_list_size(proxies);
-	jclass cls = (jclass)env->NewGlobalRef(env->FindClass("org/linphone/core/LinphoneProxyConfigImpl"));
-	jobjectArray jProxies = env->NewObjectArray(proxyCount,cls,NULL);
+	jobjectArray jProxies = env->NewObjectArray(proxyCount,proxy_config_class,NULL);
 	LinphoneCoreData* lcData = (LinphoneCoreData*)linphone_core_get_user_data((LinphoneCore*)lc);
 
 	for (int i = 0; i < proxyCount; i++ ) {
@@ -1022,7 +1131,6 @@ extern "C" jobjectArray Java_org_linphone_core_LinphoneCoreImpl_getProxyConfigLi
 		}
 		proxies = proxies->next;
 	}
-	env->DeleteGlobalRef(cls);
 	return jProxies;
 }
 
@@ -1503,7 +1611,7 @@ JNIEXPORT jobject JNICALL Java_org_linphone_core_LinphoneCoreImpl_getPresenceMod
 	LinphoneCore *lc = (LinphoneCore *)ptr;
 	LinphonePresenceModel *model = linphone_core_get_presence_model(lc);
 	if (model == NULL) return NULL;
-	RETURN_USER_DATA_OBJECT("PresenceModelImpl", linphone_presence_model, model)
+	RETURN_USER_DATA_OBJECT(presence_model, linphone_presence_model, model)
 }
 
 extern "C" jlong Java_org_linphone_core_LinphoneCoreImpl_getOrCreateChatRoom(JNIEnv*  env
@@ -2522,7 +2630,7 @@ JNIEXPORT jobject JNICALL Java_org_linphone_core_LinphoneFriendImpl_getPresenceM
 	LinphoneFriend *lf = (LinphoneFriend *)ptr;
 	LinphonePresenceModel *model = (LinphonePresenceModel *)linphone_friend_get_presence_model(lf);
 	if (model == NULL) return NULL;
-	RETURN_USER_DATA_OBJECT("PresenceModelImpl", linphone_presence_model, model);
+	RETURN_USER_DATA_OBJECT(presence_model, linphone_presence_model, model);
 }
 
 extern "C" void Java_org_linphone_core_LinphoneFriendImpl_edit(JNIEnv*  env
@@ -2860,22 +2968,19 @@ extern "C" void Java_org_linphone_core_LinphoneChatRoomImpl_sendMessage(JNIEnv*
 }
 
 static void chat_room_impl_callback(LinphoneChatMessage* msg, LinphoneChatMessageState state, void* ud) {
-	JNIEnv *env = 0;
-	jint result = jvm->AttachCurrentThread(&env,NULL);
-	if (result != 0) {
+	JNIEnv *env = ms_get_jni_env();
+	if (env == NULL) {
 		ms_error("cannot attach VM\n");
 		return;
 	}
 
 	jobject listener = (jobject) ud;
-	jclass clazz = (jclass) env->GetObjectClass(listener);
-	jmethodID method = env->GetMethodID(clazz, "onLinphoneChatMessageStateChanged","(Lorg/linphone/core/LinphoneChatMessage;Lorg/linphone/core/LinphoneChatMessage$State;)V");
 	jobject jmessage=(jobject)linphone_chat_message_get_user_data(msg);
 	LinphoneCore *lc = linphone_chat_room_get_lc(linphone_chat_message_get_chat_room(msg));
 	LinphoneCoreData* lcData = (LinphoneCoreData*)linphone_core_get_user_data(lc);
 	env->CallVoidMethod(
 			listener,
-			method,
+			chat_message_state_changed_id,
 			jmessage,
 			env->CallStaticObjectMethod(lcData->chatMessageStateClass,lcData->chatMessageStateFromIntId,(jint)state));
 
@@ -3474,7 +3579,7 @@ extern "C" jobjectArray Java_org_linphone_core_LinphoneCoreImpl_listSupportedVid
 	}
 	count = i;
 
-	jobjectArray resolutions = (jobjectArray) env->NewObjectArray(count, env->FindClass("java/lang/String"), env->NewStringUTF(""));
+	jobjectArray resolutions = (jobjectArray) env->NewObjectArray(count, string_class, env->NewStringUTF(""));
 	pdef = linphone_core_get_supported_video_sizes((LinphoneCore *)lc);
 	i = 0;
 	for (; pdef->name!=NULL; pdef++) {
@@ -3547,21 +3652,16 @@ extern "C" void Java_org_linphone_core_LinphoneCoreImpl_tunnelAddServerAndMirror
 extern "C" void Java_org_linphone_core_LinphoneCoreImpl_tunnelAddServer(JNIEnv *env, jobject thiz, jlong pCore, jobject config) {
 	LinphoneTunnel *tunnel = linphone_core_get_tunnel((LinphoneCore *)pCore);
 	if(tunnel != NULL) {
-		jclass TunnelConfigClass = env->FindClass("org/linphone/core/TunnelConfig");
-		jmethodID getHostMethod = env->GetMethodID(TunnelConfigClass, "getHost", "()Ljava/lang/String;");
-		jmethodID getPortMethod = env->GetMethodID(TunnelConfigClass, "getPort", "()I");
-		jmethodID getRemoteUdpMirrorPortMethod = env->GetMethodID(TunnelConfigClass, "getRemoteUdpMirrorPort", "()I");
-		jmethodID getDelayMethod = env->GetMethodID(TunnelConfigClass, "getDelay", "()I");
-		jstring hostString = (jstring)env->CallObjectMethod(config, getHostMethod);
+		jstring hostString = (jstring)env->CallObjectMethod(config, tunnel_config_get_host_id);
 		const char *host = env->GetStringUTFChars(hostString, NULL);
 		if(host == NULL || strlen(host)==0) {
 			ms_error("LinphoneCore.tunnelAddServer(): no tunnel host defined");
 		}
 		LinphoneTunnelConfig *tunnelConfig = linphone_tunnel_config_new();
 		linphone_tunnel_config_set_host(tunnelConfig, host);
-		linphone_tunnel_config_set_port(tunnelConfig, env->CallIntMethod(config, getPortMethod));
-		linphone_tunnel_config_set_remote_udp_mirror_port(tunnelConfig, env->CallIntMethod(config, getRemoteUdpMirrorPortMethod));
-		linphone_tunnel_config_set_delay(tunnelConfig, env->CallIntMethod(config, getDelayMethod));
+		linphone_tunnel_config_set_port(tunnelConfig, env->CallIntMethod(config, tunnel_config_get_port_id));
+		linphone_tunnel_config_set_remote_udp_mirror_port(tunnelConfig, env->CallIntMethod(config, tunnel_config_get_remote_udp_mirror_port_id));
+		linphone_tunnel_config_set_delay(tunnelConfig, env->CallIntMethod(config, tunnel_config_get_delay_id));
 		linphone_tunnel_add_server(tunnel, tunnelConfig);
 		env->ReleaseStringUTFChars(hostString, host);
 	} else {
@@ -3571,11 +3671,6 @@ extern "C" void Java_org_linphone_core_LinphoneCoreImpl_tunnelAddServer(JNIEnv *
 
 extern "C" jobjectArray Java_org_linphone_core_LinphoneCoreImpl_tunnelGetServers(JNIEnv *env, jobject thiz, jlong pCore) {
 	LinphoneTunnel *tunnel = linphone_core_get_tunnel((LinphoneCore *)pCore);
-	jclass TunnelConfigClass = env->FindClass("org/linphone/core/TunnelConfig");
-	jmethodID setHostMethod = env->GetMethodID(TunnelConfigClass, "setHost", "(Ljava/lang/String;)V");
-	jmethodID setPortMethod = env->GetMethodID(TunnelConfigClass, "setPort", "(I)V");
-	jmethodID setRemoteUdpMirrorPortMethod = env->GetMethodID(TunnelConfigClass, "setRemoteUdpMirrorPort", "(I)V");
-	jmethodID setDelayMethod = env->GetMethodID(TunnelConfigClass, "setDelay", "(I)V");
 	jobjectArray tunnelConfigArray = NULL;
 
 	if(tunnel != NULL) {
@@ -3584,14 +3679,14 @@ extern "C" jobjectArray Java_org_linphone_core_LinphoneCoreImpl_tunnelGetServers
 		int i;
 		ms_message("servers=%p", (void *)servers);
 		ms_message("taille=%i", ms_list_size(servers));
-		tunnelConfigArray = env->NewObjectArray(ms_list_size(servers), TunnelConfigClass, NULL);
+		tunnelConfigArray = env->NewObjectArray(ms_list_size(servers), tunnel_config_class, NULL);
 		for(it = servers, i=0; it != NULL; it = it->next, i++) {
 			const LinphoneTunnelConfig *conf = (const LinphoneTunnelConfig *)it->data;
-			jobject elt = env->AllocObject(TunnelConfigClass);
-			env->CallVoidMethod(elt, setHostMethod, env->NewStringUTF(linphone_tunnel_config_get_host(conf)));
-			env->CallVoidMethod(elt, setPortMethod, linphone_tunnel_config_get_port(conf));
-			env->CallVoidMethod(elt, setRemoteUdpMirrorPortMethod, linphone_tunnel_config_get_remote_udp_mirror_port(conf));
-			env->CallVoidMethod(elt, setDelayMethod, linphone_tunnel_config_get_delay(conf));
+			jobject elt = env->AllocObject(tunnel_config_class);
+			env->CallVoidMethod(elt, tunnel_config_set_host_id, env->NewStringUTF(linphone_tunnel_config_get_host(conf)));
+			env->CallVoidMethod(elt, tunnel_config_set_port_id, linphone_tunnel_config_get_port(conf));
+			env->CallVoidMethod(elt, tunnel_config_set_remote_udp_mirror_port_id, linphone_tunnel_config_get_remote_udp_mirror_port(conf));
+			env->CallVoidMethod(elt, tunnel_config_set_delay_id, linphone_tunnel_config_get_delay(conf));
 			env->SetObjectArrayElement(tunnelConfigArray, i, elt);
 		}
 	}
@@ -3754,6 +3849,10 @@ extern "C" void Java_org_linphone_core_LinphoneCoreImpl_setInCallTimeout(JNIEnv
 	linphone_core_set_in_call_timeout((LinphoneCore *)lc, timeout);
 }
 
+extern "C" void Java_org_linphone_core_LinphoneCoreImpl_setCallStatsNotificationInterval(JNIEnv *env, jobject thiz, jlong lc, jint interval) {
+	linphone_core_set_call_stats_notification_interval((LinphoneCore *)lc, interval);
+}
+
 extern "C" jstring Java_org_linphone_core_LinphoneCoreImpl_getVersion(JNIEnv*  env,jobject  thiz,jlong ptr) {
 	jstring jvalue =env->NewStringUTF(linphone_core_get_version());
 	return jvalue;
@@ -3978,15 +4077,10 @@ extern "C" jintArray Java_org_linphone_core_LpConfigImpl_getIntRange(JNIEnv *env
 }
 
 static jobject create_java_linphone_content(JNIEnv *env, const LinphoneContent *content){
-	jclass contentClass;
-	jmethodID ctor;
 	jstring jtype, jsubtype, jencoding, jname;
 	jbyteArray jdata = NULL;
 	jint jsize = 0;
 
-	contentClass = (jclass)env->NewGlobalRef(env->FindClass("org/linphone/core/LinphoneContentImpl"));
-	ctor = env->GetMethodID(contentClass,"<init>", "(Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;[BLjava/lang/String;I)V");
-
 	jtype = env->NewStringUTF(content->type);
 	jsubtype = env->NewStringUTF(content->subtype);
 	jencoding = content->encoding ? env->NewStringUTF(content->encoding) : NULL;
@@ -3998,9 +4092,7 @@ static jobject create_java_linphone_content(JNIEnv *env, const LinphoneContent *
 		env->SetByteArrayRegion(jdata, 0, content->size, (jbyte*)content->data);
 	}
 
-	jobject jobj = env->NewObject(contentClass, ctor, jname, jtype, jsubtype, jdata, jencoding, jsize);
-	env->DeleteGlobalRef(contentClass);
-	return jobj;
+	return env->NewObject(content_class, content_ctor_id, jname, jtype, jsubtype, jdata, jencoding, jsize);
 }
 
 /*
@@ -4470,7 +4562,7 @@ JNIEXPORT jobject JNICALL Java_org_linphone_core_PresenceModelImpl_getActivity(J
 	LinphonePresenceModel *model = (LinphonePresenceModel *)ptr;
 	LinphonePresenceActivity *activity = linphone_presence_model_get_activity(model);
 	if (activity == NULL) return NULL;
-	RETURN_USER_DATA_OBJECT("PresenceActivityImpl", linphone_presence_activity, activity)
+	RETURN_USER_DATA_OBJECT(presence_activity, linphone_presence_activity, activity)
 }
 
 /*
@@ -4505,7 +4597,7 @@ JNIEXPORT jobject JNICALL Java_org_linphone_core_PresenceModelImpl_getNthActivit
 	LinphonePresenceModel *model = (LinphonePresenceModel *)ptr;
 	LinphonePresenceActivity *activity = linphone_presence_model_get_nth_activity(model, (unsigned int)idx);
 	if (activity == NULL) return NULL;
-	RETURN_USER_DATA_OBJECT("PresenceActivityImpl", linphone_presence_activity, activity)
+	RETURN_USER_DATA_OBJECT(presence_activity, linphone_presence_activity, activity)
 }
 
 /*
@@ -4538,7 +4630,7 @@ JNIEXPORT jobject JNICALL Java_org_linphone_core_PresenceModelImpl_getNote(JNIEn
 	LinphonePresenceNote *note = linphone_presence_model_get_note(model, clang);
 	if (clang) env->ReleaseStringUTFChars(lang, clang);
 	if (note == NULL) return NULL;
-	RETURN_USER_DATA_OBJECT("PresenceNoteImpl", linphone_presence_note, note)
+	RETURN_USER_DATA_OBJECT(presence_note, linphone_presence_note, note)
 }
 
 /*
@@ -4585,7 +4677,7 @@ JNIEXPORT jobject JNICALL Java_org_linphone_core_PresenceModelImpl_getNthService
 	LinphonePresenceModel *model = (LinphonePresenceModel *)ptr;
 	LinphonePresenceService *service = linphone_presence_model_get_nth_service(model, (unsigned int)idx);
 	if (service == NULL) return NULL;
-	RETURN_USER_DATA_OBJECT("PresenceServiceImpl", linphone_presence_service, service)
+	RETURN_USER_DATA_OBJECT(presence_service, linphone_presence_service, service)
 }
 
 /*
@@ -4626,7 +4718,7 @@ JNIEXPORT jobject JNICALL Java_org_linphone_core_PresenceModelImpl_getNthPerson(
 	LinphonePresenceModel *model = (LinphonePresenceModel *)ptr;
 	LinphonePresencePerson *person = linphone_presence_model_get_nth_person(model, (unsigned int)idx);
 	if (person == NULL) return NULL;
-	RETURN_USER_DATA_OBJECT("PresencePersonImpl", linphone_presence_person, person)
+	RETURN_USER_DATA_OBJECT(presence_person, linphone_presence_person, person)
 }
 
 /*
@@ -4846,7 +4938,7 @@ JNIEXPORT jobject JNICALL Java_org_linphone_core_PresenceServiceImpl_getNthNote(
 	LinphonePresenceService *service = (LinphonePresenceService *)ptr;
 	LinphonePresenceNote *note = linphone_presence_service_get_nth_note(service, (unsigned int)idx);
 	if (note == NULL) return NULL;
-	RETURN_USER_DATA_OBJECT("PresenceNoteImpl", linphone_presence_note, note)
+	RETURN_USER_DATA_OBJECT(presence_note, linphone_presence_note, note)
 }
 
 /*
@@ -4937,7 +5029,7 @@ JNIEXPORT jobject JNICALL Java_org_linphone_core_PresencePersonImpl_getNthActivi
 	LinphonePresencePerson *person = (LinphonePresencePerson *)ptr;
 	LinphonePresenceActivity *activity = linphone_presence_person_get_nth_activity(person, (unsigned int)idx);
 	if (activity == NULL) return NULL;
-	RETURN_USER_DATA_OBJECT("PresenceActivityImpl", linphone_presence_activity, activity)
+	RETURN_USER_DATA_OBJECT(presence_activity, linphone_presence_activity, activity)
 }
 
 /*
@@ -4978,7 +5070,7 @@ JNIEXPORT jobject JNICALL Java_org_linphone_core_PresencePersonImpl_getNthNote(J
 	LinphonePresencePerson *person = (LinphonePresencePerson *)ptr;
 	LinphonePresenceNote *note = linphone_presence_person_get_nth_note(person, (unsigned int)idx);
 	if (note == NULL) return NULL;
-	RETURN_USER_DATA_OBJECT("PresenceNoteImpl", linphone_presence_note, note)
+	RETURN_USER_DATA_OBJECT(presence_note, linphone_presence_note, note)
 }
 
 /*
@@ -5019,7 +5111,7 @@ JNIEXPORT jobject JNICALL Java_org_linphone_core_PresencePersonImpl_getNthActivi
 	LinphonePresencePerson *person = (LinphonePresencePerson *)ptr;
 	LinphonePresenceNote *note = linphone_presence_person_get_nth_activities_note(person, (unsigned int)idx);
 	if (note == NULL) return NULL;
-	RETURN_USER_DATA_OBJECT("PresenceNoteImpl", linphone_presence_note, note)
+	RETURN_USER_DATA_OBJECT(presence_note, linphone_presence_note, note)
 }
 
 /*
@@ -5236,8 +5328,7 @@ struct LinphonePlayerData {
 	}
 
 	~LinphonePlayerData() {
-		JNIEnv *env;
-		jvm->AttachCurrentThread(&env, NULL);
+		JNIEnv *env = ms_get_jni_env();
 		env->DeleteGlobalRef(mListener);
 		env->DeleteGlobalRef(mListenerClass);
 		env->DeleteGlobalRef(mJLinphonePlayer);
@@ -5250,9 +5341,12 @@ struct LinphonePlayerData {
 };
 
 static void _eof_callback(LinphonePlayer *player, void *user_data) {
-	JNIEnv *env;
+	JNIEnv *env = ms_get_jni_env();
 	LinphonePlayerData *player_data = (LinphonePlayerData *)user_data;
-	jvm->AttachCurrentThread(&env, NULL);
+	if (env == NULL) {
+		ms_error("cannot attach VM");
+		return;
+	}
 	env->CallVoidMethod(player_data->mListener, player_data->mEndOfFileMethodID, player_data->mJLinphonePlayer);
 }
 
@@ -363,6 +363,8 @@ LINPHONE_PUBLIC	const MSList * linphone_core_get_friend_list(const LinphoneCore
 
 /**
  * Notify all friends that have subscribed
+ * The presence document is rendered once for all the friends. The notifications are sent by batches of
+ * sip/presence_notify_batch_size (50 by default, 0 for no limit) from linphone_core_iterate().
  * @param lc #LinphoneCore object
  * @param presence #LinphonePresenceModel to notify
  */
@@ -393,6 +395,22 @@ LINPHONE_PUBLIC LinphoneFriend *linphone_core_find_friend(const LinphoneCore *lc
  */
 LINPHONE_PUBLIC LinphoneFriend *linphone_core_get_friend_by_ref_key(const LinphoneCore *lc, const char *key);
 
+/**
+ * Sets the URI of a resource list served by a presence server (RFC 4662).
+ * When set, a single subscription to this list gives the presence of all the friends, instead of one subscription
+ * per friend. If the server rejects it, the friends are subscribed individually.
+ * @param[in] lc #LinphoneCore object.
+ * @param[in] uri The URI of the resource list, or NULL to subscribe to the friends individually.
+ */
+LINPHONE_PUBLIC void linphone_core_set_presence_list_uri(LinphoneCore *lc, const char *uri);
+
+/**
+ * Gets the URI of the resource list used to subscribe to the presence of the friends.
+ * @param[in] lc #LinphoneCore object.
+ * @returns The URI of the resource list, or NULL if the friends are subscribed individually.
+ */
+LINPHONE_PUBLIC const char *linphone_core_get_presence_list_uri(const LinphoneCore *lc);
+
 
 /**
  * Returns the LinphoneCore object managing this friend, if any.
@@ -24,7 +24,7 @@
 
 #define MAX_LEN 16384
 
-#include "linphonecore.h"
+#include "private.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -55,11 +55,17 @@
 
 #define lp_new0(type,n)	(type*)calloc(sizeof(type),n)
 
+/*the background writer waits at most this many times the sync delay before writing a file that keeps being modified*/
+#define LP_CONFIG_MAX_DELAY_FACTOR 10
+/*in milliseconds*/
+#define LP_CONFIG_WRITER_POLL_INTERVAL 20
+
 #include "lpconfig.h"
 
 
+/*section names and item keys are interned in the config: they are shared by all items with the same key, and only freed with the config*/
 typedef struct _LpItem{
-	char *key;
+	const char *key;
 	char *value;
 	int is_comment;
 } LpItem;
@@ -70,24 +76,84 @@ typedef struct _LpSectionParam{
 } LpSectionParam;
 
 typedef struct _LpSection{
-	char *name;
-	MSList *items;
+	const char *name;
+	MSList *items; /*in file order*/
+	LinphoneHashTable *items_by_key; /*index of items, comments excepted*/
 	MSList *params;
+	char *text; /*serialized section, as written in the last sync*/
+	size_t text_len;
+	int dirty; /*modified since text was computed*/
 } LpSection;
 
+typedef struct _LpConfigWriter{
+	ortp_thread_t thread;
+	ortp_mutex_t mutex;
+	ortp_cond_t cond;
+	char *pending; /*content to write, replaced by newer ones until it is written*/
+	size_t pending_len;
+	uint64_t first_push_time;
+	uint64_t last_push_time;
+	int delay_ms;
+	bool_t running;
+} LpConfigWriter;
+
 struct _LpConfig{
 	int refcnt;
 	FILE *file;
 	char *filename;
 	char *tmpfilename;
-	MSList *sections;
+	MSList *sections; /*in file order*/
+	LinphoneHashTable *sections_by_name;
+	LinphoneHashTable *strings; /*interned section names and keys*/
+	char *content; /*content of the file as of the last sync*/
+	size_t content_len;
+	LpConfigWriter *writer; /*NULL unless background sync is enabled*/
+	LpConfigSyncStats sync_stats; /*protected by the writer mutex when there is a writer*/
 	int modified;
-	int readonly;
+	int readonly; /*protected by the writer mutex when there is a writer*/
 };
 
+typedef struct _LpBuffer{
+	char *data;
+	size_t len;
+	size_t size;
+} LpBuffer;
+
+static void lp_buffer_append(LpBuffer *buf, const char *str, size_t len){
+	if (buf->len+len+1>buf->size){
+		size_t size=buf->size ? buf->size*2 : 256;
+		while (size<buf->len+len+1) size*=2;
+		buf->data=ms_realloc(buf->data,size);
+		buf->size=size;
+	}
+	memcpy(buf->data+buf->len,str,len);
+	buf->len+=len;
+	buf->data[buf->len]='\0';
+}
+
+static void lp_buffer_append_string(LpBuffer *buf, const char *str){
+	lp_buffer_append(buf,str,strlen(str));
+}
+
+static const char *lp_config_intern(LpConfig *lpconfig, const char *str){
+	char *interned;
+	if (lpconfig->strings==NULL) lpconfig->strings=linphone_hash_table_new_for_strings_nocopy();
+	interned=(char*)linphone_hash_table_lookup(lpconfig->strings,str);
+	if (interned==NULL){
+		interned=ortp_strdup(str);
+		linphone_hash_table_insert(lpconfig->strings,interned,interned);
+	}
+	return interned;
+}
+
+static void lp_config_free_interned(const void *key, void *value, void *user_data){
+	ortp_free(value);
+}
+
+/*key must be interned*/
 LpItem * lp_item_new(const char *key, const char *value){
 	LpItem *item=lp_new0(LpItem,1);
-	item->key=ortp_strdup(key);
+	item->key=key;
 	item->value=ortp_strdup(value);
 	return item;
 }
@@ -106,15 +172,15 @@ LpSectionParam *lp_section_param_new(const char *key, const char *value){
 	return param;
 }
 
+/*name must be interned*/
 LpSection *lp_section_new(const char *name){
 	LpSection *sec=lp_new0(LpSection,1);
-	sec->name=ortp_strdup(name);
+	sec->name=name;
 	return sec;
 }
 
 void lp_item_destroy(void *pitem){
 	LpItem *item=(LpItem*)pitem;
-	if (item->key) ortp_free(item->key);
 	ortp_free(item->value);
 	free(item);
 }
@@ -127,7 +193,8 @@ void lp_section_param_destroy(void *section_param){
 }
 
 void lp_section_destroy(LpSection *sec){
-	ortp_free(sec->name);
+	if (sec->items_by_key) linphone_hash_table_destroy(sec->items_by_key);
+	if (sec->text) ms_free(sec->text);
 	ms_list_for_each(sec->items,lp_item_destroy);
 	ms_list_for_each(sec->params,lp_section_param_destroy);
 	ms_list_free(sec->items);
@@ -136,17 +203,26 @@ void lp_section_destroy(LpSection *sec){
 
 void lp_section_add_item(LpSection *sec,LpItem *item){
 	sec->items=ms_list_append(sec->items,(void *)item);
+	if (!item->is_comment){
+		if (sec->items_by_key==NULL) sec->items_by_key=linphone_hash_table_new_for_strings_nocopy();
+		linphone_hash_table_insert(sec->items_by_key,item->key,item);
+	}
+	sec->dirty=TRUE;
 }
 
 void lp_config_add_section(LpConfig *lpconfig, LpSection *section){
 	lpconfig->sections=ms_list_append(lpconfig->sections,(void *)section);
+	if (lpconfig->sections_by_name==NULL) lpconfig->sections_by_name=linphone_hash_table_new_for_strings_nocopy();
+	linphone_hash_table_insert(lpconfig->sections_by_name,section->name,section);
 }
 
 void lp_config_add_section_param(LpSection *section, LpSectionParam *param){
 	section->params = ms_list_append(section->params, (void *)param);
+	section->dirty = TRUE;
 }
 
 void lp_config_remove_section(LpConfig *lpconfig, LpSection *section){
+	linphone_hash_table_remove(lpconfig->sections_by_name,section->name);
 	lpconfig->sections=ms_list_remove(lpconfig->sections,(void *)section);
 	lp_section_destroy(section);
 }
@@ -168,17 +244,7 @@ static int is_a_comment(const char *str){
 }
 
 LpSection *lp_config_find_section(const LpConfig *lpconfig, const char *name){
-	LpSection *sec;
-	MSList *elem;
-	/*printf("Looking for section %s\n",name);*/
-	for (elem=lpconfig->sections;elem!=NULL;elem=ms_list_next(elem)){
-		sec=(LpSection*)elem->data;
-		if (strcmp(sec->name,name)==0){
-			/*printf("Section %s found\n",name);*/
-			return sec;
-		}
-	}
-	return NULL;
+	return (LpSection*)linphone_hash_table_lookup(lpconfig->sections_by_name,name);
 }
 
 LpSectionParam *lp_section_find_param(const LpSection *sec, const char *key){
@@ -194,17 +260,7 @@ LpSectionParam *lp_section_find_param(const LpSection *sec, const char *key){
 }
 
 LpItem *lp_section_find_item(const LpSection *sec, const char *name){
-	MSList *elem;
-	LpItem *item;
-	/*printf("Looking for item %s\n",name);*/
-	for (elem=sec->items;elem!=NULL;elem=ms_list_next(elem)){
-		item=(LpItem*)elem->data;
-		if (!item->is_comment && strcmp(item->key,name)==0) {
-			/*printf("Item %s found\n",name);*/
-			return item;
-		}
-	}
-	return NULL;
+	return (LpItem*)linphone_hash_table_lookup(sec->items_by_key,name);
 }
 
 static LpSection* lp_config_parse_line(LpConfig* lpconfig, const char* line, LpSection* cur) {
@@ -229,7 +285,7 @@ static LpSection* lp_config_parse_line(LpConfig* lpconfig, const char* line, LpS
 				if (strlen(secname) > 0) {
 					cur = lp_config_find_section (lpconfig,secname);
 					if (cur == NULL) {
-						cur = lp_section_new(secname);
+						cur = lp_section_new(lp_config_intern(lpconfig,secname));
 						lp_config_add_section(lpconfig, cur);
 					}
 
@@ -290,10 +346,11 @@ static LpSection* lp_config_parse_line(LpConfig* lpconfig, const char* line, LpS
 						if (cur!=NULL){
 							item=lp_section_find_item(cur,key);
 							if (item==NULL){
-								lp_section_add_item(cur,lp_item_new(key,pos1));
+								lp_section_add_item(cur,lp_item_new(lp_config_intern(lpconfig,key),pos1));
 							}else{
 								ortp_free(item->value);
 								item->value=ortp_strdup(pos1);
+								cur->dirty=TRUE;
 							}
 							/*ms_message("Found %s=%s",key,pos1);*/
 						}else{
@@ -322,6 +379,8 @@ void lp_config_parse(LpConfig *lpconfig, FILE *file){
 	}
 }
 
+static void lp_config_update_content(LpConfig *lpconfig);
+
 LpConfig * lp_config_new(const char *filename){
 	return lp_config_new_with_factory(filename, NULL);
 }
@@ -382,6 +441,8 @@ LpConfig *lp_config_new_with_factory(const char *config_filename, const char *fa
 
 			lpconfig->file=NULL;
 			lpconfig->modified=0;
+			/*the file already holds what was just read: a sync without any change must not rewrite it*/
+			lp_config_update_content(lpconfig);
 		}
 	}
 	if (factory_config_filename != NULL) {
@@ -410,10 +471,18 @@ void lp_item_set_value(LpItem *item, const char *value){
 
 
 static void _lp_config_destroy(LpConfig *lpconfig){
+	/*writes the pending content, if any*/
+	lp_config_enable_background_sync(lpconfig,FALSE,0);
+	if (lpconfig->content!=NULL) ms_free(lpconfig->content);
 	if (lpconfig->filename!=NULL) ortp_free(lpconfig->filename);
 	if (lpconfig->tmpfilename) ortp_free(lpconfig->tmpfilename);
 	ms_list_for_each(lpconfig->sections,(void (*)(void*))lp_section_destroy);
 	ms_list_free(lpconfig->sections);
+	if (lpconfig->sections_by_name) linphone_hash_table_destroy(lpconfig->sections_by_name);
+	if (lpconfig->strings){
+		linphone_hash_table_for_each(lpconfig->strings,lp_config_free_interned,NULL);
+		linphone_hash_table_destroy(lpconfig->strings);
+	}
 	free(lpconfig);
 }
 
@@ -433,8 +502,10 @@ void lp_config_destroy(LpConfig *lpconfig){
 }
 
 void lp_section_remove_item(LpSection *sec, LpItem *item){
+	if (!item->is_comment) linphone_hash_table_remove(sec->items_by_key,item->key);
 	sec->items=ms_list_remove(sec->items,(void *)item);
 	lp_item_destroy(item);
+	sec->dirty=TRUE;
 }
 
 const char *lp_config_get_section_param_string(const LpConfig *lpconfig, const char *section, const char *key, const char *default_value){
@@ -519,18 +590,22 @@ void lp_config_set_string(LpConfig *lpconfig,const char *section, const char *ke
 	if (sec!=NULL){
 		item=lp_section_find_item(sec,key);
 		if (item!=NULL){
-			if (value!=NULL && value[0] != '\0')
+			if (value!=NULL && value[0] != '\0'){
+				/*setting the same value again does not require to write the file*/
+				if (strcmp(item->value,value)==0) return;
 				lp_item_set_value(item,value);
-			else lp_section_remove_item(sec,item);
+				sec->dirty=TRUE;
+			}else lp_section_remove_item(sec,item);
 		}else{
 			if (value!=NULL && value[0] != '\0')
-				lp_section_add_item(sec,lp_item_new(key,value));
+				lp_section_add_item(sec,lp_item_new(lp_config_intern(lpconfig,key),value));
+			else return;
 		}
 	}else if (value!=NULL && value[0] != '\0'){
-		sec=lp_section_new(section);
+		sec=lp_section_new(lp_config_intern(lpconfig,section));
 		lp_config_add_section(lpconfig,sec);
-		lp_section_add_item(sec,lp_item_new(key,value));
-	}
+		lp_section_add_item(sec,lp_item_new(lp_config_intern(lpconfig,key),value));
+	}else return;
 	lpconfig->modified++;
 }
 
@@ -565,62 +640,233 @@ void lp_config_set_float(LpConfig *lpconfig,const char *section, const char *key
 	lp_config_set_string(lpconfig,section,key,tmp);
 }
 
-void lp_item_write(LpItem *item, FILE *file){
+static void lp_item_write(LpItem *item, LpBuffer *buf){
 	if (item->is_comment)
-		fprintf(file,"%s",item->value);
-	else if (item->value && item->value[0] != '\0' )
-		fprintf(file,"%s=%s\n",item->key,item->value);
-	else {
+		lp_buffer_append_string(buf,item->value);
+	else if (item->value && item->value[0] != '\0' ){
+		lp_buffer_append_string(buf,item->key);
+		lp_buffer_append(buf,"=",1);
+		lp_buffer_append_string(buf,item->value);
+		lp_buffer_append(buf,"\n",1);
+	}else {
 		ms_warning("Not writing item %s to file, it is empty", item->key);
 	}
 }
 
-void lp_section_param_write(LpSectionParam *param, FILE *file){
+static void lp_section_param_write(LpSectionParam *param, LpBuffer *buf){
 	if( param->value && param->value[0] != '\0') {
-		fprintf(file, " %s=%s", param->key, param->value);
+		lp_buffer_append(buf," ",1);
+		lp_buffer_append_string(buf,param->key);
+		lp_buffer_append(buf,"=",1);
+		lp_buffer_append_string(buf,param->value);
 	} else {
 		ms_warning("Not writing param %s to file, it is empty", param->key);
 	}
 }
 
-void lp_section_write(LpSection *sec, FILE *file){
-	fprintf(file, "[%s",sec->name);
-	ms_list_for_each2(sec->params, (void (*)(void*, void*))lp_section_param_write, (void *)file);
-	fprintf(file, "]\n");
-	ms_list_for_each2(sec->items, (void (*)(void*, void*))lp_item_write, (void *)file);
-	fprintf(file, "\n");
+/*serializes the section again if it was modified since the last sync*/
+static void lp_section_update_text(LpSection *sec){
+	LpBuffer buf={0};
+	if (sec->text!=NULL && !sec->dirty) return;
+	lp_buffer_append(&buf,"[",1);
+	lp_buffer_append_string(&buf,sec->name);
+	ms_list_for_each2(sec->params, (void (*)(void*, void*))lp_section_param_write, (void *)&buf);
+	lp_buffer_append(&buf,"]\n",2);
+	ms_list_for_each2(sec->items, (void (*)(void*, void*))lp_item_write, (void *)&buf);
+	lp_buffer_append(&buf,"\n",1);
+	if (sec->text) ms_free(sec->text);
+	sec->text=buf.data;
+	sec->text_len=buf.len;
+	sec->dirty=FALSE;
 }
 
-int lp_config_sync(LpConfig *lpconfig){
+static int lp_config_write_file(const char *filename, const char *tmpfilename, const char *content, size_t len){
 	FILE *file;
-	if (lpconfig->filename==NULL) return -1;
-	if (lpconfig->readonly) return 0;
+	size_t written;
 #ifndef WIN32
 	/* don't create group/world-accessible files */
 	(void) umask(S_IRWXG | S_IRWXO);
 #endif
-	file=fopen(lpconfig->tmpfilename,"w");
+	file=fopen(tmpfilename,"w");
 	if (file==NULL){
-		ms_warning("Could not write %s ! Maybe it is read-only. Configuration will not be saved.",lpconfig->filename);
-		lpconfig->readonly=1;
+		ms_warning("Could not write %s ! Maybe it is read-only. Configuration will not be saved.",filename);
 		return -1;
 	}
-	ms_list_for_each2(lpconfig->sections,(void (*)(void *,void*))lp_section_write,(void *)file);
+	written=fwrite(content,1,len,file);
 	fclose(file);
+	if (written!=len){
+		ms_error("Could not write %s: %s",tmpfilename,strerror(errno));
+		return -1;
+	}
 #ifdef RENAME_REQUIRES_NONEXISTENT_NEW_PATH
 	/* On windows, rename() does not accept that the newpath is an existing file, while it is accepted on Unix.
 	 * As a result, we are forced to first delete the linphonerc file, and then rename.*/
-	if (remove(lpconfig->filename)!=0){
-		ms_error("Cannot remove %s: %s",lpconfig->filename, strerror(errno));
+	if (remove(filename)!=0){
+		ms_error("Cannot remove %s: %s",filename, strerror(errno));
 	}
 #endif
-	if (rename(lpconfig->tmpfilename,lpconfig->filename)!=0){
-		ms_error("Cannot rename %s into %s: %s",lpconfig->tmpfilename,lpconfig->filename,strerror(errno));
+	if (rename(tmpfilename,filename)!=0){
+		ms_error("Cannot rename %s into %s: %s",tmpfilename,filename,strerror(errno));
 	}
-	lpconfig->modified=0;
+	ms_message("Config file %s written (%i bytes).",filename,(int)len);
 	return 0;
 }
 
+static void lp_config_account_write(LpConfig *lpconfig, size_t len){
+	lpconfig->sync_stats.write_count++;
+	lpconfig->sync_stats.bytes_written+=len;
+	lpconfig->sync_stats.last_write_size=(unsigned int)len;
+}
+
+static void *lp_config_writer_thread(void *data){
+	LpConfig *lpconfig=(LpConfig*)data;
+	LpConfigWriter *w=lpconfig->writer;
+
+	ortp_mutex_lock(&w->mutex);
+	while(TRUE){
+		char *content;
+		size_t len;
+
+		if (w->pending==NULL){
+			if (!w->running) break;
+			ortp_cond_wait(&w->cond,&w->mutex);
+			continue;
+		}
+		if (w->running){
+			/*wait until the configuration stops changing, but not forever*/
+			uint64_t now=ortp_get_cur_time_ms();
+			if (now-w->last_push_time<(uint64_t)w->delay_ms
+				&& now-w->first_push_time<(uint64_t)w->delay_ms*LP_CONFIG_MAX_DELAY_FACTOR){
+				ortp_mutex_unlock(&w->mutex);
+				ms_usleep(LP_CONFIG_WRITER_POLL_INTERVAL*1000);
+				ortp_mutex_lock(&w->mutex);
+				continue;
+			}
+		}
+		content=w->pending;
+		len=w->pending_len;
+		w->pending=NULL;
+		ortp_mutex_unlock(&w->mutex);
+		if (lp_config_write_file(lpconfig->filename,lpconfig->tmpfilename,content,len)==0){
+			ortp_mutex_lock(&w->mutex);
+			lp_config_account_write(lpconfig,len);
+		}else{
+			ortp_mutex_lock(&w->mutex);
+			lpconfig->readonly=1;
+		}
+		ms_free(content);
+	}
+	ortp_mutex_unlock(&w->mutex);
+	return NULL;
+}
+
+static void lp_config_writer_push(LpConfigWriter *w, LpConfigSyncStats *stats, const char *content, size_t len){
+	char *copy=ms_malloc(len+1);
+	uint64_t now=ortp_get_cur_time_ms();
+	memcpy(copy,content,len+1);
+	ortp_mutex_lock(&w->mutex);
+	if (w->pending!=NULL){
+		ms_free(w->pending);
+		stats->coalesced_count++;
+	}else w->first_push_time=now;
+	w->pending=copy;
+	w->pending_len=len;
+	w->last_push_time=now;
+	ortp_cond_signal(&w->cond);
+	ortp_mutex_unlock(&w->mutex);
+}
+
+void lp_config_enable_background_sync(LpConfig *lpconfig, bool_t enable, int delay_ms){
+	LpConfigWriter *w=lpconfig->writer;
+	if (enable){
+		if (w==NULL){
+			w=lp_new0(LpConfigWriter,1);
+			ortp_mutex_init(&w->mutex,NULL);
+			ortp_cond_init(&w->cond,NULL);
+			w->running=TRUE;
+			lpconfig->writer=w;
+			ortp_thread_create(&w->thread,NULL,lp_config_writer_thread,lpconfig);
+		}
+		ortp_mutex_lock(&w->mutex);
+		w->delay_ms=delay_ms;
+		ortp_mutex_unlock(&w->mutex);
+	}else if (w!=NULL){
+		ortp_mutex_lock(&w->mutex);
+		w->running=FALSE;
+		ortp_cond_signal(&w->cond);
+		ortp_mutex_unlock(&w->mutex);
+		ortp_thread_join(w->thread,NULL);
+		ortp_mutex_destroy(&w->mutex);
+		ortp_cond_destroy(&w->cond);
+		lpconfig->writer=NULL;
+		free(w);
+	}
+}
+
+void lp_config_get_sync_stats(const LpConfig *lpconfig, LpConfigSyncStats *stats){
+	LpConfigWriter *w=lpconfig->writer;
+	if (w) ortp_mutex_lock(&w->mutex);
+	*stats=lpconfig->sync_stats;
+	if (w) ortp_mutex_unlock(&w->mutex);
+}
+
+/*only the sections modified since the last serialization are serialized again*/
+static void lp_config_serialize(LpConfig *lpconfig, LpBuffer *buf){
+	MSList *elem;
+	for (elem=lpconfig->sections;elem!=NULL;elem=ms_list_next(elem)){
+		LpSection *sec=(LpSection*)elem->data;
+		lp_section_update_text(sec);
+		lp_buffer_append(buf,sec->text,sec->text_len);
+	}
+	if (buf->data==NULL) lp_buffer_append(buf,"",0);
+}
+
+static void lp_config_update_content(LpConfig *lpconfig){
+	LpBuffer buf={0};
+	lp_config_serialize(lpconfig,&buf);
+	if (lpconfig->content!=NULL) ms_free(lpconfig->content);
+	lpconfig->content=buf.data;
+	lpconfig->content_len=buf.len;
+}
+
+static int lp_config_is_readonly(const LpConfig *lpconfig){
+	LpConfigWriter *w=lpconfig->writer;
+	int readonly;
+	if (w) ortp_mutex_lock(&w->mutex);
+	readonly=lpconfig->readonly;
+	if (w) ortp_mutex_unlock(&w->mutex);
+	return readonly;
+}
+
+int lp_config_sync(LpConfig *lpconfig){
+	LpBuffer buf={0};
+	int err=0;
+
+	if (lpconfig->filename==NULL) return -1;
+	if (lp_config_is_readonly(lpconfig)) return 0;
+
+	lp_config_serialize(lpconfig,&buf);
+	lpconfig->modified=0;
+
+	if (lpconfig->content!=NULL && lpconfig->content_len==buf.len && memcmp(lpconfig->content,buf.data,buf.len)==0){
+		/*unchanged since loaded, or modified then set back to the same content*/
+		ms_free(buf.data);
+		return 0;
+	}
+	if (lpconfig->writer){
+		lp_config_writer_push(lpconfig->writer,&lpconfig->sync_stats,buf.data,buf.len);
+	}else if (lp_config_write_file(lpconfig->filename,lpconfig->tmpfilename,buf.data,buf.len)==0){
+		lp_config_account_write(lpconfig,buf.len);
+	}else{
+		lpconfig->readonly=1;
+		err=-1;
+	}
+	if (lpconfig->content!=NULL) ms_free(lpconfig->content);
+	lpconfig->content=buf.data;
+	lpconfig->content_len=buf.len;
+	return err;
+}
+
 int lp_config_has_section(const LpConfig *lpconfig, const char *section){
 	if (lp_config_find_section(lpconfig,section)!=NULL) return 1;
 	return 0;
@@ -652,8 +898,8 @@ void lp_config_clean_section(LpConfig *lpconfig, const char *section){
 	LpSection *sec=lp_config_find_section(lpconfig,section);
 	if (sec!=NULL){
 		lp_config_remove_section(lpconfig,sec);
+		lpconfig->modified++;
 	}
-	lpconfig->modified++;
 }
 
 int lp_config_needs_commit(const LpConfig *lpconfig){
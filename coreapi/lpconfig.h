@@ -181,11 +181,42 @@ LINPHONE_PUBLIC void lp_config_set_float(LpConfig *lpconfig,const char *section,
 
 /**
  * Writes the config file to disk.
+ * Only the sections modified since the previous call are serialized again, and nothing is written
+ * if the resulting content is the same as the one of the file.
+ * When background sync is enabled, the content is handed to the writer thread and this function does not block on disk I/O.
  *
  * @ingroup misc
 **/
 LINPHONE_PUBLIC int lp_config_sync(LpConfig *lpconfig);
 
+/**
+ * Enables writing the config file from a background thread.
+ * Consecutive calls to lp_config_sync() within delay_ms are coalesced into a single write of the most recent content.
+ * Disabling it writes the pending content, if any, before returning.
+ *
+ * @ingroup misc
+**/
+LINPHONE_PUBLIC void lp_config_enable_background_sync(LpConfig *lpconfig, bool_t enable, int delay_ms);
+
+/**
+ * Statistics about the writes of the config file.
+ *
+ * @ingroup misc
+**/
+typedef struct _LpConfigSyncStats{
+	unsigned int write_count; /**< number of times the file was written */
+	unsigned int coalesced_count; /**< number of contents replaced by a newer one before being written in background */
+	uint64_t bytes_written; /**< total number of bytes written */
+	unsigned int last_write_size; /**< size in bytes of the last write */
+} LpConfigSyncStats;
+
+/**
+ * Retrieves the statistics about the writes of the config file.
+ *
+ * @ingroup misc
+**/
+LINPHONE_PUBLIC void lp_config_get_sync_stats(const LpConfig *lpconfig, LpConfigSyncStats *stats);
+
 /**
  * Returns 1 if a given section is present in the configuration.
  *
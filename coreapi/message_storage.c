@@ -26,6 +26,91 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #endif
 
 #include "sqlite3.h"
+#include <limits.h>
+
+/*version of the database schema, stored as PRAGMA user_version.*/
+#define LINPHONE_MESSAGE_STORAGE_VERSION 1
+
+/*SQL of the cached prepared statements, indexed by LinphoneStorageStatement*/
+static const char *linphone_storage_statements[LinphoneStorageStmtCount]={
+	"INSERT INTO history VALUES(NULL,?,?,?,?,?,?,?,?,?,?,?);",
+	"INSERT INTO content VALUES(NULL,?,?,?,?,?,NULL);",
+	"SELECT * FROM content WHERE id = ?;",
+	"UPDATE history SET status=? WHERE id=?;",
+	"UPDATE history SET appdata=? WHERE id=?;",
+	"UPDATE history SET url=? WHERE id=?;",
+	"UPDATE history SET read=1 WHERE remoteContact = ? AND read = 0;",
+	"SELECT count(*) FROM history WHERE remoteContact = ?;",
+	"SELECT count(*) FROM history WHERE remoteContact = ? AND read = 0;",
+	"DELETE FROM history WHERE id = ?;",
+	"DELETE FROM history WHERE remoteContact = ?;",
+	"SELECT * FROM history WHERE remoteContact = ? AND id < ? ORDER BY id DESC LIMIT ?;",
+	"SELECT id FROM history WHERE remoteContact = ? ORDER BY id DESC LIMIT 1 OFFSET ?;"
+};
+
+/*returns the cached prepared statement, preparing it on first use. The statement must be given back with linphone_message_storage_release_statement()*/
+static sqlite3_stmt *linphone_message_storage_get_statement(LinphoneCore *lc, LinphoneStorageStatement which){
+	sqlite3_stmt *stmt=lc->db_stmts[which];
+	if (stmt==NULL){
+		if (sqlite3_prepare_v2(lc->db,linphone_storage_statements[which],-1,&stmt,NULL)!=SQLITE_OK){
+			ms_error("Cannot prepare statement [%s]: %s.",linphone_storage_statements[which],sqlite3_errmsg(lc->db));
+			sqlite3_finalize(stmt);
+			return NULL;
+		}
+		lc->db_stmts[which]=stmt;
+	}
+	return stmt;
+}
+
+static void linphone_message_storage_release_statement(sqlite3_stmt *stmt){
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+}
+
+/*in write-behind mode, writes are grouped in a transaction that is committed by linphone_core_flush_chat_database()*/
+static void linphone_message_storage_begin_write(LinphoneCore *lc){
+	if (lc->db_write_behind && lc->db_transaction_start==0){
+		if (linphone_sql_request(lc->db,"BEGIN TRANSACTION;")==SQLITE_OK){
+			lc->db_transaction_start=ortp_get_cur_time_ms();
+		}
+	}
+}
+
+/*executes a statement that returns no row, then makes it ready for next use*/
+static int linphone_message_storage_execute_statement(LinphoneCore *lc, sqlite3_stmt *stmt){
+	int ret;
+	linphone_message_storage_begin_write(lc);
+	ret=sqlite3_step(stmt);
+	if (ret!=SQLITE_DONE){
+		ms_error("linphone_message_storage_execute_statement: statement %s -> error sqlite3_step(): %s.",sqlite3_sql(stmt),sqlite3_errmsg(lc->db));
+	}
+	linphone_message_storage_release_statement(stmt);
+	return ret;
+}
+
+static void linphone_message_storage_finalize_statements(LinphoneCore *lc){
+	int i;
+	for(i=0;i<LinphoneStorageStmtCount;i++){
+		if (lc->db_stmts[i]){
+			sqlite3_finalize(lc->db_stmts[i]);
+			lc->db_stmts[i]=NULL;
+		}
+	}
+}
+
+/*copies the columns of the current row of stmt into argv, the same way sqlite3_exec() gives them to its callback*/
+static int linphone_message_storage_get_row(sqlite3_stmt *stmt, char **argv, int max_columns){
+	int i;
+	int count=sqlite3_column_count(stmt);
+	if (count>max_columns) count=max_columns;
+	for(i=0;i<count;i++){
+		argv[i]=(char*)sqlite3_column_text(stmt,i);
+	}
+	for(;i<max_columns;i++){
+		argv[i]=NULL;
+	}
+	return count;
+}
 
 static ORTP_INLINE LinphoneChatMessage* get_transient_message(LinphoneChatRoom* cr, unsigned int storage_id){
 	MSList* transients = cr->transient_messages;
@@ -70,18 +155,18 @@ static int callback_content(void *data, int argc, char **argv, char **colName) {
 	return 0;
 }
 
-static void fetch_content_from_database(sqlite3 *db, LinphoneChatMessage *message, int content_id) {
-	char* errmsg = NULL;
-	int ret;
-	char * buf;
+static void fetch_content_from_database(LinphoneCore *lc, LinphoneChatMessage *message, int content_id) {
+	char *argv[7];
+	int argc;
+	sqlite3_stmt *stmt=linphone_message_storage_get_statement(lc,LinphoneStorageStmtSelectContent);
 
-	buf = sqlite3_mprintf("SELECT * FROM content WHERE id = %i", content_id);
-	ret = sqlite3_exec(db, buf, callback_content, message, &errmsg);
-	if (ret != SQLITE_OK) {
-		ms_error("Error in creation: %s.", errmsg);
-		sqlite3_free(errmsg);
+	if (stmt==NULL) return;
+	sqlite3_bind_int(stmt,1,content_id);
+	while (sqlite3_step(stmt)==SQLITE_ROW){
+		argc=linphone_message_storage_get_row(stmt,argv,7);
+		callback_content(message,argc,argv,NULL);
 	}
-	sqlite3_free(buf);
+	linphone_message_storage_release_statement(stmt);
 }
 
 /* DB layout:
@@ -141,7 +226,7 @@ static void create_chat_message(char **argv, void *data){
 		if (argv[11] != NULL) {
 			int id = atoi(argv[11]);
 			if (id >= 0) {
-				fetch_content_from_database(cr->lc->db, new_message, id);
+				fetch_content_from_database(cr->lc, new_message, id);
 			}
 		}
 	}
@@ -156,21 +241,6 @@ static int callback_all(void *data, int argc, char **argv, char **colName){
 	return 0;
 }
 
-static int callback(void *data, int argc, char **argv, char **colName){
-	create_chat_message(argv,data);
-	return 0;
-}
-
-void linphone_sql_request_message(sqlite3 *db,const char *stmt,LinphoneChatRoom *cr){
-	char* errmsg=NULL;
-	int ret;
-	ret=sqlite3_exec(db,stmt,callback,cr,&errmsg);
-	if(ret != SQLITE_OK) {
-		ms_error("Error in creation: %s.", errmsg);
-		sqlite3_free(errmsg);
-	}
-}
-
 int linphone_sql_request(sqlite3* db,const char *stmt){
 	char* errmsg=NULL;
 	int ret;
@@ -198,16 +268,14 @@ static int linphone_chat_message_store_content(LinphoneChatMessage *msg) {
 	int id = -1;
 	if (lc->db) {
 		LinphoneContent *content = msg->file_transfer_information;
-		char *buf = sqlite3_mprintf("INSERT INTO content VALUES(NULL,%Q,%Q,%Q,%Q,%i,%Q);",
-						content->type,
-						content->subtype,
-						content->name,
-						content->encoding,
-						content->size,
-						NULL
- 					);
-		linphone_sql_request(lc->db, buf);
-		sqlite3_free(buf);
+		sqlite3_stmt *stmt=linphone_message_storage_get_statement(lc,LinphoneStorageStmtInsertContent);
+		if (stmt==NULL) return id;
+		sqlite3_bind_text(stmt,1,content->type,-1,SQLITE_STATIC);
+		sqlite3_bind_text(stmt,2,content->subtype,-1,SQLITE_STATIC);
+		sqlite3_bind_text(stmt,3,content->name,-1,SQLITE_STATIC);
+		sqlite3_bind_text(stmt,4,content->encoding,-1,SQLITE_STATIC);
+		sqlite3_bind_int(stmt,5,(int)content->size);
+		linphone_message_storage_execute_statement(lc,stmt);
 		id = (unsigned int) sqlite3_last_insert_rowid (lc->db);
 	}
 	return id;
@@ -221,31 +289,32 @@ unsigned int linphone_chat_message_store(LinphoneChatMessage *msg){
 		int content_id = -1;
 		char *peer;
 		char *local_contact;
-		char *buf;
+		sqlite3_stmt *stmt;
 		if (msg->file_transfer_information) {
 			content_id = linphone_chat_message_store_content(msg);
 		}
 
+		stmt=linphone_message_storage_get_statement(lc,LinphoneStorageStmtInsertMessage);
+		if (stmt==NULL) return id;
 		peer=linphone_address_as_string_uri_only(linphone_chat_room_get_peer_address(msg->chat_room));
 		local_contact=linphone_address_as_string_uri_only(linphone_chat_message_get_local_address(msg));
-		buf = sqlite3_mprintf("INSERT INTO history VALUES(NULL,%Q,%Q,%i,%Q,%Q,%i,%i,%Q,%lld,%Q,%i);",
-						local_contact,
-						peer,
-						msg->dir,
-						msg->message,
-						"-1", /* use UTC field now */
-						msg->is_read,
-						msg->state,
-						msg->external_body_url,
-						(int64_t)msg->time,
-						msg->appdata,
-						content_id
- 					);
-		linphone_sql_request(lc->db,buf);
-		sqlite3_free(buf);
+		sqlite3_bind_text(stmt,1,local_contact,-1,SQLITE_STATIC);
+		sqlite3_bind_text(stmt,2,peer,-1,SQLITE_STATIC);
+		sqlite3_bind_int(stmt,3,msg->dir);
+		sqlite3_bind_text(stmt,4,msg->message,-1,SQLITE_STATIC);
+		sqlite3_bind_text(stmt,5,"-1",-1,SQLITE_STATIC); /* use UTC field now */
+		sqlite3_bind_int(stmt,6,msg->is_read);
+		sqlite3_bind_int(stmt,7,msg->state);
+		sqlite3_bind_text(stmt,8,msg->external_body_url,-1,SQLITE_STATIC);
+		sqlite3_bind_int64(stmt,9,(int64_t)msg->time);
+		sqlite3_bind_text(stmt,10,msg->appdata,-1,SQLITE_STATIC);
+		sqlite3_bind_int(stmt,11,content_id);
+		linphone_message_storage_execute_statement(lc,stmt);
 		ms_free(local_contact);
 		ms_free(peer);
 		id = (unsigned int) sqlite3_last_insert_rowid (lc->db);
+		if (!msg->is_read) msg->chat_room->unread_count=-1;
+		lc->profiling_counters[LinphoneProfilingMessagesStored]++;
 	}
 	return id;
 }
@@ -253,10 +322,12 @@ unsigned int linphone_chat_message_store(LinphoneChatMessage *msg){
 void linphone_chat_message_store_state(LinphoneChatMessage *msg){
 	LinphoneCore *lc=msg->chat_room->lc;
 	if (lc->db){
-		char *buf=sqlite3_mprintf("UPDATE history SET status=%i WHERE (id = %i);",
-								  msg->state,msg->storage_id);
-		linphone_sql_request(lc->db,buf);
-		sqlite3_free(buf);
+		sqlite3_stmt *stmt=linphone_message_storage_get_statement(lc,LinphoneStorageStmtUpdateState);
+		if (stmt){
+			sqlite3_bind_int(stmt,1,msg->state);
+			sqlite3_bind_int(stmt,2,msg->storage_id);
+			linphone_message_storage_execute_statement(lc,stmt);
+		}
 	}
 
 	if( msg->state == LinphoneChatMessageStateDelivered
@@ -270,66 +341,69 @@ void linphone_chat_message_store_state(LinphoneChatMessage *msg){
 void linphone_chat_message_store_appdata(LinphoneChatMessage* msg){
 	LinphoneCore *lc=msg->chat_room->lc;
 	if (lc->db){
-		char *buf=sqlite3_mprintf("UPDATE history SET appdata=%Q WHERE id=%i;",
-								  msg->appdata,msg->storage_id);
-		linphone_sql_request(lc->db,buf);
-		sqlite3_free(buf);
+		sqlite3_stmt *stmt=linphone_message_storage_get_statement(lc,LinphoneStorageStmtUpdateAppData);
+		if (stmt==NULL) return;
+		sqlite3_bind_text(stmt,1,msg->appdata,-1,SQLITE_STATIC);
+		sqlite3_bind_int(stmt,2,msg->storage_id);
+		linphone_message_storage_execute_statement(lc,stmt);
 	}
 }
 
 void linphone_chat_room_mark_as_read(LinphoneChatRoom *cr){
 	LinphoneCore *lc=linphone_chat_room_get_lc(cr);
-	int read=1;
 	char *peer;
-	char *buf;
+	sqlite3_stmt *stmt;
 
 	if (lc->db==NULL) return ;
 
+	stmt=linphone_message_storage_get_statement(lc,LinphoneStorageStmtMarkAsRead);
+	if (stmt==NULL) return;
 	peer=linphone_address_as_string_uri_only(linphone_chat_room_get_peer_address(cr));
-	buf=sqlite3_mprintf("UPDATE history SET read=%i WHERE remoteContact = %Q;",
-				   read,peer);
-	linphone_sql_request(lc->db,buf);
-	sqlite3_free(buf);
+	sqlite3_bind_text(stmt,1,peer,-1,SQLITE_STATIC);
+	linphone_message_storage_execute_statement(lc,stmt);
 	ms_free(peer);
+	cr->unread_count=0;
 }
 
 void linphone_chat_room_update_url(LinphoneChatRoom *cr, LinphoneChatMessage *msg) {
 	LinphoneCore *lc=linphone_chat_room_get_lc(cr);
-	char *buf;
+	sqlite3_stmt *stmt;
 
 	if (lc->db==NULL) return ;
 
-	buf=sqlite3_mprintf("UPDATE history SET url=%Q WHERE id=%i;",msg->external_body_url,msg->storage_id);
-	linphone_sql_request(lc->db,buf);
-	sqlite3_free(buf);
+	stmt=linphone_message_storage_get_statement(lc,LinphoneStorageStmtUpdateUrl);
+	if (stmt==NULL) return;
+	sqlite3_bind_text(stmt,1,msg->external_body_url,-1,SQLITE_STATIC);
+	sqlite3_bind_int(stmt,2,msg->storage_id);
+	linphone_message_storage_execute_statement(lc,stmt);
 }
 
 static int linphone_chat_room_get_messages_count(LinphoneChatRoom *cr, bool_t unread_only){
 	LinphoneCore *lc=linphone_chat_room_get_lc(cr);
 	int numrows=0;
 	char *peer;
-	char *buf;
-	sqlite3_stmt *selectStatement;
-	int returnValue;
+	sqlite3_stmt *stmt;
 
 	if (lc->db==NULL) return 0;
 
+	stmt=linphone_message_storage_get_statement(lc,unread_only?LinphoneStorageStmtCountUnreadMessages:LinphoneStorageStmtCountMessages);
+	if (stmt==NULL) return 0;
 	peer=linphone_address_as_string_uri_only(linphone_chat_room_get_peer_address(cr));
-	buf=sqlite3_mprintf("SELECT count(*) FROM history WHERE remoteContact = %Q %s;",peer,unread_only?"AND read = 0":"");
-	returnValue = sqlite3_prepare_v2(lc->db,buf,-1,&selectStatement,NULL);
-	if (returnValue == SQLITE_OK){
-		if(sqlite3_step(selectStatement) == SQLITE_ROW){
-			numrows= sqlite3_column_int(selectStatement, 0);
-		}
+	sqlite3_bind_text(stmt,1,peer,-1,SQLITE_STATIC);
+	if(sqlite3_step(stmt) == SQLITE_ROW){
+		numrows= sqlite3_column_int(stmt, 0);
 	}
-	sqlite3_finalize(selectStatement);
-	sqlite3_free(buf);
+	linphone_message_storage_release_statement(stmt);
 	ms_free(peer);
 	return numrows;
 }
 
 int linphone_chat_room_get_unread_messages_count(LinphoneChatRoom *cr){
-	return linphone_chat_room_get_messages_count(cr, TRUE);
+	if (cr->lc==NULL || cr->lc->db==NULL) return 0;
+	if (cr->unread_count<0){
+		cr->unread_count=linphone_chat_room_get_messages_count(cr, TRUE);
+	}
+	return cr->unread_count;
 }
 
 int linphone_chat_room_get_history_size(LinphoneChatRoom *cr){
@@ -338,67 +412,118 @@ int linphone_chat_room_get_history_size(LinphoneChatRoom *cr){
 
 void linphone_chat_room_delete_message(LinphoneChatRoom *cr, LinphoneChatMessage *msg) {
 	LinphoneCore *lc=cr->lc;
-	char *buf;
+	sqlite3_stmt *stmt;
 
 	if (lc->db==NULL) return ;
 
-	buf=sqlite3_mprintf("DELETE FROM history WHERE id = %i;", msg->storage_id);
-	linphone_sql_request(lc->db,buf);
-	sqlite3_free(buf);
+	stmt=linphone_message_storage_get_statement(lc,LinphoneStorageStmtDeleteMessage);
+	if (stmt==NULL) return;
+	sqlite3_bind_int(stmt,1,msg->storage_id);
+	linphone_message_storage_execute_statement(lc,stmt);
+	cr->unread_count=-1;
 }
 
 void linphone_chat_room_delete_history(LinphoneChatRoom *cr){
 	LinphoneCore *lc=cr->lc;
 	char *peer;
-	char *buf;
+	sqlite3_stmt *stmt;
 
 	if (lc->db==NULL) return ;
 
+	stmt=linphone_message_storage_get_statement(lc,LinphoneStorageStmtDeleteHistory);
+	if (stmt==NULL) return;
 	peer=linphone_address_as_string_uri_only(linphone_chat_room_get_peer_address(cr));
-	buf=sqlite3_mprintf("DELETE FROM history WHERE remoteContact = %Q;",peer);
-	linphone_sql_request(lc->db,buf);
-	sqlite3_free(buf);
+	sqlite3_bind_text(stmt,1,peer,-1,SQLITE_STATIC);
+	linphone_message_storage_execute_statement(lc,stmt);
 	ms_free(peer);
+	cr->unread_count=0;
 }
 
-MSList *linphone_chat_room_get_history_range(LinphoneChatRoom *cr, int startm, int endm){
+/*steps through the rows of a history query, prepending the messages to cr->messages_hist*/
+static void linphone_message_storage_fetch_messages(sqlite3_stmt *stmt, LinphoneChatRoom *cr){
+	char *argv[12];
+	int ret;
+	while ((ret=sqlite3_step(stmt))==SQLITE_ROW){
+		linphone_message_storage_get_row(stmt,argv,12);
+		create_chat_message(argv,cr);
+	}
+	if (ret!=SQLITE_DONE){
+		ms_error("Error while fetching messages: %s.",sqlite3_errmsg(cr->lc->db));
+	}
+	linphone_message_storage_release_statement(stmt);
+}
+
+MSList *linphone_chat_room_get_history_before(LinphoneChatRoom *cr, unsigned int storage_id, int nb_messages){
 	LinphoneCore *lc=linphone_chat_room_get_lc(cr);
 	MSList *ret;
-	char *buf;
 	char *peer;
-	uint64_t begin,end;
-	int buf_max_size = 512;
+	sqlite3_stmt *stmt;
 
 	if (lc->db==NULL) return NULL;
+	stmt=linphone_message_storage_get_statement(lc,LinphoneStorageStmtHistoryBefore);
+	if (stmt==NULL) return NULL;
 	peer = linphone_address_as_string_uri_only(linphone_chat_room_get_peer_address(cr));
 
 	cr->messages_hist = NULL;
 
-	/*since we want to append query parameters depending on arguments given, we use malloc instead of sqlite3_mprintf*/
-	buf=ms_malloc(buf_max_size);
-	buf=sqlite3_snprintf(buf_max_size-1,buf,"SELECT * FROM history WHERE remoteContact = %Q ORDER BY id DESC",peer);
+	sqlite3_bind_text(stmt,1,peer,-1,SQLITE_STATIC);
+	/*ids are unsigned int, any value above them means no upper bound*/
+	sqlite3_bind_int64(stmt,2,storage_id ? (sqlite3_int64)storage_id : (sqlite3_int64)UINT_MAX+1);
+	sqlite3_bind_int(stmt,3,nb_messages>0 ? nb_messages : -1);
+	linphone_message_storage_fetch_messages(stmt,cr);
+
+	ret=cr->messages_hist;
+	cr->messages_hist=NULL;
+	ms_free(peer);
+	return ret;
+}
+
+/*returns the storage id of the message at index offset (most recent has index 0), 0 if there is none*/
+static unsigned int linphone_chat_room_get_storage_id_at_offset(LinphoneChatRoom *cr, int offset){
+	LinphoneCore *lc=linphone_chat_room_get_lc(cr);
+	unsigned int id=0;
+	char *peer;
+	sqlite3_stmt *stmt=linphone_message_storage_get_statement(lc,LinphoneStorageStmtHistoryIdAtOffset);
+
+	if (stmt==NULL) return 0;
+	peer=linphone_address_as_string_uri_only(linphone_chat_room_get_peer_address(cr));
+	sqlite3_bind_text(stmt,1,peer,-1,SQLITE_STATIC);
+	sqlite3_bind_int(stmt,2,offset);
+	if (sqlite3_step(stmt)==SQLITE_ROW){
+		id=(unsigned int)sqlite3_column_int64(stmt,0);
+	}
+	linphone_message_storage_release_statement(stmt);
+	ms_free(peer);
+	return id;
+}
+
+MSList *linphone_chat_room_get_history_range(LinphoneChatRoom *cr, int startm, int endm){
+	LinphoneCore *lc=linphone_chat_room_get_lc(cr);
+	MSList *ret;
+	unsigned int before_id=0;
+	uint64_t begin,end;
+	int count=0;
+
+	if (lc->db==NULL) return NULL;
 
 	if (startm<0) startm=0;
 
 	if (endm>0&&endm>=startm){
-		buf=sqlite3_snprintf(buf_max_size-1,buf,"%s LIMIT %i ",buf,endm+1-startm);
+		count=endm+1-startm;
 	}else if(startm>0){
 		ms_message("%s(): end is lower than start (%d < %d). No end assumed.",__FUNCTION__,endm,startm);
-		buf=sqlite3_snprintf(buf_max_size-1,buf,"%s LIMIT -1",buf);
 	}
 
+	begin=ortp_get_cur_time_ms();
 	if (startm>0){
-		buf=sqlite3_snprintf(buf_max_size-1,buf,"%s OFFSET %i ",buf,startm);
+		/*the offset is only walked on the (remoteContact,id) index, the page itself is then fetched by key*/
+		before_id=linphone_chat_room_get_storage_id_at_offset(cr,startm);
+		if (before_id==0) return NULL;
+		before_id++;
 	}
-
-	begin=ortp_get_cur_time_ms();
-	linphone_sql_request_message(lc->db,buf,cr);
+	ret=linphone_chat_room_get_history_before(cr,before_id,count);
 	end=ortp_get_cur_time_ms();
 	ms_message("%s(): completed in %i ms",__FUNCTION__, (int)(end-begin));
-	ms_free(buf);
-	ret=cr->messages_hist;
-	cr->messages_hist=NULL;
-	ms_free(peer);
 	return ret;
 }
 
@@ -552,10 +677,194 @@ void linphone_update_table(sqlite3* db) {
 	}
 }
 
+static int linphone_message_storage_get_version(sqlite3 *db){
+	sqlite3_stmt *stmt;
+	int version=0;
+	if (sqlite3_prepare_v2(db,"PRAGMA user_version;",-1,&stmt,NULL)==SQLITE_OK){
+		if (sqlite3_step(stmt)==SQLITE_ROW){
+			version=sqlite3_column_int(stmt,0);
+		}
+	}
+	sqlite3_finalize(stmt);
+	return version;
+}
+
+/*applies the schema changes that cannot be detected by a failing ALTER TABLE, according to PRAGMA user_version*/
+static void linphone_message_storage_upgrade_schema(sqlite3 *db){
+	int version=linphone_message_storage_get_version(db);
+	char *buf;
+
+	if (version>=LINPHONE_MESSAGE_STORAGE_VERSION) return;
+	if (version<1){
+		/*history pages, sizes and unread counts are per remote contact*/
+		linphone_sql_request(db,"CREATE INDEX IF NOT EXISTS history_remote_id ON history(remoteContact,id);");
+		linphone_sql_request(db,"CREATE INDEX IF NOT EXISTS history_remote_read ON history(remoteContact,read);");
+	}
+	buf=sqlite3_mprintf("PRAGMA user_version=%i;",LINPHONE_MESSAGE_STORAGE_VERSION);
+	linphone_sql_request(db,buf);
+	sqlite3_free(buf);
+	ms_message("Message storage upgraded from schema version %i to %i.",version,LINPHONE_MESSAGE_STORAGE_VERSION);
+}
+
+/*
+ * In lazy mode, the chat rooms of the history are not created when the database is opened: only a descriptor is kept
+ * for each remote contact, and the LinphoneChatRoom is created when it is looked up or listed.
+ */
+typedef struct _LinphoneChatRoomDescriptor{
+	char *peer; /*remoteContact of the history*/
+	char *key; /*weak key of the peer, as chat rooms are matched with linphone_address_weak_equal()*/
+	unsigned int last_message_id;
+	int unread_count;
+}LinphoneChatRoomDescriptor;
+
+static void linphone_chat_room_descriptor_destroy(LinphoneChatRoomDescriptor *desc){
+	ms_free(desc->peer);
+	ms_free(desc->key);
+	ms_free(desc);
+}
+
+static char *linphone_message_storage_peer_key(const char *peer){
+	LinphoneAddress *addr=linphone_address_new(peer);
+	char *key;
+	if (addr==NULL) return NULL;
+	key=linphone_address_as_weak_key(addr);
+	linphone_address_destroy(addr);
+	return key;
+}
+
+static void linphone_message_storage_clear_chat_room_descriptors(LinphoneCore *lc){
+	ms_list_free_with_data(lc->chat_room_descriptors,(void (*)(void*))linphone_chat_room_descriptor_destroy);
+	lc->chat_room_descriptors=NULL;
+	if (lc->chat_room_descriptors_by_peer){
+		linphone_hash_table_destroy(lc->chat_room_descriptors_by_peer);
+		lc->chat_room_descriptors_by_peer=NULL;
+	}
+}
+
+static void linphone_message_storage_load_chat_room_descriptors(LinphoneCore *lc){
+	LinphoneHashTable *existing=linphone_hash_table_new_for_strings();
+	sqlite3_stmt *stmt;
+	MSList *elem;
+	int ret;
+
+	linphone_message_storage_clear_chat_room_descriptors(lc);
+	for(elem=lc->chatrooms;elem!=NULL;elem=elem->next){
+		LinphoneChatRoom *cr=(LinphoneChatRoom*)elem->data;
+		linphone_hash_table_insert(existing,cr->peer_key,cr);
+	}
+	/*rows come oldest conversation first, so that prepending gives the most recent first*/
+	if (sqlite3_prepare_v2(lc->db,"SELECT remoteContact, MAX(id), SUM(read = 0) FROM history GROUP BY remoteContact ORDER BY MAX(id);",-1,&stmt,NULL)!=SQLITE_OK){
+		ms_error("Cannot load chat rooms: %s.",sqlite3_errmsg(lc->db));
+		linphone_hash_table_destroy(existing);
+		return;
+	}
+	lc->chat_room_descriptors_by_peer=linphone_hash_table_new_for_strings();
+	while ((ret=sqlite3_step(stmt))==SQLITE_ROW){
+		const char *peer=(const char*)sqlite3_column_text(stmt,0);
+		LinphoneChatRoomDescriptor *desc;
+		char *key;
+		if (peer==NULL || (key=linphone_message_storage_peer_key(peer))==NULL) continue;
+		if (linphone_hash_table_lookup(existing,key)!=NULL){
+			ms_free(key);
+			continue;
+		}
+		elem=(MSList*)linphone_hash_table_lookup(lc->chat_room_descriptors_by_peer,key);
+		if (elem!=NULL){
+			/*the same peer up to its display name or parameters: a single conversation, moved to its latest message.
+			As in eager mode, the chat room gets the first remoteContact in GROUP BY order, and the unread count of
+			that remoteContact only, since the storage queries of the chat room match it exactly*/
+			desc=(LinphoneChatRoomDescriptor*)elem->data;
+			lc->chat_room_descriptors=ms_list_remove_link(lc->chat_room_descriptors,elem);
+			if (strcmp(peer,desc->peer)<0){
+				ms_free(desc->peer);
+				desc->peer=ms_strdup(peer);
+				desc->unread_count=sqlite3_column_int(stmt,2);
+			}
+			ms_free(key);
+		}else{
+			desc=ms_new0(LinphoneChatRoomDescriptor,1);
+			desc->peer=ms_strdup(peer);
+			desc->key=key;
+			desc->unread_count=sqlite3_column_int(stmt,2);
+		}
+		desc->last_message_id=(unsigned int)sqlite3_column_int64(stmt,1);
+		lc->chat_room_descriptors=ms_list_prepend(lc->chat_room_descriptors,desc);
+		linphone_hash_table_insert(lc->chat_room_descriptors_by_peer,desc->key,lc->chat_room_descriptors);
+	}
+	if (ret!=SQLITE_DONE){
+		ms_error("Error while loading chat rooms: %s.",sqlite3_errmsg(lc->db));
+	}
+	sqlite3_finalize(stmt);
+	linphone_hash_table_destroy(existing);
+	ms_message("%i chat rooms found in history.",(int)linphone_hash_table_size(lc->chat_room_descriptors_by_peer));
+}
+
+static LinphoneChatRoom *linphone_message_storage_create_lazy_chat_room(LinphoneCore *lc, MSList *elem){
+	LinphoneChatRoomDescriptor *desc=(LinphoneChatRoomDescriptor*)elem->data;
+	LinphoneChatRoom *cr;
+
+	linphone_hash_table_remove(lc->chat_room_descriptors_by_peer,desc->key);
+	lc->chat_room_descriptors=ms_list_remove_link(lc->chat_room_descriptors,elem);
+	cr=_linphone_core_create_chat_room_from_url(lc,desc->peer);
+	if (cr!=NULL){
+		cr->unread_count=desc->unread_count;
+	}else{
+		ms_warning("Cannot create chat room for [%s] found in history.",desc->peer);
+	}
+	linphone_chat_room_descriptor_destroy(desc);
+	return cr;
+}
+
+LinphoneChatRoom *linphone_message_storage_get_lazy_chat_room(LinphoneCore *lc, const LinphoneAddress *addr){
+	MSList *elem;
+	LinphoneAddress *peer;
+	bool_t same_peer;
+	char *key;
+
+	if (lc->chat_room_descriptors==NULL) return NULL;
+	key=linphone_address_as_weak_key(addr);
+	elem=(MSList*)linphone_hash_table_lookup(lc->chat_room_descriptors_by_peer,key);
+	ms_free(key);
+	if (elem==NULL) return NULL;
+	/*weak keys may collide, see linphone_address_as_weak_key()*/
+	peer=linphone_address_new(((LinphoneChatRoomDescriptor*)elem->data)->peer);
+	same_peer=(peer!=NULL && linphone_address_weak_equal(peer,addr));
+	if (peer) linphone_address_destroy(peer);
+	if (!same_peer) return NULL;
+	return linphone_message_storage_create_lazy_chat_room(lc,elem);
+}
+
+LinphoneChatRoom *linphone_message_storage_create_next_lazy_chat_room(LinphoneCore *lc){
+	while (lc->chat_room_descriptors!=NULL){
+		LinphoneChatRoom *cr=linphone_message_storage_create_lazy_chat_room(lc,lc->chat_room_descriptors);
+		if (cr!=NULL) return cr;
+	}
+	return NULL;
+}
+
+int linphone_message_storage_get_lazy_chat_rooms_count(const LinphoneCore *lc){
+	return (int)linphone_hash_table_size(lc->chat_room_descriptors_by_peer);
+}
+
+void linphone_core_enable_lazy_chat_rooms(LinphoneCore *lc, bool_t enable){
+	lp_config_set_int(lc->config,"misc","lazy_chat_rooms",enable);
+	if (!enable){
+		while (linphone_message_storage_create_next_lazy_chat_room(lc)!=NULL);
+	}
+}
+
+bool_t linphone_core_lazy_chat_rooms_enabled(const LinphoneCore *lc){
+	return lp_config_get_int(lc->config,"misc","lazy_chat_rooms",0);
+}
+
 void linphone_message_storage_init_chat_rooms(LinphoneCore *lc) {
 	char *buf;
 
 	if (lc->db==NULL) return;
+	if (linphone_core_lazy_chat_rooms_enabled(lc)){
+		linphone_message_storage_load_chat_room_descriptors(lc);
+		return;
+	}
 	buf=sqlite3_mprintf("SELECT remoteContact FROM history GROUP BY remoteContact;");
 	linphone_sql_request_all(lc->db,buf,lc);
 	sqlite3_free(buf);
@@ -582,12 +891,56 @@ void linphone_core_message_storage_set_debug(LinphoneCore *lc, bool_t debug){
 	}
 }
 
+static void linphone_message_storage_apply_write_behind(LinphoneCore *lc){
+	/*the journal mode cannot be changed within a transaction*/
+	linphone_core_flush_chat_database(lc);
+	if (lc->db_write_behind){
+		/*with write-ahead logging, a commit only appends to the log and readers are not blocked by it*/
+		linphone_sql_request(lc->db,"PRAGMA journal_mode=WAL;");
+		linphone_sql_request(lc->db,"PRAGMA synchronous=NORMAL;");
+	}
+}
+
+void linphone_core_enable_chat_database_write_behind(LinphoneCore *lc, bool_t enable){
+	lp_config_set_int(lc->config,"misc","chat_database_write_behind",enable);
+	lc->db_write_behind=enable;
+	if (lc->db){
+		linphone_message_storage_apply_write_behind(lc);
+	}
+}
+
+bool_t linphone_core_chat_database_write_behind_enabled(const LinphoneCore *lc){
+	return lc->db_write_behind;
+}
+
+void linphone_core_flush_chat_database(LinphoneCore *lc){
+	if (lc->db && lc->db_transaction_start!=0){
+		uint64_t begin=lc->db_transaction_start;
+		if (linphone_sql_request(lc->db,"COMMIT;")!=SQLITE_OK && !sqlite3_get_autocommit(lc->db)){
+			/*the transaction is still open, for example because the database is busy: it is retried at the next iteration*/
+			return;
+		}
+		lc->db_transaction_start=0;
+		ms_debug("Chat messages written behind after %i ms.",(int)(ortp_get_cur_time_ms()-begin));
+	}
+}
+
+void linphone_core_message_storage_iterate(LinphoneCore *lc){
+	if (lc->db_transaction_start!=0 && ortp_get_cur_time_ms()-lc->db_transaction_start>=(uint64_t)lc->db_flush_interval){
+		linphone_core_flush_chat_database(lc);
+	}
+}
+
 void linphone_core_message_storage_init(LinphoneCore *lc){
 	int ret;
 	const char *errmsg;
 	sqlite3 *db;
+	MSList *elem;
 
 	linphone_core_message_storage_close(lc);
+	for(elem=lc->chatrooms;elem!=NULL;elem=elem->next){
+		((LinphoneChatRoom*)elem->data)->unread_count=-1;
+	}
 
 	ret=sqlite3_open(lc->chat_db_file,&db);
 	if(ret != SQLITE_OK) {
@@ -600,7 +953,11 @@ void linphone_core_message_storage_init(LinphoneCore *lc){
 
 	linphone_create_table(db);
 	linphone_update_table(db);
+	linphone_message_storage_upgrade_schema(db);
 	lc->db=db;
+	lc->db_write_behind=lp_config_get_int(lc->config,"misc","chat_database_write_behind",0);
+	lc->db_flush_interval=lp_config_get_int(lc->config,"misc","chat_database_flush_interval",0);
+	if (lc->db_write_behind) linphone_message_storage_apply_write_behind(lc);
 
 	// Create a chatroom for each contact in the chat history
 	linphone_message_storage_init_chat_rooms(lc);
@@ -608,9 +965,12 @@ void linphone_core_message_storage_init(LinphoneCore *lc){
 
 void linphone_core_message_storage_close(LinphoneCore *lc){
 	if (lc->db){
+		linphone_core_flush_chat_database(lc);
+		linphone_message_storage_finalize_statements(lc);
 		sqlite3_close(lc->db);
 		lc->db=NULL;
 	}
+	linphone_message_storage_clear_chat_room_descriptors(lc);
 }
 
 #else
@@ -636,6 +996,10 @@ LINPHONE_PUBLIC MSList *linphone_chat_room_get_history_range(LinphoneChatRoom *c
 	return NULL;
 }
 
+MSList *linphone_chat_room_get_history_before(LinphoneChatRoom *cr, unsigned int storage_id, int nb_messages){
+	return NULL;
+}
+
 void linphone_chat_room_delete_message(LinphoneChatRoom *cr, LinphoneChatMessage *msg) {
 }
 
@@ -645,12 +1009,44 @@ void linphone_chat_room_delete_history(LinphoneChatRoom *cr){
 void linphone_message_storage_init_chat_rooms(LinphoneCore *lc) {
 }
 
+LinphoneChatRoom *linphone_message_storage_get_lazy_chat_room(LinphoneCore *lc, const LinphoneAddress *addr){
+	return NULL;
+}
+
+LinphoneChatRoom *linphone_message_storage_create_next_lazy_chat_room(LinphoneCore *lc){
+	return NULL;
+}
+
+int linphone_message_storage_get_lazy_chat_rooms_count(const LinphoneCore *lc){
+	return 0;
+}
+
+void linphone_core_enable_lazy_chat_rooms(LinphoneCore *lc, bool_t enable){
+}
+
+bool_t linphone_core_lazy_chat_rooms_enabled(const LinphoneCore *lc){
+	return FALSE;
+}
+
 void linphone_core_message_storage_init(LinphoneCore *lc){
 }
 
 void linphone_core_message_storage_close(LinphoneCore *lc){
 }
 
+void linphone_core_message_storage_iterate(LinphoneCore *lc){
+}
+
+void linphone_core_enable_chat_database_write_behind(LinphoneCore *lc, bool_t enable){
+}
+
+bool_t linphone_core_chat_database_write_behind_enabled(const LinphoneCore *lc){
+	return FALSE;
+}
+
+void linphone_core_flush_chat_database(LinphoneCore *lc){
+}
+
 void linphone_chat_room_update_url(LinphoneChatRoom *cr, LinphoneChatMessage *msg) {
 }
 
@@ -704,7 +704,6 @@ void linphone_core_update_local_media_description_from_ice(SalMediaDescription *
 {
 	const char *rtp_addr, *rtcp_addr;
 	IceSessionState session_state = ice_session_state(session);
-	int nb_candidates;
 	int i, j;
 	bool_t result;
 
@@ -720,12 +719,11 @@ void linphone_core_update_local_media_description_from_ice(SalMediaDescription *
 	else {
 		desc->ice_completed = FALSE;
 	}
-	strncpy(desc->ice_pwd, ice_session_local_pwd(session), sizeof(desc->ice_pwd));
-	strncpy(desc->ice_ufrag, ice_session_local_ufrag(session), sizeof(desc->ice_ufrag));
+	sal_shared_string_set(&desc->ice_pwd, ice_session_local_pwd(session));
+	sal_shared_string_set(&desc->ice_ufrag, ice_session_local_ufrag(session));
 	for (i = 0; i < desc->nb_streams; i++) {
 		SalStreamDescription *stream = &desc->streams[i];
 		IceCheckList *cl = ice_session_check_list(session, i);
-		nb_candidates = 0;
 		if (!sal_stream_description_active(stream) || (cl == NULL)) continue;
 		if (ice_check_list_state(cl) == ICL_Completed) {
 			stream->ice_completed = TRUE;
@@ -741,20 +739,21 @@ void linphone_core_update_local_media_description_from_ice(SalMediaDescription *
 			memset(stream->rtp_addr, 0, sizeof(stream->rtp_addr));
 			memset(stream->rtcp_addr, 0, sizeof(stream->rtcp_addr));
 		}
-		if ((strlen(ice_check_list_local_pwd(cl)) != strlen(desc->ice_pwd)) || (strcmp(ice_check_list_local_pwd(cl), desc->ice_pwd)))
-			strncpy(stream->ice_pwd, ice_check_list_local_pwd(cl), sizeof(stream->ice_pwd));
+		if ((desc->ice_pwd == NULL) || (strcmp(ice_check_list_local_pwd(cl), desc->ice_pwd) != 0))
+			sal_shared_string_set(&stream->ice_pwd, ice_check_list_local_pwd(cl));
 		else
-			memset(stream->ice_pwd, 0, sizeof(stream->ice_pwd));
-		if ((strlen(ice_check_list_local_ufrag(cl)) != strlen(desc->ice_ufrag)) || (strcmp(ice_check_list_local_ufrag(cl), desc->ice_ufrag)))
-			strncpy(stream->ice_ufrag, ice_check_list_local_ufrag(cl), sizeof(stream->ice_ufrag));
+			sal_shared_string_clear(&stream->ice_pwd);
+		if ((desc->ice_ufrag == NULL) || (strcmp(ice_check_list_local_ufrag(cl), desc->ice_ufrag) != 0))
+			sal_shared_string_set(&stream->ice_ufrag, ice_check_list_local_ufrag(cl));
 		else
-			memset(stream->ice_pwd, 0, sizeof(stream->ice_pwd));
+			sal_shared_string_clear(&stream->ice_ufrag);
 		stream->ice_mismatch = ice_check_list_is_mismatch(cl);
 		if ((ice_check_list_state(cl) == ICL_Running) || (ice_check_list_state(cl) == ICL_Completed)) {
-			memset(stream->ice_candidates, 0, sizeof(stream->ice_candidates));
-			for (j = 0; j < MIN(ms_list_size(cl->local_candidates), SAL_MEDIA_DESCRIPTION_MAX_ICE_CANDIDATES); j++) {
-				SalIceCandidate *sal_candidate = &stream->ice_candidates[nb_candidates];
-				IceCandidate *ice_candidate = ms_list_nth_data(cl->local_candidates, j);
+			MSList *elem;
+			sal_stream_description_clear_ice_candidates(stream);
+			for (elem = cl->local_candidates, j = 0; (elem != NULL) && (j < SAL_MEDIA_DESCRIPTION_MAX_ICE_CANDIDATES); elem = elem->next, j++) {
+				SalIceCandidate *sal_candidate;
+				IceCandidate *ice_candidate = (IceCandidate *)elem->data;
 				const char *default_addr = NULL;
 				int default_port = 0;
 				if (ice_candidate->componentID == 1) {
@@ -769,6 +768,7 @@ void linphone_core_update_local_media_description_from_ice(SalMediaDescription *
 				if ((ice_check_list_state(cl) == ICL_Completed)
 					&& !((ice_candidate->taddr.port == default_port) && (strlen(ice_candidate->taddr.ip) == strlen(default_addr)) && (strcmp(ice_candidate->taddr.ip, default_addr) == 0)))
 					continue;
+				sal_candidate = sal_stream_description_add_ice_candidate(stream);
 				strncpy(sal_candidate->foundation, ice_candidate->foundation, sizeof(sal_candidate->foundation));
 				sal_candidate->componentID = ice_candidate->componentID;
 				sal_candidate->priority = ice_candidate->priority;
@@ -779,7 +779,6 @@ void linphone_core_update_local_media_description_from_ice(SalMediaDescription *
 					strncpy(sal_candidate->raddr, ice_candidate->base->taddr.ip, sizeof(sal_candidate->raddr));
 					sal_candidate->rport = ice_candidate->base->taddr.port;
 				}
-				nb_candidates++;
 			}
 		}
 		if ((ice_check_list_state(cl) == ICL_Completed) && (ice_session_role(session) == IR_Controlling)) {
@@ -825,7 +824,7 @@ void linphone_core_update_ice_from_remote_media_description(LinphoneCall *call,
 {
 	bool_t ice_restarted = FALSE;
 
-	if ((md->ice_pwd[0] != '\0') && (md->ice_ufrag[0] != '\0')) {
+	if ((md->ice_pwd != NULL) && (md->ice_ufrag != NULL)) {
 		int i, j;
 
 		/* Check for ICE restart and set remote credentials. */
@@ -855,7 +854,7 @@ void linphone_core_update_ice_from_remote_media_description(LinphoneCall *call,
 		for (i = 0; i < md->nb_streams; i++) {
 			const SalStreamDescription *stream = &md->streams[i];
 			IceCheckList *cl = ice_session_check_list(call->ice_session, i);
-			if (cl && (stream->ice_pwd[0] != '\0') && (stream->ice_ufrag[0] != '\0')) {
+			if (cl && (stream->ice_pwd != NULL) && (stream->ice_ufrag != NULL)) {
 				if (ice_check_list_remote_credentials_changed(cl, stream->ice_ufrag, stream->ice_pwd)) {
 					if (ice_restarted == FALSE) {
 						ice_session_restart(call->ice_session);
@@ -894,9 +893,9 @@ void linphone_core_update_ice_from_remote_media_description(LinphoneCall *call,
 				ice_session_remove_check_list(call->ice_session, cl);
 				clear_ice_check_list(call,cl);
 			} else {
-				if ((stream->ice_pwd[0] != '\0') && (stream->ice_ufrag[0] != '\0'))
+				if ((stream->ice_pwd != NULL) && (stream->ice_ufrag != NULL))
 					ice_check_list_set_remote_credentials(cl, stream->ice_ufrag, stream->ice_pwd);
-				for (j = 0; j < SAL_MEDIA_DESCRIPTION_MAX_ICE_CANDIDATES; j++) {
+				for (j = 0; j < stream->nb_ice_candidates; j++) {
 					const SalIceCandidate *candidate = &stream->ice_candidates[j];
 					bool_t default_candidate = FALSE;
 					const char *addr = NULL;
@@ -1564,3 +1563,42 @@ bool_t linphone_core_symmetric_rtp_enabled(LinphoneCore*lc){
 	return lp_config_get_int(lc->config,"rtp","symmetric",1);
 }
 
+
+const uint8_t *linphone_send_buffer_gather(LinphoneSendBuffer *buffer, const mblk_t *msg, size_t *len){
+	if (msg->b_cont==NULL){
+		/*already contiguous, send it in place*/
+		*len=(size_t)(msg->b_wptr-msg->b_rptr);
+		return msg->b_rptr;
+	}
+	return linphone_send_buffer_gather_with_header(buffer,NULL,0,msg,len);
+}
+
+const uint8_t *linphone_send_buffer_gather_with_header(LinphoneSendBuffer *buffer, const uint8_t *header, size_t header_size, const mblk_t *msg, size_t *len){
+	const mblk_t *m;
+	size_t total=header_size;
+	uint8_t *wptr;
+
+	for(m=msg;m!=NULL;m=m->b_cont) total+=(size_t)(m->b_wptr-m->b_rptr);
+	if (total>buffer->size){
+		buffer->data=ms_realloc(buffer->data,total);
+		buffer->size=total;
+	}
+	wptr=buffer->data;
+	if (header_size>0){
+		memcpy(wptr,header,header_size);
+		wptr+=header_size;
+	}
+	for(m=msg;m!=NULL;m=m->b_cont){
+		size_t fraglen=(size_t)(m->b_wptr-m->b_rptr);
+		memcpy(wptr,m->b_rptr,fraglen);
+		wptr+=fraglen;
+	}
+	*len=total;
+	return buffer->data;
+}
+
+void linphone_send_buffer_uninit(LinphoneSendBuffer *buffer){
+	if (buffer->data) ms_free(buffer->data);
+	buffer->data=NULL;
+	buffer->size=0;
+}
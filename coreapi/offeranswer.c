@@ -21,6 +21,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "offeranswer.h"
 #include "private.h"
 
+#include <ctype.h>
+
 static bool_t only_telephone_event(const MSList *l){
 	for(;l!=NULL;l=l->next){
 		PayloadType *p=(PayloadType*)l->data;
@@ -31,49 +33,153 @@ static bool_t only_telephone_event(const MSList *l){
 	return TRUE;
 }
 
-static PayloadType * find_payload_type_best_match(const MSList *l, const PayloadType *refpt){
+/*
+ * Index of the local payload types of a stream, so that each remote payload type is matched with a hash probe
+ * instead of a scan of the local list. It is built at the first negotiation of the stream and kept with the local
+ * media description, which is reused by all the negotiations of a call: the payload types of a description do not
+ * change once it is made, a new description is made when the codecs change.
+ * Payload types are keyed by their case insensitive mime type, clock rate and channels. Entries of a bucket
+ * chain keep the order of the local list, which gives the local preference order when several entries match.
+ */
+#define PAYLOAD_INDEX_SIZE 64
+
+typedef struct PayloadIndexEntry{
 	PayloadType *pt;
+	unsigned int mime_hash;
+	unsigned int key_hash;
+	int position;
+	int packetization_mode; /*parsed from the fmtp of H264 payload types, -1 when not set*/
+	struct PayloadIndexEntry *next_key;
+	struct PayloadIndexEntry *next_mime;
+}PayloadIndexEntry;
+
+/*allocated as a single block, so that sal_media_description_destroy() frees it with ms_free()*/
+typedef struct PayloadIndex{
+	const MSList *payloads; /*the local list the index was built from*/
+	int nb_payloads;
+	PayloadIndexEntry *entries; /*nb_payloads elements, following the structure*/
+	PayloadIndexEntry *by_key[PAYLOAD_INDEX_SIZE];
+	PayloadIndexEntry *by_mime[PAYLOAD_INDEX_SIZE];
+}PayloadIndex;
+
+static unsigned int mime_type_hash(const char *mime_type){
+	unsigned int h=2166136261U;
+	for(;*mime_type!='\0';mime_type++){
+		h^=(unsigned char)tolower((unsigned char)*mime_type);
+		h*=16777619U;
+	}
+	return h;
+}
+
+static unsigned int payload_key_hash(unsigned int mime_hash, int clock_rate, int channels){
+	return mime_hash ^ ((unsigned int)clock_rate*2654435761U) ^ ((unsigned int)channels*40503U);
+}
+
+static int get_packetization_mode(const PayloadType *pt){
 	char value[10];
+	if (strcasecmp(pt->mime_type,"H264")!=0 || pt->recv_fmtp==NULL) return -1;
+	if (fmtp_get_value(pt->recv_fmtp,"packetization-mode",value,sizeof(value))) return atoi(value);
+	return 0;
+}
+
+static PayloadIndex *payload_index_new(const MSList *l){
+	PayloadIndexEntry **key_tails[PAYLOAD_INDEX_SIZE];
+	PayloadIndexEntry **mime_tails[PAYLOAD_INDEX_SIZE];
+	int nb_payloads=ms_list_size(l);
+	PayloadIndex *index=(PayloadIndex*)ms_malloc0(sizeof(PayloadIndex)+nb_payloads*sizeof(PayloadIndexEntry));
 	const MSList *elem;
-	PayloadType *candidate=NULL;
-
-	for (elem=l;elem!=NULL;elem=elem->next){
-		pt=(PayloadType*)elem->data;
-		
-		/*workaround a bug in earlier versions of linphone where opus/48000/1 is offered, which is uncompliant with opus rtp draft*/
-		if (refpt->mime_type && strcasecmp(refpt->mime_type,"opus")==0 && refpt->channels==1
-			&& strcasecmp(pt->mime_type,refpt->mime_type)==0){
-			pt->channels=1; /*so that we respond with same number of channels */
-			candidate=pt;
-			break;
-		}
-		
-		/* the compare between G729 and G729A is for some stupid uncompliant phone*/
-		if ( pt->mime_type && refpt->mime_type &&
-			(strcasecmp(pt->mime_type,refpt->mime_type)==0  ||
-			(strcasecmp(pt->mime_type, "G729") == 0 && strcasecmp(refpt->mime_type, "G729A") == 0 ))
-			&& pt->clock_rate==refpt->clock_rate && pt->channels==refpt->channels){
-			candidate=pt;
-			/*good candidate, check fmtp for H264 */
-			if (strcasecmp(pt->mime_type,"H264")==0){
-				if (pt->recv_fmtp!=NULL && refpt->recv_fmtp!=NULL){
-					int mode1=0,mode2=0;
-					if (fmtp_get_value(pt->recv_fmtp,"packetization-mode",value,sizeof(value))){
-						mode1=atoi(value);
-					}
-					if (fmtp_get_value(refpt->recv_fmtp,"packetization-mode",value,sizeof(value))){
-						mode2=atoi(value);
-					}
-					if (mode1==mode2)
-						break; /*exact match */
-				}
-			}else break;
-		}
+	int i;
+
+	index->payloads=l;
+	index->nb_payloads=nb_payloads;
+	index->entries=(PayloadIndexEntry*)(index+1);
+	for(i=0;i<PAYLOAD_INDEX_SIZE;i++){
+		key_tails[i]=&index->by_key[i];
+		mime_tails[i]=&index->by_mime[i];
+	}
+	for(elem=l,i=0;elem!=NULL;elem=elem->next){
+		PayloadType *pt=(PayloadType*)elem->data;
+		PayloadIndexEntry *entry;
+		if (pt->mime_type==NULL) continue;
+		entry=&index->entries[i];
+		entry->pt=pt;
+		entry->position=i++;
+		entry->mime_hash=mime_type_hash(pt->mime_type);
+		entry->key_hash=payload_key_hash(entry->mime_hash,pt->clock_rate,pt->channels);
+		entry->packetization_mode=get_packetization_mode(pt);
+		*key_tails[entry->key_hash%PAYLOAD_INDEX_SIZE]=entry;
+		key_tails[entry->key_hash%PAYLOAD_INDEX_SIZE]=&entry->next_key;
+		*mime_tails[entry->mime_hash%PAYLOAD_INDEX_SIZE]=entry;
+		mime_tails[entry->mime_hash%PAYLOAD_INDEX_SIZE]=&entry->next_mime;
+	}
+	return index;
+}
+
+/*the index is a cache: it is stored in the local description even though the negotiation does not change it otherwise*/
+static const PayloadIndex *get_payload_index(const SalMediaDescription *md, const SalStreamDescription *sd){
+	void **cached=&((SalMediaDescription*)md)->payload_indexes[sd-md->streams];
+	PayloadIndex *index=(PayloadIndex*)*cached;
+
+	if (index==NULL || index->payloads!=sd->payloads || index->nb_payloads!=ms_list_size(sd->payloads)){
+		if (index!=NULL) ms_free(index);
+		index=payload_index_new(sd->payloads);
+		*cached=index;
+	}
+	return index;
+}
+
+/*
+ * Returns the entry of the first local payload type with the given mime type, clock rate and channels.
+ * For H264, an entry with the same packetization mode as the reference is preferred, otherwise the last
+ * H264 entry is returned.
+ */
+static PayloadIndexEntry *payload_index_find(const PayloadIndex *index, const char *mime_type, unsigned int mime_hash,
+	const PayloadType *refpt, int ref_packetization_mode){
+	unsigned int key_hash=payload_key_hash(mime_hash,refpt->clock_rate,refpt->channels);
+	PayloadIndexEntry *entry;
+	PayloadIndexEntry *candidate=NULL;
+
+	for(entry=index->by_key[key_hash%PAYLOAD_INDEX_SIZE];entry!=NULL;entry=entry->next_key){
+		if (entry->key_hash!=key_hash || entry->pt->clock_rate!=refpt->clock_rate || entry->pt->channels!=refpt->channels
+			|| strcasecmp(entry->pt->mime_type,mime_type)!=0) continue;
+		candidate=entry;
+		/*good candidate, check fmtp for H264 */
+		if (entry->packetization_mode==-1 && strcasecmp(mime_type,"H264")!=0) break;
+		if (entry->packetization_mode!=-1 && ref_packetization_mode!=-1 && entry->packetization_mode==ref_packetization_mode)
+			break; /*exact match */
 	}
 	return candidate;
 }
 
-static MSList *match_payloads(const MSList *local, const MSList *remote, bool_t reading_response, bool_t one_matching_codec){
+static PayloadType * payload_index_find_best_match(const PayloadIndex *index, const PayloadType *refpt){
+	PayloadIndexEntry *entry;
+	PayloadIndexEntry *candidate;
+	unsigned int mime_hash;
+
+	if (refpt->mime_type==NULL) return NULL;
+	mime_hash=mime_type_hash(refpt->mime_type);
+
+	/*workaround a bug in earlier versions of linphone where opus/48000/1 is offered, which is uncompliant with opus rtp draft*/
+	if (refpt->channels==1 && strcasecmp(refpt->mime_type,"opus")==0){
+		for(entry=index->by_mime[mime_hash%PAYLOAD_INDEX_SIZE];entry!=NULL;entry=entry->next_mime){
+			if (entry->mime_hash==mime_hash && strcasecmp(entry->pt->mime_type,refpt->mime_type)==0){
+				entry->pt->channels=1; /*so that we respond with same number of channels */
+				return entry->pt;
+			}
+		}
+	}
+
+	candidate=payload_index_find(index,refpt->mime_type,mime_hash,refpt,get_packetization_mode(refpt));
+	/* the compare between G729 and G729A is for some stupid uncompliant phone*/
+	if (strcasecmp(refpt->mime_type,"G729A")==0){
+		PayloadIndexEntry *g729=payload_index_find(index,"G729",mime_type_hash("G729"),refpt,-1);
+		if (g729 && (candidate==NULL || g729->position<candidate->position)) candidate=g729;
+	}
+	return candidate ? candidate->pt : NULL;
+}
+
+static MSList *match_payloads(const PayloadIndex *index, const MSList *remote, bool_t reading_response, bool_t one_matching_codec){
+	const MSList *local=index->payloads;
 	const MSList *e2,*e1;
 	MSList *res=NULL;
 	PayloadType *matched;
@@ -81,7 +187,7 @@ static MSList *match_payloads(const MSList *local, const MSList *remote, bool_t
 
 	for(e2=remote;e2!=NULL;e2=e2->next){
 		PayloadType *p2=(PayloadType*)e2->data;
-		matched=find_payload_type_best_match(local,p2);
+		matched=payload_index_find_best_match(index,p2);
 		if (matched){
 			PayloadType *newp;
 			int local_number=payload_type_get_number(matched);
@@ -222,11 +328,11 @@ static SalStreamDir compute_dir_incoming(SalStreamDir local, SalStreamDir offere
 	return res;
 }
 
-static void initiate_outgoing(const SalStreamDescription *local_offer,
+static void initiate_outgoing(const SalMediaDescription *local_md, const SalStreamDescription *local_offer,
 						const SalStreamDescription *remote_answer,
 						SalStreamDescription *result){
 	if (remote_answer->rtp_port!=0)
-		result->payloads=match_payloads(local_offer->payloads,remote_answer->payloads,TRUE,FALSE);
+		result->payloads=match_payloads(get_payload_index(local_md,local_offer),remote_answer->payloads,TRUE,FALSE);
 	result->proto=remote_answer->proto;
 	result->type=local_offer->type;
 	result->dir=compute_dir_outgoing(local_offer->dir,remote_answer->dir);
@@ -250,10 +356,10 @@ static void initiate_outgoing(const SalStreamDescription *local_offer,
 }
 
 
-static void initiate_incoming(const SalStreamDescription *local_cap,
+static void initiate_incoming(const SalMediaDescription *local_md, const SalStreamDescription *local_cap,
 						const SalStreamDescription *remote_offer,
 						SalStreamDescription *result, bool_t one_matching_codec){
-	result->payloads=match_payloads(local_cap->payloads,remote_offer->payloads, FALSE, one_matching_codec);
+	result->payloads=match_payloads(get_payload_index(local_md,local_cap),remote_offer->payloads, FALSE, one_matching_codec);
 	result->proto=remote_offer->proto;
 	result->type=local_cap->type;
 	result->dir=compute_dir_incoming(local_cap->dir,remote_offer->dir);
@@ -274,11 +380,11 @@ static void initiate_incoming(const SalStreamDescription *local_cap,
 			result->rtp_port = 0;
 
 	}
-	strcpy(result->ice_pwd, local_cap->ice_pwd);
-	strcpy(result->ice_ufrag, local_cap->ice_ufrag);
+	sal_shared_string_assign(&result->ice_pwd, local_cap->ice_pwd);
+	sal_shared_string_assign(&result->ice_ufrag, local_cap->ice_ufrag);
 	result->ice_mismatch = local_cap->ice_mismatch;
 	result->ice_completed = local_cap->ice_completed;
-	memcpy(result->ice_candidates, local_cap->ice_candidates, sizeof(result->ice_candidates));
+	sal_stream_description_set_ice_candidates(result, local_cap->ice_candidates, local_cap->nb_ice_candidates);
 	memcpy(result->ice_remote_candidates, local_cap->ice_remote_candidates, sizeof(result->ice_remote_candidates));
 	strcpy(result->name,local_cap->name);
 }
@@ -298,7 +404,7 @@ int offer_answer_initiate_outgoing(const SalMediaDescription *local_offer,
 		ls=&local_offer->streams[i];
 		rs=sal_media_description_find_stream((SalMediaDescription*)remote_answer,ls->proto,ls->type);
 		if (rs) {
-			initiate_outgoing(ls,rs,&result->streams[j]);
+			initiate_outgoing(local_offer,ls,rs,&result->streams[j]);
 			memcpy(&result->streams[i].rtcp_xr, &ls->rtcp_xr, sizeof(result->streams[i].rtcp_xr));
 			if ((ls->rtcp_xr.enabled == TRUE) && (rs->rtcp_xr.enabled == FALSE)) {
 				result->streams[i].rtcp_xr.enabled = FALSE;
@@ -366,7 +472,7 @@ int offer_answer_initiate_incoming(const SalMediaDescription *local_capabilities
 			ls=find_local_matching_stream(result,local_capabilities,rs);
 		}else ms_warning("Unknown protocol for mline %i, declining",i);
 		if (ls){
-			initiate_incoming(ls,rs,&result->streams[i],one_matching_codec);
+			initiate_incoming(local_capabilities,ls,rs,&result->streams[i],one_matching_codec);
 
 			// Handle media RTCP XR attribute
 			memset(&result->streams[i].rtcp_xr, 0, sizeof(result->streams[i].rtcp_xr));
@@ -401,8 +507,8 @@ int offer_answer_initiate_incoming(const SalMediaDescription *local_capabilities
 	result->bandwidth=local_capabilities->bandwidth;
 	result->session_ver=local_capabilities->session_ver;
 	result->session_id=local_capabilities->session_id;
-	strcpy(result->ice_pwd, local_capabilities->ice_pwd);
-	strcpy(result->ice_ufrag, local_capabilities->ice_ufrag);
+	sal_shared_string_assign(&result->ice_pwd, local_capabilities->ice_pwd);
+	sal_shared_string_assign(&result->ice_ufrag, local_capabilities->ice_ufrag);
 	result->ice_lite = local_capabilities->ice_lite;
 	result->ice_completed = local_capabilities->ice_completed;
 
@@ -72,8 +72,16 @@ struct _LinphonePresenceModel {
 	MSList *services;	/**< A list of _LinphonePresenceService structures. Also named tuples in the RFC. */
 	MSList *persons;	/**< A list of _LinphonePresencePerson structures. */
 	MSList *notes;		/**< A list of _LinphonePresenceNote structures. */
+	char *entity;		/**< The entity of the parsed document, used to dispatch resource list notifications. */
+	unsigned int version;	/**< Bumped whenever the lists of the model change, see linphone_presence_model_get_version(). */
 };
 
+/*
+ * Services, persons, activities and notes may be shared by several models and do not know them: any change to one of
+ * them is accounted in this counter instead of in the version of its models.
+ */
+static unsigned int presence_elements_version = 0;
+
 
 static const char *person_prefix = "/pidf:presence/dm:person";
 
@@ -141,10 +149,12 @@ static void presence_service_delete(LinphonePresenceService *service) {
 
 static void presence_service_set_timestamp(LinphonePresenceService *service, time_t timestamp) {
 	service->timestamp = timestamp;
+	presence_elements_version++;
 }
 
 static void presence_service_add_note(LinphonePresenceService *service, LinphonePresenceNote *note) {
 	service->notes = ms_list_append(service->notes, note);
+	presence_elements_version++;
 }
 
 static void presence_activity_delete(LinphonePresenceActivity *activity) {
@@ -214,18 +224,22 @@ static void presence_person_delete(LinphonePresencePerson *person) {
 
 static void presence_person_add_activities_note(LinphonePresencePerson *person, LinphonePresenceNote *note) {
 	person->activities_notes = ms_list_append(person->activities_notes, note);
+	presence_elements_version++;
 }
 
 static void presence_person_add_note(LinphonePresencePerson *person, LinphonePresenceNote *note) {
 	person->notes = ms_list_append(person->notes, note);
+	presence_elements_version++;
 }
 
 static void presence_model_add_person(LinphonePresenceModel *model, LinphonePresencePerson *person) {
 	model->persons = ms_list_append(model->persons, person);
+	model->version++;
 }
 
 static void presence_model_add_note(LinphonePresenceModel *model, LinphonePresenceNote *note) {
 	model->notes = ms_list_append(model->notes, note);
+	model->version++;
 }
 
 static void presence_model_find_open_basic_status(LinphonePresenceService *service, LinphonePresenceBasicStatus *status) {
@@ -243,6 +257,7 @@ static void presence_model_delete(LinphonePresenceModel *model) {
 	ms_list_free(model->persons);
 	ms_list_for_each(model->notes, (MSIterateFunc)linphone_presence_note_unref);
 	ms_list_free(model->notes);
+	if (model->entity != NULL) ms_free(model->entity);
 	ms_free(model);
 }
 
@@ -433,6 +448,7 @@ int linphone_presence_model_add_activity(LinphonePresenceModel *model, LinphoneP
 	}
 
 	linphone_presence_person_add_activity(person, activity);
+	model->version++;
 	return 0;
 }
 
@@ -440,6 +456,7 @@ int linphone_presence_model_clear_activities(LinphonePresenceModel *model) {
 	if (model == NULL) return -1;
 
 	ms_list_for_each(model->persons, (MSIterateFunc)linphone_presence_person_clear_activities);
+	model->version++;
 	return 0;
 }
 
@@ -568,6 +585,7 @@ int linphone_presence_model_add_note(LinphonePresenceModel *model, const char *n
 
 	presence_service_add_note(service, note);
 
+	model->version++;
 	return 0;
 }
 
@@ -578,12 +596,14 @@ static void clear_presence_person_notes(LinphonePresencePerson *person) {
 	ms_list_for_each(person->notes, (MSIterateFunc)linphone_presence_note_unref);
 	ms_list_free(person->notes);
 	person->notes = NULL;
+	presence_elements_version++;
 }
 
 static void clear_presence_service_notes(LinphonePresenceService *service) {
 	ms_list_for_each(service->notes, (MSIterateFunc)linphone_presence_note_unref);
 	ms_list_free(service->notes);
 	service->notes = NULL;
+	presence_elements_version++;
 }
 
 int linphone_presence_model_clear_notes(LinphonePresenceModel *model) {
@@ -596,6 +616,7 @@ int linphone_presence_model_clear_notes(LinphonePresenceModel *model) {
 	ms_list_free(model->notes);
 	model->notes = NULL;
 
+	model->version++;
 	return 0;
 }
 
@@ -603,6 +624,11 @@ int linphone_presence_model_clear_notes(LinphonePresenceModel *model) {
  * PRESENCE MODEL FUNCTIONS TO GET ACCESS TO ALL FUNCTIONALITIES             *
  ****************************************************************************/
 
+unsigned int linphone_presence_model_get_version(const LinphonePresenceModel *model) {
+	/*both counters only grow, so the sum changes whenever either of them does*/
+	return model->version + presence_elements_version;
+}
+
 LinphonePresenceModel * linphone_presence_model_new(void) {
 	LinphonePresenceModel *model = ms_new0(LinphonePresenceModel, 1);
 	model->refcnt = 1;
@@ -623,6 +649,7 @@ LinphonePresenceService * linphone_presence_model_get_nth_service(const Linphone
 int linphone_presence_model_add_service(LinphonePresenceModel *model, LinphonePresenceService *service) {
 	if ((model == NULL) || (service == NULL)) return -1;
 	model->services = ms_list_append(model->services, linphone_presence_service_ref(service));
+	model->version++;
 	return 0;
 }
 
@@ -632,6 +659,7 @@ int linphone_presence_model_clear_services(LinphonePresenceModel *model) {
 	ms_list_for_each(model->services, (MSIterateFunc)linphone_presence_service_unref);
 	ms_list_free(model->services);
 	model->services = NULL;
+	model->version++;
 	return 0;
 }
 
@@ -649,6 +677,7 @@ LinphonePresencePerson * linphone_presence_model_get_nth_person(const LinphonePr
 int linphone_presence_model_add_person(LinphonePresenceModel *model, LinphonePresencePerson *person) {
 	if ((model == NULL) || (person == NULL)) return -1;
 	model->persons = ms_list_append(model->persons, linphone_presence_person_ref(person));
+	model->version++;
 	return 0;
 }
 
@@ -658,6 +687,7 @@ int linphone_presence_model_clear_persons(LinphonePresenceModel *model) {
 	ms_list_for_each(model->persons, (MSIterateFunc)linphone_presence_person_unref);
 	ms_list_free(model->persons);
 	model->persons = NULL;
+	model->version++;
 	return 0;
 }
 
@@ -694,6 +724,7 @@ int linphone_presence_service_set_id(LinphonePresenceService *service, const cha
 		service->id = generate_presence_id();
 	else
 		service->id = ms_strdup(id);
+	presence_elements_version++;
 	return 0;
 }
 
@@ -705,6 +736,7 @@ LinphonePresenceBasicStatus linphone_presence_service_get_basic_status(const Lin
 int linphone_presence_service_set_basic_status(LinphonePresenceService *service, LinphonePresenceBasicStatus basic_status) {
 	if (service == NULL) return -1;
 	service->status = basic_status;
+	presence_elements_version++;
 	return 0;
 }
 
@@ -721,6 +753,7 @@ int linphone_presence_service_set_contact(LinphonePresenceService *service, cons
 		service->contact = ms_strdup(contact);
 	else
 		service->contact = NULL;
+	presence_elements_version++;
 	return 0;
 }
 
@@ -738,6 +771,7 @@ LinphonePresenceNote * linphone_presence_service_get_nth_note(const LinphonePres
 int linphone_presence_service_add_note(LinphonePresenceService *service, LinphonePresenceNote *note) {
 	if ((service == NULL) || (note == NULL)) return -1;
 	service->notes = ms_list_append(service->notes, linphone_presence_note_ref(note));
+	presence_elements_version++;
 	return 0;
 }
 
@@ -747,6 +781,7 @@ int linphone_presence_service_clear_notes(LinphonePresenceService *service) {
 	ms_list_for_each(service->notes, (MSIterateFunc)linphone_presence_note_unref);
 	ms_list_free(service->notes);
 	service->notes = NULL;
+	presence_elements_version++;
 	return 0;
 }
 
@@ -773,6 +808,7 @@ int linphone_presence_person_set_id(LinphonePresencePerson *person, const char *
 		person->id = generate_presence_id();
 	else
 		person->id = ms_strdup(id);
+	presence_elements_version++;
 	return 0;
 }
 
@@ -790,6 +826,7 @@ LinphonePresenceActivity * linphone_presence_person_get_nth_activity(const Linph
 int linphone_presence_person_add_activity(LinphonePresencePerson *person, LinphonePresenceActivity *activity) {
 	if ((person == NULL) || (activity == NULL)) return -1;
 	person->activities = ms_list_append(person->activities, linphone_presence_activity_ref(activity));
+	presence_elements_version++;
 	return 0;
 }
 
@@ -798,6 +835,7 @@ int linphone_presence_person_clear_activities(LinphonePresencePerson *person) {
 	ms_list_for_each(person->activities, (MSIterateFunc)linphone_presence_activity_unref);
 	ms_list_free(person->activities);
 	person->activities = NULL;
+	presence_elements_version++;
 	return 0;
 }
 
@@ -815,6 +853,7 @@ LinphonePresenceNote * linphone_presence_person_get_nth_note(const LinphonePrese
 int linphone_presence_person_add_note(LinphonePresencePerson *person, LinphonePresenceNote *note) {
 	if ((person == NULL) || (note == NULL)) return -1;
 	person->notes = ms_list_append(person->notes, linphone_presence_note_ref(note));
+	presence_elements_version++;
 	return 0;
 }
 
@@ -823,6 +862,7 @@ int linphone_presence_person_clear_notes(LinphonePresencePerson *person) {
 	ms_list_for_each(person->notes, (MSIterateFunc)linphone_presence_note_unref);
 	ms_list_free(person->notes);
 	person->notes = NULL;
+	presence_elements_version++;
 	return 0;
 }
 
@@ -840,6 +880,7 @@ LinphonePresenceNote * linphone_presence_person_get_nth_activities_note(const Li
 int linphone_presence_person_add_activities_note(LinphonePresencePerson *person, LinphonePresenceNote *note) {
 	if ((person == NULL) || (note == NULL)) return -1;
 	person->notes = ms_list_append(person->activities_notes, linphone_presence_note_ref(note));
+	presence_elements_version++;
 	return 0;
 }
 
@@ -848,6 +889,7 @@ int linphone_presence_person_clear_activities_notes(LinphonePresencePerson *pers
 	ms_list_for_each(person->activities_notes, (MSIterateFunc)linphone_presence_note_unref);
 	ms_list_free(person->activities_notes);
 	person->activities_notes = NULL;
+	presence_elements_version++;
 	return 0;
 }
 
@@ -948,6 +990,7 @@ LinphonePresenceActivityType linphone_presence_activity_get_type(const LinphoneP
 int linphone_presence_activity_set_type(LinphonePresenceActivity *activity, LinphonePresenceActivityType acttype) {
 	if (activity == NULL) return -1;
 	activity->type = acttype;
+	presence_elements_version++;
 	return 0;
 }
 
@@ -965,6 +1008,7 @@ int linphone_presence_activity_set_description(LinphonePresenceActivity *activit
 		activity->description = ms_strdup(description);
 	else
 		activity->description = NULL;
+	presence_elements_version++;
 	return 0;
 }
 
@@ -999,6 +1043,7 @@ int linphone_presence_note_set_content(LinphonePresenceNote *note, const char *c
 		ms_free(note->content);
 	}
 	note->content = ms_strdup(content);
+	presence_elements_version++;
 	return 0;
 }
 
@@ -1016,6 +1061,7 @@ int linphone_presence_note_set_lang(LinphonePresenceNote *note, const char *lang
 	if (lang != NULL) {
 		note->lang = ms_strdup(lang);
 	}
+	presence_elements_version++;
 	return 0;
 }
 
@@ -1424,6 +1470,13 @@ static LinphonePresenceModel * process_pidf_xml_presence_notification(xmlparsing
 	if (err == 0) {
 		err = process_pidf_xml_presence_notes(xml_ctx, model);
 	}
+	if (err == 0) {
+		char *entity = linphone_get_xml_text_content(xml_ctx, "/pidf:presence/@entity");
+		if (entity != NULL) {
+			model->entity = ms_strdup(entity);
+			linphone_free_xml_text_content(entity);
+		}
+	}
 
 	if (err < 0) {
 		linphone_presence_model_unref(model);
@@ -1433,13 +1486,350 @@ static LinphonePresenceModel * process_pidf_xml_presence_notification(xmlparsing
 	return model;
 }
 
+LinphonePresenceModel * linphone_presence_model_parse_pidf_xpath(const char *body) {
+	xmlparsing_context_t *xml_ctx = linphone_xmlparsing_context_new();
+	LinphonePresenceModel *model = NULL;
+
+	xmlSetGenericErrorFunc(xml_ctx, linphone_xmlparsing_genericxml_error);
+	xml_ctx->doc = xmlReadDoc((const unsigned char*)body, 0, NULL, 0);
+	if (xml_ctx->doc != NULL) {
+		model = process_pidf_xml_presence_notification(xml_ctx);
+	} else {
+		ms_warning("Wrongly formatted presence XML: %s", xml_ctx->errorBuffer);
+	}
+	linphone_xmlparsing_context_destroy(xml_ctx);
+	return model;
+}
+
+
+
+/*****************************************************************************
+ * STREAMING PIDF PARSER                                                     *
+ ****************************************************************************/
+
+/*
+ * The PIDF documents are parsed in a single pass from the SAX events, without building a DOM nor evaluating XPath
+ * expressions. The result is the same as the one of linphone_presence_model_parse_pidf_xpath(): the tuples, persons and
+ * notes are kept in document order, and a tuple without basic status is ignored.
+ */
+
+static const char *pidf_ns = "urn:ietf:params:xml:ns:pidf";
+static const char *dm_ns = "urn:ietf:params:xml:ns:pidf:data-model";
+static const char *rpid_ns = "urn:ietf:params:xml:ns:pidf:rpid";
+static const char *xml_ns = "http://www.w3.org/XML/1998/namespace";
+
+typedef enum _PidfElement {
+	PidfElementNone,
+	PidfElementTuple,
+	PidfElementPerson
+} PidfElement;
+
+typedef enum _PidfText {
+	PidfTextNone,
+	PidfTextBasic,
+	PidfTextTimestamp,
+	PidfTextContact,
+	PidfTextNote,
+	PidfTextActivity
+} PidfText;
+
+typedef struct _PidfParser {
+	LinphonePresenceModel *model;
+	int depth;
+	int err;
+	bool_t in_presence;
+	bool_t in_status;
+	bool_t in_activities;
+	/* Tuple or person being parsed. */
+	PidfElement element;
+	char *id;
+	char *basic;
+	char *timestamp;
+	char *contact;
+	MSList *notes;
+	MSList *activities;
+	MSList *activities_notes;
+	/* Element whose text content is being collected. */
+	PidfText text_type;
+	int text_depth;
+	char *text;
+	size_t text_len;
+	size_t text_size;
+	char *lang;
+	LinphonePresenceActivityType acttype;
+	char error[XMLPARSING_BUFFER_LEN];
+} PidfParser;
+
+static bool_t pidf_element_is(const xmlChar *localname, const xmlChar *uri, const char *name, const char *ns) {
+	return (uri != NULL) && (strcmp((const char *)localname, name) == 0) && (strcmp((const char *)uri, ns) == 0);
+}
+
+/* The attributes are given as (localname, prefix, URI, value, end) tuples. */
+static char * pidf_get_attribute(int nb_attributes, const xmlChar **attributes, const char *name, const char *ns) {
+	int i;
+	for (i = 0; i < nb_attributes; i++) {
+		const xmlChar **attr = attributes + i * 5;
+		if (strcmp((const char *)attr[0], name) != 0) continue;
+		if ((ns == NULL) ? (attr[2] != NULL) : ((attr[2] == NULL) || (strcmp((const char *)attr[2], ns) != 0))) continue;
+		{
+			/* libxml2 gives the ampersands of attribute values as character references. */
+			size_t len = attr[4] - attr[3];
+			char *value = ms_malloc(len + 1);
+			const char *r = (const char *)attr[3];
+			const char *end = (const char *)attr[4];
+			char *w = value;
+			while (r < end) {
+				if (((size_t)(end - r) >= 5) && (strncmp(r, "&#38;", 5) == 0)) {
+					*w++ = '&';
+					r += 5;
+				} else {
+					*w++ = *r++;
+				}
+			}
+			*w = '\0';
+			return value;
+		}
+	}
+	return NULL;
+}
+
+static void pidf_parser_set(char **field, char *value) {
+	if (*field != NULL) ms_free(*field);
+	*field = value;
+}
+
+static void pidf_parser_clear_element(PidfParser *parser) {
+	pidf_parser_set(&parser->id, NULL);
+	pidf_parser_set(&parser->basic, NULL);
+	pidf_parser_set(&parser->timestamp, NULL);
+	pidf_parser_set(&parser->contact, NULL);
+	ms_list_for_each(parser->notes, (MSIterateFunc)linphone_presence_note_unref);
+	parser->notes = ms_list_free(parser->notes);
+	ms_list_for_each(parser->activities, (MSIterateFunc)linphone_presence_activity_unref);
+	parser->activities = ms_list_free(parser->activities);
+	ms_list_for_each(parser->activities_notes, (MSIterateFunc)linphone_presence_note_unref);
+	parser->activities_notes = ms_list_free(parser->activities_notes);
+	parser->element = PidfElementNone;
+	parser->in_status = FALSE;
+	parser->in_activities = FALSE;
+}
+
+static void pidf_parser_start_text(PidfParser *parser, PidfText type, int nb_attributes, const xmlChar **attributes) {
+	parser->text_type = type;
+	parser->text_depth = parser->depth;
+	parser->text_len = 0;
+	if (type == PidfTextNote) pidf_parser_set(&parser->lang, pidf_get_attribute(nb_attributes, attributes, "lang", xml_ns));
+}
+
+static void pidf_parser_end_tuple(PidfParser *parser) {
+	LinphonePresenceBasicStatus basic_status;
+	LinphonePresenceService *service;
+	MSList *elem;
+
+	if (parser->basic == NULL) return;
+	if (strcmp(parser->basic, "open") == 0) {
+		basic_status = LinphonePresenceBasicStatusOpen;
+	} else if (strcmp(parser->basic, "closed") == 0) {
+		basic_status = LinphonePresenceBasicStatusClosed;
+	} else {
+		/* Invalid value for basic status. */
+		parser->err = -1;
+		return;
+	}
+	service = presence_service_new(parser->id, basic_status);
+	if (parser->timestamp != NULL) presence_service_set_timestamp(service, parse_timestamp(parser->timestamp));
+	if (parser->contact != NULL) linphone_presence_service_set_contact(service, parser->contact);
+	for (elem = parser->notes; elem != NULL; elem = elem->next) {
+		presence_service_add_note(service, linphone_presence_note_ref((LinphonePresenceNote *)elem->data));
+	}
+	linphone_presence_model_add_service(parser->model, service);
+	linphone_presence_service_unref(service);
+}
+
+static void pidf_parser_end_person(PidfParser *parser) {
+	LinphonePresencePerson *person;
+	MSList *elem;
+
+	person = presence_person_new(parser->id, (parser->timestamp != NULL) ? parse_timestamp(parser->timestamp) : time(NULL));
+	for (elem = parser->activities; elem != NULL; elem = elem->next) {
+		linphone_presence_person_add_activity(person, (LinphonePresenceActivity *)elem->data);
+	}
+	for (elem = parser->activities_notes; elem != NULL; elem = elem->next) {
+		presence_person_add_activities_note(person, linphone_presence_note_ref((LinphonePresenceNote *)elem->data));
+	}
+	for (elem = parser->notes; elem != NULL; elem = elem->next) {
+		presence_person_add_note(person, linphone_presence_note_ref((LinphonePresenceNote *)elem->data));
+	}
+	presence_model_add_person(parser->model, person);
+}
+
+static void pidf_parser_end_text(PidfParser *parser) {
+	/* An element without content is ignored, as it has no text node. */
+	const char *text = (parser->text_len > 0) ? parser->text : NULL;
+
+	switch (parser->text_type) {
+		case PidfTextBasic:
+			pidf_parser_set(&parser->basic, text ? ms_strdup(text) : NULL);
+			break;
+		case PidfTextTimestamp:
+			pidf_parser_set(&parser->timestamp, text ? ms_strdup(text) : NULL);
+			break;
+		case PidfTextContact:
+			pidf_parser_set(&parser->contact, text ? ms_strdup(text) : NULL);
+			break;
+		case PidfTextNote:
+			if (text != NULL) {
+				LinphonePresenceNote *note = linphone_presence_note_new(text, parser->lang);
+				if (parser->element == PidfElementNone) presence_model_add_note(parser->model, note);
+				else if (parser->in_activities) parser->activities_notes = ms_list_append(parser->activities_notes, note);
+				else parser->notes = ms_list_append(parser->notes, note);
+			}
+			pidf_parser_set(&parser->lang, NULL);
+			break;
+		case PidfTextActivity:
+			parser->activities = ms_list_append(parser->activities, linphone_presence_activity_new(parser->acttype, text));
+			break;
+		case PidfTextNone:
+			break;
+	}
+	parser->text_type = PidfTextNone;
+}
+
+static void pidf_parser_start_element(void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *uri,
+				      int nb_namespaces, const xmlChar **namespaces, int nb_attributes, int nb_defaulted, const xmlChar **attributes) {
+	PidfParser *parser = (PidfParser *)ctx;
+
+	parser->depth++;
+	if ((parser->err < 0) || (parser->text_type != PidfTextNone)) return;
+	if (parser->depth == 1) {
+		parser->in_presence = pidf_element_is(localname, uri, "presence", pidf_ns);
+		if (parser->in_presence) parser->model->entity = pidf_get_attribute(nb_attributes, attributes, "entity", NULL);
+		else parser->err = -1; /* Not a PIDF document. */
+		return;
+	}
+	if (!parser->in_presence) return;
+
+	switch (parser->depth) {
+		case 2:
+			if (pidf_element_is(localname, uri, "tuple", pidf_ns)) {
+				parser->element = PidfElementTuple;
+				parser->id = pidf_get_attribute(nb_attributes, attributes, "id", NULL);
+			} else if (pidf_element_is(localname, uri, "person", dm_ns)) {
+				parser->element = PidfElementPerson;
+				parser->id = pidf_get_attribute(nb_attributes, attributes, "id", NULL);
+			} else if (pidf_element_is(localname, uri, "note", pidf_ns)) {
+				pidf_parser_start_text(parser, PidfTextNote, nb_attributes, attributes);
+			}
+			break;
+		case 3:
+			if (parser->element == PidfElementTuple) {
+				if (pidf_element_is(localname, uri, "status", pidf_ns)) parser->in_status = TRUE;
+				else if (pidf_element_is(localname, uri, "timestamp", pidf_ns)) pidf_parser_start_text(parser, PidfTextTimestamp, 0, NULL);
+				else if (pidf_element_is(localname, uri, "contact", pidf_ns)) pidf_parser_start_text(parser, PidfTextContact, 0, NULL);
+				else if (pidf_element_is(localname, uri, "note", pidf_ns)) pidf_parser_start_text(parser, PidfTextNote, nb_attributes, attributes);
+			} else if (parser->element == PidfElementPerson) {
+				if (pidf_element_is(localname, uri, "activities", rpid_ns)) parser->in_activities = TRUE;
+				else if (pidf_element_is(localname, uri, "timestamp", pidf_ns)) pidf_parser_start_text(parser, PidfTextTimestamp, 0, NULL);
+				else if (pidf_element_is(localname, uri, "note", dm_ns)) pidf_parser_start_text(parser, PidfTextNote, nb_attributes, attributes);
+			}
+			break;
+		case 4:
+			if (parser->in_status && pidf_element_is(localname, uri, "basic", pidf_ns)) {
+				pidf_parser_start_text(parser, PidfTextBasic, 0, NULL);
+			} else if (parser->in_activities && (uri != NULL) && (strcmp((const char *)uri, rpid_ns) == 0)) {
+				if (strcmp((const char *)localname, "note") == 0) {
+					pidf_parser_start_text(parser, PidfTextNote, nb_attributes, attributes);
+				} else if (activity_name_to_presence_activity_type((const char *)localname, &parser->acttype) == 0) {
+					pidf_parser_start_text(parser, PidfTextActivity, 0, NULL);
+				}
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+static void pidf_parser_end_element(void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *uri) {
+	PidfParser *parser = (PidfParser *)ctx;
+
+	if (parser->err < 0) {
+		parser->depth--;
+		return;
+	}
+	if (parser->text_type != PidfTextNone) {
+		if (parser->depth == parser->text_depth) pidf_parser_end_text(parser);
+	} else if (parser->in_presence) {
+		if (parser->depth == 3) {
+			parser->in_status = FALSE;
+			parser->in_activities = FALSE;
+		} else if (parser->depth == 2) {
+			if (parser->element == PidfElementTuple) pidf_parser_end_tuple(parser);
+			else if (parser->element == PidfElementPerson) pidf_parser_end_person(parser);
+			pidf_parser_clear_element(parser);
+		}
+	}
+	parser->depth--;
+}
+
+static void pidf_parser_characters(void *ctx, const xmlChar *ch, int len) {
+	PidfParser *parser = (PidfParser *)ctx;
+
+	if (parser->text_type == PidfTextNone) return;
+	if (parser->text_len + len + 1 > parser->text_size) {
+		parser->text_size = MAX(2 * parser->text_size, parser->text_len + len + 1);
+		parser->text = ms_realloc(parser->text, parser->text_size);
+	}
+	memcpy(parser->text + parser->text_len, ch, len);
+	parser->text_len += len;
+	parser->text[parser->text_len] = '\0';
+}
+
+static void pidf_parser_error(void *ctx, const char *fmt, ...) {
+	PidfParser *parser = (PidfParser *)ctx;
+	size_t sl = strlen(parser->error);
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(parser->error + sl, sizeof(parser->error) - sl, fmt, args);
+	va_end(args);
+}
+
+LinphonePresenceModel * linphone_presence_model_parse_pidf(const char *body, size_t len) {
+	xmlSAXHandler handler;
+	PidfParser parser;
+	int ret;
+
+	memset(&handler, 0, sizeof(handler));
+	handler.initialized = XML_SAX2_MAGIC;
+	handler.startElementNs = pidf_parser_start_element;
+	handler.endElementNs = pidf_parser_end_element;
+	handler.characters = pidf_parser_characters;
+	handler.error = pidf_parser_error;
+	handler.fatalError = pidf_parser_error;
+	memset(&parser, 0, sizeof(parser));
+	parser.model = linphone_presence_model_new();
+
+	ret = xmlSAXUserParseMemory(&handler, &parser, body, (int)len);
+	pidf_parser_clear_element(&parser);
+	pidf_parser_set(&parser.lang, NULL);
+	if (parser.text != NULL) ms_free(parser.text);
+	if (ret != 0) {
+		ms_warning("Wrongly formatted presence XML: %s", parser.error);
+		parser.err = -1;
+	}
+	if (parser.err < 0) {
+		linphone_presence_model_unref(parser.model);
+		return NULL;
+	}
+	return parser.model;
+}
+
 
 
 
 void linphone_core_add_subscriber(LinphoneCore *lc, const char *subscriber, SalOp *op){
 	LinphoneFriend *fl=linphone_friend_new_with_address(subscriber);
 	if (fl==NULL) return ;
-	fl->insub=op;
+	linphone_friend_set_inc_subscribe_op(fl,op);
 	linphone_friend_set_inc_subscribe_policy(fl,LinphoneSPAccept);
 	fl->inc_subscribe_pending=TRUE;
 	lc->subscribers=ms_list_append(lc->subscribers,(void *)fl);
@@ -1455,17 +1845,40 @@ void linphone_core_reject_subscriber(LinphoneCore *lc, LinphoneFriend *lf){
 }
 
 void linphone_core_notify_all_friends(LinphoneCore *lc, LinphonePresenceModel *presence){
-	MSList *elem;
 	LinphonePresenceActivity *activity = linphone_presence_model_get_activity(presence);
 	char *activity_str = linphone_presence_activity_to_string(activity);
 	ms_message("Notifying all friends that we are [%s]", activity_str);
 	if (activity_str != NULL) ms_free(activity_str);
-	for(elem=lc->friends;elem!=NULL;elem=elem->next){
-		LinphoneFriend *lf=(LinphoneFriend *)elem->data;
+	/*this is a new version of our presence: friends that were not notified of the previous one yet will only get this one*/
+	linphone_core_set_presence_notify_model(lc,presence);
+	ms_list_free(lc->presence_notify_queue);
+	/*friends without incoming subscription are skipped when the queue is processed*/
+	lc->presence_notify_queue=ms_list_copy(lc->friends);
+	linphone_core_send_queued_presence_notifies(lc);
+}
+
+/*
+ * Sends the NOTIFYs that are still pending for the last presence notified to all friends.
+ * They are sent by batches of sip/presence_notify_batch_size per call so that a presence change does not
+ * flood the network with hundreds of requests within a single iteration.
+ */
+void linphone_core_send_queued_presence_notifies(LinphoneCore *lc){
+	int batch_size;
+	int count=0;
+
+	if (lc->presence_notify_queue==NULL) return;
+	batch_size=lp_config_get_int(lc->config,"sip","presence_notify_batch_size",50);
+	while(lc->presence_notify_queue!=NULL && (batch_size<=0 || count<batch_size)){
+		LinphoneFriend *lf=(LinphoneFriend *)lc->presence_notify_queue->data;
+		lc->presence_notify_queue=ms_list_remove_link(lc->presence_notify_queue,lc->presence_notify_queue);
 		if (lf->insub){
-			linphone_friend_notify(lf,presence);
+			linphone_friend_notify(lf,lc->presence_notify_model);
+			count++;
 		}
 	}
+	if (lc->presence_notify_queue!=NULL){
+		ms_message("%i presence notifications sent, %i remaining.",count,ms_list_size(lc->presence_notify_queue));
+	}
 }
 
 void linphone_subscription_new(LinphoneCore *lc, SalOp *op, const char *from){
@@ -1490,8 +1903,8 @@ void linphone_subscription_new(LinphoneCore *lc, SalOp *op, const char *from){
 	}
 
 	/* check if we answer to this subscription */
-	if (linphone_find_friend_by_address(lc->friends,uri,&lf)!=NULL){
-		lf->insub=op;
+	if ((lf=linphone_core_find_friend(lc,uri))!=NULL){
+		linphone_friend_set_inc_subscribe_op(lf,op);
 		lf->inc_subscribe_pending=TRUE;
 		sal_subscribe_accept(op);
 		linphone_friend_done(lf);	/*this will do all necessary actions */
@@ -1516,7 +1929,6 @@ void linphone_subscription_new(LinphoneCore *lc, SalOp *op, const char *from){
 }
 
 void linphone_notify_parse_presence(SalOp *op, const char *content_type, const char *content_subtype, const char *body, SalPresenceModel **result) {
-	xmlparsing_context_t *xml_ctx;
 	LinphonePresenceModel *model = NULL;
 
 	if (strcmp(content_type, "application") != 0) {
@@ -1525,15 +1937,9 @@ void linphone_notify_parse_presence(SalOp *op, const char *content_type, const c
 	}
 
 	if (strcmp(content_subtype, "pidf+xml") == 0) {
-		xml_ctx = linphone_xmlparsing_context_new();
-		xmlSetGenericErrorFunc(xml_ctx, linphone_xmlparsing_genericxml_error);
-		xml_ctx->doc = xmlReadDoc((const unsigned char*)body, 0, NULL, 0);
-		if (xml_ctx->doc != NULL) {
-			model = process_pidf_xml_presence_notification(xml_ctx);
-		} else {
-			ms_warning("Wrongly formatted presence XML: %s", xml_ctx->errorBuffer);
-		}
-		linphone_xmlparsing_context_destroy(xml_ctx);
+		LinphoneCore *lc = (LinphoneCore *)sal_get_user_pointer(sal_op_get_sal(op));
+		model = linphone_presence_model_parse_pidf(body, strlen(body));
+		if (lc != NULL) lc->profiling_counters[LinphoneProfilingNotifiesParsed]++;
 	} else {
 		ms_error("Unknown content type '%s/%s' for presence", content_type, content_subtype);
 	}
@@ -1776,24 +2182,22 @@ static void write_xml_presence_person_obj(LinphonePresencePerson *person, struct
 	if (err < 0) *st->err = err;
 }
 
-void linphone_notify_convert_presence_to_xml(SalOp *op, SalPresenceModel *presence, const char *contact, char **content) {
-	LinphonePresenceModel *model;
+static char * presence_model_render_xml(LinphonePresenceModel *model, const char *contact) {
 	xmlBufferPtr buf;
 	xmlTextWriterPtr writer;
+	char *content = NULL;
 	int err;
 
-	if ((contact == NULL) || (content == NULL)) return;
-
-	model = (LinphonePresenceModel *)presence;
 	buf = xmlBufferCreate();
 	if (buf == NULL) {
 		ms_error("Error creating the XML buffer");
-		return;
+		return NULL;
 	}
 	writer = xmlNewTextWriterMemory(buf, 0);
 	if (writer == NULL) {
 		ms_error("Error creating the XML writer");
-		return;
+		xmlBufferFree(buf);
+		return NULL;
 	}
 
 	err = xmlTextWriterStartDocument(writer, "1.0", "UTF-8", NULL);
@@ -1844,10 +2248,90 @@ void linphone_notify_convert_presence_to_xml(SalOp *op, SalPresenceModel *presen
 	}
 	if (err > 0) {
 		/* xmlTextWriterEndDocument returns the size of the content. */
-		*content = ms_strdup((char *)buf->content);
+		content = ms_strdup((char *)buf->content);
 	}
 	xmlFreeTextWriter(writer);
 	xmlBufferFree(buf);
+	return content;
+}
+
+/*
+ * The PIDF body only depends on the subscriber through the contact, which appears as the entity and as the contact of
+ * the tuples that do not have their own. The body is thus rendered once with a placeholder instead of the contact,
+ * and the placeholder is replaced for each subscriber.
+ */
+#define PRESENCE_CONTACT_PLACEHOLDER "@@LINPHONE_PRESENCE_CONTACT@@"
+
+static char * presence_xml_set_contact(const char *xml_template, const char *contact) {
+	const size_t placeholder_len = strlen(PRESENCE_CONTACT_PLACEHOLDER);
+	xmlChar *escaped = xmlEncodeSpecialChars(NULL, (const xmlChar *)contact);
+	size_t escaped_len;
+	size_t count = 0;
+	const char *p;
+	const char *found;
+	char *result;
+	char *w;
+
+	if (escaped == NULL) return NULL;
+	escaped_len = strlen((const char *)escaped);
+	for (p = xml_template; (found = strstr(p, PRESENCE_CONTACT_PLACEHOLDER)) != NULL; p = found + placeholder_len) count++;
+	result = w = ms_malloc(strlen(xml_template) + count * escaped_len - count * placeholder_len + 1);
+	for (p = xml_template; (found = strstr(p, PRESENCE_CONTACT_PLACEHOLDER)) != NULL; p = found + placeholder_len) {
+		memcpy(w, p, found - p);
+		w += found - p;
+		memcpy(w, escaped, escaped_len);
+		w += escaped_len;
+	}
+	strcpy(w, p);
+	xmlFree(escaped);
+	return result;
+}
+
+void linphone_core_set_presence_notify_model(LinphoneCore *lc, LinphonePresenceModel *model) {
+	if (lc->presence_notify_xml != NULL) {
+		ms_free(lc->presence_notify_xml);
+		lc->presence_notify_xml = NULL;
+	}
+	if (model != NULL) linphone_presence_model_ref(model);
+	if (lc->presence_notify_model != NULL) linphone_presence_model_unref(lc->presence_notify_model);
+	lc->presence_notify_model = model;
+}
+
+char * linphone_core_presence_model_to_xml(LinphoneCore *lc, LinphonePresenceModel *model, const char *contact) {
+	char *xml_template;
+	char *content;
+
+	/*only the model being notified to all friends is cached, it is rendered once for all the subscribers*/
+	if ((lc != NULL) && (model != NULL) && (model == lc->presence_notify_model)) {
+		unsigned int version = linphone_presence_model_get_version(model);
+		if ((lc->presence_notify_xml != NULL) && (lc->presence_notify_xml_version != version)) {
+			/*the model was changed in place since it was rendered*/
+			ms_free(lc->presence_notify_xml);
+			lc->presence_notify_xml = NULL;
+		}
+		if (lc->presence_notify_xml == NULL) {
+			lc->presence_notify_xml = presence_model_render_xml(model, PRESENCE_CONTACT_PLACEHOLDER);
+			lc->presence_notify_xml_version = version;
+		}
+		if (lc->presence_notify_xml == NULL) return NULL;
+		return presence_xml_set_contact(lc->presence_notify_xml, contact);
+	}
+	xml_template = presence_model_render_xml(model, PRESENCE_CONTACT_PLACEHOLDER);
+	if (xml_template == NULL) return NULL;
+	content = presence_xml_set_contact(xml_template, contact);
+	ms_free(xml_template);
+	return content;
+}
+
+void linphone_notify_convert_presence_to_xml(SalOp *op, SalPresenceModel *presence, const char *contact, char **content) {
+	LinphoneCore *lc = NULL;
+	char *xml;
+
+	if ((contact == NULL) || (content == NULL)) return;
+
+	if (op != NULL) lc = (LinphoneCore *)sal_get_user_pointer(sal_op_get_sal(op));
+	xml = linphone_core_presence_model_to_xml(lc, (LinphonePresenceModel *)presence, contact);
+	if (xml != NULL) *content = xml;
 }
 
 void linphone_notify_recv(LinphoneCore *lc, SalOp *op, SalSubscribeStatus ss, SalPresenceModel *model){
@@ -1855,12 +2339,20 @@ void linphone_notify_recv(LinphoneCore *lc, SalOp *op, SalSubscribeStatus ss, Sa
 	LinphoneFriend *lf;
 	LinphoneAddress *friend=NULL;
 	LinphonePresenceModel *presence = model ? (LinphonePresenceModel *)model:linphone_presence_model_new_with_activity(LinphonePresenceActivityOffline, NULL);
-
-	lf=linphone_find_friend_by_out_subscribe(lc->friends,op);
+	bool_t from_list = (lc->presence_list_op != NULL && op == lc->presence_list_op);
+
+	lf=linphone_core_find_friend_by_out_subscribe(lc,op);
+	if (lf==NULL && from_list && presence->entity!=NULL){
+		/*resource list notifications carry the presence of each friend in a document of its own*/
+		LinphoneAddress *addr=linphone_address_new(presence->entity);
+		if (addr!=NULL){
+			lf=linphone_core_find_friend(lc,addr);
+			linphone_address_destroy(addr);
+		}
+	}
 	if (lf==NULL && lp_config_get_int(lc->config,"sip","allow_out_of_subscribe_presence",0)){
 		const SalAddress *addr=sal_op_get_from_address(op);
-		lf=NULL;
-		linphone_find_friend_by_address(lc->friends,(LinphoneAddress*)addr,&lf);
+		lf=linphone_core_find_friend(lc,(LinphoneAddress*)addr);
 	}
 	if (lf!=NULL){
 		LinphonePresenceActivity *activity = NULL;
@@ -1875,28 +2367,41 @@ void linphone_notify_recv(LinphoneCore *lc, SalOp *op, SalSubscribeStatus ss, Sa
 			linphone_presence_model_unref(lf->presence);
 		}
 		lf->presence = presence;
-		lf->subscribe_active=TRUE;
+		if (!from_list) lf->subscribe_active=TRUE;
 		linphone_core_notify_notify_presence_received(lc,(LinphoneFriend*)lf);
 		ms_free(tmp);
 	}else{
-		ms_message("But this person is not part of our friend list, so we don't care.");
+		if (model != NULL || !from_list) ms_message("But this person is not part of our friend list, so we don't care.");
 		linphone_presence_model_unref(presence);
 	}
+	if (ss==SalSubscribeActive && model != NULL){
+		/*the server is answering again*/
+		lc->subscribe_backoff=0;
+	}
 	if (ss==SalSubscribeTerminated){
+		const SalErrorInfo *ei=sal_op_get_error_info(op);
+		int code=ei->protocol_code;
+		int retry_after=ei->retry_after;
 		sal_op_release(op);
-		if (lf){
-			lf->outsub=NULL;
+		if (from_list){
+			linphone_core_presence_list_terminated(lc,code,retry_after);
+		}else if (lf && lf->outsub==op){
+			linphone_friend_set_out_subscribe_op(lf,NULL);
 			lf->subscribe_active=FALSE;
+			if (code==503){
+				linphone_core_delay_subscribes(lc,retry_after);
+				linphone_core_schedule_friend_subscribe(lc,lf);
+			}
 		}
 	}
 }
 
 void linphone_subscription_closed(LinphoneCore *lc, SalOp *op){
 	LinphoneFriend *lf;
-	lf=linphone_find_friend_by_inc_subscribe(lc->friends,op);
+	lf=linphone_core_find_friend_by_inc_subscribe(lc,op);
 	sal_op_release(op);
 	if (lf!=NULL){
-		lf->insub=NULL;
+		linphone_friend_set_inc_subscribe_op(lf,NULL);
 	}else{
 		ms_warning("Receiving unsuscribe for unknown in-subscribtion from %s", sal_op_get_from(op));
 	}
@@ -79,6 +79,79 @@ extern "C" {
 #endif
 #endif
 
+/*****************************************************************************
+ * HASH TABLE                                                                *
+ ****************************************************************************/
+
+typedef struct _LinphoneHashTable LinphoneHashTable;
+typedef unsigned int (*LinphoneHashFunc)(const void *key);
+/*returns 0 when both keys are equal*/
+typedef int (*LinphoneHashCompareFunc)(const void *key1, const void *key2);
+typedef void (*LinphoneHashTableForEachFunc)(const void *key, void *value, void *user_data);
+
+unsigned int linphone_hash_string(const void *key);
+unsigned int linphone_hash_string_nocase(const void *key);
+unsigned int linphone_hash_pointer(const void *key);
+LinphoneHashTable *linphone_hash_table_new(LinphoneHashFunc hash_func, LinphoneHashCompareFunc compare_func, bool_t copy_keys);
+/*keys are copied on insertion*/
+LinphoneHashTable *linphone_hash_table_new_for_strings(void);
+LinphoneHashTable *linphone_hash_table_new_for_strings_nocase(void);
+/*keys are not copied and must remain valid as long as they are in the table*/
+LinphoneHashTable *linphone_hash_table_new_for_strings_nocopy(void);
+LinphoneHashTable *linphone_hash_table_new_for_pointers(void);
+void linphone_hash_table_destroy(LinphoneHashTable *table);
+void linphone_hash_table_clear(LinphoneHashTable *table);
+/*replaces the value if the key is already present*/
+void linphone_hash_table_insert(LinphoneHashTable *table, const void *key, void *value);
+void *linphone_hash_table_lookup(const LinphoneHashTable *table, const void *key);
+/*returns the value that was associated to the key*/
+void *linphone_hash_table_remove(LinphoneHashTable *table, const void *key);
+size_t linphone_hash_table_size(const LinphoneHashTable *table);
+void linphone_hash_table_for_each(const LinphoneHashTable *table, LinphoneHashTableForEachFunc func, void *user_data);
+
+/*****************************************************************************
+ * TIMER WHEEL                                                               *
+ ****************************************************************************/
+
+typedef struct _LinphoneTimerWheel LinphoneTimerWheel;
+typedef void (*LinphoneTimerFunc)(void *data);
+
+/*timers are meant to be embedded in the object they belong to, so that scheduling them does not allocate*/
+typedef struct _LinphoneTimer{
+	struct _LinphoneTimer *next;
+	struct _LinphoneTimer *prev;
+	struct _LinphoneTimer **head;
+	LinphoneTimerWheel *wheel; /*non NULL while the timer is scheduled*/
+	uint64_t expire_time; /*in milliseconds, on the ortp_get_cur_time_ms() clock*/
+	LinphoneTimerFunc func;
+	void *data;
+}LinphoneTimer;
+
+LinphoneTimerWheel *linphone_timer_wheel_new(uint64_t now);
+/*pending timers are unscheduled but not fired*/
+void linphone_timer_wheel_destroy(LinphoneTimerWheel *w);
+void linphone_timer_init(LinphoneTimer *t, LinphoneTimerFunc func, void *data);
+/*reschedules the timer if it is already pending*/
+void linphone_timer_wheel_schedule(LinphoneTimerWheel *w, LinphoneTimer *t, uint64_t expire_time);
+void linphone_timer_cancel(LinphoneTimer *t);
+bool_t linphone_timer_is_scheduled(const LinphoneTimer *t);
+/*fires all the timers expired at the given time, returns the number of timers fired*/
+int linphone_timer_wheel_run(LinphoneTimerWheel *w, uint64_t now);
+/*returns FALSE if no timer is pending*/
+bool_t linphone_timer_wheel_get_next_expiry(const LinphoneTimerWheel *w, uint64_t *expire_time);
+size_t linphone_timer_wheel_size(const LinphoneTimerWheel *w);
+
+/*****************************************************************************
+ * PROFILING                                                                 *
+ ****************************************************************************/
+
+/*monotonic enough for durations, in microseconds*/
+uint64_t linphone_profiling_get_time(void);
+void linphone_core_profiling_record(LinphoneCore *lc, LinphoneProfilingSection section, uint64_t begin);
+/*reading the clock is skipped entirely when profiling is disabled*/
+#define linphone_core_profiling_start(lc) ((lc)->profiling ? linphone_profiling_get_time() : 0)
+#define linphone_core_profiling_stop(lc,section,begin) do{ if ((lc)->profiling) linphone_core_profiling_record(lc,section,begin); }while(0)
+
 struct _LinphoneCallParams{
 	belle_sip_object_t base;
 	void *user_data;
@@ -133,6 +206,7 @@ struct _LinphoneCallLog{
 	time_t start_date_time; /**Start date of the call in seconds as expressed in a time_t */
 	time_t connected_date_time; /**Connecting date of the call in seconds as expressed in a time_t */
 	char* call_id; /**unique id of a call*/
+	unsigned int storage_id; /*id in the call logs database, 0 if not stored there*/
 	struct _LinphoneQualityReporting reporting;
 	bool_t video_enabled;
 };
@@ -186,8 +260,21 @@ typedef struct StunCandidate{
 typedef struct _PortConfig{
 	int rtp_port;
 	int rtcp_port;
+	bool_t allocated; /*the ports are reserved in the port allocator of the core*/
 }PortConfig;
 
+typedef struct _PortAllocator{
+	int min_port; /*configured range the allocator was built for*/
+	int max_port;
+	int base_port; /*RTP ports are base_port+2*i, each followed by its RTCP port*/
+	int nb_pairs;
+	int nb_used;
+	int max_used;
+	unsigned int nb_exhausted;
+	unsigned int *bitmap; /*bit i is set when the pair starting at base_port+2*i is in use*/
+	bool_t sequential; /*a single port is configured: the following pairs are used in order, as fallback*/
+}PortAllocator;
+
 struct _LinphoneCall
 {
 	belle_sip_object_t base;
@@ -227,6 +314,9 @@ struct _LinphoneCall
 	OrtpEvQueue *videostream_app_evq;
 	CallCallbackObj nextVideoFrameDecoded;
 	LinphoneCallStats stats[2];
+	LinphoneTimer stats_timer; /*delivers the stats updates held back by the notification interval*/
+	uint64_t stats_notified_time[2]; /*ms, last call_stats_updated notification of each stream*/
+	int stats_pending_updates[2]; /*LINPHONE_CALL_STATS_*_UPDATE flags not notified yet*/
 #ifdef BUILD_UPNP
 	UpnpSession *upnp_session;
 #endif //BUILD_UPNP
@@ -238,6 +328,7 @@ struct _LinphoneCall
 	LinphoneCall *transfer_target;/*if this call received a transfer request, then transfer_target points to the new call created to the refer target */
 	int localdesc_changed;/*not a boolean, contains a mask representing changes*/
 	LinphonePlayer *player;
+	LinphoneTimer timeout_timer; /*fires the delayed, incoming or in-call timeout that applies to the current state*/
 
 	bool_t refer_pending;
 	bool_t expect_media_in_ack;
@@ -312,11 +403,20 @@ char* linphone_proxy_config_get_contact(const LinphoneProxyConfig *cfg);
 void linphone_friend_close_subscriptions(LinphoneFriend *lf);
 void linphone_friend_update_subscribes(LinphoneFriend *fr, LinphoneProxyConfig *cfg, bool_t only_when_registered);
 void linphone_friend_notify(LinphoneFriend *lf, LinphonePresenceModel *presence);
-LinphoneFriend *linphone_find_friend_by_inc_subscribe(MSList *l, SalOp *op);
-LinphoneFriend *linphone_find_friend_by_out_subscribe(MSList *l, SalOp *op);
+LinphoneFriend *linphone_core_find_friend_by_inc_subscribe(const LinphoneCore *lc, SalOp *op);
+LinphoneFriend *linphone_core_find_friend_by_out_subscribe(const LinphoneCore *lc, SalOp *op);
+void linphone_friend_set_inc_subscribe_op(LinphoneFriend *lf, SalOp *op);
+void linphone_friend_set_out_subscribe_op(LinphoneFriend *lf, SalOp *op);
+void linphone_core_clear_friend_indexes(LinphoneCore *lc);
 MSList *linphone_find_friend_by_address(MSList *fl, const LinphoneAddress *addr, LinphoneFriend **lf);
 bool_t linphone_core_should_subscribe_friends_only_when_registered(const LinphoneCore *lc);
 void linphone_core_update_friends_subscriptions(LinphoneCore *lc, LinphoneProxyConfig *cfg, bool_t only_when_registered);
+void linphone_core_schedule_friend_subscribe(LinphoneCore *lc, LinphoneFriend *lf);
+void linphone_core_process_subscribe_queue(LinphoneCore *lc);
+void linphone_core_clear_subscribe_queue(LinphoneCore *lc);
+void linphone_core_delay_subscribes(LinphoneCore *lc, int retry_after);
+void linphone_core_presence_list_terminated(LinphoneCore *lc, int code, int retry_after);
+void linphone_core_close_presence_list(LinphoneCore *lc);
 
 int parse_hostname_to_addr(const char *server, struct sockaddr_storage *ss, socklen_t *socklen, int default_port);
 
@@ -358,6 +458,13 @@ void linphone_subscription_new(LinphoneCore *lc, SalOp *op, const char *from);
 void linphone_core_send_presence(LinphoneCore *lc, LinphonePresenceModel *presence);
 void linphone_notify_parse_presence(SalOp *op, const char *content_type, const char *content_subtype, const char *body, SalPresenceModel **result);
 void linphone_notify_convert_presence_to_xml(SalOp *op, SalPresenceModel *presence, const char *contact, char **content);
+char * linphone_core_presence_model_to_xml(LinphoneCore *lc, LinphonePresenceModel *model, const char *contact);
+LinphonePresenceModel * linphone_presence_model_parse_pidf(const char *body, size_t len);
+LinphonePresenceModel * linphone_presence_model_parse_pidf_xpath(const char *body);
+void linphone_core_set_presence_notify_model(LinphoneCore *lc, LinphonePresenceModel *model);
+/*changes whenever the model, or one of its services, persons, activities or notes, is modified*/
+LINPHONE_PUBLIC unsigned int linphone_presence_model_get_version(const LinphonePresenceModel *model);
+void linphone_core_send_queued_presence_notifies(LinphoneCore *lc);
 void linphone_notify_recv(LinphoneCore *lc, SalOp *op, SalSubscribeStatus ss, SalPresenceModel *model);
 void linphone_proxy_config_process_authentication_failure(LinphoneCore *lc, SalOp *op);
 
@@ -374,6 +481,7 @@ void linphone_core_adapt_to_network(LinphoneCore *lc, int ping_time_ms, Linphone
 int linphone_core_gather_ice_candidates(LinphoneCore *lc, LinphoneCall *call);
 void linphone_core_update_ice_state_in_call_stats(LinphoneCall *call);
 void linphone_call_stats_fill(LinphoneCallStats *stats, MediaStream *ms, OrtpEvent *ev);
+void linphone_call_notify_stats_updated(LinphoneCall *call, int stream_index);
 void linphone_core_update_local_media_description_from_ice(SalMediaDescription *desc, IceSession *session);
 void linphone_core_update_ice_from_remote_media_description(LinphoneCall *call, const SalMediaDescription *md);
 bool_t linphone_core_media_description_contains_video_stream(const SalMediaDescription *md);
@@ -393,6 +501,7 @@ LinphoneProxyConfig *linphone_proxy_config_new_from_config_file(LinphoneCore *lc
 void linphone_proxy_config_write_to_config_file(struct _LpConfig* config,LinphoneProxyConfig *obj, int index);
 
 int linphone_proxy_config_normalize_number(LinphoneProxyConfig *cfg, const char *username, char *result, size_t result_len);
+void linphone_dial_plans_compile(void);
 
 void linphone_core_message_received(LinphoneCore *lc, SalOp *op, const SalMessage *msg);
 void linphone_core_is_composing_received(LinphoneCore *lc, SalOp *op, const SalIsComposing *is_composing);
@@ -438,6 +547,11 @@ void _linphone_proxy_config_release_ops(LinphoneProxyConfig *obj);
 
 /*chat*/
 void linphone_chat_room_release(LinphoneChatRoom *cr);
+void linphone_core_clear_chat_room_index(LinphoneCore *lc);
+LinphoneChatRoom *_linphone_core_create_chat_room_from_url(LinphoneCore *lc, const char *to);
+LinphoneChatRoom *linphone_message_storage_get_lazy_chat_room(LinphoneCore *lc, const LinphoneAddress *addr);
+LinphoneChatRoom *linphone_message_storage_create_next_lazy_chat_room(LinphoneCore *lc);
+int linphone_message_storage_get_lazy_chat_rooms_count(const LinphoneCore *lc);
 void linphone_chat_message_destroy(LinphoneChatMessage* msg);
 /**/
 
@@ -494,6 +608,10 @@ struct _LinphoneAuthInfo
 	char *passwd;
 	char *ha1;
 	char *domain;
+	char *cached_ha1; /*ha1 computed from passwd for the realm of the last challenge*/
+	char *cached_ha1_realm;
+	int pos; /*index of the auth_info_N config section, for auth infos held by the core*/
+	LinphoneCore *lc; /*core holding this auth info and indexing it, NULL otherwise*/
 };
 
 typedef enum _LinphoneIsComposingState {
@@ -507,6 +625,8 @@ struct _LinphoneChatRoom{
 	struct _LinphoneCore *lc;
 	char  *peer;
 	LinphoneAddress *peer_url;
+	char *peer_key; /*key of the chat room in the peer index of the core*/
+	int unread_count; /*cached number of unread messages, -1 when unknown*/
 	MSList *messages_hist;
 	MSList *transient_messages;
 	LinphoneIsComposingState remote_is_composing;
@@ -528,12 +648,14 @@ struct _LinphoneFriend{
 	struct _LinphoneCore *lc;
 	BuddyInfo *info;
 	char *refkey;
+	char *address_key; /*key of the friend in the address index of the core*/
 	void *up;
 	bool_t subscribe;
 	bool_t subscribe_active;
 	bool_t inc_subscribe_pending;
 	bool_t commit;
 	bool_t initial_subscribes_sent; /*used to know if initial subscribe message was sent or not*/
+	bool_t subscribe_scheduled; /*the friend is in the subscribe queue of the core*/
 };
 
 
@@ -569,6 +691,7 @@ typedef struct rtp_config
 	int audio_jitt_comp;  /*jitter compensation*/
 	int video_jitt_comp;  /*jitter compensation*/
 	int nortp_timeout;
+	int stats_notification_interval; /*ms, 0 to notify every stats update*/
 	int disable_upnp;
 	MSCryptoSuite *srtp_suites;
 	LinphoneAVPFMode avpf_mode;
@@ -681,6 +804,26 @@ const char *linphone_core_get_tone_file(const LinphoneCore *lc, LinphoneToneID i
 int _linphone_core_accept_call_update(LinphoneCore *lc, LinphoneCall *call, const LinphoneCallParams *params, LinphoneCallState next_state, const char *state_info);
 typedef struct _LinphoneConference LinphoneConference;
 
+#ifdef MSG_STORAGE_ENABLED
+/*prepared statements of the chat message store, see message_storage.c*/
+typedef enum _LinphoneStorageStatement{
+	LinphoneStorageStmtInsertMessage,
+	LinphoneStorageStmtInsertContent,
+	LinphoneStorageStmtSelectContent,
+	LinphoneStorageStmtUpdateState,
+	LinphoneStorageStmtUpdateAppData,
+	LinphoneStorageStmtUpdateUrl,
+	LinphoneStorageStmtMarkAsRead,
+	LinphoneStorageStmtCountMessages,
+	LinphoneStorageStmtCountUnreadMessages,
+	LinphoneStorageStmtDeleteMessage,
+	LinphoneStorageStmtDeleteHistory,
+	LinphoneStorageStmtHistoryBefore,
+	LinphoneStorageStmtHistoryIdAtOffset,
+	LinphoneStorageStmtCount
+} LinphoneStorageStatement;
+#endif
+
 struct _LinphoneCore
 {
 	MSList* vtables;
@@ -700,15 +843,23 @@ struct _LinphoneCore
 	int dyn_pt;
 	LinphoneProxyConfig *default_proxy;
 	MSList *friends;
+	LinphoneHashTable *friends_by_address;
+	LinphoneHashTable *friends_by_refkey;
+	LinphoneHashTable *friends_by_op;
 	MSList *auth_info;
+	LinphoneHashTable *auth_info_by_username; /*lists of auth infos sorted by pos, for each username*/
+	LinphoneHashTable *auth_info_by_realm; /*same, for each username and realm without quotes*/
+	LinphoneHashTable *auth_info_by_domain; /*same, for each username and domain*/
 	struct _RingStream *ringstream;
 	time_t dmfs_playing_start_time;
 	LCCallbackObj preview_finished_cb;
 	LinphoneCall *current_call;   /* the current call */
 	MSList *calls;				/* all the processed calls */
+	PortAllocator port_allocators[2]; /*RTP/RTCP port pairs reserved by the calls, for audio and video*/
 	MSList *queued_calls;	/* used by the autoreplier */
 	MSList *call_logs;
 	MSList *chatrooms;
+	LinphoneHashTable *chatrooms_by_peer;
 	int max_call_logs;
 	int missed_calls;
 	VideoPreview *previewstream;
@@ -718,6 +869,15 @@ struct _LinphoneCore
 	MSList *subscribers;	/* unknown subscribers */
 	int minutes_away;
 	LinphonePresenceModel *presence_model;
+	LinphonePresenceModel *presence_notify_model; /*last presence notified to all friends*/
+	char *presence_notify_xml; /*PIDF body of presence_notify_model, with a placeholder for the contact*/
+	unsigned int presence_notify_xml_version; /*version of presence_notify_model when presence_notify_xml was rendered*/
+	MSList *presence_notify_queue; /*friends still to be notified of presence_notify_model*/
+	MSList *subscribe_queue; /*friends whose SUBSCRIBE is not sent yet*/
+	uint64_t next_subscribe_time; /*earliest time in ms at which the next SUBSCRIBE of the queue can be sent*/
+	uint64_t subscribe_resume_time; /*SUBSCRIBEs are suspended until this time in ms after a 503*/
+	int subscribe_backoff; /*last back-off delay in ms applied without Retry-After*/
+	SalOp *presence_list_op; /*subscription to the presence list (RFC 4662), if any*/
 	void *data;
 	char *play_file;
 	char *rec_file;
@@ -730,12 +890,18 @@ struct _LinphoneCore
 	time_t netup_time; /*time when network went reachable */
 	struct _EcCalibrator *ecc;
 	MSList *hooks;
+	LinphoneTimerWheel *timer_wheel;
+	uint64_t wait_deadline; /*end of the linphone_core_wait() in progress, 0 if none*/
+	LinphoneProfilingHistogram *profiling; /*one histogram per LinphoneProfilingSection, NULL when profiling is disabled*/
+	uint64_t profiling_counters[LinphoneProfilingCounterCount]; /*the SIP message counters are kept by the sal*/
 	LinphoneConference conf_ctx;
 	char* zrtp_secrets_cache;
 	LinphoneVideoPolicy video_policy;
 	bool_t use_files;
 	bool_t apply_nat_settings;
 	bool_t initial_subscribes_sent;
+	bool_t presence_list_pending; /*the subscription to the presence list is to be sent*/
+	bool_t presence_list_unavailable; /*the presence list was rejected, friends are subscribed individually*/
 	bool_t bl_refresh;
 
 	bool_t preview_finished;
@@ -756,9 +922,17 @@ struct _LinphoneCore
 	char* device_id;
 	MSList *last_recv_msg_ids;
 	char *chat_db_file;
+	char *logs_db_file;
 #ifdef MSG_STORAGE_ENABLED
 	sqlite3 *db;
+	sqlite3 *logs_db;
+	sqlite3_stmt *db_stmts[LinphoneStorageStmtCount];
+	uint64_t db_transaction_start; /*time at which the pending write-behind transaction was opened, 0 if none*/
+	int db_flush_interval; /*in milliseconds*/
 	bool_t debug_storage;
+	bool_t db_write_behind;
+	MSList *chat_room_descriptors; /*chat rooms of the history not created yet, most recent first*/
+	LinphoneHashTable *chat_room_descriptors_by_peer;
 #endif
 #ifdef BUILD_UPNP
 	UpnpContext *upnp;
@@ -796,6 +970,10 @@ void linphone_tunnel_enable_logs_with_handler(LinphoneTunnel *tunnel, bool_t ena
 bool_t linphone_core_can_we_add_call(LinphoneCore *lc);
 int linphone_core_add_call( LinphoneCore *lc, LinphoneCall *call);
 int linphone_core_del_call( LinphoneCore *lc, LinphoneCall *call);
+void linphone_call_release_media_ports(LinphoneCall *call);
+const char *linphone_auth_info_get_challenge_ha1(LinphoneAuthInfo *info, const char *realm);
+void linphone_core_free_auth_infos(LinphoneCore *lc);
+void linphone_core_uninit_port_allocators(LinphoneCore *lc);
 int linphone_core_set_as_current_call(LinphoneCore *lc, LinphoneCall *call);
 int linphone_core_get_calls_nb(const LinphoneCore *lc);
 
@@ -834,6 +1012,8 @@ LinphoneEcCalibratorStatus ec_calibrator_get_status(EcCalibrator *ecc);
 void ec_calibrator_destroy(EcCalibrator *ecc);
 
 void linphone_call_background_tasks(LinphoneCall *call, bool_t one_second_elapsed);
+void linphone_call_update_timeout(LinphoneCall *call);
+void linphone_call_flush_stats_notifications(LinphoneCall *call);
 void linphone_core_preempt_sound_resources(LinphoneCore *lc);
 int _linphone_core_pause_call(LinphoneCore *lc, LinphoneCall *call);
 
@@ -861,6 +1041,12 @@ void _linphone_core_codec_config_write(LinphoneCore *lc);
 #endif
 void call_logs_read_from_config_file(LinphoneCore *lc);
 void call_logs_write_to_config_file(LinphoneCore *lc);
+void linphone_core_call_log_storage_init(LinphoneCore *lc);
+void linphone_core_call_log_storage_close(LinphoneCore *lc);
+/*the following ones write the call logs to the config file when there is no call logs database*/
+void linphone_core_call_log_storage_add(LinphoneCore *lc, LinphoneCallLog *cl);
+void linphone_core_call_log_storage_remove(LinphoneCore *lc, LinphoneCallLog *cl);
+void linphone_core_call_log_storage_clear(LinphoneCore *lc);
 
 int linphone_core_get_edge_bw(LinphoneCore *lc);
 int linphone_core_get_edge_ptime(LinphoneCore *lc);
@@ -869,6 +1055,7 @@ int linphone_upnp_init(LinphoneCore *lc);
 void linphone_upnp_destroy(LinphoneCore *lc);
 
 #ifdef MSG_STORAGE_ENABLED
+int linphone_sql_request(sqlite3* db,const char *stmt);
 sqlite3 * linphone_message_storage_init();
 void linphone_message_storage_init_chat_rooms(LinphoneCore *lc);
 #endif
@@ -877,6 +1064,7 @@ void linphone_chat_message_store_appdata(LinphoneChatMessage* msg);
 void linphone_core_message_storage_init(LinphoneCore *lc);
 void linphone_core_message_storage_close(LinphoneCore *lc);
 void linphone_core_message_storage_set_debug(LinphoneCore *lc, bool_t debug);
+void linphone_core_message_storage_iterate(LinphoneCore *lc);
 
 void linphone_core_play_named_tone(LinphoneCore *lc, LinphoneToneID id);
 bool_t linphone_core_tone_indications_enabled(LinphoneCore*lc);
@@ -964,6 +1152,7 @@ xmlXPathObjectPtr linphone_get_xml_xpath_object_for_node_list(xmlparsing_context
  * OTHER UTILITY FUNCTIONS                                                     *
  ****************************************************************************/
 char * linphone_timestamp_to_rfc3339_string(time_t timestamp);
+char *linphone_address_as_weak_key(const LinphoneAddress *addr);
 
 
 static MS2_INLINE const LinphoneErrorInfo *linphone_error_info_from_sal_op(const SalOp *op){
@@ -1028,6 +1217,46 @@ void linphone_core_notify_publish_state_changed(LinphoneCore *lc, LinphoneEvent
 void linphone_core_notify_log_collection_upload_state_changed(LinphoneCore *lc, LinphoneCoreLogCollectionUploadState state, const char *info);
 void linphone_core_notify_log_collection_upload_progress_indication(LinphoneCore *lc, size_t offset, size_t total);
 
+/*
+ * Reusable buffer into which fragmented packets are gathered before being handed to a transport that only accepts
+ * contiguous data. It grows to the largest packet sent and is kept for the lifetime of the transport, so that the
+ * send path does not allocate per packet. Packets made of a single fragment are sent in place.
+ */
+typedef struct _LinphoneSendBuffer{
+	uint8_t *data;
+	size_t size;
+}LinphoneSendBuffer;
+
+LINPHONE_PUBLIC const uint8_t *linphone_send_buffer_gather(LinphoneSendBuffer *buffer, const mblk_t *msg, size_t *len);
+/*same as linphone_send_buffer_gather(), with the given header prepended to the packet*/
+LINPHONE_PUBLIC const uint8_t *linphone_send_buffer_gather_with_header(LinphoneSendBuffer *buffer, const uint8_t *header, size_t header_size, const mblk_t *msg, size_t *len);
+LINPHONE_PUBLIC void linphone_send_buffer_uninit(LinphoneSendBuffer *buffer);
+
+/*
+ * Tunnel socket shared by all the RTP and RTCP flows of the core when rtp multiplexing is enabled. Each flow is a
+ * stream of the channel, and its datagrams are prefixed with its stream id. The socket is accessed through the given
+ * functions, and closed together with the last stream.
+ */
+#define LINPHONE_TUNNEL_CHANNEL_HEADER_SIZE 2
+#define LINPHONE_TUNNEL_CHANNEL_MAX_PENDING 64 /*per stream, the oldest datagram is dropped beyond*/
+
+typedef struct _LinphoneTunnelChannel LinphoneTunnelChannel;
+typedef int (*LinphoneTunnelChannelSendFunc)(void *socket, const uint8_t *data, size_t len, const struct sockaddr *to, socklen_t tolen);
+typedef int (*LinphoneTunnelChannelRecvFunc)(void *socket, uint8_t *buf, size_t size, struct sockaddr *from, socklen_t fromlen);
+typedef void (*LinphoneTunnelChannelCloseFunc)(void *socket);
+
+LINPHONE_PUBLIC LinphoneTunnelChannel *linphone_tunnel_channel_new(void *socket, LinphoneTunnelChannelSendFunc send_func, LinphoneTunnelChannelRecvFunc recv_func, LinphoneTunnelChannelCloseFunc close_func);
+LINPHONE_PUBLIC void linphone_tunnel_channel_destroy(LinphoneTunnelChannel *channel);
+LINPHONE_PUBLIC void *linphone_tunnel_channel_get_socket(const LinphoneTunnelChannel *channel);
+/*to be called when the socket is destroyed by its owner: the channel neither uses nor closes it anymore*/
+LINPHONE_PUBLIC void linphone_tunnel_channel_detach_socket(LinphoneTunnelChannel *channel);
+LINPHONE_PUBLIC uint16_t linphone_tunnel_channel_add_stream(LinphoneTunnelChannel *channel);
+/*returns TRUE when no stream is left, the socket being closed then*/
+LINPHONE_PUBLIC bool_t linphone_tunnel_channel_remove_stream(LinphoneTunnelChannel *channel, uint16_t id);
+LINPHONE_PUBLIC int linphone_tunnel_channel_sendto(LinphoneTunnelChannel *channel, uint16_t id, LinphoneSendBuffer *buffer, const mblk_t *msg, const struct sockaddr *to, socklen_t tolen);
+LINPHONE_PUBLIC int linphone_tunnel_channel_recvfrom(LinphoneTunnelChannel *channel, uint16_t id, uint8_t *buf, size_t size, struct sockaddr *from, socklen_t fromlen);
+LINPHONE_PUBLIC int linphone_tunnel_channel_get_pending_count(const LinphoneTunnelChannel *channel, uint16_t id);
+
 void set_mic_gain_db(AudioStream *st, float gain);
 void set_playback_gain_db(AudioStream *st, float gain);
 
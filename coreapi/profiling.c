@@ -0,0 +1,120 @@
+/*
+profiling.c
+Copyright (C) 2015  Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#include "private.h"
+
+uint64_t linphone_profiling_get_time(void){
+	struct timeval tv;
+	ortp_gettimeofday(&tv,NULL);
+	return (uint64_t)tv.tv_sec*1000000+tv.tv_usec;
+}
+
+void linphone_core_profiling_record(LinphoneCore *lc, LinphoneProfilingSection section, uint64_t begin){
+	LinphoneProfilingHistogram *h;
+	uint64_t end;
+	unsigned int elapsed=0;
+	int bucket=0;
+
+	if (lc->profiling==NULL) return;
+	end=linphone_profiling_get_time();
+	/*the clock may step backwards*/
+	if (end>begin) elapsed=(end-begin>0xffffffffULL) ? 0xffffffffU : (unsigned int)(end-begin);
+	h=&lc->profiling[section];
+	while(elapsed>>bucket && bucket<LINPHONE_PROFILING_HISTOGRAM_SIZE-1) bucket++;
+	h->buckets[bucket]++;
+	h->count++;
+	h->total+=elapsed;
+	if (elapsed>h->max) h->max=elapsed;
+}
+
+void linphone_core_enable_profiling(LinphoneCore *lc, bool_t enable){
+	if (enable && lc->profiling==NULL){
+		lc->profiling=ms_new0(LinphoneProfilingHistogram,LinphoneProfilingSectionCount);
+	}else if (!enable && lc->profiling!=NULL){
+		ms_free(lc->profiling);
+		lc->profiling=NULL;
+	}
+}
+
+bool_t linphone_core_profiling_enabled(const LinphoneCore *lc){
+	return lc->profiling!=NULL;
+}
+
+void linphone_core_reset_profiling(LinphoneCore *lc){
+	if (lc->profiling)
+		memset(lc->profiling,0,LinphoneProfilingSectionCount*sizeof(LinphoneProfilingHistogram));
+	memset(lc->profiling_counters,0,sizeof(lc->profiling_counters));
+	sal_reset_message_counters(lc->sal);
+}
+
+void linphone_core_get_profiling_histogram(const LinphoneCore *lc, LinphoneProfilingSection section, LinphoneProfilingHistogram *histogram){
+	if (lc->profiling==NULL || (unsigned int)section>=LinphoneProfilingSectionCount){
+		memset(histogram,0,sizeof(*histogram));
+		return;
+	}
+	*histogram=lc->profiling[section];
+}
+
+uint64_t linphone_core_get_profiling_counter(const LinphoneCore *lc, LinphoneProfilingCounter counter){
+	uint64_t requests_received,responses_received,requests_sent;
+
+	switch(counter){
+		case LinphoneProfilingSipRequestsReceived:
+		case LinphoneProfilingSipResponsesReceived:
+		case LinphoneProfilingSipRequestsSent:
+			sal_get_message_counters(lc->sal,&requests_received,&responses_received,&requests_sent);
+			if (counter==LinphoneProfilingSipRequestsReceived) return requests_received;
+			if (counter==LinphoneProfilingSipResponsesReceived) return responses_received;
+			return requests_sent;
+		case LinphoneProfilingNotifiesParsed:
+		case LinphoneProfilingMessagesStored:
+			return lc->profiling_counters[counter];
+		case LinphoneProfilingCounterCount:
+			break;
+	}
+	return 0;
+}
+
+const char *linphone_profiling_section_to_string(LinphoneProfilingSection section){
+	switch(section){
+		case LinphoneProfilingIterate: return "Iterate";
+		case LinphoneProfilingSalIterate: return "SalIterate";
+		case LinphoneProfilingEventQueue: return "EventQueue";
+		case LinphoneProfilingTimers: return "Timers";
+		case LinphoneProfilingCallTasks: return "CallTasks";
+		case LinphoneProfilingProxyUpdate: return "ProxyUpdate";
+		case LinphoneProfilingHooks: return "Hooks";
+		case LinphoneProfilingStorage: return "Storage";
+		case LinphoneProfilingConfigSync: return "ConfigSync";
+		case LinphoneProfilingSectionCount: break;
+	}
+	return "Unknown";
+}
+
+const char *linphone_profiling_counter_to_string(LinphoneProfilingCounter counter){
+	switch(counter){
+		case LinphoneProfilingSipRequestsReceived: return "SipRequestsReceived";
+		case LinphoneProfilingSipResponsesReceived: return "SipResponsesReceived";
+		case LinphoneProfilingSipRequestsSent: return "SipRequestsSent";
+		case LinphoneProfilingNotifiesParsed: return "NotifiesParsed";
+		case LinphoneProfilingMessagesStored: return "MessagesStored";
+		case LinphoneProfilingCounterCount: break;
+	}
+	return "Unknown";
+}
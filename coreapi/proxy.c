@@ -820,55 +820,82 @@ static dial_plan_t const dial_plans[]={
 	{"Zimbabwe"                     ,"ZW"		, "263"     , 9     , "00"  },
 	{NULL                           ,NULL       ,  ""       , 0     , NULL	}
 };
-static dial_plan_t most_common_dialplan={ "generic" ,"", "", 10, "00"};
-
-int linphone_dial_plan_lookup_ccc_from_e164(const char* e164) {
-	dial_plan_t* dial_plan;
-	dial_plan_t* elected_dial_plan=NULL;
-	unsigned int found;
-	unsigned int i=0;
-	if (e164[1]=='1') {
-		/*USA case*/
-		return 1;
-	}
-	do {
-		found=0;
-		i++;
-		for (dial_plan=(dial_plan_t*)dial_plans; dial_plan->country!=NULL; dial_plan++) {
-			if (strncmp(dial_plan->ccc,&e164[1],i) == 0) {
-				elected_dial_plan=dial_plan;
-				found++;
-			}
+static dial_plan_t const most_common_dialplan={ "generic" ,"", "", 10, "00"};
+
+#define DIAL_PLAN_COUNT (sizeof(dial_plans)/sizeof(dial_plans[0])-1)
+
+/*the country calling codes are compiled once into a digit trie and the ISO codes into a direct index,
+ * so that lookups no longer scan the dial_plans table.*/
+typedef struct dial_plan_trie_node{
+	short children[10]; /*index of the node for the next digit, 0 if none*/
+	short plan; /*index+1 in dial_plans of the plan whose ccc ends on this node, 0 if none*/
+}dial_plan_trie_node_t;
+
+static dial_plan_trie_node_t dial_plan_trie[DIAL_PLAN_COUNT*(sizeof(dial_plans[0].ccc)-1)+1];
+static short dial_plan_iso_index[26*26]; /*index+1 in dial_plans for each two uppercase letters code, 0 if none*/
+static bool_t dial_plans_compiled=FALSE;
+
+void linphone_dial_plans_compile(void){
+	int nb_nodes=1;
+	size_t i;
+
+	if (dial_plans_compiled) return;
+	for(i=0;i<DIAL_PLAN_COUNT;++i){
+		const dial_plan_t *plan=&dial_plans[i];
+		const char *p;
+		int node=0;
+		for(p=plan->ccc;*p!='\0';++p){
+			int digit=*p-'0';
+			if (dial_plan_trie[node].children[digit]==0) dial_plan_trie[node].children[digit]=nb_nodes++;
+			node=dial_plan_trie[node].children[digit];
+		}
+		/*the first plan of a shared ccc is the one in use, as with the former linear scan*/
+		if (dial_plan_trie[node].plan==0) dial_plan_trie[node].plan=i+1;
+		if (isupper(plan->iso_country_code[0]) && isupper(plan->iso_country_code[1]) && plan->iso_country_code[2]=='\0'){
+			int index=(plan->iso_country_code[0]-'A')*26+(plan->iso_country_code[1]-'A');
+			if (dial_plan_iso_index[index]==0) dial_plan_iso_index[index]=i+1;
 		}
-	} while ((found>1 || found==0) && i < sizeof(dial_plan->ccc));
-	if (found==1) {
-		return atoi(elected_dial_plan->ccc);
-	} else {
-		return -1; /*not found */
 	}
-
+	dial_plans_compiled=TRUE;
 }
-int linphone_dial_plan_lookup_ccc_from_iso(const char* iso) {
-	dial_plan_t* dial_plan;
-	for (dial_plan=(dial_plan_t*)dial_plans; dial_plan->country!=NULL; dial_plan++) {
-		if (strcmp(iso, dial_plan->iso_country_code)==0) {
-			return atoi(dial_plan->ccc);
-		}
+
+/*returns the plan with the longest ccc that is a prefix of the given digits*/
+static const dial_plan_t *lookup_dial_plan_by_prefix(const char *digits){
+	const dial_plan_t *found=NULL;
+	int node=0;
+	linphone_dial_plans_compile();
+	for(;*digits>='0' && *digits<='9';++digits){
+		node=dial_plan_trie[node].children[*digits-'0'];
+		if (node==0) break;
+		if (dial_plan_trie[node].plan!=0) found=&dial_plans[dial_plan_trie[node].plan-1];
 	}
-	return -1;
+	return found;
 }
 
-static void lookup_dial_plan(const char *ccc, dial_plan_t *plan){
-	int i;
-	for(i=0;dial_plans[i].country!=NULL;++i){
-		if (strcmp(ccc,dial_plans[i].ccc)==0){
-			*plan=dial_plans[i];
-			return;
-		}
+static const dial_plan_t *lookup_dial_plan(const char *ccc){
+	int node=0;
+	linphone_dial_plans_compile();
+	for(;*ccc!='\0';++ccc){
+		if (*ccc<'0' || *ccc>'9') return NULL;
+		node=dial_plan_trie[node].children[*ccc-'0'];
+		if (node==0) return NULL;
 	}
-	/*else return a generic "most common" dial plan*/
-	*plan=most_common_dialplan;
-	strcpy(plan->ccc,ccc);
+	return dial_plan_trie[node].plan!=0 ? &dial_plans[dial_plan_trie[node].plan-1] : NULL;
+}
+
+int linphone_dial_plan_lookup_ccc_from_e164(const char* e164) {
+	const dial_plan_t *plan;
+	if (e164[0]=='\0') return -1;
+	plan=lookup_dial_plan_by_prefix(&e164[1]);
+	return plan ? atoi(plan->ccc) : -1; /*-1 if not found */
+}
+
+int linphone_dial_plan_lookup_ccc_from_iso(const char* iso) {
+	int index;
+	linphone_dial_plans_compile();
+	if (!isupper((unsigned char)iso[0]) || !isupper((unsigned char)iso[1]) || iso[2]!='\0') return -1;
+	index=(iso[0]-'A')*26+(iso[1]-'A');
+	return dial_plan_iso_index[index]!=0 ? atoi(dial_plans[dial_plan_iso_index[index]-1].ccc) : -1;
 }
 
 static bool_t is_a_phone_number(const char *username){
@@ -890,87 +917,97 @@ static bool_t is_a_phone_number(const char *username){
 	return TRUE;
 }
 
-static char *flatten_number(const char *number){
-	char *result=ms_malloc0(strlen(number)+1);
-	char *w=result;
-	const char *r;
-	for(r=number;*r!='\0';++r){
-		if (*r=='+' || isdigit(*r)){
-			*w++=*r;
-		}
+static size_t flattened_number_length(const char *number){
+	size_t len=0;
+	for(;*number!='\0';++number){
+		if (*number=='+' || isdigit(*number)) len++;
 	}
-	*w++='\0';
-	return result;
+	return len;
 }
 
-static void replace_plus(const char *src, char *dest, size_t destlen, const char *icp){
-	int i=0;
-
-	if (icp && src[0]=='+' && (destlen>(i=strlen(icp))) ){
-		src++;
-		strcpy(dest,icp);
+/*copies the flattened number (only '+' and digits), starting from its skip-th character*/
+static void flatten_number(const char *number, size_t skip, char *dest, size_t destlen){
+	size_t i=0;
+	if (destlen==0) return;
+	for(;*number!='\0' && i<destlen-1;++number){
+		if (*number=='+' || isdigit(*number)){
+			if (skip>0) skip--;
+			else dest[i++]=*number;
+		}
 	}
+	dest[i]='\0';
+}
 
-	for(;(i<destlen-1) && *src!='\0';++i){
-		dest[i]=*src;
-		src++;
+static void normalize_phone_number(const char *number, const dial_plan_t *dialplan, const char *ccc, bool_t escape_plus, char *result, size_t result_len){
+	char head[8];
+	size_t icplen=strlen(dialplan->icp);
+	size_t i;
+	size_t skip=0;
+	size_t numlen;
+
+	/*only the first characters are needed to know whether the number is already international*/
+	flatten_number(number,0,head,sizeof(head));
+	if (head[0]=='+' || strncmp(head,dialplan->icp,icplen)==0){
+		/* the number has international prefix or +, so nothing to do*/
+		/*eventually replace the plus*/
+		if (escape_plus && head[0]=='+' && result_len>icplen){
+			strcpy(result,dialplan->icp);
+			flatten_number(number,1,result+icplen,result_len-icplen);
+		}else flatten_number(number,0,result,result_len);
+		return;
 	}
-	dest[i]='\0';
+	/*keep at most national number significant digits */
+	numlen=flattened_number_length(number);
+	if (numlen>(size_t)dialplan->nnl) skip=numlen-dialplan->nnl;
+	/*first prepend internation calling prefix or +*/
+	i=escape_plus ? icplen : 1;
+	if (result_len<=i){
+		flatten_number(number,skip,result,result_len);
+		return;
+	}
+	strcpy(result,escape_plus ? dialplan->icp : "+");
+	/*add prefix*/
+	if (result_len-i>strlen(ccc)){
+		strcpy(result+i,ccc);
+		i+=strlen(ccc);
+	}
+	/*add user digits */
+	flatten_number(number,skip,result+i,result_len-i);
+}
+
+static void normalize_number(LinphoneProxyConfig *proxy, const dial_plan_t *dialplan, const char *username, char *result, size_t result_len){
+	if (result_len==0) return;
+	if (!is_a_phone_number(username)){
+		strncpy(result,username,result_len-1);
+		result[result_len-1]='\0';
+	}else if (dialplan==NULL){
+		/*no prefix configured, nothing else to do*/
+		flatten_number(username,0,result,result_len);
+	}else normalize_phone_number(username,dialplan,proxy->dial_prefix,proxy->dial_escape_plus,result,result_len);
 }
 
+static const dial_plan_t *get_proxy_dial_plan(const LinphoneProxyConfig *proxy){
+	const dial_plan_t *dialplan;
+	if (proxy->dial_prefix==NULL || proxy->dial_prefix[0]=='\0') return NULL;
+	dialplan=lookup_dial_plan(proxy->dial_prefix);
+	/*else use a generic "most common" dial plan*/
+	return dialplan ? dialplan : &most_common_dialplan;
+}
 
 int linphone_proxy_config_normalize_number(LinphoneProxyConfig *proxy, const char *username, char *result, size_t result_len){
-	int numlen;
-	if (is_a_phone_number(username)){
-		char *flatten;
-		flatten=flatten_number(username);
-		ms_message("Flattened number is '%s'",flatten);
-
-		if (proxy->dial_prefix==NULL || proxy->dial_prefix[0]=='\0'){
-			/*no prefix configured, nothing else to do*/
-			strncpy(result,flatten,result_len);
-			ms_free(flatten);
-			return 0;
-		}else{
-			dial_plan_t dialplan;
-			lookup_dial_plan(proxy->dial_prefix,&dialplan);
-			ms_message("Using dialplan '%s'",dialplan.country);
-			if (flatten[0]=='+' || strstr(flatten,dialplan.icp)==flatten){
-				/* the number has international prefix or +, so nothing to do*/
-				ms_message("Prefix already present.");
-				/*eventually replace the plus*/
-				replace_plus(flatten,result,result_len,proxy->dial_escape_plus ? dialplan.icp : NULL);
-				ms_free(flatten);
-				return 0;
-			}else{
-				int i=0;
-				int skip;
-				numlen=strlen(flatten);
-				/*keep at most national number significant digits */
-				skip=numlen-dialplan.nnl;
-				if (skip<0) skip=0;
-				/*first prepend internation calling prefix or +*/
-				if (proxy->dial_escape_plus){
-					strncpy(result,dialplan.icp,result_len);
-					i+=strlen(dialplan.icp);
-				}else{
-					strncpy(result,"+",result_len);
-					i+=1;
-				}
-				/*add prefix*/
-				if (result_len-i>strlen(dialplan.ccc)){
-					strcpy(result+i,dialplan.ccc);
-					i+=strlen(dialplan.ccc);
-				}
-				/*add user digits */
-				strncpy(result+i,flatten+skip,result_len-i-1);
-				ms_free(flatten);
-			}
-		}
-	}else strncpy(result,username,result_len);
+	normalize_number(proxy,get_proxy_dial_plan(proxy),username,result,result_len);
 	return 0;
 }
 
+int linphone_proxy_config_normalize_numbers(LinphoneProxyConfig *proxy, const char * const *numbers, int count, char *results, size_t result_len){
+	const dial_plan_t *dialplan=get_proxy_dial_plan(proxy);
+	int i;
+	for(i=0;i<count;++i){
+		normalize_number(proxy,dialplan,numbers[i],results+i*result_len,result_len);
+	}
+	return count;
+}
+
 /**
  * Commits modification made to the proxy configuration.
 **/
@@ -29,6 +29,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "bellesip_sal/sal_impl.h"
 
 #include <ctype.h>
+#include <stddef.h>
 
 const char* sal_transport_to_string(SalTransport transport) {
 	switch (transport) {
@@ -59,13 +60,90 @@ SalMediaDescription *sal_media_description_new(){
 	return md;
 }
 
+typedef struct SalSharedString{
+	int refcount;
+	char value[1];
+}SalSharedString;
+
+#define SAL_SHARED_STRING(str) ((SalSharedString*)((char*)(str)-offsetof(SalSharedString,value)))
+
+static size_t sal_shared_string_size(const char *str){
+	return str ? offsetof(SalSharedString,value)+strlen(str)+1 : 0;
+}
+
+void sal_shared_string_clear(const char **str){
+	SalSharedString *ss;
+	if (*str==NULL) return;
+	ss=SAL_SHARED_STRING(*str);
+	if (--ss->refcount==0) ms_free(ss);
+	*str=NULL;
+}
+
+void sal_shared_string_assign(const char **str, const char *shared){
+	if (*str==shared) return;
+	if (shared) SAL_SHARED_STRING(shared)->refcount++;
+	sal_shared_string_clear(str);
+	*str=shared;
+}
+
+void sal_shared_string_set(const char **str, const char *value){
+	SalSharedString *ss;
+	size_t len;
+
+	if (value==NULL || value[0]=='\0'){
+		sal_shared_string_clear(str);
+		return;
+	}
+	if (*str && strcmp(*str,value)==0) return;
+	len=strlen(value);
+	ss=(SalSharedString*)ms_malloc(offsetof(SalSharedString,value)+len+1);
+	ss->refcount=1;
+	memcpy(ss->value,value,len+1);
+	sal_shared_string_clear(str);
+	*str=ss->value;
+}
+
+SalIceCandidate *sal_stream_description_add_ice_candidate(SalStreamDescription *sd){
+	SalIceCandidate *candidate;
+	if (sd->nb_ice_candidates>=SAL_MEDIA_DESCRIPTION_MAX_ICE_CANDIDATES) return NULL;
+	sd->ice_candidates=ms_realloc(sd->ice_candidates,(sd->nb_ice_candidates+1)*sizeof(SalIceCandidate));
+	candidate=&sd->ice_candidates[sd->nb_ice_candidates++];
+	memset(candidate,0,sizeof(*candidate));
+	return candidate;
+}
+
+void sal_stream_description_clear_ice_candidates(SalStreamDescription *sd){
+	if (sd->ice_candidates){
+		ms_free(sd->ice_candidates);
+		sd->ice_candidates=NULL;
+	}
+	sd->nb_ice_candidates=0;
+}
+
+void sal_stream_description_set_ice_candidates(SalStreamDescription *sd, const SalIceCandidate *candidates, int nb_candidates){
+	if (candidates==sd->ice_candidates) return;
+	sal_stream_description_clear_ice_candidates(sd);
+	if (nb_candidates>SAL_MEDIA_DESCRIPTION_MAX_ICE_CANDIDATES) nb_candidates=SAL_MEDIA_DESCRIPTION_MAX_ICE_CANDIDATES;
+	if (nb_candidates<=0) return;
+	sd->ice_candidates=ms_new(SalIceCandidate,nb_candidates);
+	memcpy(sd->ice_candidates,candidates,nb_candidates*sizeof(SalIceCandidate));
+	sd->nb_ice_candidates=nb_candidates;
+}
+
 static void sal_media_description_destroy(SalMediaDescription *md){
 	int i;
 	for(i=0;i<SAL_MEDIA_DESCRIPTION_MAX_STREAMS;i++){
-		ms_list_for_each(md->streams[i].payloads,(void (*)(void *))payload_type_destroy);
-		ms_list_free(md->streams[i].payloads);
-		md->streams[i].payloads=NULL;
-	}
+		SalStreamDescription *sd=&md->streams[i];
+		ms_list_for_each(sd->payloads,(void (*)(void *))payload_type_destroy);
+		ms_list_free(sd->payloads);
+		sd->payloads=NULL;
+		sal_stream_description_clear_ice_candidates(sd);
+		sal_shared_string_clear(&sd->ice_ufrag);
+		sal_shared_string_clear(&sd->ice_pwd);
+		if (md->payload_indexes[i]) ms_free(md->payload_indexes[i]);
+	}
+	sal_shared_string_clear(&md->ice_ufrag);
+	sal_shared_string_clear(&md->ice_pwd);
 	ms_free(md);
 }
 
@@ -150,6 +228,20 @@ int sal_media_description_get_nb_active_streams(const SalMediaDescription *md) {
 	return nb;
 }
 
+/*shared strings are accounted for each reference, so this is an upper bound when descriptions share them*/
+size_t sal_media_description_get_memory_size(const SalMediaDescription *md) {
+	size_t size = sizeof(SalMediaDescription);
+	int i;
+	size += sal_shared_string_size(md->ice_ufrag) + sal_shared_string_size(md->ice_pwd);
+	for (i = 0; i < md->nb_streams; i++) {
+		const SalStreamDescription *sd = &md->streams[i];
+		size += sd->nb_ice_candidates * sizeof(SalIceCandidate);
+		size += sal_shared_string_size(sd->ice_ufrag) + sal_shared_string_size(sd->ice_pwd);
+		size += ms_list_size(sd->payloads) * (sizeof(MSList) + sizeof(PayloadType));
+	}
+	return size;
+}
+
 
 static bool_t is_null_address(const char *addr){
 	return strcmp(addr,"0.0.0.0")==0 || strcmp(addr,"::0")==0;
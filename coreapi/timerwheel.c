@@ -0,0 +1,170 @@
+/*
+timerwheel.c
+Copyright (C) 2015  Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#include "private.h"
+
+/*
+ * Hashed timer wheel: a timer lands in the slot of its expiry tick, modulo the number of slots.
+ * Scheduling and cancelling are O(1), and running the wheel only visits the slots of the ticks elapsed
+ * since the previous run. Timers due in a later revolution simply stay in their slot until their time comes.
+ */
+#define TIMER_WHEEL_SLOTS 512 /*must be a power of 2*/
+#define TIMER_WHEEL_TICK_MS 50
+
+struct _LinphoneTimerWheel{
+	LinphoneTimer *slots[TIMER_WHEEL_SLOTS];
+	uint64_t current_tick; /*last tick processed by linphone_timer_wheel_run()*/
+	size_t count;
+};
+
+static void timer_unlink(LinphoneTimer *t){
+	if (t->prev) t->prev->next=t->next;
+	else *t->head=t->next;
+	if (t->next) t->next->prev=t->prev;
+	t->next=t->prev=NULL;
+	t->head=NULL;
+}
+
+static void timer_link(LinphoneTimer *t, LinphoneTimer **head){
+	t->prev=NULL;
+	t->next=*head;
+	if (*head) (*head)->prev=t;
+	*head=t;
+	t->head=head;
+}
+
+LinphoneTimerWheel *linphone_timer_wheel_new(uint64_t now){
+	LinphoneTimerWheel *w=ms_new0(LinphoneTimerWheel,1);
+	w->current_tick=now/TIMER_WHEEL_TICK_MS;
+	return w;
+}
+
+void linphone_timer_wheel_destroy(LinphoneTimerWheel *w){
+	int i;
+	for(i=0;i<TIMER_WHEEL_SLOTS;i++){
+		while(w->slots[i]!=NULL){
+			LinphoneTimer *t=w->slots[i];
+			timer_unlink(t);
+			t->wheel=NULL;
+		}
+	}
+	ms_free(w);
+}
+
+void linphone_timer_init(LinphoneTimer *t, LinphoneTimerFunc func, void *data){
+	memset(t,0,sizeof(*t));
+	t->func=func;
+	t->data=data;
+}
+
+void linphone_timer_wheel_schedule(LinphoneTimerWheel *w, LinphoneTimer *t, uint64_t expire_time){
+	uint64_t tick=expire_time/TIMER_WHEEL_TICK_MS;
+
+	linphone_timer_cancel(t);
+	/*a timer that is already due goes to the current slot, which is always visited by the next run*/
+	if (tick<w->current_tick) tick=w->current_tick;
+	t->expire_time=expire_time;
+	t->wheel=w;
+	timer_link(t,&w->slots[tick & (TIMER_WHEEL_SLOTS-1)]);
+	w->count++;
+}
+
+void linphone_timer_cancel(LinphoneTimer *t){
+	if (t->wheel==NULL) return;
+	if (t->head) timer_unlink(t);
+	t->wheel->count--;
+	t->wheel=NULL;
+}
+
+bool_t linphone_timer_is_scheduled(const LinphoneTimer *t){
+	return t->wheel!=NULL;
+}
+
+int linphone_timer_wheel_run(LinphoneTimerWheel *w, uint64_t now){
+	uint64_t now_tick=now/TIMER_WHEEL_TICK_MS;
+	uint64_t nticks,i;
+	LinphoneTimer *due=NULL;
+	LinphoneTimer *t,*next;
+	int fired=0;
+
+	if (w->count==0){
+		if (now_tick>w->current_tick) w->current_tick=now_tick;
+		return 0;
+	}
+	/*the current tick is visited again, because timers that were already due when scheduled are put there*/
+	nticks=(now_tick>=w->current_tick) ? now_tick-w->current_tick+1 : 1;
+	if (nticks>TIMER_WHEEL_SLOTS) nticks=TIMER_WHEEL_SLOTS;
+	/*move the expired timers to a private list first, so that callbacks can freely schedule or cancel any timer*/
+	for(i=0;i<nticks;i++){
+		LinphoneTimer **slot=&w->slots[(w->current_tick+i) & (TIMER_WHEEL_SLOTS-1)];
+		for(t=*slot;t!=NULL;t=next){
+			next=t->next;
+			if (t->expire_time<=now){
+				timer_unlink(t);
+				timer_link(t,&due);
+			}
+		}
+	}
+	if (now_tick>w->current_tick) w->current_tick=now_tick;
+	while(due!=NULL){
+		t=due;
+		timer_unlink(t);
+		w->count--;
+		t->wheel=NULL;
+		fired++;
+		t->func(t->data);
+	}
+	return fired;
+}
+
+bool_t linphone_timer_wheel_get_next_expiry(const LinphoneTimerWheel *w, uint64_t *expire_time){
+	uint64_t i;
+	uint64_t best=0;
+	bool_t found=FALSE;
+	LinphoneTimer *t;
+
+	if (w->count==0) return FALSE;
+	/*the first slot, in wheel order, holding a timer of the current revolution contains the earliest one*/
+	for(i=0;i<TIMER_WHEEL_SLOTS && !found;i++){
+		uint64_t tick=w->current_tick+i;
+		for(t=w->slots[tick & (TIMER_WHEEL_SLOTS-1)];t!=NULL;t=t->next){
+			if (t->expire_time/TIMER_WHEEL_TICK_MS<=tick && (!found || t->expire_time<best)){
+				best=t->expire_time;
+				found=TRUE;
+			}
+		}
+	}
+	if (!found){
+		/*all timers are more than one revolution away*/
+		for(i=0;i<TIMER_WHEEL_SLOTS;i++){
+			for(t=w->slots[i];t!=NULL;t=t->next){
+				if (!found || t->expire_time<best){
+					best=t->expire_time;
+					found=TRUE;
+				}
+			}
+		}
+	}
+	*expire_time=best;
+	return found;
+}
+
+size_t linphone_timer_wheel_size(const LinphoneTimerWheel *w){
+	return w->count;
+}
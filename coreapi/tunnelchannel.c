@@ -0,0 +1,210 @@
+/*
+tunnelchannel.c
+Copyright (C) 2015  Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#include "private.h"
+
+/*
+ * Socket shared by several datagram flows. Every datagram is prefixed with the id of the flow it belongs to, on
+ * 2 bytes in network byte order. As each flow reads the socket from its own thread, datagrams read on behalf of
+ * another flow are queued until that flow reads them.
+ */
+
+typedef struct _TunnelChannelDatagram{
+	struct sockaddr_storage from;
+	socklen_t fromlen;
+	size_t len;
+	/*followed by the payload*/
+}TunnelChannelDatagram;
+
+typedef struct _TunnelChannelStream{
+	uint16_t id;
+	MSList *pending; /*TunnelChannelDatagram, oldest first*/
+	int nb_pending;
+}TunnelChannelStream;
+
+struct _LinphoneTunnelChannel{
+	void *socket; /*NULL once detached*/
+	LinphoneTunnelChannelSendFunc send_func;
+	LinphoneTunnelChannelRecvFunc recv_func;
+	LinphoneTunnelChannelCloseFunc close_func;
+	ortp_mutex_t mutex;
+	MSList *streams;
+	uint16_t next_id;
+};
+
+static void tunnel_channel_stream_destroy(TunnelChannelStream *stream){
+	ms_list_for_each(stream->pending,ms_free);
+	ms_list_free(stream->pending);
+	ms_free(stream);
+}
+
+static TunnelChannelStream *tunnel_channel_find_stream(const LinphoneTunnelChannel *channel, uint16_t id){
+	const MSList *elem;
+	for(elem=channel->streams;elem!=NULL;elem=elem->next){
+		TunnelChannelStream *stream=(TunnelChannelStream*)elem->data;
+		if (stream->id==id) return stream;
+	}
+	return NULL;
+}
+
+LinphoneTunnelChannel *linphone_tunnel_channel_new(void *socket, LinphoneTunnelChannelSendFunc send_func, LinphoneTunnelChannelRecvFunc recv_func, LinphoneTunnelChannelCloseFunc close_func){
+	LinphoneTunnelChannel *channel=ms_new0(LinphoneTunnelChannel,1);
+	channel->socket=socket;
+	channel->send_func=send_func;
+	channel->recv_func=recv_func;
+	channel->close_func=close_func;
+	ortp_mutex_init(&channel->mutex,NULL);
+	return channel;
+}
+
+void linphone_tunnel_channel_destroy(LinphoneTunnelChannel *channel){
+	ms_list_for_each(channel->streams,(void (*)(void*))tunnel_channel_stream_destroy);
+	ms_list_free(channel->streams);
+	ortp_mutex_destroy(&channel->mutex);
+	ms_free(channel);
+}
+
+void *linphone_tunnel_channel_get_socket(const LinphoneTunnelChannel *channel){
+	return channel->socket;
+}
+
+void linphone_tunnel_channel_detach_socket(LinphoneTunnelChannel *channel){
+	ortp_mutex_lock(&channel->mutex);
+	channel->socket=NULL;
+	ortp_mutex_unlock(&channel->mutex);
+}
+
+uint16_t linphone_tunnel_channel_add_stream(LinphoneTunnelChannel *channel){
+	TunnelChannelStream *stream=ms_new0(TunnelChannelStream,1);
+	ortp_mutex_lock(&channel->mutex);
+	do{
+		if (++channel->next_id==0) channel->next_id=1;
+	}while(tunnel_channel_find_stream(channel,channel->next_id)!=NULL);
+	stream->id=channel->next_id;
+	channel->streams=ms_list_append(channel->streams,stream);
+	ortp_mutex_unlock(&channel->mutex);
+	return stream->id;
+}
+
+bool_t linphone_tunnel_channel_remove_stream(LinphoneTunnelChannel *channel, uint16_t id){
+	TunnelChannelStream *stream;
+	void *socket=NULL;
+	bool_t empty;
+	ortp_mutex_lock(&channel->mutex);
+	stream=tunnel_channel_find_stream(channel,id);
+	if (stream!=NULL){
+		channel->streams=ms_list_remove(channel->streams,stream);
+		tunnel_channel_stream_destroy(stream);
+	}
+	empty=(channel->streams==NULL);
+	if (empty){
+		socket=channel->socket;
+		channel->socket=NULL;
+	}
+	ortp_mutex_unlock(&channel->mutex);
+	if (socket!=NULL && channel->close_func!=NULL) channel->close_func(socket);
+	return empty;
+}
+
+int linphone_tunnel_channel_sendto(LinphoneTunnelChannel *channel, uint16_t id, LinphoneSendBuffer *buffer, const mblk_t *msg, const struct sockaddr *to, socklen_t tolen){
+	uint8_t header[LINPHONE_TUNNEL_CHANNEL_HEADER_SIZE];
+	const uint8_t *data;
+	size_t size;
+	int err=-1;
+
+	header[0]=(uint8_t)(id>>8);
+	header[1]=(uint8_t)(id&0xff);
+	data=linphone_send_buffer_gather_with_header(buffer,header,sizeof(header),msg,&size);
+	ortp_mutex_lock(&channel->mutex);
+	if (channel->socket!=NULL){
+		channel->send_func(channel->socket,data,size,to,tolen);
+		err=(int)(size-sizeof(header));
+	}
+	ortp_mutex_unlock(&channel->mutex);
+	return err;
+}
+
+static void tunnel_channel_stream_queue(TunnelChannelStream *stream, const uint8_t *data, size_t len, const struct sockaddr *from, socklen_t fromlen){
+	TunnelChannelDatagram *d;
+	if (stream->nb_pending>=LINPHONE_TUNNEL_CHANNEL_MAX_PENDING){
+		/*this flow does not read anymore, drop its oldest datagram*/
+		ms_free(stream->pending->data);
+		stream->pending=ms_list_remove_link(stream->pending,stream->pending);
+		stream->nb_pending--;
+	}
+	d=(TunnelChannelDatagram*)ms_malloc(sizeof(TunnelChannelDatagram)+len);
+	d->fromlen=MIN(fromlen,(socklen_t)sizeof(d->from));
+	memcpy(&d->from,from,d->fromlen);
+	d->len=len;
+	memcpy(d+1,data,len);
+	stream->pending=ms_list_append(stream->pending,d);
+	stream->nb_pending++;
+}
+
+int linphone_tunnel_channel_recvfrom(LinphoneTunnelChannel *channel, uint16_t id, uint8_t *buf, size_t size, struct sockaddr *from, socklen_t fromlen){
+	TunnelChannelStream *stream;
+	int ret=0;
+
+	ortp_mutex_lock(&channel->mutex);
+	stream=tunnel_channel_find_stream(channel,id);
+	if (stream==NULL){
+		ortp_mutex_unlock(&channel->mutex);
+		return 0;
+	}
+	if (stream->pending!=NULL){
+		TunnelChannelDatagram *d=(TunnelChannelDatagram*)stream->pending->data;
+		size_t len=MIN(d->len,size);
+		memcpy(buf,d+1,len);
+		memcpy(from,&d->from,MIN(fromlen,d->fromlen));
+		ms_free(d);
+		stream->pending=ms_list_remove_link(stream->pending,stream->pending);
+		stream->nb_pending--;
+		ortp_mutex_unlock(&channel->mutex);
+		return (int)len;
+	}
+	while(channel->socket!=NULL){
+		TunnelChannelStream *other;
+		uint16_t dest;
+		int len=channel->recv_func(channel->socket,buf,size,from,fromlen);
+		if (len<=0) break;
+		if (len<LINPHONE_TUNNEL_CHANNEL_HEADER_SIZE) continue; /*not a multiplexed datagram*/
+		dest=(uint16_t)((buf[0]<<8)|buf[1]);
+		len-=LINPHONE_TUNNEL_CHANNEL_HEADER_SIZE;
+		if (dest==id){
+			memmove(buf,buf+LINPHONE_TUNNEL_CHANNEL_HEADER_SIZE,len);
+			ret=len;
+			break;
+		}
+		other=tunnel_channel_find_stream(channel,dest);
+		if (other==NULL) continue; /*the stream is closed already*/
+		tunnel_channel_stream_queue(other,buf+LINPHONE_TUNNEL_CHANNEL_HEADER_SIZE,len,from,fromlen);
+	}
+	ortp_mutex_unlock(&channel->mutex);
+	return ret;
+}
+
+int linphone_tunnel_channel_get_pending_count(const LinphoneTunnelChannel *channel, uint16_t id){
+	TunnelChannelStream *stream;
+	int count=0;
+	ortp_mutex_lock((ortp_mutex_t*)&channel->mutex);
+	stream=tunnel_channel_find_stream(channel,id);
+	if (stream!=NULL) count=stream->nb_pending;
+	ortp_mutex_unlock((ortp_mutex_t*)&channel->mutex);
+	return count;
+}
@@ -200,10 +200,11 @@ typedef struct SalStreamDescription{
 	unsigned int crypto_local_tag;
 	int max_rate;
 	OrtpRtcpXrConfiguration rtcp_xr;
-	SalIceCandidate ice_candidates[SAL_MEDIA_DESCRIPTION_MAX_ICE_CANDIDATES];
+	SalIceCandidate *ice_candidates; /*nb_ice_candidates elements, at most SAL_MEDIA_DESCRIPTION_MAX_ICE_CANDIDATES*/
+	int nb_ice_candidates;
 	SalIceRemoteCandidate ice_remote_candidates[SAL_MEDIA_DESCRIPTION_MAX_ICE_REMOTE_CANDIDATES];
-	char ice_ufrag[SAL_MEDIA_DESCRIPTION_MAX_ICE_UFRAG_LEN];
-	char ice_pwd[SAL_MEDIA_DESCRIPTION_MAX_ICE_PWD_LEN];
+	const char *ice_ufrag; /*shared string, NULL if not set*/
+	const char *ice_pwd; /*shared string, NULL if not set*/
 	bool_t ice_mismatch;
 	bool_t ice_completed;
 	bool_t pad[2];
@@ -211,6 +212,14 @@ typedef struct SalStreamDescription{
 
 const char *sal_stream_description_get_type_as_string(const SalStreamDescription *desc);
 const char *sal_stream_description_get_proto_as_string(const SalStreamDescription *desc);
+LINPHONE_PUBLIC SalIceCandidate *sal_stream_description_add_ice_candidate(SalStreamDescription *sd);
+void sal_stream_description_set_ice_candidates(SalStreamDescription *sd, const SalIceCandidate *candidates, int nb_candidates);
+void sal_stream_description_clear_ice_candidates(SalStreamDescription *sd);
+
+/*shared strings are immutable and reference counted: assigning one takes a reference instead of a copy. Empty strings are stored as NULL.*/
+LINPHONE_PUBLIC void sal_shared_string_set(const char **str, const char *value);
+void sal_shared_string_assign(const char **str, const char *shared);
+void sal_shared_string_clear(const char **str);
 
 #define SAL_MEDIA_DESCRIPTION_MAX_STREAMS 8
 
@@ -226,11 +235,12 @@ typedef struct SalMediaDescription{
 	SalStreamDir dir;
 	SalStreamDescription streams[SAL_MEDIA_DESCRIPTION_MAX_STREAMS];
 	OrtpRtcpXrConfiguration rtcp_xr;
-	char ice_ufrag[SAL_MEDIA_DESCRIPTION_MAX_ICE_UFRAG_LEN];
-	char ice_pwd[SAL_MEDIA_DESCRIPTION_MAX_ICE_PWD_LEN];
+	const char *ice_ufrag; /*shared string, NULL if not set*/
+	const char *ice_pwd; /*shared string, NULL if not set*/
 	bool_t ice_lite;
 	bool_t ice_completed;
 	bool_t pad[2];
+	void *payload_indexes[SAL_MEDIA_DESCRIPTION_MAX_STREAMS]; /*built by the offer/answer when the description is the local one*/
 } SalMediaDescription;
 
 typedef struct SalMessage{
@@ -249,9 +259,9 @@ typedef struct SalIsComposing {
 
 #define SAL_MEDIA_DESCRIPTION_MAX_MESSAGE_ATTRIBUTES 5
 
-SalMediaDescription *sal_media_description_new();
+LINPHONE_PUBLIC SalMediaDescription *sal_media_description_new();
 SalMediaDescription * sal_media_description_ref(SalMediaDescription *md);
-void sal_media_description_unref(SalMediaDescription *md);
+LINPHONE_PUBLIC void sal_media_description_unref(SalMediaDescription *md);
 bool_t sal_media_description_empty(const SalMediaDescription *md);
 int sal_media_description_equals(const SalMediaDescription *md1, const SalMediaDescription *md2);
 bool_t sal_media_description_has_dir(const SalMediaDescription *md, SalStreamDir dir);
@@ -268,6 +278,7 @@ bool_t sal_stream_description_has_srtp(const SalStreamDescription *sd);
 bool_t sal_media_description_has_avpf(const SalMediaDescription *md);
 bool_t sal_media_description_has_srtp(const SalMediaDescription *md);
 int sal_media_description_get_nb_active_streams(const SalMediaDescription *md);
+LINPHONE_PUBLIC size_t sal_media_description_get_memory_size(const SalMediaDescription *md);
 
 
 /*this structure must be at the first byte of the SalOp structure defined by implementors*/
@@ -330,6 +341,7 @@ typedef struct SalErrorInfo{
 	int protocol_code;
 	char *warnings;
 	char *full_string; /*concatenation of status_string + warnings*/
+	int retry_after; /*delay in seconds requested by the Retry-After header of the response, 0 if none*/
 }SalErrorInfo;
 
 typedef enum SalPresenceStatus{
@@ -558,6 +570,14 @@ LINPHONE_PUBLIC void sal_enable_test_features(Sal*ctx, bool_t enabled);
 void sal_use_no_initial_route(Sal *ctx, bool_t enabled);
 
 int sal_iterate(Sal *sal);
+/*processes SIP events until timeout_ms elapsed, sal_interrupt_wait() is called or a SIP event is processed*/
+int sal_wait(Sal *sal, int timeout_ms);
+void sal_interrupt_wait(Sal *sal);
+/*same as sal_interrupt_wait(), but can be called from any thread*/
+void sal_wakeup(Sal *sal);
+/*requests sent counts the ones initiated by operations, not the retransmissions, refreshes, ACKs or CANCELs*/
+void sal_get_message_counters(const Sal *sal, uint64_t *requests_received, uint64_t *responses_received, uint64_t *requests_sent);
+void sal_reset_message_counters(Sal *sal);
 MSList * sal_get_pending_auths(Sal *sal);
 
 /*create an operation */
@@ -653,6 +673,7 @@ int sal_message_reply(SalOp *op, SalReason reason);
 
 /*presence Subscribe/notify*/
 int sal_subscribe_presence(SalOp *op, const char *from, const char *to, int expires);
+int sal_subscribe_presence_list(SalOp *op, const char *from, const char *to, int expires);
 int sal_notify_presence(SalOp *op, SalPresenceModel *presence);
 int sal_notify_presence_close(SalOp *op);
 
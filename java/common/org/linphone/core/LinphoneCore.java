@@ -1507,6 +1507,12 @@ public interface LinphoneCore {
 	 * Once this time is elapsed (ringing included), the call is automatically hung up.
 	**/
 	void setInCallTimeout(int timeout);
+
+	/**
+	 * Set the minimum interval in milliseconds between two callStatsUpdated() notifications for the same stream of a call.
+	 * The updates received in between are coalesced into the next notification. 0, the default, notifies every update.
+	**/
+	void setCallStatsNotificationInterval(int interval);
 	/**
 	 * Allow to control microphone level:
 	 * @param gain in db
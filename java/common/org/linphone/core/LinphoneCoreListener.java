@@ -45,7 +45,9 @@ public interface LinphoneCoreListener {
 	void callState(LinphoneCore lc, LinphoneCall call, LinphoneCall.State cstate,String message);
 
 	/**
-	 * Call stats notification
+	 * Call stats notification.
+	 * The same stats object is updated and passed again for each report of the call's audio or video stream,
+	 * the values must be copied if they are to be kept.
 	 */
 	void callStatsUpdated(LinphoneCore lc, LinphoneCall call, LinphoneCallStats stats);
 
@@ -50,6 +50,12 @@ class LinphoneCallStatsImpl implements LinphoneCallStats {
 	private native float getLocalLateRate(long nativeStatsPtr);
 	private native void updateStats(long nativeCallPtr, int mediaType);
 
+	/*
+	 * Used by JNI for the stats of a call, whose fields are then updated in place on each report.
+	 */
+	private LinphoneCallStatsImpl() {
+	}
+
 	protected LinphoneCallStatsImpl(long nativeCallPtr, long nativeStatsPtr) {
 		nativePtr=nativeStatsPtr;
 		mediaType = getMediaType(nativeStatsPtr);
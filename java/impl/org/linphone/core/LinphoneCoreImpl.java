@@ -145,6 +145,7 @@ class LinphoneCoreImpl implements LinphoneCore {
 	private native void setVideoPortRange(long nativePtr, int minPort, int maxPort);
 	private native void setIncomingTimeout(long nativePtr, int timeout);
 	private native void setInCallTimeout(long nativePtr, int timeout);
+	private native void setCallStatsNotificationInterval(long nativePtr, int interval);
 	private native void setPrimaryContact(long nativePtr, String displayName, String username);
 	private native String getPrimaryContactUsername(long nativePtr);
 	private native String getPrimaryContactDisplayName(long nativePtr);
@@ -948,6 +949,10 @@ class LinphoneCoreImpl implements LinphoneCore {
 		setInCallTimeout(nativePtr, timeout);
 	}
 
+	public synchronized void setCallStatsNotificationInterval(int interval) {
+		setCallStatsNotificationInterval(nativePtr, interval);
+	}
+
 	private native void setMicrophoneGain(long ptr, float gain);
 	public synchronized void setMicrophoneGain(float gain) {
 		setMicrophoneGain(nativePtr, gain);
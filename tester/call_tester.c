@@ -95,6 +95,11 @@ void linphone_call_encryption_changed(LinphoneCore *lc, LinphoneCall *call, bool
 	else
 		counters->number_of_LinphoneCallEncryptedOff++;
 }
+void linphone_call_stats_updated(LinphoneCore *lc, LinphoneCall *call, const LinphoneCallStats *call_stats) {
+	stats* counters = get_stats(lc);
+	counters->number_of_LinphoneCallStatsUpdated++;
+	counters->last_call_stats_updated_flags = call_stats->updated;
+}
 void linphone_transfer_state_changed(LinphoneCore *lc, LinphoneCall *transfered, LinphoneCallState new_call_state) {
 	char* to=linphone_address_as_string(linphone_call_get_call_log(transfered)->to);
 	char* from=linphone_address_as_string(linphone_call_get_call_log(transfered)->from);
@@ -640,6 +645,114 @@ static void call_failed_because_of_codecs(void) {
 	linphone_core_manager_destroy(pauline);
 }
 
+static void media_port_allocation(void) {
+	LinphoneCoreManager* marie = linphone_core_manager_new2( "empty_rc", FALSE);
+	LinphoneCall *calls[4];
+	LinphoneCall *call;
+	LinphoneMediaPortStats stats;
+	int freed_port;
+	int i, j;
+
+	/*three RTP/RTCP pairs: 40200, 40202 and 40204*/
+	linphone_core_set_audio_port_range(marie->lc,40200,40205);
+	linphone_core_set_max_calls(marie->lc,10);
+	for (i=0;i<4;i++){
+		calls[i]=linphone_core_invite(marie->lc,"sip:pauline@127.0.0.1:5999");
+		CU_ASSERT_PTR_NOT_NULL_FATAL(calls[i]);
+	}
+	for (i=0;i<3;i++){
+		CU_ASSERT_TRUE(calls[i]->media_ports[0].allocated);
+		CU_ASSERT_TRUE(calls[i]->media_ports[0].rtp_port>=40200 && calls[i]->media_ports[0].rtp_port<=40204);
+		CU_ASSERT_EQUAL(calls[i]->media_ports[0].rtp_port%2,0);
+		CU_ASSERT_EQUAL(calls[i]->media_ports[0].rtcp_port,calls[i]->media_ports[0].rtp_port+1);
+		for (j=0;j<i;j++) CU_ASSERT_NOT_EQUAL(calls[i]->media_ports[0].rtp_port,calls[j]->media_ports[0].rtp_port);
+	}
+	/*the range is exhausted, the port of the last call is chosen by the system*/
+	CU_ASSERT_FALSE(calls[3]->media_ports[0].allocated);
+	linphone_core_get_media_port_stats(marie->lc,LINPHONE_CALL_STATS_AUDIO,&stats);
+	CU_ASSERT_EQUAL(stats.nb_ports,3);
+	CU_ASSERT_EQUAL(stats.nb_used,3);
+	CU_ASSERT_EQUAL(stats.max_used,3);
+	CU_ASSERT_EQUAL(stats.nb_exhausted,1);
+	/*with a fixed video port, the following ones are used in order*/
+	linphone_core_get_media_port_stats(marie->lc,LINPHONE_CALL_STATS_VIDEO,&stats);
+	CU_ASSERT_EQUAL(stats.nb_used,4);
+	CU_ASSERT_EQUAL(calls[1]->media_ports[1].rtp_port,calls[0]->media_ports[1].rtp_port+2);
+
+	/*the pair of a terminated call is reused*/
+	freed_port=calls[1]->media_ports[0].rtp_port;
+	linphone_core_terminate_call(marie->lc,calls[1]);
+	CU_ASSERT_TRUE(wait_for(marie->lc,NULL,&marie->stat.number_of_LinphoneCallReleased,1));
+	linphone_core_get_media_port_stats(marie->lc,LINPHONE_CALL_STATS_AUDIO,&stats);
+	CU_ASSERT_EQUAL(stats.nb_used,2);
+	call=linphone_core_invite(marie->lc,"sip:pauline@127.0.0.1:5999");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(call);
+	CU_ASSERT_TRUE(call->media_ports[0].allocated);
+	CU_ASSERT_EQUAL(call->media_ports[0].rtp_port,freed_port);
+
+	linphone_core_terminate_all_calls(marie->lc);
+	CU_ASSERT_TRUE(wait_for(marie->lc,NULL,&marie->stat.number_of_LinphoneCallReleased,5));
+	linphone_core_get_media_port_stats(marie->lc,LINPHONE_CALL_STATS_AUDIO,&stats);
+	CU_ASSERT_EQUAL(stats.nb_used,0);
+	CU_ASSERT_EQUAL(stats.max_used,3);
+	linphone_core_manager_destroy(marie);
+}
+
+static void call_stats_notification_interval(void) {
+	LinphoneCoreManager* marie = linphone_core_manager_new2( "empty_rc", FALSE);
+	LinphoneCallStatsSnapshot snapshots[4];
+	LinphoneCall *call;
+	int nb_streams, i;
+
+	linphone_core_set_call_stats_notification_interval(marie->lc,300);
+	CU_ASSERT_EQUAL(linphone_core_get_call_stats_notification_interval(marie->lc),300);
+	call=linphone_core_invite(marie->lc,"sip:pauline@127.0.0.1:5999");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(call);
+
+	/*the first update is notified immediately*/
+	call->stats[LINPHONE_CALL_STATS_AUDIO].updated=LINPHONE_CALL_STATS_RECEIVED_RTCP_UPDATE;
+	linphone_call_notify_stats_updated(call,LINPHONE_CALL_STATS_AUDIO);
+	CU_ASSERT_EQUAL(marie->stat.number_of_LinphoneCallStatsUpdated,1);
+	/*the next ones are coalesced until the interval is elapsed*/
+	call->stats[LINPHONE_CALL_STATS_AUDIO].updated=LINPHONE_CALL_STATS_SENT_RTCP_UPDATE;
+	linphone_call_notify_stats_updated(call,LINPHONE_CALL_STATS_AUDIO);
+	call->stats[LINPHONE_CALL_STATS_AUDIO].updated=LINPHONE_CALL_STATS_RECEIVED_RTCP_UPDATE;
+	linphone_call_notify_stats_updated(call,LINPHONE_CALL_STATS_AUDIO);
+	CU_ASSERT_EQUAL(marie->stat.number_of_LinphoneCallStatsUpdated,1);
+	CU_ASSERT_TRUE(wait_for(marie->lc,NULL,&marie->stat.number_of_LinphoneCallStatsUpdated,2));
+	CU_ASSERT_EQUAL(marie->stat.last_call_stats_updated_flags,LINPHONE_CALL_STATS_RECEIVED_RTCP_UPDATE|LINPHONE_CALL_STATS_SENT_RTCP_UPDATE);
+	CU_ASSERT_EQUAL(call->stats[LINPHONE_CALL_STATS_AUDIO].updated,0);
+
+	/*an update held back is delivered when the interval is changed*/
+	call->stats[LINPHONE_CALL_STATS_AUDIO].updated=LINPHONE_CALL_STATS_SENT_RTCP_UPDATE;
+	linphone_call_notify_stats_updated(call,LINPHONE_CALL_STATS_AUDIO);
+	CU_ASSERT_EQUAL(marie->stat.number_of_LinphoneCallStatsUpdated,2);
+	linphone_core_set_call_stats_notification_interval(marie->lc,0);
+	CU_ASSERT_EQUAL(marie->stat.number_of_LinphoneCallStatsUpdated,3);
+	call->stats[LINPHONE_CALL_STATS_AUDIO].updated=LINPHONE_CALL_STATS_SENT_RTCP_UPDATE;
+	linphone_call_notify_stats_updated(call,LINPHONE_CALL_STATS_AUDIO);
+	CU_ASSERT_EQUAL(marie->stat.number_of_LinphoneCallStatsUpdated,4);
+
+	nb_streams=linphone_core_get_call_stats_snapshot(marie->lc,NULL,0);
+	/*the audio stream is created with the call, the video one depends on the configuration*/
+	CU_ASSERT_TRUE(nb_streams>=1 && nb_streams<=2);
+	CU_ASSERT_EQUAL(linphone_core_get_call_stats_snapshot(marie->lc,snapshots,4),nb_streams);
+	for (i=0;i<nb_streams;i++){
+		CU_ASSERT_PTR_EQUAL(snapshots[i].call,call);
+		CU_ASSERT_TRUE(snapshots[i].type==LINPHONE_CALL_STATS_AUDIO || snapshots[i].type==LINPHONE_CALL_STATS_VIDEO);
+	}
+	/*the audio snapshot comes first and reflects the audio stats of the call*/
+	CU_ASSERT_EQUAL(snapshots[0].type,LINPHONE_CALL_STATS_AUDIO);
+	CU_ASSERT_EQUAL(snapshots[0].ice_state,linphone_call_stats_get_ice_state(linphone_call_get_audio_stats(call)));
+	CU_ASSERT_TRUE(snapshots[0].download_bandwidth>=0 && snapshots[0].upload_bandwidth>=0);
+	CU_ASSERT_EQUAL(linphone_core_get_call_stats_snapshot(marie->lc,snapshots,nb_streams-1),nb_streams-1);
+
+	linphone_core_terminate_all_calls(marie->lc);
+	CU_ASSERT_TRUE(wait_for(marie->lc,NULL,&marie->stat.number_of_LinphoneCallReleased,1));
+	CU_ASSERT_EQUAL(linphone_core_get_call_stats_snapshot(marie->lc,NULL,0),0);
+	linphone_core_manager_destroy(marie);
+}
+
 static void call_with_dns_time_out(void) {
 	LinphoneCoreManager* marie = linphone_core_manager_new2( "empty_rc", FALSE);
 	LCSipTransports transport = {9773,0,0,0};
@@ -3198,12 +3311,100 @@ static void call_log_from_taken_from_p_asserted_id(void) {
 	linphone_core_manager_destroy(marie);
 	linphone_core_manager_destroy(pauline);
 }
+
+#ifdef MSG_STORAGE_ENABLED
+static void call_logs_storage(void) {
+	LinphoneCoreManager* marie = linphone_core_manager_new2("empty_rc", FALSE);
+	LinphoneCore *lc = marie->lc;
+	LinphoneAddress *bob = linphone_address_new("sip:bob@sip.example.org");
+	LinphoneCallLogFilter filter = {0};
+	LinphoneCallLog *cl;
+	MSList *logs;
+	char tmp_db[256];
+	time_t now = time(NULL);
+	int i;
+
+	snprintf(tmp_db, sizeof(tmp_db), "%s/tmp_call_logs.db", liblinphone_tester_writable_dir_prefix);
+	remove(tmp_db);
+
+	/*30 incoming calls, one per minute, every third one from bob, every other one missed*/
+	for (i = 0; i < 30; i++) {
+		cl = linphone_call_log_new(LinphoneCallIncoming,
+			linphone_address_new(i % 3 ? "sip:alice@sip.example.org" : "sip:bob@sip.example.org"),
+			linphone_address_new("sip:marie@sip.example.org"));
+		cl->start_date_time = now - (30 - i) * 60;
+		cl->status = (i % 2) ? LinphoneCallMissed : LinphoneCallSuccess;
+		lc->call_logs = ms_list_prepend(lc->call_logs, cl);
+	}
+	call_logs_write_to_config_file(lc);
+	CU_ASSERT_TRUE(lp_config_has_section(lc->config, "call_log_29"));
+
+	/*they are moved to the database, and only the most recent ones are kept in memory*/
+	linphone_core_set_call_logs_database_path(lc, tmp_db);
+	CU_ASSERT_FALSE(lp_config_has_section(lc->config, "call_log_0"));
+	CU_ASSERT_EQUAL(ms_list_size(linphone_core_get_call_logs(lc)), MIN(30, lc->max_call_logs));
+	CU_ASSERT_EQUAL(linphone_core_get_call_history_size(lc, NULL), 30);
+
+	filter.missed_only = TRUE;
+	CU_ASSERT_EQUAL(linphone_core_get_call_history_size(lc, &filter), 15);
+	filter.peer = bob;
+	CU_ASSERT_EQUAL(linphone_core_get_call_history_size(lc, &filter), 5);
+	filter.missed_only = FALSE;
+	CU_ASSERT_EQUAL(linphone_core_get_call_history_size(lc, &filter), 10);
+	filter.peer = NULL;
+	filter.start_date = now - 20 * 60;
+	filter.end_date = now - 5 * 60;
+	CU_ASSERT_EQUAL(linphone_core_get_call_history_size(lc, &filter), 15);
+	logs = linphone_core_get_call_history(lc, &filter, 0, 0);
+	CU_ASSERT_EQUAL(ms_list_size(logs), 15);
+	if (logs) CU_ASSERT_EQUAL(linphone_call_log_get_start_date((LinphoneCallLog *)logs->data), now - 6 * 60);
+	ms_list_free_with_data(logs, (void (*)(void *))linphone_call_log_unref);
+
+	/*pages are ordered by start date, most recent first*/
+	logs = linphone_core_get_call_history(lc, NULL, 0, 5);
+	CU_ASSERT_EQUAL(ms_list_size(logs), 5);
+	if (logs) CU_ASSERT_PTR_EQUAL(logs->data, linphone_core_get_call_logs(lc)->data);
+	ms_list_free_with_data(logs, (void (*)(void *))linphone_call_log_unref);
+	logs = linphone_core_get_call_history(lc, NULL, 25, 10);
+	CU_ASSERT_EQUAL(ms_list_size(logs), 5);
+	if (logs) {
+		CU_ASSERT_EQUAL(linphone_call_log_get_start_date((LinphoneCallLog *)logs->data), now - 26 * 60);
+		/*call logs that are not in memory can be removed too*/
+		linphone_core_remove_call_log(lc, (LinphoneCallLog *)logs->data);
+	}
+	ms_list_free_with_data(logs, (void (*)(void *))linphone_call_log_unref);
+	CU_ASSERT_EQUAL(linphone_core_get_call_history_size(lc, NULL), 29);
+
+	/*new calls are added to the database, which is not migrated again when reopened*/
+	cl = linphone_call_log_new(LinphoneCallOutgoing, linphone_address_new("sip:marie@sip.example.org"), linphone_address_clone(bob));
+	lc->call_logs = ms_list_prepend(lc->call_logs, cl);
+	linphone_core_call_log_storage_add(lc, cl);
+	CU_ASSERT_NOT_EQUAL(cl->storage_id, 0);
+	linphone_core_set_call_logs_database_path(lc, tmp_db);
+	CU_ASSERT_EQUAL(linphone_core_get_call_history_size(lc, NULL), 30);
+	filter.start_date = now;
+	filter.end_date = 0;
+	filter.peer = bob;
+	CU_ASSERT_EQUAL(linphone_core_get_call_history_size(lc, &filter), 1);
+
+	linphone_core_clear_call_logs(lc);
+	CU_ASSERT_EQUAL(linphone_core_get_call_history_size(lc, NULL), 0);
+	CU_ASSERT_PTR_NULL(linphone_core_get_call_logs(lc));
+
+	linphone_address_destroy(bob);
+	linphone_core_manager_destroy(marie);
+	remove(tmp_db);
+}
+#endif
+
 test_t call_tests[] = {
 	{ "Early declined call", early_declined_call },
 	{ "Call declined", call_declined },
 	{ "Cancelled call", cancelled_call },
 	{ "Early cancelled call", early_cancelled_call},
 	{ "Call with DNS timeout", call_with_dns_time_out },
+	{ "Media port allocation", media_port_allocation },
+	{ "Call stats notification interval", call_stats_notification_interval },
 	{ "Cancelled ringing call", cancelled_ringing_call },
 	{ "Call failed because of codecs", call_failed_because_of_codecs },
 	{ "Simple call", simple_call },
@@ -3298,7 +3499,10 @@ test_t call_tests[] = {
 	{ "Call with in-dialog codec change", call_with_in_dialog_codec_change },
 	{ "Call with in-dialog codec change no sdp", call_with_in_dialog_codec_change_no_sdp },
 	{ "Call with custom supported tags", call_with_custom_supported_tags },
-	{ "Call log from taken from asserted id",call_log_from_taken_from_p_asserted_id}
+	{ "Call log from taken from asserted id",call_log_from_taken_from_p_asserted_id},
+#ifdef MSG_STORAGE_ENABLED
+	{ "Call logs storage", call_logs_storage },
+#endif
 };
 
 test_suite_t call_test_suite = {
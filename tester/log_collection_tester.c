@@ -131,10 +131,33 @@ static void collect_files_small_size()  {
 	linphone_core_manager_destroy(marie);
 }
 
+static void collect_files_flushed()  {
+	LinphoneCoreManager* marie = setup(TRUE);
+	char *filepath = ms_strdup_printf("%s/%s1.log", linphone_core_get_log_collection_path(), linphone_core_get_log_collection_prefix());
+	char line[512];
+	bool_t found = FALSE;
+	FILE *file;
+
+	ms_message("Log collection flush marker");
+	linphone_core_flush_log_collection();
+	file = fopen(filepath, "r");
+	CU_ASSERT_PTR_NOT_NULL(file);
+	if (file != NULL) {
+		while (fgets(line, sizeof(line), file) != NULL) {
+			if (strstr(line, "MESSAGE Log collection flush marker") != NULL) found = TRUE;
+		}
+		fclose(file);
+	}
+	CU_ASSERT_TRUE(found);
+	ms_free(filepath);
+	linphone_core_manager_destroy(marie);
+}
+
 test_t log_collection_tests[] = {
 	{ "No file when disabled", collect_files_disabled},
 	{ "Collect files filled when enabled", collect_files_filled},
 	{ "Logs collected into small file", collect_files_small_size},
+	{ "Logs written to file on flush", collect_files_flushed},
 };
 
 test_suite_t log_collection_test_suite = {
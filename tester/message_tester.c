@@ -903,6 +903,60 @@ static void is_composing_notification(void) {
 	linphone_core_manager_destroy(pauline);
 }
 
+static void chat_room_dispatch_performance(void) {
+	LinphoneCoreManager* marie = linphone_core_manager_new2("empty_rc", FALSE);
+	const int nb_rooms=10000;
+	LinphoneChatRoom **rooms=ms_new0(LinphoneChatRoom*,nb_rooms);
+	LinphoneAddress **peers=ms_new0(LinphoneAddress*,nb_rooms);
+	char uri[64];
+	uint64_t begin,elapsed;
+	int i;
+	bool_t all_found=TRUE;
+
+	for (i=0;i<nb_rooms;i++){
+		snprintf(uri,sizeof(uri),"sip:peer%i@sip.example.org",i);
+		rooms[i]=linphone_core_get_chat_room_from_uri(marie->lc,uri);
+		peers[i]=linphone_address_new(uri);
+	}
+	CU_ASSERT_EQUAL(ms_list_size(linphone_core_get_chat_rooms(marie->lc)),nb_rooms);
+
+	begin=ortp_get_cur_time_ms();
+	for (i=0;i<nb_rooms;i++){
+		if (linphone_core_get_chat_room(marie->lc,peers[(i*7919)%nb_rooms])!=rooms[(i*7919)%nb_rooms]) all_found=FALSE;
+	}
+	elapsed=ortp_get_cur_time_ms()-begin;
+	CU_ASSERT_TRUE(all_found);
+	ms_message("%i chat rooms looked up among %i in %i ms",nb_rooms,nb_rooms,(int)elapsed);
+
+	/*incoming messages go through the same lookup*/
+	begin=ortp_get_cur_time_ms();
+	for (i=0;i<nb_rooms;i++){
+		SalOp *op=sal_op_new(marie->lc->sal);
+		SalMessage msg={0};
+		snprintf(uri,sizeof(uri),"\"Peer\" <sip:peer%i@sip.example.org>",(i*7919)%nb_rooms);
+		msg.from=uri;
+		msg.text="hello";
+		msg.time=time(NULL);
+		linphone_core_message_received(marie->lc,op,&msg);
+		sal_op_release(op);
+	}
+	elapsed=ortp_get_cur_time_ms()-begin;
+	ms_message("%i messages dispatched to %i chat rooms in %i ms",nb_rooms,nb_rooms,(int)elapsed);
+	CU_ASSERT_EQUAL(marie->stat.number_of_LinphoneMessageReceived,nb_rooms);
+	CU_ASSERT_EQUAL(ms_list_size(linphone_core_get_chat_rooms(marie->lc)),nb_rooms);
+
+	/*a destroyed chat room is no longer found, a new one is created instead*/
+	linphone_chat_room_unref(rooms[42]);
+	CU_ASSERT_EQUAL(ms_list_size(linphone_core_get_chat_rooms(marie->lc)),nb_rooms-1);
+	CU_ASSERT_PTR_NOT_NULL(linphone_core_get_chat_room(marie->lc,peers[42]));
+	CU_ASSERT_EQUAL(ms_list_size(linphone_core_get_chat_rooms(marie->lc)),nb_rooms);
+
+	for (i=0;i<nb_rooms;i++) linphone_address_unref(peers[i]);
+	ms_free(peers);
+	ms_free(rooms);
+	linphone_core_manager_destroy(marie);
+}
+
 #ifdef MSG_STORAGE_ENABLED
 
 /*
@@ -1020,12 +1074,256 @@ static void history_messages_count() {
 
 		/*test invalid start*/
 		CU_ASSERT_EQUAL(ms_list_size(linphone_chat_room_get_history_range(chatroom, 1265, 1260)), 1270-1265);
+
+		/*test cursor based pagination: the page before the 42th latest message starts with the 43th*/
+		messages=linphone_chat_room_get_history_range(chatroom, 0, 41);
+		CU_ASSERT_EQUAL(ms_list_size(messages), 42);
+		messages=linphone_chat_room_get_history_before(chatroom, linphone_chat_message_get_storage_id((LinphoneChatMessage *)messages->data), 1);
+		CU_ASSERT_EQUAL(ms_list_size(messages), 1);
+		CU_ASSERT_STRING_EQUAL(linphone_chat_message_get_text((LinphoneChatMessage *)messages->data), linphone_chat_message_get_text((LinphoneChatMessage *)linphone_chat_room_get_history_range(chatroom, 42, 42)->data));
+
+		/*browse the whole history page by page*/
+		{
+			int total=0;
+			unsigned int cursor=0;
+			while ((messages=linphone_chat_room_get_history_before(chatroom, cursor, 100))!=NULL){
+				total+=ms_list_size(messages);
+				cursor=linphone_chat_message_get_storage_id((LinphoneChatMessage *)messages->data);
+			}
+			CU_ASSERT_EQUAL(total, 1270);
+		}
 	}
 	linphone_core_manager_destroy(marie);
 	linphone_address_destroy(jehan_addr);
 	remove(tmp_db);
 }
 
+static int history_messages_fill(sqlite3 *db, int total, int peers){
+	sqlite3_stmt *insert;
+	char peer[64];
+	int i;
+
+	if (sqlite3_prepare_v2(db,"INSERT INTO history(localContact,remoteContact,direction,message,time,read,status,utc) VALUES(?,?,?,?,'-1',?,?,?);",-1,&insert,NULL)!=SQLITE_OK){
+		return -1;
+	}
+	sqlite3_exec(db,"BEGIN TRANSACTION;",NULL,NULL,NULL);
+	for(i=0;i<total;i++){
+		snprintf(peer,sizeof(peer),"sip:peer%i@sip.example.org",i%peers);
+		sqlite3_bind_text(insert,1,"sip:marie@sip.example.org",-1,SQLITE_STATIC);
+		sqlite3_bind_text(insert,2,peer,-1,SQLITE_TRANSIENT);
+		sqlite3_bind_int(insert,3,LinphoneChatMessageIncoming);
+		sqlite3_bind_text(insert,4,"The Tao that can be told is not the eternal Tao.",-1,SQLITE_STATIC);
+		/*one message out of ten of each peer is unread*/
+		sqlite3_bind_int(insert,5,((i/peers)%10)==0 ? 0 : 1);
+		sqlite3_bind_int(insert,6,LinphoneChatMessageStateDelivered);
+		sqlite3_bind_int64(insert,7,(sqlite3_int64)i);
+		sqlite3_step(insert);
+		sqlite3_reset(insert);
+	}
+	sqlite3_exec(db,"COMMIT;",NULL,NULL,NULL);
+	sqlite3_finalize(insert);
+	return 0;
+}
+
+static bool_t history_index_exists(sqlite3 *db, const char *name){
+	sqlite3_stmt *stmt;
+	bool_t exists;
+
+	if (sqlite3_prepare_v2(db,"SELECT name FROM sqlite_master WHERE type='index' AND tbl_name='history' AND name=?;",-1,&stmt,NULL)!=SQLITE_OK){
+		return FALSE;
+	}
+	sqlite3_bind_text(stmt,1,name,-1,SQLITE_STATIC);
+	exists=(sqlite3_step(stmt)==SQLITE_ROW);
+	sqlite3_finalize(stmt);
+	return exists;
+}
+
+static void history_messages_performance() {
+	LinphoneCoreManager *marie = linphone_core_manager_new("marie_rc");
+	LinphoneChatRoom *chatroom;
+	MSList *messages;
+	char tmp_db[256];
+	uint64_t begin,elapsed;
+	const int total=1000000;
+	const int peers=100;
+	const int per_peer=total/peers;
+	snprintf(tmp_db,sizeof(tmp_db), "%s/tmp_perf.db", liblinphone_tester_writable_dir_prefix);
+	remove(tmp_db);
+
+	linphone_core_set_chat_database_path(marie->lc, tmp_db);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(marie->lc->db);
+	CU_ASSERT_EQUAL_FATAL(history_messages_fill(marie->lc->db, total, peers), 0);
+	/*the timings below rely on the indexes created with the schema*/
+	CU_ASSERT_TRUE(history_index_exists(marie->lc->db, "history_remote_id"));
+	CU_ASSERT_TRUE(history_index_exists(marie->lc->db, "history_remote_read"));
+
+	chatroom = linphone_core_get_or_create_chat_room(marie->lc, "sip:peer42@sip.example.org");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(chatroom);
+
+	begin=ortp_get_cur_time_ms();
+	CU_ASSERT_EQUAL(linphone_chat_room_get_history_size(chatroom), per_peer);
+	elapsed=ortp_get_cur_time_ms()-begin;
+	ms_message("History size of %i messages out of %i computed in %i ms",per_peer,total,(int)elapsed);
+
+	begin=ortp_get_cur_time_ms();
+	CU_ASSERT_EQUAL(linphone_chat_room_get_unread_messages_count(chatroom), per_peer/10);
+	elapsed=ortp_get_cur_time_ms()-begin;
+	ms_message("Unread count computed in %i ms",(int)elapsed);
+
+	/*first and deep pages*/
+	begin=ortp_get_cur_time_ms();
+	messages=linphone_chat_room_get_history_range(chatroom, 0, 19);
+	elapsed=ortp_get_cur_time_ms()-begin;
+	CU_ASSERT_EQUAL(ms_list_size(messages), 20);
+	ms_list_free_with_data(messages, (void (*)(void *))linphone_chat_message_unref);
+	ms_message("First history page retrieved in %i ms",(int)elapsed);
+
+	begin=ortp_get_cur_time_ms();
+	messages=linphone_chat_room_get_history_range(chatroom, per_peer-20, per_peer-1);
+	elapsed=ortp_get_cur_time_ms()-begin;
+	CU_ASSERT_EQUAL(ms_list_size(messages), 20);
+	ms_list_free_with_data(messages, (void (*)(void *))linphone_chat_message_unref);
+	ms_message("Last history page retrieved in %i ms",(int)elapsed);
+
+	begin=ortp_get_cur_time_ms();
+	messages=linphone_chat_room_get_history_before(chatroom, 20*peers, 20);
+	elapsed=ortp_get_cur_time_ms()-begin;
+	CU_ASSERT_EQUAL(ms_list_size(messages), 20);
+	ms_list_free_with_data(messages, (void (*)(void *))linphone_chat_message_unref);
+	ms_message("Oldest history page retrieved by storage id in %i ms",(int)elapsed);
+
+	linphone_core_manager_destroy(marie);
+	remove(tmp_db);
+}
+
+static int history_messages_count_on_disk(const char *db_file){
+	sqlite3 *db;
+	sqlite3_stmt *stmt;
+	int count=-1;
+	if (sqlite3_open(db_file,&db)!=SQLITE_OK) return -1;
+	if (sqlite3_prepare_v2(db,"SELECT count(*) FROM history;",-1,&stmt,NULL)==SQLITE_OK){
+		if (sqlite3_step(stmt)==SQLITE_ROW) count=sqlite3_column_int(stmt,0);
+	}
+	sqlite3_finalize(stmt);
+	sqlite3_close(db);
+	return count;
+}
+
+static void history_messages_write_behind() {
+	LinphoneCoreManager *marie = linphone_core_manager_new("marie_rc");
+	LinphoneChatRoom *chatroom;
+	LinphoneChatMessage *msg;
+	MSList *messages;
+	char tmp_db[256];
+	int i;
+	snprintf(tmp_db,sizeof(tmp_db), "%s/tmp_write_behind.db", liblinphone_tester_writable_dir_prefix);
+	remove(tmp_db);
+
+	linphone_core_set_chat_database_path(marie->lc, tmp_db);
+	linphone_core_enable_chat_database_write_behind(marie->lc, TRUE);
+	CU_ASSERT_TRUE(linphone_core_chat_database_write_behind_enabled(marie->lc));
+	chatroom = linphone_core_get_or_create_chat_room(marie->lc, "sip:pauline@sip.example.org");
+
+	for(i=0;i<10;i++){
+		msg=linphone_chat_room_create_message_2(chatroom, "Write me behind", NULL, LinphoneChatMessageStateIdle, time(NULL), FALSE, TRUE);
+		msg->storage_id=linphone_chat_message_store(msg);
+		msg->state=LinphoneChatMessageStateInProgress;
+		linphone_chat_message_store_state(msg);
+		linphone_chat_message_unref(msg);
+	}
+
+	/*history getters see the pending messages, other readers do not*/
+	CU_ASSERT_EQUAL(linphone_chat_room_get_history_size(chatroom), 10);
+	CU_ASSERT_EQUAL(linphone_chat_room_get_unread_messages_count(chatroom), 10);
+	messages=linphone_chat_room_get_history(chatroom, 0);
+	CU_ASSERT_EQUAL(ms_list_size(messages), 10);
+	CU_ASSERT_EQUAL(linphone_chat_message_get_state((LinphoneChatMessage *)messages->data), LinphoneChatMessageStateInProgress);
+	ms_list_free_with_data(messages, (void (*)(void *))linphone_chat_message_unref);
+	CU_ASSERT_EQUAL(history_messages_count_on_disk(tmp_db), 0);
+
+	/*next iteration writes them*/
+	linphone_core_iterate(marie->lc);
+	CU_ASSERT_EQUAL(history_messages_count_on_disk(tmp_db), 10);
+
+	msg=linphone_chat_room_create_message_2(chatroom, "Flushed on close", NULL, LinphoneChatMessageStateDelivered, time(NULL), TRUE, FALSE);
+	msg->storage_id=linphone_chat_message_store(msg);
+	linphone_chat_message_unref(msg);
+	CU_ASSERT_EQUAL(history_messages_count_on_disk(tmp_db), 10);
+
+	linphone_core_manager_destroy(marie);
+	CU_ASSERT_EQUAL(history_messages_count_on_disk(tmp_db), 11);
+	remove(tmp_db);
+}
+
+static void lazy_chat_rooms() {
+	LinphoneCoreManager *marie = linphone_core_manager_new2("empty_rc", FALSE);
+	LinphoneChatRoom *chatroom;
+	MSList *rooms;
+	char tmp_db[256];
+	char *buf;
+	uint64_t begin,elapsed;
+	const int peers=2000;
+	snprintf(tmp_db,sizeof(tmp_db), "%s/tmp_lazy.db", liblinphone_tester_writable_dir_prefix);
+	remove(tmp_db);
+
+	linphone_core_set_chat_database_path(marie->lc, tmp_db);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(marie->lc->db);
+	CU_ASSERT_EQUAL_FATAL(history_messages_fill(marie->lc->db, peers*10, peers), 0);
+	/*the same peer as peer1999 up to its parameters: both belong to one conversation*/
+	buf=sqlite3_mprintf("INSERT INTO history(localContact,remoteContact,direction,message,time,read,status,utc) "
+		"VALUES('sip:marie@sip.example.org','sip:peer1999@sip.example.org;transport=tcp',%i,'hello','-1',0,%i,%i);",
+		LinphoneChatMessageIncoming,LinphoneChatMessageStateDelivered,peers*10);
+	CU_ASSERT_EQUAL(sqlite3_exec(marie->lc->db,buf,NULL,NULL,NULL),SQLITE_OK);
+	sqlite3_free(buf);
+
+	linphone_core_enable_lazy_chat_rooms(marie->lc, TRUE);
+	CU_ASSERT_TRUE(linphone_core_lazy_chat_rooms_enabled(marie->lc));
+	begin=ortp_get_cur_time_ms();
+	linphone_core_set_chat_database_path(marie->lc, tmp_db);
+	elapsed=ortp_get_cur_time_ms()-begin;
+	ms_message("Chat database with %i conversations opened in %i ms",peers,(int)elapsed);
+	CU_ASSERT_EQUAL(ms_list_size(marie->lc->chatrooms), 0);
+	CU_ASSERT_EQUAL(linphone_core_get_chat_rooms_count(marie->lc), peers);
+
+	/*most recent conversations first, only the requested ones are created*/
+	rooms=linphone_core_get_chat_rooms_page(marie->lc, 0, 20);
+	CU_ASSERT_EQUAL(ms_list_size(rooms), 20);
+	CU_ASSERT_STRING_EQUAL(linphone_address_get_username(linphone_chat_room_get_peer_address((LinphoneChatRoom*)rooms->data)), "peer1999");
+	CU_ASSERT_PTR_EQUAL(linphone_core_get_or_create_chat_room(marie->lc, "\"Peer\" <sip:peer1999@sip.example.org;transport=tcp>"), rooms->data);
+	/*as in eager mode, the conversation is the one of sip:peer1999@sip.example.org, and counts its own messages only*/
+	chatroom = (LinphoneChatRoom*)rooms->data;
+	CU_ASSERT_STRING_EQUAL(chatroom->peer, "sip:peer1999@sip.example.org");
+	CU_ASSERT_EQUAL(linphone_chat_room_get_unread_messages_count(chatroom), 1);
+	chatroom->unread_count = -1;
+	CU_ASSERT_EQUAL(linphone_chat_room_get_unread_messages_count(chatroom), 1);
+	linphone_chat_room_mark_as_read(chatroom);
+	chatroom->unread_count = -1;
+	CU_ASSERT_EQUAL(linphone_chat_room_get_unread_messages_count(chatroom), 0);
+	ms_list_free(rooms);
+	CU_ASSERT_EQUAL(ms_list_size(marie->lc->chatrooms), 20);
+
+	rooms=linphone_core_get_chat_rooms_page(marie->lc, 20, 20);
+	CU_ASSERT_EQUAL(ms_list_size(rooms), 20);
+	CU_ASSERT_STRING_EQUAL(linphone_address_get_username(linphone_chat_room_get_peer_address((LinphoneChatRoom*)rooms->data)), "peer1979");
+	ms_list_free(rooms);
+	CU_ASSERT_EQUAL(ms_list_size(marie->lc->chatrooms), 40);
+
+	/*looking a chat room up creates it from the history*/
+	chatroom = linphone_core_get_or_create_chat_room(marie->lc, "sip:peer5@sip.example.org");
+	CU_ASSERT_EQUAL(ms_list_size(marie->lc->chatrooms), 41);
+	CU_ASSERT_EQUAL(linphone_core_get_chat_rooms_count(marie->lc), peers);
+	CU_ASSERT_EQUAL(linphone_chat_room_get_history_size(chatroom), 10);
+	CU_ASSERT_EQUAL(linphone_chat_room_get_unread_messages_count(chatroom), 1);
+	linphone_chat_room_mark_as_read(chatroom);
+	CU_ASSERT_EQUAL(linphone_chat_room_get_unread_messages_count(chatroom), 0);
+	CU_ASSERT_PTR_EQUAL(linphone_core_get_or_create_chat_room(marie->lc, "sip:peer5@sip.example.org"), chatroom);
+
+	CU_ASSERT_EQUAL(ms_list_size(linphone_core_get_chat_rooms(marie->lc)), peers);
+	CU_ASSERT_EQUAL(linphone_core_get_chat_rooms_count(marie->lc), peers);
+
+	linphone_core_manager_destroy(marie);
+	remove(tmp_db);
+}
 
 #endif
 
@@ -1047,10 +1345,14 @@ test_t message_tests[] = {
 	{ "Text message denied", text_message_denied },
 	{ "Info message", info_message },
 	{ "Info message with body", info_message_with_body },
-	{ "IsComposing notification", is_composing_notification }
+	{ "IsComposing notification", is_composing_notification },
+	{ "Chat room dispatch performance", chat_room_dispatch_performance }
 #ifdef MSG_STORAGE_ENABLED
 	,{ "Database migration", message_storage_migration }
 	,{ "History count", history_messages_count }
+	,{ "History performance", history_messages_performance }
+	,{ "History write-behind", history_messages_write_behind }
+	,{ "Lazy chat rooms", lazy_chat_rooms }
 #endif
 };
 
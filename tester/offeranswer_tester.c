@@ -0,0 +1,380 @@
+/*
+    liblinphone_tester - liblinphone test suite
+    Copyright (C) 2015  Belledonne Communications SARL
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+#include "linphonecore.h"
+#include "private.h"
+#include "offeranswer.h"
+#include "bellesip_sal/sal_impl.h"
+#include "liblinphone_tester.h"
+
+/*
+ * Payload lists are written as comma separated "mime/rate[/channels]:number[|fmtp]" entries.
+ * Payload types of a result that can only be received are followed by "(recv)".
+ */
+typedef struct _OfferAnswerVector {
+	const char *name;
+	const char *local;
+	const char *remote;
+	bool_t incoming;
+	bool_t one_matching_codec;
+	const char *expected;
+} OfferAnswerVector;
+
+static const OfferAnswerVector offer_answer_vectors[] = {
+	{ "Remote order and numbering", "PCMU/8000:0,PCMA/8000:8,telephone-event/8000:101", "PCMA/8000:8,PCMU/8000:0,telephone-event/8000:100",
+		TRUE, FALSE, "PCMA/8000:8,PCMU/8000:0,telephone-event/8000:100" },
+	{ "Case insensitive mime types", "speex/16000:97", "SPEEX/16000:98", TRUE, FALSE, "speex/16000:98" },
+	{ "Clock rate mismatch", "speex/16000:97,PCMU/8000:0", "speex/8000:97,PCMU/8000:0", TRUE, FALSE, "PCMU/8000:0" },
+	{ "Channels mismatch", "L16/44100/2:10", "L16/44100/1:11", TRUE, FALSE, "" },
+	{ "No common codec", "PCMU/8000:0", "GSM/8000:3", TRUE, FALSE, "" },
+	{ "G729A offered to G729", "PCMU/8000:0,G729/8000:18", "G729A/8000:18", TRUE, FALSE, "G729/8000:18" },
+	{ "G729 not offered to G729A", "G729A/8000:18", "G729/8000:18", TRUE, FALSE, "" },
+	{ "Mono opus offer", "speex/16000:97,opus/48000/2:120", "opus/48000/1:111", TRUE, FALSE, "opus/48000/1:111" },
+	{ "H264 packetization mode", "H264/90000:96|packetization-mode=0,H264/90000:97|packetization-mode=1", "H264/90000:99|packetization-mode=1",
+		TRUE, FALSE, "H264/90000:99|packetization-mode=1" },
+	{ "H264 default packetization mode", "H264/90000:96|packetization-mode=1,H264/90000:97|profile-level-id=42801F", "H264/90000:99|profile-level-id=428014",
+		TRUE, FALSE, "H264/90000:99|profile-level-id=42801F" },
+	{ "H264 without fmtp", "H264/90000:96|packetization-mode=0,H264/90000:97|packetization-mode=1", "H264/90000:99",
+		TRUE, FALSE, "H264/90000:99|packetization-mode=1" },
+	{ "One matching codec", "PCMU/8000:0,PCMA/8000:8,telephone-event/8000:101", "PCMA/8000:8,PCMU/8000:0,telephone-event/8000:101",
+		TRUE, TRUE, "PCMA/8000:8,telephone-event/8000:101" },
+	{ "Answer to our offer", "PCMU/8000:0,PCMA/8000:8,telephone-event/8000:101", "PCMA/8000:8",
+		FALSE, FALSE, "PCMA/8000:8,PCMU/8000:0(recv),telephone-event/8000:101(recv)" },
+	{ "Answer with other numbering", "PCMU/8000:0,telephone-event/8000:101", "PCMU/8000:0,telephone-event/8000:100",
+		FALSE, FALSE, "PCMU/8000:0,telephone-event/8000:100,telephone-event/8000:101" },
+	{ "Video answer", "VP8/90000:103,H264/90000:102|packetization-mode=1", "H264/90000:98|packetization-mode=1,VP8/90000:99",
+		FALSE, FALSE, "H264/90000:98|packetization-mode=1,H264/90000:102|packetization-mode=1,VP8/90000:99,VP8/90000:103" }
+};
+
+static MSList *parse_payload_list(const char *spec) {
+	MSList *list = NULL;
+	const char *entry = spec;
+
+	while (entry && *entry != '\0') {
+		char buffer[128];
+		char mime_type[64];
+		const char *end = strchr(entry, ',');
+		size_t len = end ? (size_t)(end - entry) : strlen(entry);
+		char *fmtp;
+		int clock_rate = 0, channels = 0, number = 0;
+		PayloadType *pt;
+
+		snprintf(buffer, sizeof(buffer), "%.*s", (int)len, entry);
+		fmtp = strchr(buffer, '|');
+		if (fmtp) *fmtp++ = '\0';
+		if (sscanf(buffer, "%63[^/]/%i/%i:%i", mime_type, &clock_rate, &channels, &number) != 4) {
+			channels = 0;
+			CU_ASSERT_EQUAL(sscanf(buffer, "%63[^/]/%i:%i", mime_type, &clock_rate, &number), 3);
+		}
+		pt = payload_type_new();
+		pt->type = (clock_rate == 90000) ? PAYLOAD_VIDEO : PAYLOAD_AUDIO_CONTINUOUS;
+		pt->mime_type = ms_strdup(mime_type);
+		pt->clock_rate = clock_rate;
+		pt->channels = channels;
+		if (fmtp) payload_type_set_recv_fmtp(pt, fmtp);
+		payload_type_set_number(pt, number);
+		list = ms_list_append(list, pt);
+		entry = end ? end + 1 : NULL;
+	}
+	return list;
+}
+
+static void payload_list_to_string(const MSList *list, char *buffer, size_t size) {
+	size_t offset = 0;
+	buffer[0] = '\0';
+	for (; list != NULL && offset < size; list = list->next) {
+		const PayloadType *pt = (const PayloadType *)list->data;
+		offset += snprintf(buffer + offset, size - offset, "%s%s/%i", (offset > 0) ? "," : "", pt->mime_type, pt->clock_rate);
+		if (offset < size && pt->channels > 0) offset += snprintf(buffer + offset, size - offset, "/%i", pt->channels);
+		if (offset < size) offset += snprintf(buffer + offset, size - offset, ":%i", payload_type_get_number(pt));
+		if (offset < size && pt->recv_fmtp) offset += snprintf(buffer + offset, size - offset, "|%s", pt->recv_fmtp);
+		if (offset < size && !(pt->flags & PAYLOAD_TYPE_FLAG_CAN_SEND)) offset += snprintf(buffer + offset, size - offset, "(recv)");
+	}
+}
+
+static SalMediaDescription *create_media_description(const char *payloads) {
+	SalMediaDescription *md = sal_media_description_new();
+	SalStreamDescription *sd = &md->streams[0];
+
+	md->nb_streams = 1;
+	strcpy(md->addr, "127.0.0.1");
+	strcpy(sd->name, "Audio");
+	strcpy(sd->rtp_addr, "127.0.0.1");
+	strcpy(sd->rtcp_addr, "127.0.0.1");
+	sd->proto = SalProtoRtpAvp;
+	sd->type = SalAudio;
+	sd->dir = SalStreamSendRecv;
+	sd->rtp_port = 7078;
+	sd->rtcp_port = 7079;
+	sd->payloads = parse_payload_list(payloads);
+	return md;
+}
+
+/*an audio and a video stream, each with the given number of ICE candidates, as offered in a call*/
+static SalMediaDescription *create_ice_media_description(const char *addr, int nb_candidates) {
+	SalMediaDescription *md = sal_media_description_new();
+	int i, j;
+
+	strncpy(md->addr, addr, sizeof(md->addr) - 1);
+	sal_shared_string_set(&md->ice_ufrag, "8hhY");
+	sal_shared_string_set(&md->ice_pwd, "asd88fgpdd777uzjYhagZg");
+	md->nb_streams = 2;
+	for (i = 0; i < md->nb_streams; i++) {
+		SalStreamDescription *sd = &md->streams[i];
+		sd->proto = SalProtoRtpAvp;
+		sd->type = (i == 0) ? SalAudio : SalVideo;
+		sd->dir = SalStreamSendRecv;
+		strncpy(sd->name, (i == 0) ? "Audio" : "Video", sizeof(sd->name) - 1);
+		strncpy(sd->rtp_addr, addr, sizeof(sd->rtp_addr) - 1);
+		strncpy(sd->rtcp_addr, addr, sizeof(sd->rtcp_addr) - 1);
+		sd->rtp_port = 7078 + 2 * i;
+		sd->rtcp_port = sd->rtp_port + 1;
+		sd->payloads = parse_payload_list((i == 0) ? "PCMU/8000:0" : "H263/90000:34");
+		for (j = 0; j < nb_candidates; j++) {
+			SalIceCandidate *candidate = sal_stream_description_add_ice_candidate(sd);
+			snprintf(candidate->foundation, sizeof(candidate->foundation), "%i", j / 2 + 1);
+			strcpy(candidate->type, "host");
+			strncpy(candidate->addr, addr, sizeof(candidate->addr) - 1);
+			candidate->componentID = 1 + (j % 2);
+			candidate->priority = 2130706431 - j;
+			candidate->port = sd->rtp_port + (j % 2);
+		}
+	}
+	return md;
+}
+
+static void offer_answer_vectors_test(void) {
+	size_t i;
+
+	for (i = 0; i < sizeof(offer_answer_vectors) / sizeof(offer_answer_vectors[0]); i++) {
+		const OfferAnswerVector *vector = &offer_answer_vectors[i];
+		SalMediaDescription *local = create_media_description(vector->local);
+		SalMediaDescription *remote = create_media_description(vector->remote);
+		SalMediaDescription *result = sal_media_description_new();
+		char payloads[512];
+
+		if (vector->incoming) offer_answer_initiate_incoming(local, remote, result, vector->one_matching_codec);
+		else offer_answer_initiate_outgoing(local, remote, result);
+		payload_list_to_string(result->streams[0].payloads, payloads, sizeof(payloads));
+		if (strcmp(payloads, vector->expected) != 0)
+			ms_error("Offer answer vector [%s]: got [%s] instead of [%s]", vector->name, payloads, vector->expected);
+		CU_ASSERT_STRING_EQUAL(payloads, vector->expected);
+		/*a stream without any common codec is declined*/
+		CU_ASSERT_EQUAL(result->streams[0].rtp_port == 0, vector->expected[0] == '\0');
+
+		sal_media_description_unref(local);
+		sal_media_description_unref(remote);
+		sal_media_description_unref(result);
+	}
+}
+
+static void offer_answer_performance_test(void) {
+	const char *local_payloads = "opus/48000/2:120,speex/32000:98,speex/16000:97,speex/8000:96,PCMU/8000:0,PCMA/8000:8,G722/8000:9,GSM/8000:3,"
+		"iLBC/8000:111,AMR/8000:112,G729/8000:18,telephone-event/48000:101,telephone-event/16000:100,telephone-event/8000:110";
+	const char *remote_payloads = "telephone-event/8000:101,G729A/8000:18,AMR-WB/16000:113,iLBC/8000:102,GSM/8000:3,G722/8000:9,PCMA/8000:8,"
+		"PCMU/8000:0,speex/8000:97,speex/16000:98,speex/32000:99,opus/48000/2:96,SILK/24000:117,SILK/16000:118";
+	const int nb_negotiations = 5000;
+	SalMediaDescription *local = create_media_description(local_payloads);
+	SalMediaDescription *remote = create_media_description(remote_payloads);
+	void *payload_index = NULL;
+	uint64_t begin, elapsed;
+	int nb_matched = 0;
+	int i;
+
+	begin = ortp_get_cur_time_ms();
+	for (i = 0; i < nb_negotiations; i++) {
+		SalMediaDescription *result = sal_media_description_new();
+		offer_answer_initiate_incoming(local, remote, result, FALSE);
+		nb_matched += ms_list_size(result->streams[0].payloads);
+		sal_media_description_unref(result);
+		if (i == 0) payload_index = local->payload_indexes[0];
+	}
+	elapsed = ortp_get_cur_time_ms() - begin;
+	ms_message("%i offer/answer negotiations of %i codecs against %i codecs in %i ms", nb_negotiations,
+		ms_list_size(remote->streams[0].payloads), ms_list_size(local->streams[0].payloads), (int)elapsed);
+	CU_ASSERT_EQUAL(nb_matched, 11 * nb_negotiations);
+	/*the local payload types are indexed at the first negotiation only*/
+	CU_ASSERT_PTR_NOT_NULL(payload_index);
+	CU_ASSERT_PTR_EQUAL(local->payload_indexes[0], payload_index);
+	CU_ASSERT_PTR_NULL(remote->payload_indexes[0]);
+
+	sal_media_description_unref(local);
+	sal_media_description_unref(remote);
+}
+
+static void media_description_footprint_test(void) {
+	const int nb_calls = 200, nb_candidates = 4;
+	SalMediaDescription **descs = ms_new0(SalMediaDescription *, 3 * nb_calls);
+	size_t total = 0;
+	uint64_t begin, elapsed;
+	int i;
+
+	begin = ortp_get_cur_time_ms();
+	for (i = 0; i < nb_calls; i++) {
+		SalMediaDescription *local = create_ice_media_description("192.168.0.10", nb_candidates);
+		SalMediaDescription *remote = create_ice_media_description("192.168.0.20", nb_candidates);
+		SalMediaDescription *result = sal_media_description_new();
+		offer_answer_initiate_incoming(local, remote, result, FALSE);
+		descs[3 * i] = local;
+		descs[3 * i + 1] = remote;
+		descs[3 * i + 2] = result;
+		total += sal_media_description_get_memory_size(local) + sal_media_description_get_memory_size(remote)
+			+ sal_media_description_get_memory_size(result);
+	}
+	elapsed = ortp_get_cur_time_ms() - begin;
+	ms_message("%i calls with %i ICE candidates per stream use %u bytes of media descriptions per call, built in %i ms",
+		nb_calls, nb_candidates, (unsigned int)(total / nb_calls), (int)elapsed);
+	/*the fixed size layout used more than 80kB per call*/
+	CU_ASSERT_TRUE(total / nb_calls < 40000);
+
+	/*the answer shares the ICE credentials of the local description and copies only the candidates in use*/
+	CU_ASSERT_EQUAL(descs[2]->nb_streams, 2);
+	CU_ASSERT_PTR_EQUAL(descs[2]->ice_ufrag, descs[0]->ice_ufrag);
+	CU_ASSERT_PTR_EQUAL(descs[2]->ice_pwd, descs[0]->ice_pwd);
+	CU_ASSERT_EQUAL(descs[2]->streams[0].nb_ice_candidates, nb_candidates);
+	CU_ASSERT_PTR_NOT_EQUAL(descs[2]->streams[0].ice_candidates, descs[0]->streams[0].ice_candidates);
+	CU_ASSERT_EQUAL(descs[2]->streams[1].ice_candidates[nb_candidates - 1].port, descs[0]->streams[1].rtcp_port);
+
+	for (i = 0; i < 3 * nb_calls; i++) sal_media_description_unref(descs[i]);
+	ms_free(descs);
+}
+
+static bool_t sdp_text_matches_full_encoding(const SalMediaDescription *md, const char *text) {
+	belle_sdp_session_description_t *sdp = media_description_to_sdp(md);
+	char *full = belle_sip_object_to_string(BELLE_SIP_OBJECT(sdp));
+	bool_t ret = (strcmp(full, text) == 0);
+	if (!ret) ms_error("Cached SDP encoding:\n%s\ndiffers from full encoding:\n%s", text, full);
+	belle_sip_free(full);
+	belle_sip_object_unref(sdp);
+	return ret;
+}
+
+static void sdp_encoding_cache_test(void) {
+	const int nb_iterations = 2000;
+	SalMediaDescription *md = create_ice_media_description("192.168.0.10", 4);
+	SalMediaDescription *parsed;
+	SalSdpCache *cache = sal_sdp_cache_new();
+	belle_sdp_session_description_t *sdp;
+	uint64_t begin, full_elapsed, cached_elapsed, parse_elapsed;
+	char *text;
+	size_t length;
+	int i;
+
+	md->session_id = 1234;
+	md->session_ver = 1;
+	strcpy(md->username, "marie");
+
+	CU_ASSERT_EQUAL(media_description_to_sdp_text(md, cache, &text, &length), 0);
+	CU_ASSERT_EQUAL(cache->nb_encoded, 3);
+	CU_ASSERT_EQUAL(length, strlen(text));
+	CU_ASSERT_TRUE(sdp_text_matches_full_encoding(md, text));
+	belle_sip_free(text);
+
+	/*nothing changed: everything comes from the cache*/
+	CU_ASSERT_EQUAL(media_description_to_sdp_text(md, cache, &text, &length), 0);
+	CU_ASSERT_EQUAL(cache->nb_encoded, 3);
+	CU_ASSERT_EQUAL(cache->nb_reused, 3);
+	belle_sip_free(text);
+
+	/*put the video on hold in a new version: only the session and the video stream are encoded again*/
+	md->session_ver++;
+	md->streams[1].dir = SalStreamSendOnly;
+	CU_ASSERT_EQUAL(media_description_to_sdp_text(md, cache, &text, &length), 0);
+	CU_ASSERT_EQUAL(cache->nb_encoded, 5);
+	CU_ASSERT_EQUAL(cache->nb_reused, 4);
+	CU_ASSERT_TRUE(sdp_text_matches_full_encoding(md, text));
+	belle_sip_free(text);
+
+	/*ICE completion changes the candidates of the audio stream only*/
+	md->session_ver++;
+	md->streams[0].ice_completed = TRUE;
+	md->streams[0].ice_candidates[0].port = 9078;
+	CU_ASSERT_EQUAL(media_description_to_sdp_text(md, cache, &text, &length), 0);
+	CU_ASSERT_EQUAL(cache->nb_encoded, 7);
+	CU_ASSERT_EQUAL(cache->nb_reused, 5);
+	CU_ASSERT_TRUE(sdp_text_matches_full_encoding(md, text));
+
+	/*the cached text parses back to the same description*/
+	sdp = belle_sdp_session_description_parse(text);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(sdp);
+	parsed = sal_media_description_new();
+	sdp_to_media_description(sdp, parsed);
+	CU_ASSERT_EQUAL(parsed->nb_streams, 2);
+	CU_ASSERT_EQUAL(parsed->streams[1].dir, SalStreamSendOnly);
+	CU_ASSERT_EQUAL(parsed->streams[0].nb_ice_candidates, 4);
+	CU_ASSERT_EQUAL(parsed->streams[0].ice_candidates[0].port, 9078);
+	CU_ASSERT_STRING_EQUAL(parsed->ice_ufrag, md->ice_ufrag);
+	CU_ASSERT_EQUAL(parsed->streams[1].rtp_port, md->streams[1].rtp_port);
+	sal_media_description_unref(parsed);
+	belle_sip_object_unref(sdp);
+	belle_sip_free(text);
+
+	/*microbenchmark: a re-INVITE per iteration, changing only the session version*/
+	begin = ortp_get_cur_time_ms();
+	for (i = 0; i < nb_iterations; i++) {
+		md->session_ver++;
+		sdp = media_description_to_sdp(md);
+		text = belle_sip_object_to_string(BELLE_SIP_OBJECT(sdp));
+		belle_sip_object_unref(sdp);
+		belle_sip_free(text);
+	}
+	full_elapsed = ortp_get_cur_time_ms() - begin;
+
+	begin = ortp_get_cur_time_ms();
+	for (i = 0; i < nb_iterations; i++) {
+		md->session_ver++;
+		media_description_to_sdp_text(md, cache, &text, &length);
+		if (i < nb_iterations - 1) belle_sip_free(text);
+	}
+	cached_elapsed = ortp_get_cur_time_ms() - begin;
+
+	begin = ortp_get_cur_time_ms();
+	for (i = 0; i < nb_iterations; i++) {
+		sdp = belle_sdp_session_description_parse(text);
+		parsed = sal_media_description_new();
+		sdp_to_media_description(sdp, parsed);
+		sal_media_description_unref(parsed);
+		belle_sip_object_unref(sdp);
+	}
+	parse_elapsed = ortp_get_cur_time_ms() - begin;
+	belle_sip_free(text);
+
+	ms_message("%i audio+video+ICE offers: full encoding in %i ms, cached encoding in %i ms, parsing in %i ms",
+		nb_iterations, (int)full_elapsed, (int)cached_elapsed, (int)parse_elapsed);
+
+	sal_sdp_cache_destroy(cache);
+	sal_media_description_unref(md);
+}
+
+test_t offeranswer_tests[] = {
+	{ "Offer answer vectors", offer_answer_vectors_test },
+	{ "Offer answer performance", offer_answer_performance_test },
+	{ "Media description footprint (internal api)", media_description_footprint_test },
+	{ "SDP encoding cache (internal api)", sdp_encoding_cache_test }
+};
+
+test_suite_t offeranswer_test_suite = {
+	"Offer answer",
+	NULL,
+	NULL,
+	sizeof(offeranswer_tests) / sizeof(offeranswer_tests[0]),
+	offeranswer_tests
+};
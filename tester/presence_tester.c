@@ -20,6 +20,7 @@
 #include "CUnit/Basic.h"
 #include "linphonecore.h"
 #include "private.h"
+#include "bellesip_sal/sal_impl.h"
 #include "liblinphone_tester.h"
 
 static LinphoneCoreManager* presence_linphone_core_manager_new(char* username) {
@@ -226,6 +227,21 @@ static void simple_subscribe(void) {
 	linphone_core_manager_destroy(pauline);
 }
 
+static void subscribe_profiling_counters(void) {
+	LinphoneCoreManager* marie = presence_linphone_core_manager_new("marie");
+	LinphoneCoreManager* pauline = presence_linphone_core_manager_new("pauline");
+
+	CU_ASSERT_EQUAL(linphone_core_get_profiling_counter(marie->lc,LinphoneProfilingNotifiesParsed),0);
+	CU_ASSERT_TRUE(subscribe_to_callee_presence(marie,pauline));
+	CU_ASSERT_TRUE(linphone_core_get_profiling_counter(marie->lc,LinphoneProfilingNotifiesParsed)>=1);
+	CU_ASSERT_TRUE(linphone_core_get_profiling_counter(marie->lc,LinphoneProfilingSipRequestsSent)>=1);
+	CU_ASSERT_TRUE(linphone_core_get_profiling_counter(marie->lc,LinphoneProfilingSipResponsesReceived)>=1);
+	CU_ASSERT_TRUE(linphone_core_get_profiling_counter(pauline->lc,LinphoneProfilingSipRequestsReceived)>=1);
+
+	linphone_core_manager_destroy(marie);
+	linphone_core_manager_destroy(pauline);
+}
+
 static void unsubscribe_while_subscribing(void) {
 	LinphoneCoreManager* marie = linphone_core_manager_new( "marie_rc");
 	LinphoneFriend* friend = linphone_friend_new_with_address("sip:toto@git.linphone.org"); /*any unexisting address*/
@@ -237,6 +253,397 @@ static void unsubscribe_while_subscribing(void) {
 	linphone_core_manager_destroy(marie);
 }
 
+static void friend_lookups(void) {
+	LinphoneCoreManager* marie = linphone_core_manager_new2( "empty_rc", FALSE);
+	LinphoneFriend *lf;
+	LinphoneAddress *addr;
+	char uri[64];
+	char key[32];
+	int i;
+	int nb_friends=200;
+
+	for (i=0;i<nb_friends;i++){
+		snprintf(uri,sizeof(uri),"sip:friend%i@sip.example.org",i);
+		snprintf(key,sizeof(key),"key%i",i);
+		lf=linphone_core_create_friend_with_address(marie->lc,uri);
+		linphone_friend_enable_subscribes(lf,FALSE);
+		linphone_friend_set_ref_key(lf,key);
+		linphone_core_add_friend(marie->lc,lf);
+	}
+	for (i=0;i<nb_friends;i++){
+		snprintf(uri,sizeof(uri),"sip:friend%i@sip.example.org",i);
+		snprintf(key,sizeof(key),"key%i",i);
+		lf=linphone_core_get_friend_by_address(marie->lc,uri);
+		CU_ASSERT_PTR_NOT_NULL(lf);
+		CU_ASSERT_PTR_EQUAL(linphone_core_get_friend_by_ref_key(marie->lc,key),lf);
+	}
+	/*display name and uri parameters are not part of the lookup*/
+	lf=linphone_core_get_friend_by_address(marie->lc,"\"Friend 3\" <sip:friend3@sip.example.org;transport=tcp>");
+	CU_ASSERT_PTR_EQUAL(lf,linphone_core_get_friend_by_ref_key(marie->lc,"key3"));
+	CU_ASSERT_PTR_NULL(linphone_core_get_friend_by_address(marie->lc,"sip:friend3@sip.example.org:5070"));
+	CU_ASSERT_PTR_NULL(linphone_core_get_friend_by_address(marie->lc,"sip:unknown@sip.example.org"));
+
+	/*a friend whose address is edited must be found under its new address only*/
+	lf=linphone_core_get_friend_by_ref_key(marie->lc,"key5");
+	addr=linphone_address_new("sip:renamed@sip.example.org");
+	linphone_friend_edit(lf);
+	linphone_friend_set_address(lf,addr);
+	linphone_friend_done(lf);
+	linphone_address_unref(addr);
+	CU_ASSERT_PTR_EQUAL(linphone_core_get_friend_by_address(marie->lc,"sip:renamed@sip.example.org"),lf);
+	CU_ASSERT_PTR_NULL(linphone_core_get_friend_by_address(marie->lc,"sip:friend5@sip.example.org"));
+
+	linphone_friend_set_ref_key(lf,"renamed");
+	CU_ASSERT_PTR_EQUAL(linphone_core_get_friend_by_ref_key(marie->lc,"renamed"),lf);
+	CU_ASSERT_PTR_NULL(linphone_core_get_friend_by_ref_key(marie->lc,"key5"));
+
+	/*duplicated addresses: the first friend wins, the second one takes over when the first is removed*/
+	lf=linphone_core_create_friend_with_address(marie->lc,"sip:friend7@sip.example.org");
+	linphone_friend_enable_subscribes(lf,FALSE);
+	linphone_core_add_friend(marie->lc,lf);
+	CU_ASSERT_PTR_EQUAL(linphone_core_get_friend_by_address(marie->lc,"sip:friend7@sip.example.org"),linphone_core_get_friend_by_ref_key(marie->lc,"key7"));
+	linphone_core_remove_friend(marie->lc,linphone_core_get_friend_by_ref_key(marie->lc,"key7"));
+	CU_ASSERT_PTR_EQUAL(linphone_core_get_friend_by_address(marie->lc,"sip:friend7@sip.example.org"),lf);
+	CU_ASSERT_PTR_NULL(linphone_core_get_friend_by_ref_key(marie->lc,"key7"));
+
+	CU_ASSERT_EQUAL(ms_list_size(linphone_core_get_friend_list(marie->lc)),nb_friends);
+	linphone_core_manager_destroy(marie);
+}
+
+static void presence_notify_body_cache(void) {
+	LinphoneCoreManager* marie = linphone_core_manager_new2( "empty_rc", FALSE);
+	LinphonePresenceModel *model=linphone_presence_model_new_with_activity(LinphonePresenceActivityBusy,"In a meeting");
+	LinphonePresenceModel *other=linphone_presence_model_new_with_activity(LinphonePresenceActivityAway,NULL);
+	char *body1;
+	char *body2;
+	char *cached;
+
+	linphone_core_notify_all_friends(marie->lc,model);
+	body1=linphone_core_presence_model_to_xml(marie->lc,model,"sip:marie@sip.example.org");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(body1);
+	cached=marie->lc->presence_notify_xml;
+	CU_ASSERT_PTR_NOT_NULL(cached);
+	/*the contact is escaped like the rest of the document*/
+	body2=linphone_core_presence_model_to_xml(marie->lc,model,"sip:pauline@sip.example.org;a=1&b=2");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(body2);
+	CU_ASSERT_PTR_EQUAL(marie->lc->presence_notify_xml,cached);
+	CU_ASSERT_PTR_NOT_NULL(strstr(body1,"entity=\"sip:marie@sip.example.org\""));
+	CU_ASSERT_PTR_NOT_NULL(strstr(body1,">sip:marie@sip.example.org</contact>"));
+	CU_ASSERT_PTR_NOT_NULL(strstr(body2,"entity=\"sip:pauline@sip.example.org;a=1&amp;b=2\""));
+	CU_ASSERT_PTR_NOT_NULL(strstr(body2,"In a meeting"));
+	CU_ASSERT_PTR_NULL(strstr(body2,"marie"));
+	CU_ASSERT_PTR_NULL(strstr(body2,"@@"));
+	ms_free(body1);
+	ms_free(body2);
+
+	/*another model is rendered without touching the cache*/
+	body1=linphone_core_presence_model_to_xml(marie->lc,other,"sip:marie@sip.example.org");
+	CU_ASSERT_PTR_NOT_NULL(strstr(body1,"away"));
+	CU_ASSERT_PTR_EQUAL(marie->lc->presence_notify_xml,cached);
+	ms_free(body1);
+
+	/*a new presence invalidates the cache*/
+	linphone_core_notify_all_friends(marie->lc,other);
+	CU_ASSERT_PTR_NULL(marie->lc->presence_notify_xml);
+	CU_ASSERT_PTR_EQUAL(marie->lc->presence_notify_model,other);
+	body1=linphone_core_presence_model_to_xml(marie->lc,other,"sip:marie@sip.example.org");
+	CU_ASSERT_PTR_NOT_NULL(strstr(body1,"away"));
+	CU_ASSERT_PTR_NULL(strstr(body1,"In a meeting"));
+	ms_free(body1);
+
+	/*changing the notified model in place is seen by the next subscribers, whichever element is changed*/
+	linphone_presence_model_add_note(other,"Back soon",NULL);
+	body1=linphone_core_presence_model_to_xml(marie->lc,other,"sip:marie@sip.example.org");
+	CU_ASSERT_PTR_NOT_NULL(strstr(body1,"Back soon"));
+	ms_free(body1);
+	linphone_presence_activity_set_description(linphone_presence_model_get_activity(other),"Lunch break");
+	body1=linphone_core_presence_model_to_xml(marie->lc,other,"sip:marie@sip.example.org");
+	CU_ASSERT_PTR_NOT_NULL(strstr(body1,"Lunch break"));
+	ms_free(body1);
+	cached=marie->lc->presence_notify_xml;
+	body1=linphone_core_presence_model_to_xml(marie->lc,other,"sip:marie@sip.example.org");
+	CU_ASSERT_PTR_EQUAL(marie->lc->presence_notify_xml,cached);
+	ms_free(body1);
+
+	linphone_presence_model_unref(model);
+	linphone_presence_model_unref(other);
+	linphone_core_manager_destroy(marie);
+}
+
+/*real world PIDF/RPID documents: the last one is the RFC 4480 example*/
+static const char *pidf_corpus[] = {
+	"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	"<presence xmlns=\"urn:ietf:params:xml:ns:pidf\" xmlns:dm=\"urn:ietf:params:xml:ns:pidf:data-model\" xmlns:rpid=\"urn:ietf:params:xml:ns:pidf:rpid\" entity=\"sip:bob@example.com\">\n"
+	"<tuple id=\"t1\"><status><basic>open</basic></status><contact priority=\"0.8\">sip:bob@1.2.3.4</contact><note xml:lang=\"en\">Back at 5 &amp; later</note><timestamp>2015-03-01T10:00:00Z</timestamp></tuple>\n"
+	"<dm:person id=\"p1\"><rpid:activities><rpid:note>Meeting</rpid:note><rpid:busy>in a meeting</rpid:busy><rpid:away/></rpid:activities><dm:note xml:lang=\"fr\">bientot</dm:note><timestamp>2015-03-01T10:00:00Z</timestamp></dm:person>\n"
+	"<note>global</note></presence>",
+	"<presence xmlns=\"urn:ietf:params:xml:ns:pidf\" entity=\"pres:alice@example.com\">"
+	"<tuple id=\"a1\"><status><basic>closed</basic></status><contact>sip:alice@10.0.0.1;transport=tcp</contact></tuple>"
+	"<tuple id=\"a2\"><status><basic>open</basic></status><contact>sip:alice@10.0.0.2</contact><note>mobile</note></tuple></presence>",
+	"<presence xmlns='urn:ietf:params:xml:ns:pidf' xmlns:dm='urn:ietf:params:xml:ns:pidf:data-model' xmlns:rpid='urn:ietf:params:xml:ns:pidf:rpid' xmlns:c='urn:ietf:params:xml:ns:pidf:cipid' entity='pres:someone@example.com'>"
+	"<tuple id='bs35r9'><status><basic>open</basic></status><dm:deviceID>urn:x-mac:0003ba4811e3</dm:deviceID><rpid:relationship><rpid:self/></rpid:relationship>"
+	"<rpid:service-class><rpid:electronic/></rpid:service-class><contact priority='0.8'>im:someone@mobilecarrier.net</contact>"
+	"<note xml:lang='en'>Don't Disturb Please!</note><note xml:lang='fr'>Ne derangez pas, s'il vous plait</note><timestamp>2005-10-27T16:49:29Z</timestamp></tuple>"
+	"<dm:person id='p1'><rpid:activities><rpid:appointment/><rpid:busy/></rpid:activities><rpid:mood><rpid:angry/></rpid:mood>"
+	"<rpid:place-type><rpid:other>home</rpid:other></rpid:place-type><dm:timestamp>2005-05-30T22:00:29Z</dm:timestamp></dm:person>"
+	"<dm:device id='pc122'><rpid:user-input idle-threshold='600'>idle</rpid:user-input><dm:deviceID>urn:device:0003ba4811e3</dm:deviceID></dm:device></presence>"
+};
+
+static void check_same_presence_notes(LinphonePresenceNote *n1, LinphonePresenceNote *n2) {
+	CU_ASSERT_STRING_EQUAL(linphone_presence_note_get_content(n1), linphone_presence_note_get_content(n2));
+	if (linphone_presence_note_get_lang(n2) != NULL) {
+		CU_ASSERT_STRING_EQUAL(linphone_presence_note_get_lang(n1), linphone_presence_note_get_lang(n2));
+	} else {
+		CU_ASSERT_PTR_NULL(linphone_presence_note_get_lang(n1));
+	}
+}
+
+static void check_same_presence_strings(char *s1, char *s2) {
+	if (s2 != NULL) {
+		CU_ASSERT_STRING_EQUAL(s1, s2);
+		ms_free(s2);
+	} else {
+		CU_ASSERT_PTR_NULL(s1);
+	}
+	if (s1 != NULL) ms_free(s1);
+}
+
+static void check_same_presence_models(LinphonePresenceModel *m1, LinphonePresenceModel *m2) {
+	unsigned int i, j;
+
+	CU_ASSERT_EQUAL(linphone_presence_model_get_basic_status(m1), linphone_presence_model_get_basic_status(m2));
+	CU_ASSERT_EQUAL_FATAL(linphone_presence_model_get_nb_services(m1), linphone_presence_model_get_nb_services(m2));
+	for (i = 0; i < linphone_presence_model_get_nb_services(m2); i++) {
+		LinphonePresenceService *s1 = linphone_presence_model_get_nth_service(m1, i);
+		LinphonePresenceService *s2 = linphone_presence_model_get_nth_service(m2, i);
+		CU_ASSERT_EQUAL(linphone_presence_service_get_basic_status(s1), linphone_presence_service_get_basic_status(s2));
+		check_same_presence_strings(linphone_presence_service_get_id(s1), linphone_presence_service_get_id(s2));
+		check_same_presence_strings(linphone_presence_service_get_contact(s1), linphone_presence_service_get_contact(s2));
+		CU_ASSERT_EQUAL_FATAL(linphone_presence_service_get_nb_notes(s1), linphone_presence_service_get_nb_notes(s2));
+		for (j = 0; j < linphone_presence_service_get_nb_notes(s2); j++)
+			check_same_presence_notes(linphone_presence_service_get_nth_note(s1, j), linphone_presence_service_get_nth_note(s2, j));
+	}
+	CU_ASSERT_EQUAL_FATAL(linphone_presence_model_get_nb_persons(m1), linphone_presence_model_get_nb_persons(m2));
+	for (i = 0; i < linphone_presence_model_get_nb_persons(m2); i++) {
+		LinphonePresencePerson *p1 = linphone_presence_model_get_nth_person(m1, i);
+		LinphonePresencePerson *p2 = linphone_presence_model_get_nth_person(m2, i);
+		check_same_presence_strings(linphone_presence_person_get_id(p1), linphone_presence_person_get_id(p2));
+		CU_ASSERT_EQUAL_FATAL(linphone_presence_person_get_nb_activities(p1), linphone_presence_person_get_nb_activities(p2));
+		for (j = 0; j < linphone_presence_person_get_nb_activities(p2); j++) {
+			LinphonePresenceActivity *a1 = linphone_presence_person_get_nth_activity(p1, j);
+			LinphonePresenceActivity *a2 = linphone_presence_person_get_nth_activity(p2, j);
+			CU_ASSERT_EQUAL(linphone_presence_activity_get_type(a1), linphone_presence_activity_get_type(a2));
+			if (linphone_presence_activity_get_description(a2) != NULL) {
+				CU_ASSERT_STRING_EQUAL(linphone_presence_activity_get_description(a1), linphone_presence_activity_get_description(a2));
+			} else {
+				CU_ASSERT_PTR_NULL(linphone_presence_activity_get_description(a1));
+			}
+		}
+		CU_ASSERT_EQUAL_FATAL(linphone_presence_person_get_nb_activities_notes(p1), linphone_presence_person_get_nb_activities_notes(p2));
+		for (j = 0; j < linphone_presence_person_get_nb_activities_notes(p2); j++)
+			check_same_presence_notes(linphone_presence_person_get_nth_activities_note(p1, j), linphone_presence_person_get_nth_activities_note(p2, j));
+		CU_ASSERT_EQUAL_FATAL(linphone_presence_person_get_nb_notes(p1), linphone_presence_person_get_nb_notes(p2));
+		for (j = 0; j < linphone_presence_person_get_nb_notes(p2); j++)
+			check_same_presence_notes(linphone_presence_person_get_nth_note(p1, j), linphone_presence_person_get_nth_note(p2, j));
+	}
+}
+
+static void pidf_parser(void) {
+	LinphoneCoreManager* marie = linphone_core_manager_new2( "empty_rc", FALSE);
+	LinphonePresenceModel *model = linphone_presence_model_new_with_activity(LinphonePresenceActivityOnThePhone, "Talking to Pauline");
+	const char *docs[sizeof(pidf_corpus) / sizeof(pidf_corpus[0]) + 1];
+	char *generated;
+	int nb_docs = 0;
+	int iterations = 2000;
+	int i, k;
+	uint64_t begin, sax_elapsed, xpath_elapsed;
+
+	/*the body linphone itself sends is part of the corpus*/
+	generated = linphone_core_presence_model_to_xml(marie->lc, model, "sip:marie@sip.example.org");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(generated);
+	docs[nb_docs++] = generated;
+	for (i = 0; i < (int)(sizeof(pidf_corpus) / sizeof(pidf_corpus[0])); i++)
+		docs[nb_docs++] = pidf_corpus[i];
+
+	for (i = 0; i < nb_docs; i++) {
+		LinphonePresenceModel *m1 = linphone_presence_model_parse_pidf(docs[i], strlen(docs[i]));
+		LinphonePresenceModel *m2 = linphone_presence_model_parse_pidf_xpath(docs[i]);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(m1);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(m2);
+		check_same_presence_models(m1, m2);
+		linphone_presence_model_unref(m1);
+		linphone_presence_model_unref(m2);
+	}
+
+	/*invalid documents are rejected*/
+	CU_ASSERT_PTR_NULL(linphone_presence_model_parse_pidf("<foo/>", 6));
+	CU_ASSERT_PTR_NULL(linphone_presence_model_parse_pidf(pidf_corpus[1], strlen(pidf_corpus[1]) / 2));
+	{
+		const char *bad_basic = "<presence xmlns=\"urn:ietf:params:xml:ns:pidf\"><tuple id=\"x\"><status><basic>maybe</basic></status></tuple></presence>";
+		CU_ASSERT_PTR_NULL(linphone_presence_model_parse_pidf(bad_basic, strlen(bad_basic)));
+	}
+
+	begin = ortp_get_cur_time_ms();
+	for (k = 0; k < iterations; k++) {
+		for (i = 0; i < nb_docs; i++)
+			linphone_presence_model_unref(linphone_presence_model_parse_pidf(docs[i], strlen(docs[i])));
+	}
+	sax_elapsed = ortp_get_cur_time_ms() - begin;
+	begin = ortp_get_cur_time_ms();
+	for (k = 0; k < iterations; k++) {
+		for (i = 0; i < nb_docs; i++)
+			linphone_presence_model_unref(linphone_presence_model_parse_pidf_xpath(docs[i]));
+	}
+	xpath_elapsed = ortp_get_cur_time_ms() - begin;
+	ms_message("Parsed %i PIDF documents in %i ms with the streaming parser and in %i ms with the XPath parser",
+		iterations * nb_docs, (int)sax_elapsed, (int)xpath_elapsed);
+
+	ms_free(generated);
+	linphone_presence_model_unref(model);
+	linphone_core_manager_destroy(marie);
+}
+
+static void paced_subscribes(void) {
+	LinphoneCoreManager* marie = linphone_core_manager_new2( "empty_rc", FALSE);
+	LinphoneFriend *lf;
+	char uri[64];
+	uint64_t start;
+	int i;
+	int nb_friends=20;
+	int rate=10;
+
+	lp_config_set_int(marie->lc->config,"sip","subscribe_rate",rate);
+	lp_config_set_int(marie->lc->config,"sip","subscribe_backoff_ms",2000);
+	lp_config_set_int(marie->lc->config,"sip","subscribe_max_backoff_ms",3000);
+	start=ortp_get_cur_time_ms();
+	for (i=0;i<nb_friends;i++){
+		snprintf(uri,sizeof(uri),"sip:friend%i@127.0.0.1:5999",i);
+		lf=linphone_core_create_friend_with_address(marie->lc,uri);
+		linphone_friend_enable_subscribes(lf,TRUE);
+		linphone_core_add_friend(marie->lc,lf);
+	}
+	/*the first SUBSCRIBE is sent right away, the others are queued until the next one is due*/
+	CU_ASSERT_EQUAL(ms_list_size(marie->lc->subscribe_queue),nb_friends-1);
+	CU_ASSERT_TRUE(marie->lc->next_subscribe_time>=start+1000/rate);
+
+	/*a single SUBSCRIBE is sent each time one is due*/
+	for (i=1;i<nb_friends;i++){
+		start=ortp_get_cur_time_ms();
+		marie->lc->next_subscribe_time=0;
+		linphone_core_process_subscribe_queue(marie->lc);
+		CU_ASSERT_EQUAL(ms_list_size(marie->lc->subscribe_queue),nb_friends-1-i);
+		CU_ASSERT_TRUE(marie->lc->next_subscribe_time>=start+1000/rate);
+	}
+	CU_ASSERT_PTR_NULL(marie->lc->subscribe_queue);
+
+	/*a 503 suspends the queue for the time given by Retry-After*/
+	start=ortp_get_cur_time_ms();
+	linphone_core_delay_subscribes(marie->lc,60);
+	CU_ASSERT_TRUE(marie->lc->subscribe_resume_time>=start+60000);
+	CU_ASSERT_EQUAL(marie->lc->subscribe_backoff,0);
+	marie->lc->next_subscribe_time=0;
+	lf=linphone_core_create_friend_with_address(marie->lc,"sip:late@127.0.0.1:5999");
+	linphone_friend_enable_subscribes(lf,TRUE);
+	linphone_core_add_friend(marie->lc,lf);
+	linphone_core_iterate(marie->lc);
+	CU_ASSERT_EQUAL(ms_list_size(marie->lc->subscribe_queue),1);
+	CU_ASSERT_FALSE(lf->subscribe_active);
+
+	/*without Retry-After, the delay is an exponential back-off*/
+	linphone_core_delay_subscribes(marie->lc,0);
+	CU_ASSERT_EQUAL(marie->lc->subscribe_backoff,2000);
+	linphone_core_delay_subscribes(marie->lc,0);
+	CU_ASSERT_EQUAL(marie->lc->subscribe_backoff,3000);
+
+	/*the queue is processed again once the delay is over*/
+	marie->lc->subscribe_resume_time=0;
+	linphone_core_process_subscribe_queue(marie->lc);
+	CU_ASSERT_PTR_NULL(marie->lc->subscribe_queue);
+	CU_ASSERT_TRUE(lf->subscribe_active);
+
+	linphone_core_manager_destroy(marie);
+}
+
+static void presence_list_notification(void) {
+	LinphoneCoreManager* marie = linphone_core_manager_new2( "empty_rc", FALSE);
+	const char *body =
+		"--boundary42\r\n"
+		"Content-Transfer-Encoding: binary\r\n"
+		"Content-ID: <list@sip.example.org>\r\n"
+		"Content-Type: application/rlmi+xml;charset=\"UTF-8\"\r\n"
+		"\r\n"
+		"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		"<list xmlns=\"urn:ietf:params:xml:ns:rlmi\" uri=\"sip:friends@sip.example.org\" version=\"1\" fullState=\"true\">"
+		"<resource uri=\"sip:friend0@sip.example.org\"><instance id=\"i0\" state=\"active\" cid=\"f0@sip.example.org\"/></resource>"
+		"<resource uri=\"sip:friend1@sip.example.org\"><instance id=\"i1\" state=\"active\" cid=\"f1@sip.example.org\"/></resource>"
+		"<resource uri=\"sip:stranger@sip.example.org\"><instance id=\"i2\" state=\"active\" cid=\"s@sip.example.org\"/></resource>"
+		"</list>\r\n"
+		"--boundary42\r\n"
+		"Content-Transfer-Encoding: binary\r\n"
+		"Content-ID: <f0@sip.example.org>\r\n"
+		"Content-Type: application/pidf+xml;charset=\"UTF-8\"\r\n"
+		"\r\n"
+		"<presence xmlns=\"urn:ietf:params:xml:ns:pidf\" entity=\"sip:friend0@sip.example.org\">"
+		"<tuple id=\"t0\"><status><basic>open</basic></status></tuple></presence>\r\n"
+		"--boundary42\r\n"
+		"Content-Transfer-Encoding: binary\r\n"
+		"Content-ID: <f1@sip.example.org>\r\n"
+		"Content-Type: application/pidf+xml;charset=\"UTF-8\"\r\n"
+		"\r\n"
+		"<presence xmlns=\"urn:ietf:params:xml:ns:pidf\" entity=\"sip:friend1@sip.example.org\">"
+		"<tuple id=\"t1\"><status><basic>closed</basic></status></tuple></presence>\r\n"
+		"--boundary42\r\n"
+		"Content-Transfer-Encoding: binary\r\n"
+		"Content-ID: <s@sip.example.org>\r\n"
+		"Content-Type: application/pidf+xml;charset=\"UTF-8\"\r\n"
+		"\r\n"
+		"<presence xmlns=\"urn:ietf:params:xml:ns:pidf\" entity=\"sip:stranger@sip.example.org\">"
+		"<tuple id=\"t2\"><status><basic>open</basic></status></tuple></presence>\r\n"
+		"--boundary42--\r\n";
+	LinphoneFriend *friends[2];
+	SalOp *op;
+	const char *last_part;
+	char *copy;
+	char uri[64];
+	int i;
+
+	for (i=0;i<2;i++){
+		snprintf(uri,sizeof(uri),"sip:friend%i@sip.example.org",i);
+		friends[i]=linphone_core_create_friend_with_address(marie->lc,uri);
+		linphone_friend_enable_subscribes(friends[i],FALSE);
+		linphone_core_add_friend(marie->lc,friends[i]);
+	}
+	/*stands for the subscription to the resource list*/
+	op=sal_op_new(marie->lc->sal);
+	marie->lc->presence_list_op=op;
+
+	/*each PIDF part updates the friend given by its entity, the RLMI part and unknown resources are ignored*/
+	CU_ASSERT_EQUAL(sal_process_presence_list_notification(op,body,strlen(body),"boundary42"),3);
+	CU_ASSERT_EQUAL(marie->stat.number_of_NotifyReceived,2);
+	CU_ASSERT_EQUAL(marie->stat.number_of_LinphonePresenceActivityOnline,1);
+	CU_ASSERT_EQUAL(marie->stat.number_of_LinphonePresenceActivityOffline,1);
+	CU_ASSERT_EQUAL(linphone_presence_model_get_basic_status(linphone_friend_get_presence_model(friends[0])),LinphonePresenceBasicStatusOpen);
+	CU_ASSERT_EQUAL(linphone_presence_model_get_basic_status(linphone_friend_get_presence_model(friends[1])),LinphonePresenceBasicStatusClosed);
+
+	/*a body without any PIDF part changes nothing*/
+	CU_ASSERT_EQUAL(sal_process_presence_list_notification(op,"--boundary42--\r\n",strlen("--boundary42--\r\n"),"boundary42"),0);
+	CU_ASSERT_EQUAL(marie->stat.number_of_NotifyReceived,2);
+
+	/*message bodies are not NUL terminated: only the given length is parsed*/
+	copy=ms_malloc(strlen(body));
+	memcpy(copy,body,strlen(body));
+	CU_ASSERT_EQUAL(sal_process_presence_list_notification(op,copy,strlen(body),"boundary42"),3);
+	/*a part that is not followed by a delimiter within the body is ignored*/
+	last_part=strstr(body,"--boundary42\r\nContent-Transfer-Encoding: binary\r\nContent-ID: <s@");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(last_part);
+	CU_ASSERT_EQUAL(sal_process_presence_list_notification(op,copy,last_part-body+strlen("--boundary42"),"boundary42"),2);
+	ms_free(copy);
+
+	marie->lc->presence_list_op=NULL;
+	sal_op_release(op);
+	linphone_core_manager_destroy(marie);
+}
+
 #if 0
 /* the core no longer changes the presence status when a call is ongoing, this is left to the application*/
 static void call_with_presence(void) {
@@ -406,10 +813,16 @@ static void test_subscribe_notify_publish(void) {
 
 test_t presence_tests[] = {
 	{ "Simple Subscribe", simple_subscribe },
+	{ "Subscribe profiling counters", subscribe_profiling_counters },
 	{ "Simple Publish", simple_publish },
 	{ "Simple Publish with expires", publish_with_expires },
 	/*{ "Call with presence", call_with_presence },*/
 	{ "Unsubscribe while subscribing", unsubscribe_while_subscribing },
+	{ "Friend lookups", friend_lookups },
+	{ "Presence notify body cache", presence_notify_body_cache },
+	{ "Paced subscribes", paced_subscribes },
+	{ "Presence list notification (internal api)", presence_list_notification },
+	{ "PIDF parser", pidf_parser },
 	{ "Presence information", presence_information },
 	{ "App managed presence failure", subscribe_failure_handle_by_app },
 #if USE_PRESENCE_SERVER
@@ -810,6 +810,100 @@ static void redirect(){
 	linphone_core_manager_destroy(lcm);
 }
 
+static void linphone_auth_info_store(){
+	const int nb_auth_infos=5000, nb_lookups=50000;
+	LinphoneCoreManager* marie = linphone_core_manager_new2( "empty_rc", FALSE);
+	LinphoneCore *lc = marie->lc;
+	LpConfig *config = linphone_core_get_config(lc);
+	LinphoneAuthInfo *ai;
+	const LinphoneAuthInfo *found;
+	const char *ha1;
+	char expected_ha1[33];
+	char username[32];
+	char *previous_ha1;
+	uint64_t begin, elapsed;
+	bool_t all_found = TRUE;
+	int i;
+
+	for (i = 0; i < nb_auth_infos; i++) {
+		snprintf(username, sizeof(username), "user%i", i);
+		ai = linphone_auth_info_new(username, NULL, "secret", NULL, "sip.example.org", "sip.example.org");
+		linphone_core_add_auth_info(lc, ai);
+		linphone_auth_info_destroy(ai);
+	}
+	CU_ASSERT_EQUAL(ms_list_size(linphone_core_get_auth_info_list(lc)), nb_auth_infos);
+
+	begin = ortp_get_cur_time_ms();
+	for (i = 0; i < nb_lookups; i++) {
+		snprintf(username, sizeof(username), "user%i", (i * 7) % nb_auth_infos);
+		found = linphone_core_find_auth_info(lc, (i % 2) ? "\"sip.example.org\"" : NULL, username, "sip.example.org");
+		if (found == NULL || strcmp(linphone_auth_info_get_username(found), username) != 0) all_found = FALSE;
+	}
+	elapsed = ortp_get_cur_time_ms() - begin;
+	CU_ASSERT_TRUE(all_found);
+	ms_message("%i auth info lookups among %i in %i ms", nb_lookups, nb_auth_infos, (int)elapsed);
+	CU_ASSERT_PTR_NULL(linphone_core_find_auth_info(lc, "sip.example.org", "nobody", "sip.example.org"));
+
+	/*an updated auth info keeps its config section*/
+	CU_ASSERT_STRING_EQUAL(lp_config_get_string(config, "auth_info_10", "username", ""), "user10");
+	previous_ha1 = ms_strdup(lp_config_get_string(config, "auth_info_10", "ha1", ""));
+	ai = linphone_auth_info_new("user10", NULL, "other secret", NULL, "sip.example.org", "sip.example.org");
+	linphone_core_add_auth_info(lc, ai);
+	linphone_auth_info_destroy(ai);
+	CU_ASSERT_EQUAL(ms_list_size(linphone_core_get_auth_info_list(lc)), nb_auth_infos);
+	CU_ASSERT_STRING_EQUAL(lp_config_get_string(config, "auth_info_10", "username", ""), "user10");
+	CU_ASSERT_STRING_NOT_EQUAL(lp_config_get_string(config, "auth_info_10", "ha1", ""), previous_ha1);
+	CU_ASSERT_TRUE(lp_config_has_section(config, "auth_info_4999"));
+	CU_ASSERT_FALSE(lp_config_has_section(config, "auth_info_5000"));
+	ms_free(previous_ha1);
+
+	/*the following ones move up when one is removed*/
+	found = linphone_core_find_auth_info(lc, "sip.example.org", "user0", "sip.example.org");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(found);
+	linphone_core_remove_auth_info(lc, found);
+	CU_ASSERT_PTR_NULL(linphone_core_find_auth_info(lc, "sip.example.org", "user0", "sip.example.org"));
+	CU_ASSERT_STRING_EQUAL(lp_config_get_string(config, "auth_info_0", "username", ""), "user1");
+	CU_ASSERT_STRING_EQUAL(lp_config_get_string(config, "auth_info_4998", "username", ""), "user4999");
+	CU_ASSERT_FALSE(lp_config_has_section(config, "auth_info_4999"));
+
+	/*the ha1 answering a challenge is computed once per realm*/
+	ai = linphone_auth_info_new("bob", NULL, "secret", NULL, NULL, NULL);
+	ha1 = linphone_auth_info_get_challenge_ha1(ai, "sip.example.org");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(ha1);
+	sal_auth_compute_ha1("bob", "sip.example.org", "secret", expected_ha1);
+	CU_ASSERT_STRING_EQUAL(ha1, expected_ha1);
+	CU_ASSERT_PTR_EQUAL(linphone_auth_info_get_challenge_ha1(ai, "sip.example.org"), ha1);
+	sal_auth_compute_ha1("bob", "other.org", "secret", expected_ha1);
+	CU_ASSERT_STRING_EQUAL(linphone_auth_info_get_challenge_ha1(ai, "other.org"), expected_ha1);
+	/*and computed again when the credentials change*/
+	linphone_auth_info_set_passwd(ai, "other secret");
+	sal_auth_compute_ha1("bob", "other.org", "other secret", expected_ha1);
+	CU_ASSERT_STRING_EQUAL(linphone_auth_info_get_challenge_ha1(ai, "other.org"), expected_ha1);
+	linphone_auth_info_set_userid(ai, "bob_id");
+	sal_auth_compute_ha1("bob_id", "other.org", "other secret", expected_ha1);
+	CU_ASSERT_STRING_EQUAL(linphone_auth_info_get_challenge_ha1(ai, "other.org"), expected_ha1);
+	linphone_auth_info_set_username(ai, "alice");
+	linphone_auth_info_set_userid(ai, NULL);
+	sal_auth_compute_ha1("alice", "other.org", "other secret", expected_ha1);
+	CU_ASSERT_STRING_EQUAL(linphone_auth_info_get_challenge_ha1(ai, "other.org"), expected_ha1);
+	linphone_auth_info_destroy(ai);
+
+	/*the auth infos of the core are still found after their credentials are changed*/
+	ai = (LinphoneAuthInfo*)linphone_core_find_auth_info(lc, "sip.example.org", "user1", "sip.example.org");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(ai);
+	linphone_auth_info_set_username(ai, "renamed");
+	linphone_auth_info_set_realm(ai, "other.org");
+	CU_ASSERT_PTR_NULL(linphone_core_find_auth_info(lc, "sip.example.org", "user1", "sip.example.org"));
+	CU_ASSERT_PTR_EQUAL(linphone_core_find_auth_info(lc, "other.org", "renamed", NULL), ai);
+	linphone_auth_info_set_domain(ai, "other.org");
+	CU_ASSERT_PTR_EQUAL(linphone_core_find_auth_info(lc, NULL, "renamed", "other.org"), ai);
+
+	linphone_core_clear_all_auth_info(lc);
+	CU_ASSERT_PTR_NULL(linphone_core_find_auth_info(lc, NULL, "user2", NULL));
+	CU_ASSERT_FALSE(lp_config_has_section(config, "auth_info_0"));
+	linphone_core_manager_destroy(marie);
+}
+
 test_t register_tests[] = {
 	{ "Simple register", simple_register },
 	{ "Simple register unregister", simple_unregister },
@@ -842,7 +936,8 @@ test_t register_tests[] = {
 	{ "Io recv error with recovery", io_recv_error_retry_immediatly},
 	{ "Io recv error with late recovery", io_recv_error_late_recovery},
 	{ "Io recv error without active registration", io_recv_error_without_active_register},
-	{ "Simple redirect", redirect}
+	{ "Simple redirect", redirect},
+	{ "Auth info store", linphone_auth_info_store }
 };
 
 test_suite_t register_test_suite = {
@@ -164,6 +164,295 @@ static void linphone_lpconfig_from_xml_zerolen_value(){
 
 }
 
+static void linphone_lpconfig_incremental_sync(){
+	char *rc_path = ms_strdup_printf("%s/lpconfig_sync_rc", liblinphone_tester_writable_dir_prefix);
+	LpConfig *conf;
+	LpConfigSyncStats stats;
+	unsigned int bytes;
+	int i;
+
+	remove(rc_path);
+	conf = lp_config_new(rc_path);
+	lp_config_set_string(conf, "sec1", "key", "value");
+	lp_config_set_int(conf, "sec2", "key", 1);
+	CU_ASSERT_EQUAL(lp_config_sync(conf), 0);
+	lp_config_get_sync_stats(conf, &stats);
+	CU_ASSERT_EQUAL(stats.write_count, 1);
+	CU_ASSERT_EQUAL(stats.bytes_written, stats.last_write_size);
+	bytes = stats.last_write_size;
+	CU_ASSERT_TRUE(bytes > 0);
+
+	/*setting the same values or removing missing ones does not modify the config*/
+	lp_config_set_string(conf, "sec1", "key", "value");
+	lp_config_set_int(conf, "sec2", "key", 1);
+	lp_config_set_string(conf, "sec1", "missing", NULL);
+	lp_config_clean_section(conf, "missing");
+	CU_ASSERT_FALSE(lp_config_needs_commit(conf));
+
+	/*changing a value and setting it back does not write the file*/
+	lp_config_set_int(conf, "sec2", "key", 2);
+	lp_config_set_int(conf, "sec2", "key", 1);
+	CU_ASSERT_TRUE(lp_config_needs_commit(conf));
+	CU_ASSERT_EQUAL(lp_config_sync(conf), 0);
+	lp_config_get_sync_stats(conf, &stats);
+	CU_ASSERT_EQUAL(stats.write_count, 1);
+
+	/*consecutive syncs are coalesced by the background writer. The delay is long enough for the writer to never
+	 write while the loop runs: the only write is the one flushing the pending content when the writer is disabled.*/
+	lp_config_enable_background_sync(conf, TRUE, 60000);
+	for (i = 0; i < 20; i++) {
+		lp_config_set_int(conf, "sec2", "key", i + 10);
+		lp_config_sync(conf);
+	}
+	lp_config_get_sync_stats(conf, &stats);
+	CU_ASSERT_EQUAL(stats.write_count, 1);
+	CU_ASSERT_EQUAL(stats.coalesced_count, 19);
+	lp_config_enable_background_sync(conf, FALSE, 0);
+	lp_config_get_sync_stats(conf, &stats);
+	CU_ASSERT_EQUAL(stats.write_count, 2);
+	CU_ASSERT_EQUAL(stats.coalesced_count, 19);
+	CU_ASSERT_EQUAL(stats.bytes_written, bytes + stats.last_write_size);
+	lp_config_destroy(conf);
+
+	conf = lp_config_new(rc_path);
+	CU_ASSERT_STRING_EQUAL(lp_config_get_string(conf, "sec1", "key", ""), "value");
+	CU_ASSERT_EQUAL(lp_config_get_int(conf, "sec2", "key", 0), 29);
+	/*the file is not written again when nothing changed since it was loaded*/
+	CU_ASSERT_EQUAL(lp_config_sync(conf), 0);
+	lp_config_get_sync_stats(conf, &stats);
+	CU_ASSERT_EQUAL(stats.write_count, 0);
+	lp_config_destroy(conf);
+	remove(rc_path);
+	ms_free(rc_path);
+}
+
+static void append_name(const char *name, void *ctx){
+	char *names = (char*)ctx;
+	strcat(names, name);
+	strcat(names, ",");
+}
+
+static void linphone_lpconfig_lookup_performance(){
+	const int nb_sections=50, nb_keys=100, nb_lookups=500000;
+	LpConfig *conf = lp_config_new(NULL);
+	char **sections = ms_new0(char*, nb_sections);
+	char **keys = ms_new0(char*, nb_keys);
+	char names[64] = {0};
+	uint64_t begin, elapsed;
+	bool_t all_found = TRUE;
+	int i, j;
+
+	for (i = 0; i < nb_sections; i++) sections[i] = ms_strdup_printf("section_%i", i);
+	for (j = 0; j < nb_keys; j++) keys[j] = ms_strdup_printf("key_%i", j);
+	for (i = 0; i < nb_sections; i++) {
+		for (j = 0; j < nb_keys; j++) lp_config_set_int(conf, sections[i], keys[j], i * nb_keys + j);
+	}
+
+	begin = ortp_get_cur_time_ms();
+	for (i = 0; i < nb_lookups; i++) {
+		if (lp_config_get_string(conf, sections[i % nb_sections], keys[(i / nb_sections) % nb_keys], NULL) == NULL) all_found = FALSE;
+	}
+	elapsed = ortp_get_cur_time_ms() - begin;
+	CU_ASSERT_TRUE(all_found);
+	ms_message("%i lp_config_get_string() in a config of %i entries in %i ms", nb_lookups, nb_sections * nb_keys, (int)elapsed);
+
+	begin = ortp_get_cur_time_ms();
+	for (i = 0; i < nb_lookups; i++) {
+		int sec = i % nb_sections, key = (i / nb_sections) % nb_keys;
+		if (lp_config_get_int(conf, sections[sec], keys[key], -1) != sec * nb_keys + key) all_found = FALSE;
+	}
+	elapsed = ortp_get_cur_time_ms() - begin;
+	CU_ASSERT_TRUE(all_found);
+	ms_message("%i lp_config_get_int() in a config of %i entries in %i ms", nb_lookups, nb_sections * nb_keys, (int)elapsed);
+	CU_ASSERT_EQUAL(lp_config_get_int(conf, "section_1", "missing", -1), -1);
+	CU_ASSERT_EQUAL(lp_config_get_int(conf, "missing", "key_1", -1), -1);
+
+	lp_config_destroy(conf);
+
+	/*sections and entries remain in file order, removed ones are appended when added again*/
+	conf = lp_config_new_from_buffer("[b]\nz=1\na=2\nm=3\n[a]\ny=4\n");
+	lp_config_set_int(conf, "b", "z", 5);
+	lp_config_set_string(conf, "b", "a", NULL);
+	lp_config_set_int(conf, "b", "a", 6);
+	lp_config_for_each_entry(conf, "b", append_name, names);
+	CU_ASSERT_STRING_EQUAL(names, "z,m,a,");
+	lp_config_clean_section(conf, "b");
+	CU_ASSERT_EQUAL(lp_config_get_int(conf, "b", "z", 0), 0);
+	lp_config_set_int(conf, "b", "z", 7);
+	CU_ASSERT_EQUAL(lp_config_get_int(conf, "b", "z", 0), 7);
+	names[0] = '\0';
+	lp_config_for_each_section(conf, append_name, names);
+	CU_ASSERT_STRING_EQUAL(names, "a,b,");
+	lp_config_destroy(conf);
+
+	for (i = 0; i < nb_sections; i++) ms_free(sections[i]);
+	for (j = 0; j < nb_keys; j++) ms_free(keys[j]);
+	ms_free(sections);
+	ms_free(keys);
+}
+
+static void linphone_dial_plan_lookups(){
+	CU_ASSERT_EQUAL(linphone_dial_plan_lookup_ccc_from_iso("FR"), 33);
+	CU_ASSERT_EQUAL(linphone_dial_plan_lookup_ccc_from_iso("US"), 1);
+	CU_ASSERT_EQUAL(linphone_dial_plan_lookup_ccc_from_iso("ZW"), 263);
+	CU_ASSERT_EQUAL(linphone_dial_plan_lookup_ccc_from_iso("XX"), -1);
+	CU_ASSERT_EQUAL(linphone_dial_plan_lookup_ccc_from_iso("FRA"), -1);
+	CU_ASSERT_EQUAL(linphone_dial_plan_lookup_ccc_from_e164("+33952650121"), 33);
+	CU_ASSERT_EQUAL(linphone_dial_plan_lookup_ccc_from_e164("+14155551234"), 1);
+	CU_ASSERT_EQUAL(linphone_dial_plan_lookup_ccc_from_e164("+35512345678"), 355);
+	/*country calling codes shared by several countries or prefix of another one*/
+	CU_ASSERT_EQUAL(linphone_dial_plan_lookup_ccc_from_e164("+79161234567"), 7);
+	CU_ASSERT_EQUAL(linphone_dial_plan_lookup_ccc_from_e164("+66812345678"), 66);
+	CU_ASSERT_EQUAL(linphone_dial_plan_lookup_ccc_from_e164("+999123"), -1);
+}
+
+static void linphone_proxy_config_normalize_numbers_test(){
+	const int nb_contacts=50000;
+	const size_t result_len=64;
+	LinphoneProxyConfig *cfg = linphone_proxy_config_new();
+	const char **numbers = ms_new0(const char*, nb_contacts);
+	char *results = ms_new0(char, nb_contacts * result_len);
+	char normalized[64];
+	uint64_t begin, elapsed;
+	bool_t all_equal = TRUE;
+	int i;
+
+	linphone_proxy_config_set_dial_prefix(cfg, "33");
+	linphone_proxy_config_normalize_number(cfg, "06.12.34.56.78", normalized, sizeof(normalized));
+	CU_ASSERT_STRING_EQUAL(normalized, "+33612345678");
+	linphone_proxy_config_normalize_number(cfg, "+33 (0)6 12 34 56 78", normalized, sizeof(normalized));
+	CU_ASSERT_STRING_EQUAL(normalized, "+330612345678");
+	linphone_proxy_config_normalize_number(cfg, "toto", normalized, sizeof(normalized));
+	CU_ASSERT_STRING_EQUAL(normalized, "toto");
+	linphone_proxy_config_set_dial_escape_plus(cfg, TRUE);
+	linphone_proxy_config_normalize_number(cfg, "+1 (415) 555-1234", normalized, sizeof(normalized));
+	CU_ASSERT_STRING_EQUAL(normalized, "0014155551234");
+	linphone_proxy_config_normalize_number(cfg, "06 12 34 56 78", normalized, 6);
+	CU_ASSERT_STRING_EQUAL(normalized, "00336");
+
+	/*an address book as imported by contact sync*/
+	for (i = 0; i < nb_contacts; i++) {
+		switch (i % 4) {
+			case 0: numbers[i] = ms_strdup_printf("06 %02i %02i %02i %02i", i % 100, (i / 100) % 100, i % 97, i % 89); break;
+			case 1: numbers[i] = ms_strdup_printf("+33 (0)1.%02i.%02i.%02i.%02i", i % 100, (i / 100) % 100, i % 97, i % 89); break;
+			case 2: numbers[i] = ms_strdup_printf("+1 (415) 555-%04i", i % 10000); break;
+			default: numbers[i] = ms_strdup_printf("sip:contact%i@sip.example.org", i); break;
+		}
+	}
+
+	begin = ortp_get_cur_time_ms();
+	CU_ASSERT_EQUAL(linphone_proxy_config_normalize_numbers(cfg, numbers, nb_contacts, results, result_len), nb_contacts);
+	elapsed = ortp_get_cur_time_ms() - begin;
+	ms_message("%i phone numbers normalized in %i ms", nb_contacts, (int)elapsed);
+
+	for (i = 0; i < nb_contacts; i++) {
+		linphone_proxy_config_normalize_number(cfg, numbers[i], normalized, sizeof(normalized));
+		if (strcmp(normalized, results + i * result_len) != 0) all_equal = FALSE;
+	}
+	CU_ASSERT_TRUE(all_equal);
+	CU_ASSERT_STRING_EQUAL(results + 2 * result_len, "0014155550002");
+	CU_ASSERT_STRING_EQUAL(results + 3 * result_len, "sip:contact3@sip.example.org");
+
+	for (i = 0; i < nb_contacts; i++) ms_free((char*)numbers[i]);
+	ms_free(numbers);
+	ms_free(results);
+	linphone_proxy_config_destroy(cfg);
+}
+
+static void timer_fired(void *data){
+	(*(int*)data)++;
+}
+
+static void linphone_timer_wheel_test(){
+	LinphoneTimerWheel *w = linphone_timer_wheel_new(1000);
+	LinphoneTimer timers[3];
+	int fired[3] = {0};
+	uint64_t expire;
+	int i;
+
+	for (i = 0; i < 3; i++) linphone_timer_init(&timers[i], timer_fired, &fired[i]);
+	linphone_timer_wheel_schedule(w, &timers[0], 4000);
+	linphone_timer_wheel_schedule(w, &timers[1], 1100);
+	/*more than one revolution of the wheel away*/
+	linphone_timer_wheel_schedule(w, &timers[2], 61000);
+	CU_ASSERT_TRUE(linphone_timer_wheel_get_next_expiry(w, &expire));
+	CU_ASSERT_EQUAL(expire, 1100);
+
+	CU_ASSERT_EQUAL(linphone_timer_wheel_run(w, 1099), 0);
+	CU_ASSERT_EQUAL(linphone_timer_wheel_run(w, 1100), 1);
+	CU_ASSERT_EQUAL(fired[1], 1);
+	CU_ASSERT_FALSE(linphone_timer_is_scheduled(&timers[1]));
+
+	linphone_timer_cancel(&timers[0]);
+	CU_ASSERT_EQUAL(linphone_timer_wheel_size(w), 1);
+	CU_ASSERT_TRUE(linphone_timer_wheel_get_next_expiry(w, &expire));
+	CU_ASSERT_EQUAL(expire, 61000);
+	CU_ASSERT_EQUAL(linphone_timer_wheel_run(w, 60999), 0);
+	CU_ASSERT_EQUAL(linphone_timer_wheel_run(w, 61000), 1);
+	CU_ASSERT_EQUAL(fired[0], 0);
+	CU_ASSERT_EQUAL(fired[2], 1);
+	CU_ASSERT_FALSE(linphone_timer_wheel_get_next_expiry(w, &expire));
+
+	/*a timer scheduled in the past fires at the next run*/
+	linphone_timer_wheel_schedule(w, &timers[0], 500);
+	CU_ASSERT_EQUAL(linphone_timer_wheel_run(w, 61001), 1);
+	CU_ASSERT_EQUAL(fired[0], 1);
+
+	linphone_timer_wheel_schedule(w, &timers[0], 70000);
+	linphone_timer_wheel_destroy(w);
+	CU_ASSERT_FALSE(linphone_timer_is_scheduled(&timers[0]));
+}
+
+static void *wakeup_core_later(void *data) {
+	ms_usleep(100000);
+	linphone_core_wakeup((LinphoneCore *)data);
+	return NULL;
+}
+
+static void linphone_core_wait_test(){
+	LinphoneCoreManager* marie = linphone_core_manager_new2( "empty_rc", FALSE);
+	LinphoneCore *lc = marie->lc;
+	ms_thread_t thread;
+	uint64_t begin, elapsed;
+	int i;
+
+	for (i = 0; i < 10; i++) linphone_core_iterate(lc);
+	linphone_core_set_network_reachable(lc, FALSE);
+	linphone_core_iterate(lc);
+	/*an idle core has nothing to do until its config is written*/
+	lp_config_sync(linphone_core_get_config(lc));
+	CU_ASSERT_EQUAL(linphone_core_get_iterate_timeout(lc), -1);
+
+	/*the bounds are loose, so that a loaded machine does not fail them*/
+	begin = ortp_get_cur_time_ms();
+	linphone_core_wait(lc, 300);
+	elapsed = ortp_get_cur_time_ms() - begin;
+	ms_message("Idle core waited %i ms", (int)elapsed);
+	CU_ASSERT_TRUE(elapsed < 3000);
+
+	/*a wakeup posted before the wait ends it*/
+	linphone_core_wakeup(lc);
+	begin = ortp_get_cur_time_ms();
+	linphone_core_wait(lc, 5000);
+	elapsed = ortp_get_cur_time_ms() - begin;
+	ms_message("Woken up core waited %i ms", (int)elapsed);
+	CU_ASSERT_TRUE(elapsed < 4000);
+
+	/*so does a wakeup from another thread during the wait*/
+	ms_thread_create(&thread, NULL, wakeup_core_later, lc);
+	begin = ortp_get_cur_time_ms();
+	linphone_core_wait(lc, 5000);
+	elapsed = ortp_get_cur_time_ms() - begin;
+	ms_thread_join(thread, NULL);
+	ms_message("Core woken up from another thread waited %i ms", (int)elapsed);
+	CU_ASSERT_TRUE(elapsed < 4000);
+
+	linphone_core_enable_video_preview(lc, TRUE);
+	CU_ASSERT(linphone_core_get_iterate_timeout(lc) >= 0 && linphone_core_get_iterate_timeout(lc) <= 20);
+	linphone_core_enable_video_preview(lc, FALSE);
+	linphone_core_manager_destroy(marie);
+}
+
 void linphone_proxy_config_address_equal_test() {
 	LinphoneAddress *a = linphone_address_new("sip:toto@titi");
 	LinphoneAddress *b = linphone_address_new("sips:toto@titi");
@@ -226,6 +515,50 @@ void linphone_proxy_config_is_server_config_changed_test() {
 	linphone_proxy_config_destroy(proxy_config);
 }
 
+static void linphone_core_profiling_test(void) {
+	LinphoneCoreManager* mgr = linphone_core_manager_new2("empty_rc", FALSE);
+	LinphoneProfilingHistogram h;
+	unsigned int bucket_sum;
+	int i, j;
+	int iterations = 50;
+
+	CU_ASSERT_FALSE(linphone_core_profiling_enabled(mgr->lc));
+	for (i = 0; i < 5; i++) linphone_core_iterate(mgr->lc);
+	linphone_core_get_profiling_histogram(mgr->lc, LinphoneProfilingIterate, &h);
+	CU_ASSERT_EQUAL(h.count, 0);
+
+	linphone_core_enable_profiling(mgr->lc, TRUE);
+	CU_ASSERT_TRUE(linphone_core_profiling_enabled(mgr->lc));
+	for (i = 0; i < iterations; i++) linphone_core_iterate(mgr->lc);
+	for (i = 0; i < LinphoneProfilingSectionCount; i++) {
+		linphone_core_get_profiling_histogram(mgr->lc, (LinphoneProfilingSection)i, &h);
+		bucket_sum = 0;
+		for (j = 0; j < LINPHONE_PROFILING_HISTOGRAM_SIZE; j++) bucket_sum += h.buckets[j];
+		CU_ASSERT_EQUAL(bucket_sum, h.count);
+		CU_ASSERT_TRUE(h.total >= h.max);
+		CU_ASSERT_STRING_NOT_EQUAL(linphone_profiling_section_to_string((LinphoneProfilingSection)i), "Unknown");
+	}
+	linphone_core_get_profiling_histogram(mgr->lc, LinphoneProfilingIterate, &h);
+	CU_ASSERT_EQUAL(h.count, iterations);
+	linphone_core_get_profiling_histogram(mgr->lc, LinphoneProfilingSalIterate, &h);
+	CU_ASSERT_EQUAL(h.count, iterations);
+	linphone_core_get_profiling_histogram(mgr->lc, LinphoneProfilingTimers, &h);
+	CU_ASSERT_EQUAL(h.count, iterations);
+
+	linphone_core_reset_profiling(mgr->lc);
+	linphone_core_get_profiling_histogram(mgr->lc, LinphoneProfilingIterate, &h);
+	CU_ASSERT_EQUAL(h.count, 0);
+	for (i = 0; i < LinphoneProfilingCounterCount; i++) {
+		CU_ASSERT_EQUAL(linphone_core_get_profiling_counter(mgr->lc, (LinphoneProfilingCounter)i), 0);
+	}
+
+	linphone_core_enable_profiling(mgr->lc, FALSE);
+	linphone_core_iterate(mgr->lc);
+	linphone_core_get_profiling_histogram(mgr->lc, LinphoneProfilingIterate, &h);
+	CU_ASSERT_EQUAL(h.count, 0);
+	linphone_core_manager_destroy(mgr);
+}
+
 static void chat_root_test(void) {
 	LinphoneCoreVTable v_table;
 	LinphoneCore* lc;
@@ -248,6 +581,13 @@ test_t setup_tests[] = {
 	{ "LPConfig zero_len value from buffer", linphone_lpconfig_from_buffer_zerolen_value },
 	{ "LPConfig zero_len value from file", linphone_lpconfig_from_file_zerolen_value },
 	{ "LPConfig zero_len value from XML", linphone_lpconfig_from_xml_zerolen_value },
+	{ "LPConfig incremental sync", linphone_lpconfig_incremental_sync },
+	{ "LPConfig lookup performance", linphone_lpconfig_lookup_performance },
+	{ "Dial plan lookups", linphone_dial_plan_lookups },
+	{ "Phone numbers batch normalization", linphone_proxy_config_normalize_numbers_test },
+	{ "Timer wheel", linphone_timer_wheel_test },
+	{ "Core wait", linphone_core_wait_test },
+	{ "Profiling", linphone_core_profiling_test },
 	{ "Chat room", chat_root_test }
 };
 
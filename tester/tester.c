@@ -224,6 +224,7 @@ LinphoneCoreManager* linphone_core_manager_new2(const char* rc_file, int check_f
 	mgr->v_table.publish_state_changed=linphone_publish_state_changed;
 	mgr->v_table.configuring_status=linphone_configuration_status;
 	mgr->v_table.call_encryption_changed=linphone_call_encryption_changed;
+	mgr->v_table.call_stats_updated=linphone_call_stats_updated;
 	mgr->v_table.network_reachable=network_reachable;
 
 	reset_counters(&mgr->stat);
@@ -390,6 +391,7 @@ void liblinphone_tester_init(void) {
 	add_test_suite(&log_collection_test_suite);
 	add_test_suite(&transport_test_suite);
 	add_test_suite(&player_test_suite);
+	add_test_suite(&offeranswer_test_suite);
 }
 
 void liblinphone_tester_uninit(void) {
@@ -24,6 +24,7 @@
 #include "linphonecore.h"
 #include "lpconfig.h"
 #include "private.h"
+#include "ortp/port.h"
 #include "liblinphone_tester.h"
 
 /* Retrieve the public IP from a given hostname */
@@ -157,12 +158,239 @@ static void call_with_tunnel_auto_without_sip_with_srtp(void) {
 	call_with_transport_base(LinphoneTunnelModeAuto, FALSE, LinphoneMediaEncryptionSRTP);
 }
 
+static mblk_t *create_fragmented_packet(size_t header_size, size_t payload_size) {
+	mblk_t *header = allocb(header_size, 0);
+	mblk_t *payload = allocb(payload_size, 0);
+	size_t i;
+
+	for (i = 0; i < header_size; i++) *header->b_wptr++ = (uint8_t)i;
+	for (i = 0; i < payload_size; i++) *payload->b_wptr++ = (uint8_t)(i * 7);
+	header->b_cont = payload;
+	return header;
+}
+
+static void tunnel_send_path_test(void) {
+	const int nb_packets = 20000;
+	mblk_t *packet = create_fragmented_packet(12, 1200);
+	mblk_t *single = allocb(160, 0);
+	mblk_t *m;
+	LinphoneSendBuffer buffer = { NULL, 0 };
+	const uint8_t stream_id[2] = { 0, 3 };
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+	ortp_socket_t receiver, sender;
+	const uint8_t *data;
+	uint8_t received[1500];
+	size_t len;
+	uint64_t begin, pullup_elapsed, gather_elapsed;
+	int i;
+
+	/*a message made of a single fragment is sent in place*/
+	single->b_wptr += 160;
+	CU_ASSERT_PTR_EQUAL(linphone_send_buffer_gather(&buffer, single, &len), single->b_rptr);
+	CU_ASSERT_EQUAL(len, 160);
+	CU_ASSERT_PTR_NULL(buffer.data);
+	freemsg(single);
+
+	/*the loopback UDP socket stands in for the tunnel socket, which takes one datagram per write*/
+	receiver = socket(AF_INET, SOCK_DGRAM, 0);
+	sender = socket(AF_INET, SOCK_DGRAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	CU_ASSERT_EQUAL_FATAL(bind(receiver, (struct sockaddr *)&addr, sizeof(addr)), 0);
+	CU_ASSERT_EQUAL_FATAL(getsockname(receiver, (struct sockaddr *)&addr, &addrlen), 0);
+
+	data = linphone_send_buffer_gather(&buffer, packet, &len);
+	CU_ASSERT_EQUAL(len, msgdsize(packet));
+	CU_ASSERT_EQUAL(buffer.size, len);
+	CU_ASSERT_EQUAL((int)sendto(sender, (const char *)data, (int)len, 0, (struct sockaddr *)&addr, addrlen), (int)len);
+	CU_ASSERT_EQUAL((int)recv(receiver, (char *)received, sizeof(received), 0), (int)len);
+	m = dupmsg(packet);
+	msgpullup(m, -1);
+	CU_ASSERT_EQUAL(memcmp(received, m->b_rptr, len), 0);
+	freemsg(m);
+
+	begin = ortp_get_cur_time_ms();
+	for (i = 0; i < nb_packets; i++) {
+		m = dupmsg(packet);
+		msgpullup(m, -1);
+		sendto(sender, (const char *)m->b_rptr, (int)msgdsize(m), 0, (struct sockaddr *)&addr, addrlen);
+		freemsg(m);
+	}
+	pullup_elapsed = ortp_get_cur_time_ms() - begin;
+
+	begin = ortp_get_cur_time_ms();
+	for (i = 0; i < nb_packets; i++) {
+		m = dupmsg(packet);
+		data = linphone_send_buffer_gather(&buffer, m, &len);
+		sendto(sender, (const char *)data, (int)len, 0, (struct sockaddr *)&addr, addrlen);
+		freemsg(m);
+	}
+	gather_elapsed = ortp_get_cur_time_ms() - begin;
+	/*the buffer is reused, never grown again after the first packet*/
+	CU_ASSERT_EQUAL(buffer.size, msgdsize(packet));
+
+	ms_message("%i fragmented video packets of %i bytes: pullup and send in %i ms, gather and send in %i ms",
+		nb_packets, (int)msgdsize(packet), (int)pullup_elapsed, (int)gather_elapsed);
+
+	/*multiplexed tunnel flows prepend their stream id to the gathered fragments*/
+	data = linphone_send_buffer_gather_with_header(&buffer, stream_id, sizeof(stream_id), packet, &len);
+	CU_ASSERT_EQUAL(len, sizeof(stream_id) + msgdsize(packet));
+	CU_ASSERT_EQUAL(memcmp(data, stream_id, sizeof(stream_id)), 0);
+	CU_ASSERT_EQUAL(memcmp(data + sizeof(stream_id), received, len - sizeof(stream_id)), 0);
+
+	close_socket(sender);
+	close_socket(receiver);
+	linphone_send_buffer_uninit(&buffer);
+	CU_ASSERT_PTR_NULL(buffer.data);
+	freemsg(packet);
+}
+
+/*stand-in for the tunnel socket: datagrams to receive are queued beforehand, the last one sent is kept*/
+typedef struct _FakeTunnelSocket {
+	uint8_t inbound[80][16];
+	int inbound_len[80];
+	int nb_inbound;
+	int next_inbound;
+	uint8_t sent[1500];
+	int sent_len;
+	int closed;
+} FakeTunnelSocket;
+
+static void fake_tunnel_socket_push(FakeTunnelSocket *s, uint16_t id, uint8_t value, int len) {
+	s->inbound[s->nb_inbound][0] = (uint8_t)(id >> 8);
+	s->inbound[s->nb_inbound][1] = (uint8_t)(id & 0xff);
+	s->inbound[s->nb_inbound][2] = value;
+	s->inbound_len[s->nb_inbound] = len;
+	s->nb_inbound++;
+}
+
+static int fake_tunnel_socket_sendto(void *socket, const uint8_t *data, size_t len, const struct sockaddr *to, socklen_t tolen) {
+	FakeTunnelSocket *s = (FakeTunnelSocket *)socket;
+	memcpy(s->sent, data, len);
+	s->sent_len = (int)len;
+	return (int)len;
+}
+
+static int fake_tunnel_socket_recvfrom(void *socket, uint8_t *buf, size_t size, struct sockaddr *from, socklen_t fromlen) {
+	FakeTunnelSocket *s = (FakeTunnelSocket *)socket;
+	struct sockaddr_in *addr = (struct sockaddr_in *)from;
+	int len;
+	if (s->next_inbound == s->nb_inbound) return 0;
+	len = s->inbound_len[s->next_inbound];
+	memcpy(buf, s->inbound[s->next_inbound], len);
+	s->next_inbound++;
+	memset(addr, 0, sizeof(*addr));
+	addr->sin_family = AF_INET;
+	addr->sin_port = htons(5004);
+	return len;
+}
+
+static void fake_tunnel_socket_close(void *socket) {
+	((FakeTunnelSocket *)socket)->closed++;
+}
+
+static void tunnel_rtp_multiplexing_test(void) {
+	FakeTunnelSocket *s = ms_new0(FakeTunnelSocket, 1);
+	LinphoneTunnelChannel *channel = linphone_tunnel_channel_new(s, fake_tunnel_socket_sendto, fake_tunnel_socket_recvfrom, fake_tunnel_socket_close);
+	LinphoneSendBuffer buffer = { NULL, 0 };
+	mblk_t *packet = create_fragmented_packet(12, 100);
+	struct sockaddr_in from;
+	uint8_t buf[1500];
+	uint16_t a, b, c;
+	int i;
+
+	a = linphone_tunnel_channel_add_stream(channel);
+	b = linphone_tunnel_channel_add_stream(channel);
+	c = linphone_tunnel_channel_add_stream(channel);
+	CU_ASSERT_EQUAL(a, 1);
+	CU_ASSERT_EQUAL(b, 2);
+	CU_ASSERT_EQUAL(c, 3);
+
+	/*the stream id is prepended to what is sent, but not counted as sent*/
+	CU_ASSERT_EQUAL(linphone_tunnel_channel_sendto(channel, b, &buffer, packet, (struct sockaddr *)&from, sizeof(from)), (int)msgdsize(packet));
+	CU_ASSERT_EQUAL(s->sent_len, LINPHONE_TUNNEL_CHANNEL_HEADER_SIZE + (int)msgdsize(packet));
+	CU_ASSERT_EQUAL(s->sent[0], 0);
+	CU_ASSERT_EQUAL(s->sent[1], 2);
+	CU_ASSERT_EQUAL(s->sent[LINPHONE_TUNNEL_CHANNEL_HEADER_SIZE + 13], 7);
+
+	/*datagrams of the other flows are queued while the socket is read for the first one*/
+	fake_tunnel_socket_push(s, c, 'c', 3);
+	fake_tunnel_socket_push(s, b, 'b', 3);
+	fake_tunnel_socket_push(s, a, 'a', 3);
+	CU_ASSERT_EQUAL(linphone_tunnel_channel_recvfrom(channel, a, buf, sizeof(buf), (struct sockaddr *)&from, sizeof(from)), 1);
+	CU_ASSERT_EQUAL(buf[0], 'a');
+	CU_ASSERT_EQUAL(linphone_tunnel_channel_get_pending_count(channel, b), 1);
+	CU_ASSERT_EQUAL(linphone_tunnel_channel_get_pending_count(channel, c), 1);
+	memset(&from, 0, sizeof(from));
+	CU_ASSERT_EQUAL(linphone_tunnel_channel_recvfrom(channel, b, buf, sizeof(buf), (struct sockaddr *)&from, sizeof(from)), 1);
+	CU_ASSERT_EQUAL(buf[0], 'b');
+	CU_ASSERT_EQUAL(ntohs(from.sin_port), 5004);
+	CU_ASSERT_EQUAL(linphone_tunnel_channel_get_pending_count(channel, b), 0);
+
+	/*datagrams for unknown streams and datagrams too short to carry a stream id are dropped*/
+	fake_tunnel_socket_push(s, 9, 'x', 3);
+	fake_tunnel_socket_push(s, b, 'x', 1);
+	CU_ASSERT_EQUAL(linphone_tunnel_channel_recvfrom(channel, c, buf, sizeof(buf), (struct sockaddr *)&from, sizeof(from)), 1);
+	CU_ASSERT_EQUAL(buf[0], 'c');
+	CU_ASSERT_EQUAL(linphone_tunnel_channel_recvfrom(channel, c, buf, sizeof(buf), (struct sockaddr *)&from, sizeof(from)), 0);
+	CU_ASSERT_EQUAL(s->next_inbound, s->nb_inbound);
+	CU_ASSERT_EQUAL(linphone_tunnel_channel_get_pending_count(channel, a), 0);
+	CU_ASSERT_EQUAL(linphone_tunnel_channel_get_pending_count(channel, b), 0);
+
+	/*a flow that does not read anymore keeps its most recent datagrams only*/
+	for (i = 0; i < LINPHONE_TUNNEL_CHANNEL_MAX_PENDING + 6; i++) fake_tunnel_socket_push(s, c, (uint8_t)i, 3);
+	CU_ASSERT_EQUAL(linphone_tunnel_channel_recvfrom(channel, a, buf, sizeof(buf), (struct sockaddr *)&from, sizeof(from)), 0);
+	CU_ASSERT_EQUAL(linphone_tunnel_channel_get_pending_count(channel, c), LINPHONE_TUNNEL_CHANNEL_MAX_PENDING);
+	CU_ASSERT_EQUAL(linphone_tunnel_channel_recvfrom(channel, c, buf, sizeof(buf), (struct sockaddr *)&from, sizeof(from)), 1);
+	CU_ASSERT_EQUAL(buf[0], 6);
+
+	/*the queue of a closed stream is flushed, and datagrams arriving for it afterwards are dropped*/
+	CU_ASSERT_FALSE(linphone_tunnel_channel_remove_stream(channel, c));
+	s->nb_inbound = s->next_inbound = 0;
+	fake_tunnel_socket_push(s, c, 'c', 3);
+	fake_tunnel_socket_push(s, b, 'b', 3);
+	CU_ASSERT_EQUAL(linphone_tunnel_channel_recvfrom(channel, a, buf, sizeof(buf), (struct sockaddr *)&from, sizeof(from)), 0);
+	CU_ASSERT_EQUAL(linphone_tunnel_channel_get_pending_count(channel, c), 0);
+	CU_ASSERT_EQUAL(linphone_tunnel_channel_get_pending_count(channel, b), 1);
+
+	/*ids of closed streams are not reused while the others are open*/
+	c = linphone_tunnel_channel_add_stream(channel);
+	CU_ASSERT_EQUAL(c, 4);
+
+	/*the socket is closed together with the last stream*/
+	CU_ASSERT_FALSE(linphone_tunnel_channel_remove_stream(channel, a));
+	CU_ASSERT_FALSE(linphone_tunnel_channel_remove_stream(channel, b));
+	CU_ASSERT_EQUAL(s->closed, 0);
+	CU_ASSERT_TRUE(linphone_tunnel_channel_remove_stream(channel, c));
+	CU_ASSERT_EQUAL(s->closed, 1);
+	linphone_tunnel_channel_destroy(channel);
+
+	/*a socket destroyed by its owner is neither used nor closed by the channel*/
+	channel = linphone_tunnel_channel_new(s, fake_tunnel_socket_sendto, fake_tunnel_socket_recvfrom, fake_tunnel_socket_close);
+	a = linphone_tunnel_channel_add_stream(channel);
+	linphone_tunnel_channel_detach_socket(channel);
+	CU_ASSERT_PTR_NULL(linphone_tunnel_channel_get_socket(channel));
+	CU_ASSERT_EQUAL(linphone_tunnel_channel_sendto(channel, a, &buffer, packet, (struct sockaddr *)&from, sizeof(from)), -1);
+	CU_ASSERT_TRUE(linphone_tunnel_channel_remove_stream(channel, a));
+	CU_ASSERT_EQUAL(s->closed, 1);
+	linphone_tunnel_channel_destroy(channel);
+
+	linphone_send_buffer_uninit(&buffer);
+	freemsg(packet);
+	ms_free(s);
+}
+
 test_t transport_tests[] = {
 	{ "Tunnel only", call_with_tunnel },
 	{ "Tunnel with SRTP", call_with_tunnel_srtp },
 	{ "Tunnel without SIP", call_with_tunnel_without_sip },
 	{ "Tunnel in automatic mode", call_with_tunnel_auto },
 	{ "Tunnel in automatic mode with SRTP without SIP", call_with_tunnel_auto_without_sip_with_srtp },
+	{ "Tunnel send path (internal api)", tunnel_send_path_test },
+	{ "Tunnel RTP multiplexing (internal api)", tunnel_rtp_multiplexing_test },
 };
 
 test_suite_t transport_test_suite = {